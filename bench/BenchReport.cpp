@@ -0,0 +1,278 @@
+#include "BenchReport.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+// Just enough JSON for reading reports back: objects, arrays, strings, numbers, literals
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object } type = Type::Null;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* find(const std::string& key) const {
+        for (const auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text(text) {}
+
+    bool parse(JsonValue& value) {
+        return parseValue(value) && (skipSpace(), position == text.size());
+    }
+
+private:
+    void skipSpace() {
+        while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) ++position;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (position < text.size() && text[position] == c) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseString(std::string& out) {
+        if (!consume('"')) return false;
+        while (position < text.size() && text[position] != '"') {
+            char c = text[position++];
+            if (c == '\\' && position < text.size()) {
+                char escaped = text[position++];
+                if (escaped == 'n') c = '\n';
+                else if (escaped == 't') c = '\t';
+                else if (escaped == 'u' && position + 4 <= text.size()) {
+                    c = static_cast<char>(std::strtol(text.substr(position, 4).c_str(), nullptr, 16));
+                    position += 4;
+                } else c = escaped;
+            }
+            out += c;
+        }
+        return position++ < text.size();
+    }
+
+    bool parseValue(JsonValue& value) {
+        skipSpace();
+        if (position >= text.size()) return false;
+        char c = text[position];
+        if (c == '{') {
+            ++position;
+            value.type = JsonValue::Type::Object;
+            if (consume('}')) return true;
+            do {
+                std::pair<std::string, JsonValue> member;
+                skipSpace();
+                if (!parseString(member.first) || !consume(':') || !parseValue(member.second)) return false;
+                value.members.push_back(std::move(member));
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            ++position;
+            value.type = JsonValue::Type::Array;
+            if (consume(']')) return true;
+            do {
+                value.items.emplace_back();
+                if (!parseValue(value.items.back())) return false;
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            value.type = JsonValue::Type::String;
+            return parseString(value.text);
+        }
+        for (const char* literal : {"true", "false", "null"}) {
+            if (text.compare(position, std::strlen(literal), literal) == 0) {
+                position += std::strlen(literal);
+                value.type = literal[0] == 'n' ? JsonValue::Type::Null : JsonValue::Type::Bool;
+                value.number = literal[0] == 't' ? 1.0 : 0.0;
+                return true;
+            }
+        }
+        char* end = nullptr;
+        value.number = std::strtod(text.c_str() + position, &end);
+        if (end == text.c_str() + position) return false;
+        value.type = JsonValue::Type::Number;
+        position = static_cast<size_t>(end - text.c_str());
+        return true;
+    }
+
+    const std::string& text;
+    size_t position = 0;
+};
+
+std::string escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out;
+}
+
+double mean(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+unsigned configValue(const JsonValue& config, const char* key, unsigned fallback) {
+    const JsonValue* value = config.find(key);
+    return value && value->type == JsonValue::Type::Number ? static_cast<unsigned>(value->number) : fallback;
+}
+
+} // namespace
+
+void writeReport(std::ostream& out, const BenchReport& report) {
+    const BenchConfig& config = report.config;
+    out << "{\n  \"benchmark\": \"DroneBench\",\n  \"label\": \"" << escape(config.label) << "\",\n"
+        << "  \"config\": {\"meshes\": " << config.meshes << ", \"triangles\": " << config.triangles
+        << ", \"depth\": " << config.depth << ", \"frames\": " << config.frames << ", \"repeat\": " << config.repeat
+        << ", \"seed\": " << config.seed << ", \"threads\": " << config.threads << ", \"model\": \"" << escape(config.model) << "\"},\n  \"results\": [";
+
+    char number[32];
+    auto field = [&](const char* name, double value) {
+        std::snprintf(number, sizeof(number), "%.6f", value);
+        out << ", \"" << name << "\": " << number;
+    };
+    for (size_t s = 0; s < report.stages.size(); ++s) {
+        const StageResult& stage = report.stages[s];
+        out << (s ? "," : "") << "\n    {\"name\": \"" << escape(stage.name) << "\", \"unit\": \"ms\"";
+        field("mean", mean(stage.samplesMs));
+        field("median", percentile(stage.samplesMs, 0.5));
+        field("p95", percentile(stage.samplesMs, 0.95));
+        field("min", stage.samplesMs.empty() ? 0.0 : *std::min_element(stage.samplesMs.begin(), stage.samplesMs.end()));
+        field("max", stage.samplesMs.empty() ? 0.0 : *std::max_element(stage.samplesMs.begin(), stage.samplesMs.end()));
+        field("checksum", stage.checksum);
+        out << ", \"run_means\": [";
+        for (size_t i = 0; i < stage.runMeansMs.size(); ++i) {
+            std::snprintf(number, sizeof(number), "%.6f", stage.runMeansMs[i]);
+            out << (i ? ", " : "") << number;
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+bool readReport(const std::string& path, BenchReport& report, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    JsonValue root;
+    if (!JsonParser(text).parse(root) || root.type != JsonValue::Type::Object) {
+        error = path + " is not valid JSON";
+        return false;
+    }
+    const JsonValue* results = root.find("results");
+    if (!results || results->type != JsonValue::Type::Array) {
+        error = path + " has no results array";
+        return false;
+    }
+
+    report = BenchReport();
+    if (const JsonValue* label = root.find("label")) report.config.label = label->text;
+    if (const JsonValue* config = root.find("config")) {
+        BenchConfig& c = report.config;
+        c.meshes = configValue(*config, "meshes", c.meshes);
+        c.triangles = configValue(*config, "triangles", c.triangles);
+        c.depth = configValue(*config, "depth", c.depth);
+        c.frames = configValue(*config, "frames", c.frames);
+        c.repeat = configValue(*config, "repeat", c.repeat);
+        c.seed = configValue(*config, "seed", c.seed);
+        c.threads = configValue(*config, "threads", c.threads);
+        if (const JsonValue* model = config->find("model")) c.model = model->text;
+    }
+    for (const JsonValue& item : results->items) {
+        const JsonValue* name = item.find("name");
+        const JsonValue* runs = item.find("run_means");
+        if (!name || !runs) continue;
+        StageResult stage;
+        stage.name = name->text;
+        for (const JsonValue& run : runs->items) stage.runMeansMs.push_back(run.number);
+        stage.samplesMs = stage.runMeansMs;
+        if (const JsonValue* checksum = item.find("checksum")) stage.checksum = checksum->number;
+        report.stages.push_back(std::move(stage));
+    }
+    return true;
+}
+
+std::vector<StageComparison> compareReports(const BenchReport& baseline, const BenchReport& candidate,
+                                            double threshold, double confidence, int resamples) {
+    std::vector<StageComparison> comparisons;
+    std::mt19937 rng(12345);  // Fixed so the same pair of reports always gives the same verdict
+
+    for (const StageResult& base : baseline.stages) {
+        auto match = std::find_if(candidate.stages.begin(), candidate.stages.end(),
+                                  [&base](const StageResult& s) { return s.name == base.name; });
+        if (match == candidate.stages.end() || base.runMeansMs.empty() || match->runMeansMs.empty()) {
+            continue;
+        }
+        const std::vector<double>& a = base.runMeansMs;
+        const std::vector<double>& b = match->runMeansMs;
+
+        StageComparison comparison;
+        comparison.name = base.name;
+        comparison.baselineMs = mean(a);
+        comparison.candidateMs = mean(b);
+        comparison.ratio = comparison.baselineMs > 0.0 ? comparison.candidateMs / comparison.baselineMs : 1.0;
+
+        std::uniform_int_distribution<size_t> pickA(0, a.size() - 1), pickB(0, b.size() - 1);
+        std::vector<double> ratios(resamples);
+        for (double& ratio : ratios) {
+            double sumA = 0.0, sumB = 0.0;
+            for (size_t i = 0; i < a.size(); ++i) sumA += a[pickA(rng)];
+            for (size_t i = 0; i < b.size(); ++i) sumB += b[pickB(rng)];
+            ratio = sumA > 0.0 ? (sumB / b.size()) / (sumA / a.size()) : 1.0;
+        }
+        double tail = (1.0 - confidence) * 0.5;
+        comparison.lower = percentile(ratios, tail);
+        comparison.upper = percentile(ratios, 1.0 - tail);
+        comparison.regression = comparison.lower > 1.0 && comparison.ratio > 1.0 + threshold;
+        comparison.improvement = comparison.upper < 1.0 && comparison.ratio < 1.0 - threshold;
+        comparisons.push_back(comparison);
+    }
+    return comparisons;
+}
+
+void printComparison(std::ostream& out, const std::vector<StageComparison>& comparisons) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-10s %12s %12s %8s %19s  %s\n", "stage", "baseline ms", "candidate ms",
+                  "ratio", "CI", "verdict");
+    out << line;
+    for (const StageComparison& c : comparisons) {
+        const char* verdict = c.regression ? "SLOWER" : (c.improvement ? "faster" : "same");
+        std::snprintf(line, sizeof(line), "%-10s %12.4f %12.4f %8.3f   [%6.3f, %6.3f]  %s\n", c.name.c_str(),
+                      c.baselineMs, c.candidateMs, c.ratio, c.lower, c.upper, verdict);
+        out << line;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// DroneBench results: JSON baselines and the statistics used to compare two of them
+
+struct BenchConfig {
+    unsigned meshes = 256;
+    unsigned triangles = 512;  // Per mesh
+    unsigned depth = 4;        // Node levels below the root
+    unsigned frames = 200;     // Per run
+    unsigned repeat = 5;       // Independent runs; comparisons resample these
+    unsigned seed = 1;
+    unsigned threads = 1;      // Job system threads for culling, traversal and collision; 1 = serial
+    std::string model;         // Imported instead of the synthetic scene when set
+    std::string label;
+};
+
+struct StageResult {
+    std::string name;
+    std::vector<double> samplesMs;   // Every sample of every run
+    std::vector<double> runMeansMs;  // One mean per run
+    double checksum = 0.0;           // Accumulated query results, keeps the work observable
+};
+
+struct BenchReport {
+    BenchConfig config;
+    std::vector<StageResult> stages;
+};
+
+void writeReport(std::ostream& out, const BenchReport& report);
+
+// Reads a report written by writeReport; only run means survive, not the raw samples
+bool readReport(const std::string& path, BenchReport& report, std::string& error);
+
+struct StageComparison {
+    std::string name;
+    double baselineMs = 0.0;
+    double candidateMs = 0.0;
+    double ratio = 1.0;              // Candidate / baseline mean
+    double lower = 1.0, upper = 1.0; // Bootstrap confidence interval of the ratio
+    bool regression = false;
+    bool improvement = false;
+};
+
+// Percentile bootstrap of the mean ratio over the per-run means of each stage. A stage
+// regresses when the interval lies entirely above 1 and the ratio exceeds 1 + threshold.
+std::vector<StageComparison> compareReports(const BenchReport& baseline, const BenchReport& candidate,
+                                            double threshold, double confidence = 0.95, int resamples = 10000);
+
+void printComparison(std::ostream& out, const std::vector<StageComparison>& comparisons);
+
+#endif // BENCH_REPORT_H
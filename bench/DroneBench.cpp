@@ -0,0 +1,1363 @@
+// Headless benchmark of the CPU scene work (load, transforms, culling, traversal, collision,
+// picking) on synthetic scenes or an imported model. Writes a JSON report that can serve as a
+// baseline; --compare reruns with the baseline's settings (or reads a second report) and flags
+// statistically significant slowdowns per stage. Exits with status 2 on a regression.
+// --scaling runs culling, traversal and collision through the job system with 1, 2, 4 ... N
+// threads (default scene: 100k small meshes) and prints the speedup over the serial code.
+// --math times the Float4 matrix product, box transform and frustum culling against their
+// scalar references on --meshes random inputs and checks that both give the same answers.
+// --rotors spins the four rotors of --meshes drones (default 4096) through their mesh
+// transforms and times the per-frame cost per rotor.
+// --flightlog writes a synthetic flight log of --meshes records (default 4M, about 220 MB) at
+// 1 kHz, maps it and times random seeks and sequential playback against a plain binary search.
+// --swarm steps swarms of 1k, 10k ... --meshes drones (default 100k) in formation flight with the
+// scalar integrator, the Float4 one and the Float4 one over the job system, and writes their
+// instance matrices.
+// --quadrotor steps --meshes quadrotors (default 4096) through one second of flight at 1 kHz with
+// the scalar RK4, the Float4 batch and the batch over the job system, and checks hover, free
+// fall and the position controller against their expected outcomes.
+// --broadphase flies a swarm of --meshes drones (default 10k) among random obstacles and finds
+// the drones near each other or near an obstacle every frame, with the spatial hash grid
+// serially and over the job system and by testing every pair, and checks the answers agree.
+// --occupancy voxelizes a ground plane and --meshes box buildings (default 500) into the
+// occupancy octree, times its build and its point, box and ray queries, and checks them
+// against tests of every voxel.
+// Scratch data of each frame lives in a FrameArena; every heap allocation is counted, and a run
+// fails if any frame after the first one allocates.
+//
+//   DroneBench [--meshes N] [--triangles M] [--depth D] [--frames F] [--repeat R] [--seed S]
+//              [--threads T] [--model file] [--label text] [--output file.json]
+//   DroneBench --compare baseline.json [candidate.json] [--threshold 0.05] [--output file.json]
+//   DroneBench --scaling [--threads N] [scene options]
+//   DroneBench --math [--meshes N] [--frames F] [--seed S]
+//   DroneBench --rotors [--meshes N] [--frames F] [--triangles M] [--seed S]
+//   DroneBench --flightlog [--meshes N] [--output log.bin] [--seed S]
+//   DroneBench --swarm [--meshes N] [--frames F] [--threads T] [--seed S]
+//   DroneBench --quadrotor [--meshes N] [--frames F] [--threads T] [--seed S]
+//   DroneBench --broadphase [--meshes N] [--frames F] [--threads T] [--seed S]
+//   DroneBench --occupancy [--meshes N] [--frames F] [--threads T] [--seed S]
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchReport.h"
+#include "FlightLog.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "OccupancyMap.h"
+#include "QuadrotorDynamics.h"
+#include "RotorAnimation.h"
+#include "SceneQueries.h"
+#include "SpatialHash.h"
+#include "SwarmSimulation.h"
+#include "TransformHierarchy.h"
+
+namespace {
+
+// Every operator new in the process, on any thread
+std::atomic<uint64_t> heapAllocations{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct BenchOptions {
+    BenchConfig config;
+    std::string outputPath;
+    std::string baselinePath;
+    std::string candidatePath;
+    double threshold = 0.05;
+    bool configOverridden = false;
+    bool scaling = false;
+    bool math = false;
+    bool rotors = false;
+    bool flightLog = false;
+    bool swarm = false;
+    bool quadrotor = false;
+    bool broadphase = false;
+    bool occupancy = false;
+};
+
+double nowMs() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+aiMesh* makeBlobMesh(const Vec3& center, unsigned triangles, std::mt19937& rng) {
+    std::uniform_real_distribution<float> blob(-0.6f, 0.6f);
+    std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+
+    aiMesh* mesh = new aiMesh();
+    mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    mesh->mNumVertices = triangles * 3;
+    mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+    mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+    mesh->mNumFaces = triangles;
+    mesh->mFaces = new aiFace[triangles];
+    for (unsigned t = 0; t < triangles; ++t) {
+        Vec3 base = center + Vec3(blob(rng), blob(rng), blob(rng));
+        Vec3 corners[3];
+        for (Vec3& corner : corners) {
+            corner = base + Vec3(jitter(rng), jitter(rng), jitter(rng));
+        }
+        Vec3 normal = normalize(cross(corners[1] - corners[0], corners[2] - corners[0]));
+
+        aiFace& face = mesh->mFaces[t];
+        face.mNumIndices = 3;
+        face.mIndices = new unsigned int[3];
+        for (unsigned k = 0; k < 3; ++k) {
+            unsigned index = t * 3 + k;
+            mesh->mVertices[index] = aiVector3D(corners[k].x, corners[k].y, corners[k].z);
+            mesh->mNormals[index] = aiVector3D(normal.x, normal.y, normal.z);
+            face.mIndices[k] = index;
+        }
+    }
+    return mesh;
+}
+
+// Full tree with the given depth; each leaf references one mesh until all are placed
+aiNode* makeNode(unsigned level, unsigned depth, unsigned branching, unsigned& nextMesh, unsigned meshCount) {
+    aiNode* node = new aiNode();
+    if (level == depth) {
+        unsigned count = depth == 0 ? meshCount : (nextMesh < meshCount ? 1u : 0u);
+        node->mNumMeshes = count;
+        node->mMeshes = count ? new unsigned int[count] : nullptr;
+        for (unsigned i = 0; i < count; ++i) {
+            node->mMeshes[i] = nextMesh++;
+        }
+        return node;
+    }
+
+    std::vector<aiNode*> children;
+    for (unsigned i = 0; i < branching && nextMesh < meshCount; ++i) {
+        aiNode* child = makeNode(level + 1, depth, branching, nextMesh, meshCount);
+        child->mParent = node;
+        children.push_back(child);
+    }
+    node->mNumChildren = static_cast<unsigned>(children.size());
+    node->mChildren = children.empty() ? nullptr : new aiNode*[children.size()];
+    std::copy(children.begin(), children.end(), node->mChildren);
+    return node;
+}
+
+// Meshes on a cubic grid, one unit apart, with blobs large enough to overlap their neighbours
+std::unique_ptr<aiScene> makeSyntheticScene(const BenchConfig& config, float& extent) {
+    std::mt19937 rng(config.seed);
+    unsigned side = static_cast<unsigned>(std::ceil(std::cbrt(static_cast<double>(config.meshes))));
+    extent = static_cast<float>(side);
+
+    auto scene = std::make_unique<aiScene>();
+    scene->mNumMeshes = config.meshes;
+    scene->mMeshes = new aiMesh*[config.meshes];
+    for (unsigned i = 0; i < config.meshes; ++i) {
+        Vec3 cell(static_cast<float>(i % side), static_cast<float>((i / side) % side),
+                  static_cast<float>(i / (side * side)));
+        scene->mMeshes[i] = makeBlobMesh(cell - Vec3(extent, extent, extent) * 0.5f, config.triangles, rng);
+    }
+
+    unsigned branching = config.depth == 0
+        ? 1u
+        : std::max(2u, static_cast<unsigned>(std::ceil(std::pow(config.meshes, 1.0 / config.depth))));
+    unsigned nextMesh = 0;
+    scene->mRootNode = makeNode(0, config.depth, branching, nextMesh, config.meshes);
+    return scene;
+}
+
+bool parseArguments(int argc, char** argv, BenchOptions& options) {
+    BenchConfig& config = options.config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--scaling") {
+            options.scaling = true;
+            continue;
+        }
+        if (arg == "--math") {
+            options.math = true;
+            continue;
+        }
+        if (arg == "--rotors") {
+            options.rotors = true;
+            continue;
+        }
+        if (arg == "--flightlog") {
+            options.flightLog = true;
+            continue;
+        }
+        if (arg == "--swarm") {
+            options.swarm = true;
+            continue;
+        }
+        if (arg == "--quadrotor") {
+            options.quadrotor = true;
+            continue;
+        }
+        if (arg == "--broadphase") {
+            options.broadphase = true;
+            continue;
+        }
+        if (arg == "--occupancy") {
+            options.occupancy = true;
+            continue;
+        }
+        if (arg == "--compare") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing baseline for --compare" << std::endl;
+                return false;
+            }
+            options.baselinePath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                options.candidatePath = argv[++i];
+            }
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        bool sceneOption = true;
+        if (arg == "--meshes") config.meshes = std::max(1, std::atoi(value));
+        else if (arg == "--triangles") config.triangles = std::max(1, std::atoi(value));
+        else if (arg == "--depth") config.depth = std::max(0, std::atoi(value));
+        else if (arg == "--frames") config.frames = std::max(1, std::atoi(value));
+        else if (arg == "--repeat") config.repeat = std::max(1, std::atoi(value));
+        else if (arg == "--seed") config.seed = static_cast<unsigned>(std::atoi(value));
+        else if (arg == "--threads") config.threads = static_cast<unsigned>(std::max(0, std::atoi(value)));
+        else if (arg == "--model") config.model = value;
+        else {
+            sceneOption = false;
+            if (arg == "--label") config.label = value;
+            else if (arg == "--output") options.outputPath = value;
+            else if (arg == "--threshold") options.threshold = std::atof(value);
+            else {
+                std::cerr << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        options.configOverridden = options.configOverridden || sceneOption;
+    }
+    return true;
+}
+
+// The synthetic scene or the imported model, whichever the config asks for
+struct LoadedScene {
+    Assimp::Importer importer;
+    std::unique_ptr<aiScene> synthetic;
+    const aiScene* scene = nullptr;
+    float extent = 1.0f;
+};
+
+bool loadScene(const BenchConfig& config, LoadedScene& loaded) {
+    if (config.model.empty()) {
+        loaded.synthetic = makeSyntheticScene(config, loaded.extent);
+        loaded.scene = loaded.synthetic.get();
+        return true;
+    }
+    loaded.scene = loaded.importer.ReadFile(config.model, aiProcess_Triangulate | aiProcess_FlipUVs |
+                                                              aiProcess_JoinIdenticalVertices);
+    if (!loaded.scene || !loaded.scene->mRootNode) {
+        std::cerr << "Failed to load " << config.model << ": " << loaded.importer.GetErrorString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Local bounds of every mesh and the union of their world bounds
+Aabb computeSceneBounds(const aiScene* scene, const TransformHierarchy& transforms, std::vector<Aabb>& localBounds) {
+    Aabb sceneBounds;
+    localBounds.resize(scene->mNumMeshes);
+    for (unsigned i = 0; i < scene->mNumMeshes; ++i) {
+        localBounds[i] = computeMeshBounds(scene->mMeshes[i]);
+        sceneBounds.expand(transformAabb(transforms.meshWorld(i), localBounds[i]));
+    }
+    return sceneBounds;
+}
+
+// Orbiting camera and gently drifting meshes so every frame does fresh work
+Mat4 animateFrame(unsigned frame, unsigned frames, const Mat4& projection, const Vec3& center, float extent,
+                  std::vector<Vec3>& offsets) {
+    float angle = 6.2831853f * frame / frames;
+    Vec3 eye = center + Vec3(std::cos(angle) * extent * 1.2f, extent * 0.4f, std::sin(angle) * extent * 1.2f);
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        offsets[i] = Vec3(0.01f * extent * std::sin(0.05f * frame + i), 0.0f, 0.0f);
+    }
+    return projection * makeLookAt(eye, center, Vec3(0.0f, 1.0f, 0.0f));
+}
+
+// Moves the meshes to their new offsets and refreshes the world bounds; returns the nodes updated
+size_t updateTransforms(TransformHierarchy& transforms, const std::vector<Vec3>& offsets,
+                        const std::vector<Aabb>& localBounds, std::vector<Aabb>& worldBounds) {
+    for (unsigned int i = 0; i < offsets.size(); ++i) {
+        transforms.setMeshOffset(i, offsets[i]);
+    }
+    size_t updated = transforms.update();
+    for (unsigned int i = 0; i < localBounds.size(); ++i) {
+        worldBounds[i] = transformAabb(transforms.meshWorld(i), localBounds[i]);
+    }
+    return updated;
+}
+
+// One run: load the scene, then a fixed number of frames of the per-frame queries
+bool runOnce(const BenchConfig& config, std::vector<StageResult>& stages) {
+    StageResult& load = stages[0];
+    StageResult& frameTotal = stages[1];
+    StageResult& transformStage = stages[2];
+    StageResult& culling = stages[3];
+    StageResult& traversal = stages[4];
+    StageResult& collision = stages[5];
+    StageResult& picking = stages[6];
+    size_t firstSample[7];
+    for (size_t i = 0; i < stages.size(); ++i) firstSample[i] = stages[i].samplesMs.size();
+
+    double loadStart = nowMs();
+    LoadedScene loaded;
+    if (!loadScene(config, loaded)) {
+        return false;
+    }
+    const aiScene* scene = loaded.scene;
+    TransformHierarchy transforms;
+    transforms.build(scene);
+    std::vector<Aabb> localBounds;
+    Aabb sceneBounds = computeSceneBounds(scene, transforms, localBounds);
+    load.samplesMs.push_back(nowMs() - loadStart);
+    if (!config.model.empty() && !sceneBounds.empty()) {
+        loaded.extent = length(sceneBounds.max - sceneBounds.min);
+    }
+    float extent = loaded.extent;
+    Vec3 center = sceneBounds.empty() ? Vec3() : sceneBounds.center();
+
+    std::vector<Aabb> worldBounds(scene->mNumMeshes);
+    std::vector<Vec3> offsets(scene->mNumMeshes);
+    std::vector<uint8_t> visible, colliding;
+    std::vector<DrawItem> drawItems;
+    drawItems.reserve(scene->mNumMeshes);
+    const Mat4 projection = makePerspective(45.0f, 16.0f / 9.0f, 0.01f * extent, 100.0f * extent);
+    const int pickGrid = 4;
+    std::unique_ptr<JobSystem> jobs;
+    if (config.threads != 1) {
+        jobs = std::make_unique<JobSystem>(config.threads);
+    }
+    FrameArena arena;
+    uint64_t steadyAllocations = 0;  // Frames after the first, which sizes the buffers and the arena
+    for (StageResult* stage : {&frameTotal, &transformStage, &culling, &traversal, &collision, &picking}) {
+        stage->samplesMs.reserve(stage->samplesMs.size() + config.frames);
+    }
+
+    for (unsigned frame = 0; frame < config.frames; ++frame) {
+        Mat4 viewProjection = animateFrame(frame, config.frames, projection, center, extent, offsets);
+
+        uint64_t allocationsBefore = heapAllocations.load(std::memory_order_relaxed);
+        double frameStart = nowMs();
+        double start = frameStart;
+        transformStage.checksum += updateTransforms(transforms, offsets, localBounds, worldBounds);
+        double end = nowMs();
+        transformStage.samplesMs.push_back(end - start);
+
+        start = nowMs();
+        cullBounds(frustumFromMatrix(viewProjection), worldBounds, visible, jobs.get());
+        end = nowMs();
+        culling.samplesMs.push_back(end - start);
+        culling.checksum += std::count(visible.begin(), visible.end(), 1);
+
+        start = nowMs();
+        collectDrawItems(transforms, visible, drawItems, jobs.get(), &arena);
+        end = nowMs();
+        traversal.samplesMs.push_back(end - start);
+        traversal.checksum += drawItems.size();
+
+        start = nowMs();
+        findCollisions(worldBounds, colliding, jobs.get(), &arena);
+        end = nowMs();
+        collision.samplesMs.push_back(end - start);
+        collision.checksum += std::count(colliding.begin(), colliding.end(), 1);
+
+        start = nowMs();
+        for (int py = 0; py < pickGrid; ++py) {
+            for (int px = 0; px < pickGrid; ++px) {
+                float ndcX = (px + 0.5f) / pickGrid * 2.0f - 1.0f;
+                float ndcY = (py + 0.5f) / pickGrid * 2.0f - 1.0f;
+                picking.checksum += pickMesh(scene, worldBounds, transforms.meshWorlds(),
+                                             rayFromNdc(viewProjection, ndcX, ndcY), nullptr, &arena);
+            }
+        }
+        arena.reset();
+        end = nowMs();
+        picking.samplesMs.push_back(end - start);
+        frameTotal.samplesMs.push_back(end - frameStart);
+        if (frame > 0) {
+            steadyAllocations += heapAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+        }
+    }
+
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const std::vector<double>& samples = stages[i].samplesMs;
+        double sum = 0.0;
+        for (size_t j = firstSample[i]; j < samples.size(); ++j) sum += samples[j];
+        stages[i].runMeansMs.push_back(sum / (samples.size() - firstSample[i]));
+    }
+    if (steadyAllocations != 0) {
+        std::cerr << steadyAllocations << " heap allocations in frames 1-" << config.frames - 1
+                  << "; per-frame data must come from the frame arena" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool runBenchmark(const BenchConfig& config, BenchReport& report) {
+    report.config = config;
+    report.stages.clear();
+    for (const char* name : {"load", "frame", "transforms", "culling", "traversal", "collision", "picking"}) {
+        report.stages.emplace_back();
+        report.stages.back().name = name;
+    }
+    // Discarded warm-up run: first-touch page faults and cold caches would inflate run 0
+    std::vector<StageResult> warmup = report.stages;
+    if (!runOnce(config, warmup)) {
+        return false;
+    }
+    for (unsigned run = 0; run < config.repeat; ++run) {
+        if (!runOnce(config, report.stages)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double median(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples.empty() ? 0.0 : samples[samples.size() / 2];
+}
+
+// Culling, traversal and collision per frame with 1, 2, 4 ... maxThreads job system threads.
+// The single-thread row runs the serial code and is the reference for speedup and checksums.
+bool runScaling(const BenchConfig& config) {
+    LoadedScene loaded;
+    if (!loadScene(config, loaded)) {
+        return false;
+    }
+    const aiScene* scene = loaded.scene;
+    TransformHierarchy transforms;
+    transforms.build(scene);
+    std::vector<Aabb> localBounds;
+    Aabb sceneBounds = computeSceneBounds(scene, transforms, localBounds);
+    float extent = config.model.empty() ? loaded.extent : length(sceneBounds.max - sceneBounds.min);
+    Vec3 center = sceneBounds.empty() ? Vec3() : sceneBounds.center();
+    const Mat4 projection = makePerspective(45.0f, 16.0f / 9.0f, 0.01f * extent, 100.0f * extent);
+
+    unsigned maxThreads = config.threads > 1 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::vector<Aabb> worldBounds(scene->mNumMeshes);
+    std::vector<Vec3> offsets(scene->mNumMeshes);
+    std::vector<uint8_t> visible, colliding;
+    std::vector<DrawItem> drawItems;
+    FrameArena arena;
+    std::printf("%u meshes, %u frames per thread count, %u hardware threads\n", scene->mNumMeshes, config.frames,
+                std::thread::hardware_concurrency());
+    std::printf("threads  culling ms  traversal ms  collision ms  frame ms  speedup  efficiency\n");
+
+    double serialFrameMs = 0.0;
+    double referenceChecksum = -1.0;
+    bool consistent = true;
+    for (unsigned threads : threadCounts) {
+        std::unique_ptr<JobSystem> jobs;
+        if (threads > 1) {
+            jobs = std::make_unique<JobSystem>(threads);
+        }
+        std::vector<double> cullMs, traverseMs, collideMs, frameMs;
+        double checksum = 0.0;
+        // Frame 0 is a warm-up: first-touch allocations and cold caches
+        for (unsigned frame = 0; frame <= config.frames; ++frame) {
+            Mat4 viewProjection =
+                animateFrame(frame % config.frames, config.frames, projection, center, extent, offsets);
+            updateTransforms(transforms, offsets, localBounds, worldBounds);
+            double start = nowMs();
+            cullBounds(frustumFromMatrix(viewProjection), worldBounds, visible, jobs.get());
+            double culled = nowMs();
+            collectDrawItems(transforms, visible, drawItems, jobs.get(), &arena);
+            double traversed = nowMs();
+            findCollisions(worldBounds, colliding, jobs.get(), &arena);
+            double end = nowMs();
+            arena.reset();
+            if (frame == 0) {
+                continue;
+            }
+            cullMs.push_back(culled - start);
+            traverseMs.push_back(traversed - culled);
+            collideMs.push_back(end - traversed);
+            frameMs.push_back(end - start);
+            checksum += std::count(visible.begin(), visible.end(), 1) + drawItems.size() +
+                        std::count(colliding.begin(), colliding.end(), 1);
+        }
+
+        double frame = median(frameMs);
+        if (threads == 1) {
+            serialFrameMs = frame;
+            referenceChecksum = checksum;
+        } else if (checksum != referenceChecksum) {
+            consistent = false;
+        }
+        double speedup = frame > 0.0 ? serialFrameMs / frame : 0.0;
+        std::printf("%7u  %10.3f  %12.3f  %12.3f  %8.3f  %6.2fx  %9.0f%%\n", threads, median(cullMs),
+                    median(traverseMs), median(collideMs), frame, speedup, 100.0 * speedup / threads);
+    }
+    if (!consistent) {
+        std::fprintf(stderr, "Parallel results differ from the serial run\n");
+    }
+    return consistent;
+}
+
+// Random affine transforms and boxes, each kernel timed over all of them per frame, scalar
+// reference first. Products and boxes must match exactly (same operation order per lane);
+// culling may differ only for boxes touching a plane within rounding.
+bool runMathComparison(const BenchConfig& config) {
+    size_t count = config.meshes;
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    auto randomVec = [&](float scale) { return Vec3(unit(rng), unit(rng), unit(rng)) * scale; };
+    auto randomAffine = [&]() {
+        return makeTranslation(randomVec(50.0f)) * makeRotation(180.0f * unit(rng), randomVec(1.0f)) *
+               makeScale(Vec3(1.5f, 1.5f, 1.5f) + randomVec(1.0f));
+    };
+    std::vector<Mat4> parents(count), locals(count), products(count), productsScalar(count);
+    std::vector<Aabb> boxes(count), moved(count), movedScalar(count);
+    for (size_t i = 0; i < count; ++i) {
+        parents[i] = randomAffine();
+        locals[i] = randomAffine();
+        Vec3 corner = randomVec(20.0f);
+        boxes[i].expand(corner);
+        boxes[i].expand(corner + Vec3(1.0f, 1.0f, 1.0f) + randomVec(0.9f));
+    }
+    Frustum frustum = frustumFromMatrix(makePerspective(45.0f, 16.0f / 9.0f, 0.1f, 200.0f) *
+                                        makeLookAt(Vec3(0.0f, 20.0f, 120.0f), Vec3(), Vec3(0.0f, 1.0f, 0.0f)));
+    std::vector<uint8_t> visible, visibleScalar(count);
+
+    std::vector<double> multiplyMs[2], boxMs[2], cullMs[2];
+    // Frame 0 is a warm-up
+    for (unsigned frame = 0; frame <= config.frames; ++frame) {
+        double start = nowMs();
+        for (size_t i = 0; i < count; ++i) productsScalar[i] = multiplyScalar(parents[i], locals[i]);
+        double multipliedScalar = nowMs();
+        for (size_t i = 0; i < count; ++i) products[i] = parents[i] * locals[i];
+        double multiplied = nowMs();
+        for (size_t i = 0; i < count; ++i) movedScalar[i] = transformAabbScalar(products[i], boxes[i]);
+        double transformedScalar = nowMs();
+        for (size_t i = 0; i < count; ++i) moved[i] = transformAabb(products[i], boxes[i]);
+        double transformed = nowMs();
+        for (size_t i = 0; i < count; ++i) visibleScalar[i] = intersectsFrustum(frustum, moved[i]) ? 1 : 0;
+        double culledScalar = nowMs();
+        cullBounds(frustum, moved, visible);
+        double culled = nowMs();
+        if (frame == 0) {
+            continue;
+        }
+        multiplyMs[0].push_back(multipliedScalar - start);
+        multiplyMs[1].push_back(multiplied - multipliedScalar);
+        boxMs[0].push_back(transformedScalar - multiplied);
+        boxMs[1].push_back(transformed - transformedScalar);
+        cullMs[0].push_back(culledScalar - transformed);
+        cullMs[1].push_back(culled - culledScalar);
+    }
+
+    size_t matrixMismatches = 0, boxMismatches = 0, cullMismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        matrixMismatches += std::equal(products[i].m, products[i].m + 16, productsScalar[i].m) ? 0 : 1;
+        const Aabb& a = moved[i];
+        const Aabb& b = movedScalar[i];
+        boxMismatches += a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z && a.max.x == b.max.x &&
+                         a.max.y == b.max.y && a.max.z == b.max.z ? 0 : 1;
+        cullMismatches += visible[i] != visibleScalar[i] ? 1 : 0;
+    }
+
+    std::printf("%zu items, %u frames\n", count, config.frames);
+    std::printf("kernel           scalar ms  simd ms  speedup  mismatches\n");
+    auto row = [](const char* name, const std::vector<double>* samples, size_t mismatches) {
+        double scalar = median(samples[0]), simd = median(samples[1]);
+        std::printf("%-15s  %9.3f  %7.3f  %6.2fx  %10zu\n", name, scalar, simd, simd > 0.0 ? scalar / simd : 0.0,
+                    mismatches);
+    };
+    row("mat4 multiply", multiplyMs, matrixMismatches);
+    row("aabb transform", boxMs, boxMismatches);
+    row("frustum cull", cullMs, cullMismatches);
+
+    bool consistent = matrixMismatches == 0 && boxMismatches == 0 && cullMismatches * 10000 <= count;
+    if (!consistent) {
+        std::fprintf(stderr, "SIMD results differ from the scalar reference\n");
+    }
+    return consistent;
+}
+
+// One body and four rotor nodes per drone, drones on a square grid; config.meshes is the
+// number of drones. Rotors are flat blobs found by name, as in the viewer.
+std::unique_ptr<aiScene> makeSwarmScene(const BenchConfig& config) {
+    std::mt19937 rng(config.seed);
+    unsigned drones = config.meshes;
+    unsigned side = static_cast<unsigned>(std::ceil(std::sqrt(static_cast<double>(drones))));
+    auto scene = std::make_unique<aiScene>();
+    scene->mNumMeshes = drones * 5;
+    scene->mMeshes = new aiMesh*[scene->mNumMeshes];
+    scene->mRootNode = new aiNode();
+    scene->mRootNode->mNumChildren = drones;
+    scene->mRootNode->mChildren = new aiNode*[drones];
+    const Vec3 arms[4] = {Vec3(1.0f, 0.2f, 1.0f), Vec3(-1.0f, 0.2f, 1.0f), Vec3(-1.0f, 0.2f, -1.0f),
+                          Vec3(1.0f, 0.2f, -1.0f)};
+    for (unsigned d = 0; d < drones; ++d) {
+        aiNode* drone = new aiNode();
+        drone->mParent = scene->mRootNode;
+        scene->mRootNode->mChildren[d] = drone;
+        Vec3 cell(4.0f * (d % side), 0.0f, 4.0f * (d / side));
+        for (int r = 0; r < 4; ++r) {
+            drone->mTransformation[r][3] = r < 3 ? cell[r] : 1.0f;
+        }
+        unsigned body = d * 5;
+        scene->mMeshes[body] = makeBlobMesh(Vec3(), config.triangles, rng);
+        drone->mNumMeshes = 1;
+        drone->mMeshes = new unsigned int[1]{body};
+        drone->mNumChildren = 4;
+        drone->mChildren = new aiNode*[4];
+        for (unsigned r = 0; r < 4; ++r) {
+            aiMesh* rotor = makeBlobMesh(Vec3(), config.triangles, rng);
+            for (unsigned v = 0; v < rotor->mNumVertices; ++v) {
+                rotor->mVertices[v] = aiVector3D(arms[r].x + rotor->mVertices[v].x * 0.8f, arms[r].y + 0.05f *
+                                                 rotor->mVertices[v].y, arms[r].z + rotor->mVertices[v].z * 0.8f);
+            }
+            scene->mMeshes[body + 1 + r] = rotor;
+            aiNode* node = new aiNode(("rotor_" + std::to_string(r)).c_str());
+            node->mParent = drone;
+            node->mNumMeshes = 1;
+            node->mMeshes = new unsigned int[1]{body + 1 + r};
+            drone->mChildren[r] = node;
+        }
+    }
+    return scene;
+}
+
+// Per frame: advance every rotor and set its mesh transform, update the hierarchy, refresh the
+// rotors' world bounds. Only rotor matrices may change, no node is recomputed, and each rotor's
+// pivot must stay where its node puts it.
+bool runRotorBenchmark(const BenchConfig& config) {
+    std::unique_ptr<aiScene> scene = makeSwarmScene(config);
+    TransformHierarchy transforms;
+    transforms.build(scene.get());
+    std::vector<Aabb> localBounds;
+    computeSceneBounds(scene.get(), transforms, localBounds);
+    std::vector<Aabb> worldBounds(scene->mNumMeshes);
+    RotorAnimation rotors;
+    rotors.detect(scene.get(), transforms, localBounds);
+    for (size_t i = 0; i < rotors.size(); ++i) {
+        rotors.setRpm(i, (i % 2 == 0 ? 1.0f : -1.0f) * (2000.0f + 10.0f * (i % 97)));
+    }
+
+    const float dt = 1.0f / 120.0f;
+    std::vector<double> spinMs, updateMs, boundsMs;
+    size_t nodesUpdated = 0;
+    // Frame 0 is a warm-up
+    for (unsigned frame = 0; frame <= config.frames; ++frame) {
+        double start = nowMs();
+        rotors.step(dt);
+        rotors.apply(transforms, 0.5f);
+        double spun = nowMs();
+        nodesUpdated += transforms.update();
+        double updated = nowMs();
+        for (size_t i = 0; i < rotors.size(); ++i) {
+            unsigned int mesh = rotors.rotor(i).mesh;
+            worldBounds[mesh] = transformAabb(transforms.meshWorld(mesh), localBounds[mesh]);
+        }
+        double end = nowMs();
+        if (frame == 0) {
+            continue;
+        }
+        spinMs.push_back(spun - start);
+        updateMs.push_back(updated - spun);
+        boundsMs.push_back(end - updated);
+    }
+
+    float pivotError = 0.0f;
+    for (size_t i = 0; i < rotors.size(); ++i) {
+        const RotorAnimation::Rotor& rotor = rotors.rotor(i);
+        Vec3 expected = transformPoint(transforms.world(transforms.meshNode(rotor.mesh)), rotor.pivot);
+        Vec3 actual = transformPoint(transforms.meshWorld(rotor.mesh), rotor.pivot);
+        pivotError = std::max(pivotError, length(actual - expected));
+    }
+
+    std::printf("%u drones, %zu rotors, %u frames\n", config.meshes, rotors.size(), config.frames);
+    std::printf("stage      ms  ns/rotor\n");
+    auto row = [&](const char* name, const std::vector<double>& samples) {
+        double ms = median(samples);
+        std::printf("%-7s %7.3f  %8.1f\n", name, ms, rotors.size() ? ms * 1e6 / rotors.size() : 0.0);
+    };
+    row("spin", spinMs);
+    row("update", updateMs);
+    row("bounds", boundsMs);
+    std::printf("nodes updated %zu, max pivot drift %g\n", nodesUpdated, pivotError);
+
+    bool consistent = rotors.size() == static_cast<size_t>(config.meshes) * 4 && nodesUpdated == 0 &&
+                      pivotError < 1e-3f;
+    if (!consistent) {
+        std::fprintf(stderr, "Rotors were missed, moved their nodes or left their pivots\n");
+    }
+    return consistent;
+}
+
+// A circling, bobbing flight at 1 kHz with slightly jittered timestamps. Seeks must land on the
+// same record as a binary search over the whole log, and sampling at a record's time must
+// return that record.
+bool runFlightLogBenchmark(const BenchConfig& config, const std::string& path) {
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<double> jitter(0.0, 0.0005);
+    double start = nowMs();
+    FlightLogWriter writer;
+    if (!writer.open(path)) {
+        return false;
+    }
+    for (unsigned i = 0; i < config.meshes; ++i) {
+        FlightLogRecord record = {};
+        record.time = i * 0.001 + jitter(rng);
+        float t = static_cast<float>(record.time);
+        record.position[0] = 20.0f * std::cos(0.1f * t);
+        record.position[1] = 10.0f + 2.0f * std::sin(0.5f * t);
+        record.position[2] = 20.0f * std::sin(0.1f * t);
+        Quat attitude = makeQuat(-5.7f * t, Vec3(0.0f, 1.0f, 0.0f));
+        record.attitude[0] = attitude.x;
+        record.attitude[1] = attitude.y;
+        record.attitude[2] = attitude.z;
+        record.attitude[3] = attitude.w;
+        for (int r = 0; r < kFlightLogRotors; ++r) {
+            record.rotorRpm[r] = 5000.0f + 100.0f * std::sin(t + r);
+        }
+        if (!writer.append(record)) {
+            return false;
+        }
+    }
+    if (!writer.close()) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    double written = nowMs();
+
+    FlightLog log;
+    if (!log.open(path)) {
+        return false;
+    }
+    double opened = nowMs();
+
+    const size_t seeks = 1000000;
+    std::uniform_real_distribution<double> anyTime(log.startTime() - 1.0, log.endTime() + 1.0);
+    std::vector<double> times(seeks);
+    for (double& t : times) t = anyTime(rng);
+    size_t checksum = 0;
+    double seekStart = nowMs();
+    for (double t : times) checksum += log.seek(t);
+    double seekEnd = nowMs();
+    size_t referenceChecksum = 0, mismatches = 0;
+    for (double t : times) {
+        size_t index = 0;
+        size_t lo = 0, hi = log.size();  // First record after t
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (log.record(mid).time <= t) lo = mid + 1;
+            else hi = mid;
+        }
+        index = lo > 0 ? lo - 1 : 0;
+        referenceChecksum += index;
+    }
+    double referenceEnd = nowMs();
+    mismatches += checksum != referenceChecksum ? 1 : 0;
+
+    // Playback at 60 frames per second of log time, through the cursor
+    size_t cursor = 0, frames = 0;
+    double playStart = nowMs();
+    for (double t = log.startTime(); t < log.endTime(); t += 1.0 / 60.0, ++frames) {
+        FlightSample sample = log.sample(t, cursor);
+        checksum += static_cast<size_t>(sample.rotorRpm[0]);
+    }
+    double playEnd = nowMs();
+    for (size_t i = 0; i < log.size(); i += log.size() / 1000 + 1) {
+        size_t exactCursor = SIZE_MAX;
+        FlightSample sample = log.sample(log.record(i).time, exactCursor);
+        mismatches += sample.position.x == log.record(i).position[0] && exactCursor == i ? 0 : 1;
+    }
+
+    double seekMs = seekEnd - seekStart, referenceMs = referenceEnd - seekEnd;
+    std::printf("%zu records, %.1f MB, %.1f s of flight\n", log.size(),
+                (sizeof(FlightLogHeader) + log.size() * sizeof(FlightLogRecord)) / 1e6, log.endTime() - log.startTime());
+    std::printf("write %.1f ms, open and index %.3f ms\n", written - start, opened - written);
+    std::printf("random seek %.1f ns (binary search over the log %.1f ns)\n", seekMs * 1e6 / seeks,
+                referenceMs * 1e6 / seeks);
+    std::printf("playback sample %.1f ns over %zu frames\n", frames ? (playEnd - playStart) * 1e6 / frames : 0.0,
+                frames);
+    if (mismatches != 0) {
+        std::fprintf(stderr, "Flight log seeks disagree with the reference search\n");
+    }
+    return mismatches == 0;
+}
+
+// Drones scattered over a box converge on grid slots around a circling formation centre at
+// 120 Hz. The scalar and the vector integrator run side by side from the same start and must
+// agree; the parallel run continues the vector swarm.
+bool runSwarmBenchmark(const BenchConfig& config) {
+    unsigned threads = config.threads > 1 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<JobSystem> jobs = std::make_unique<JobSystem>(threads);
+    const float dt = 1.0f / 120.0f;
+    SwarmParameters parameters;
+    std::printf("%u frames per size, %u threads\n", config.frames, threads);
+    std::printf("drones   scalar ns  simd ns  parallel ns  instances ns  drones/ms  max diff\n");
+
+    bool consistent = true;
+    for (size_t drones = 1000; drones <= config.meshes; drones *= 10) {
+        std::mt19937 rng(config.seed);
+        std::uniform_real_distribution<float> scatter(-50.0f, 50.0f);
+        size_t side = static_cast<size_t>(std::ceil(std::cbrt(static_cast<double>(drones))));
+        Swarm scalar, simd;
+        scalar.resize(drones);
+        simd.resize(drones);
+        for (size_t i = 0; i < drones; ++i) {
+            Vec3 start(scatter(rng), 0.5f * scatter(rng) + 25.0f, scatter(rng));
+            Vec3 slot(3.0f * (i % side), 3.0f * ((i / side) % side), 3.0f * (i / (side * side)));
+            slot = slot - Vec3(1.5f, 1.5f, 1.5f) * static_cast<float>(side);
+            scalar.place(i, start, slot);
+            simd.place(i, start, slot);
+        }
+
+        std::vector<Mat4> instances;
+        std::vector<double> scalarMs, simdMs, parallelMs, instanceMs;
+        // Frame 0 is a warm-up
+        for (unsigned frame = 0; frame <= config.frames; ++frame) {
+            float t = frame * dt;
+            Vec3 center(20.0f * std::cos(0.2f * t), 5.0f, 20.0f * std::sin(0.2f * t));
+            double start = nowMs();
+            scalar.stepScalar(dt, center, parameters);
+            double steppedScalar = nowMs();
+            simd.step(dt, center, parameters);
+            double stepped = nowMs();
+            if (frame == 0) {
+                continue;
+            }
+            scalarMs.push_back(steppedScalar - start);
+            simdMs.push_back(stepped - steppedScalar);
+        }
+        float maxDifference = 0.0f;
+        for (size_t i = 0; i < drones; ++i) {
+            maxDifference = std::max(maxDifference, length(simd.position(i) - scalar.position(i)));
+        }
+        for (unsigned frame = 0; frame <= config.frames; ++frame) {
+            float t = (config.frames + 1 + frame) * dt;
+            Vec3 center(20.0f * std::cos(0.2f * t), 5.0f, 20.0f * std::sin(0.2f * t));
+            double start = nowMs();
+            simd.step(dt, center, parameters, jobs.get());
+            double stepped = nowMs();
+            simd.writeInstances(instances, 0.5f, Mat4(), 1.0f, jobs.get());
+            double written = nowMs();
+            if (frame == 0) {
+                continue;
+            }
+            parallelMs.push_back(stepped - start);
+            instanceMs.push_back(written - stepped);
+        }
+
+        double perDrone = 1e6 / drones;
+        double parallel = median(parallelMs);
+        std::printf("%7zu  %9.2f  %7.2f  %11.2f  %12.2f  %9.0f  %8.2g\n", drones, median(scalarMs) * perDrone,
+                    median(simdMs) * perDrone, parallel * perDrone, median(instanceMs) * perDrone,
+                    parallel > 0.0 ? drones / parallel : 0.0, maxDifference);
+        consistent = consistent && maxDifference < 1e-3f;
+    }
+    if (!consistent) {
+        std::fprintf(stderr, "The vector integrator differs from the scalar reference\n");
+    }
+    return consistent;
+}
+
+// Quadrotors of a 35 cm frame with random velocities, body rates and rotor speeds around hover,
+// config.frames steps of 1 ms each way. The batch must match the scalar steps; the model must
+// hover in place at hover speed, fall as g t^2 / 2 without thrust or drag, and the controller
+// must bring a drone to a target 3 m away.
+bool runQuadrotorBenchmark(const BenchConfig& config) {
+    const float dt = 0.001f;
+    size_t drones = config.meshes;
+    unsigned threads = config.threads > 1 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<JobSystem> jobs = std::make_unique<JobSystem>(threads);
+    QuadrotorParameters parameters =
+        quadrotorFromBounds(Aabb{Vec3(-0.175f, -0.05f, -0.175f), Vec3(0.175f, 0.05f, 0.175f)}, {}, 1.0f);
+    float hover = parameters.hoverRotorSpeed();
+
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<QuadrotorState> scalar(drones);
+    std::vector<float> speeds(drones * kQuadrotorRotors);
+    QuadrotorBatch batch(parameters), parallel(parameters);
+    batch.resize(drones);
+    parallel.resize(drones);
+    for (size_t i = 0; i < drones; ++i) {
+        QuadrotorState& state = scalar[i];
+        state.position = Vec3(unit(rng), unit(rng), unit(rng)) * 10.0f;
+        state.velocity = Vec3(unit(rng), unit(rng), unit(rng)) * 2.0f;
+        state.angularVelocity = Vec3(unit(rng), unit(rng), unit(rng));
+        float* rotor = &speeds[i * kQuadrotorRotors];
+        for (int r = 0; r < kQuadrotorRotors; ++r) {
+            rotor[r] = hover * (1.0f + 0.02f * unit(rng));
+        }
+        batch.setState(i, state);
+        batch.setRotorSpeeds(i, rotor);
+        parallel.setState(i, state);
+        parallel.setRotorSpeeds(i, rotor);
+    }
+
+    std::vector<double> scalarMs, batchMs, parallelMs;
+    // Frame 0 is a warm-up
+    for (unsigned frame = 0; frame <= config.frames; ++frame) {
+        double start = nowMs();
+        for (size_t i = 0; i < drones; ++i) {
+            stepQuadrotor(parameters, scalar[i], &speeds[i * kQuadrotorRotors], dt);
+        }
+        double steppedScalar = nowMs();
+        batch.step(dt);
+        double stepped = nowMs();
+        parallel.step(dt, jobs.get());
+        double steppedParallel = nowMs();
+        if (frame == 0) {
+            continue;
+        }
+        scalarMs.push_back(steppedScalar - start);
+        batchMs.push_back(stepped - steppedScalar);
+        parallelMs.push_back(steppedParallel - stepped);
+    }
+    float maxDifference = 0.0f;
+    for (size_t i = 0; i < drones; ++i) {
+        maxDifference = std::max({maxDifference, length(batch.state(i).position - scalar[i].position),
+                                  length(parallel.state(i).position - scalar[i].position)});
+    }
+
+    QuadrotorState hovering, falling, controlled;
+    const float hoverSpeeds[kQuadrotorRotors] = {hover, hover, hover, hover};
+    const float stopped[kQuadrotorRotors] = {};
+    QuadrotorParameters vacuum = parameters;
+    vacuum.linearDrag = vacuum.quadraticDrag = 0.0f;
+    const Vec3 target(2.0f, 1.0f, -2.0f);
+    float command[kQuadrotorRotors];
+    for (int i = 0; i < 1000; ++i) {
+        stepQuadrotor(parameters, hovering, hoverSpeeds, dt);
+        stepQuadrotor(vacuum, falling, stopped, dt);
+    }
+    for (int i = 0; i < 5000; ++i) {
+        controlQuadrotor(parameters, controlled, target, command);
+        stepQuadrotor(parameters, controlled, command, dt);
+    }
+    float hoverDrift = length(hovering.position);
+    float fallError = std::fabs(falling.position.y + 0.5f * parameters.gravity);
+    float controlError = length(controlled.position - target);
+
+    double perDrone = 1e6 / drones;
+    std::printf("%zu quadrotors, %.3f kg, hover %.0f rpm, %u steps of 1 ms, %u threads\n", drones, parameters.mass,
+                hover * 60.0f / (2.0f * static_cast<float>(M_PI)), config.frames, threads);
+    std::printf("integrator  ms/step  ns/drone  drones/ms\n");
+    auto row = [&](const char* name, const std::vector<double>& samples) {
+        double ms = median(samples);
+        std::printf("%-10s  %7.3f  %8.1f  %9.0f\n", name, ms, ms * perDrone, ms > 0.0 ? drones / ms : 0.0);
+    };
+    row("scalar", scalarMs);
+    row("simd", batchMs);
+    row("parallel", parallelMs);
+    std::printf("batch vs scalar %g m, hover drift %g m, free fall error %g m, controller error %g m after 5 s\n",
+                maxDifference, hoverDrift, fallError, controlError);
+
+    bool consistent = maxDifference < 1e-3f && hoverDrift < 1e-4f && fallError < 1e-3f && controlError < 0.05f;
+    if (!consistent) {
+        std::fprintf(stderr, "The flight model disagrees with its reference or the expected motion\n");
+    }
+    return consistent;
+}
+
+// Drones gathering from a 100 m cube into a formation 3 m apart, so the number of near pairs
+// grows over the run, among 200 boxes of 1 to 10 m and one 200 m ground slab that covers more
+// cells than there are drones. Near means within 2 m of another drone or 1 m of a box.
+bool runBroadphaseBenchmark(const BenchConfig& config) {
+    const float dt = 1.0f / 120.0f, pairRadius = 2.0f, obstacleRadius = 1.0f;
+    size_t drones = config.meshes;
+    unsigned threads = config.threads > 1 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<JobSystem> jobs = std::make_unique<JobSystem>(threads);
+
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<float> scatter(-50.0f, 50.0f), extent(0.5f, 5.0f);
+    size_t side = static_cast<size_t>(std::ceil(std::cbrt(static_cast<double>(drones))));
+    Swarm swarm;
+    swarm.resize(drones);
+    for (size_t i = 0; i < drones; ++i) {
+        Vec3 slot(3.0f * (i % side), 3.0f * ((i / side) % side), 3.0f * (i / (side * side)));
+        swarm.place(i, Vec3(scatter(rng), scatter(rng) + 50.0f, scatter(rng)), slot - Vec3(1.5f, 0.0f, 1.5f) * side);
+    }
+    std::vector<Aabb> obstacles(200);
+    for (Aabb& box : obstacles) {
+        Vec3 center(scatter(rng), scatter(rng) + 50.0f, scatter(rng));
+        Vec3 half(extent(rng), extent(rng), extent(rng));
+        box.min = center - half;
+        box.max = center + half;
+    }
+    obstacles.push_back(Aabb{Vec3(-100.0f, -1.0f, -100.0f), Vec3(100.0f, 0.0f, 100.0f)});
+
+    SpatialHashGrid serialGrid, parallelGrid;
+    std::vector<ProximityPair> pairs, contacts, parallelPairs, parallelContacts, brutePairs, bruteContacts;
+    std::vector<double> buildMs, pairMs, contactMs, parallelBuildMs, parallelPairMs, parallelContactMs, bruteMs;
+    bool consistent = true;
+    size_t pairCount = 0, contactCount = 0;
+    // Frame 0 is a warm-up
+    for (unsigned frame = 0; frame <= config.frames; ++frame) {
+        swarm.step(dt, Vec3(0.0f, 20.0f, 0.0f), SwarmParameters(), jobs.get());
+        const SwarmVectors& positions = swarm.positions();
+        double start = nowMs();
+        serialGrid.build(positions, drones, pairRadius);
+        double built = nowMs();
+        serialGrid.findPairs(pairRadius, pairs);
+        double paired = nowMs();
+        serialGrid.findObstacleContacts(obstacles, obstacleRadius, contacts);
+        double contacted = nowMs();
+        parallelGrid.build(positions, drones, pairRadius, jobs.get());
+        double builtParallel = nowMs();
+        parallelGrid.findPairs(pairRadius, parallelPairs, jobs.get());
+        double pairedParallel = nowMs();
+        parallelGrid.findObstacleContacts(obstacles, obstacleRadius, parallelContacts, jobs.get());
+        double contactedParallel = nowMs();
+        findPairsBruteForce(positions, drones, pairRadius, brutePairs);
+        findObstacleContactsBruteForce(positions, drones, obstacles, obstacleRadius, bruteContacts);
+        double brute = nowMs();
+
+        consistent = consistent && pairs == brutePairs && parallelPairs == brutePairs && contacts == bruteContacts &&
+                     parallelContacts == bruteContacts;
+        pairCount = pairs.size();
+        contactCount = contacts.size();
+        if (frame == 0) {
+            continue;
+        }
+        buildMs.push_back(built - start);
+        pairMs.push_back(paired - built);
+        contactMs.push_back(contacted - paired);
+        parallelBuildMs.push_back(builtParallel - contacted);
+        parallelPairMs.push_back(pairedParallel - builtParallel);
+        parallelContactMs.push_back(contactedParallel - pairedParallel);
+        bruteMs.push_back(brute - contactedParallel);
+    }
+
+    double serial = median(buildMs) + median(pairMs) + median(contactMs);
+    double parallel = median(parallelBuildMs) + median(parallelPairMs) + median(parallelContactMs);
+    std::printf("%zu drones, %zu obstacles, %u frames, %u threads\n", drones, obstacles.size(), config.frames, threads);
+    std::printf("last frame: %zu near pairs, %zu obstacle contacts\n", pairCount, contactCount);
+    std::printf("broadphase   build ms  pairs ms  obstacles ms  total ms\n");
+    std::printf("grid         %8.3f  %8.3f  %12.3f  %8.3f\n", median(buildMs), median(pairMs), median(contactMs),
+                serial);
+    std::printf("grid jobs    %8.3f  %8.3f  %12.3f  %8.3f\n", median(parallelBuildMs), median(parallelPairMs),
+                median(parallelContactMs), parallel);
+    std::printf("brute force  %8s  %8s  %12s  %8.3f  (%.0fx the grid)\n", "", "", "", median(bruteMs),
+                serial > 0.0 ? median(bruteMs) / serial : 0.0);
+
+    if (!consistent) {
+        std::fprintf(stderr, "The grid and the brute force found different pairs\n");
+    }
+    return consistent;
+}
+
+// The twelve triangles of a box's faces
+void appendBoxTriangles(const Aabb& box, std::vector<Vec3>& out) {
+    static const int faces[6][4] = {{0, 2, 6, 4}, {1, 5, 7, 3}, {0, 4, 5, 1}, {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 6, 7, 5}};
+    for (const int* face : faces) {
+        for (int k : {0, 1, 2, 0, 2, 3}) {
+            out.push_back(box.corner(face[k]));
+        }
+    }
+}
+
+// A 200 m square of ground with buildings of 2 to 10 m a side and up to 40 m tall on it,
+// voxelized at 0.5 m. The references test every voxel: whether the one containing a point is
+// occupied, whether any overlaps a drone-sized box, and which one a ray enters first.
+bool runOccupancyBenchmark(const BenchConfig& config) {
+    const float voxelSize = 0.5f;
+    unsigned threads = config.threads > 1 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<JobSystem> jobs = std::make_unique<JobSystem>(threads);
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<float> ground(-100.0f, 100.0f), footprint(1.0f, 5.0f), height(2.0f, 40.0f);
+    std::vector<Vec3> triangles = {Vec3(-100.0f, 0.0f, -100.0f), Vec3(100.0f, 0.0f, -100.0f),
+                                   Vec3(100.0f, 0.0f, 100.0f),   Vec3(-100.0f, 0.0f, -100.0f),
+                                   Vec3(100.0f, 0.0f, 100.0f),   Vec3(-100.0f, 0.0f, 100.0f)};
+    for (unsigned i = 0; i < config.meshes; ++i) {
+        Vec3 center(ground(rng), 0.0f, ground(rng));
+        Vec3 half(footprint(rng), 0.0f, footprint(rng));
+        appendBoxTriangles(Aabb{center - half, center + half + Vec3(0.0f, height(rng), 0.0f)}, triangles);
+    }
+
+    OccupancyMap map;
+    std::vector<double> buildMs, parallelBuildMs;
+    // Frame 0 is a warm-up
+    for (unsigned frame = 0; frame <= config.frames; ++frame) {
+        double start = nowMs();
+        map.build(triangles, voxelSize);
+        double built = nowMs();
+        if (!map.build(triangles, voxelSize, jobs.get())) {
+            return false;
+        }
+        if (frame > 0) {
+            buildMs.push_back(built - start);
+            parallelBuildMs.push_back(nowMs() - built);
+        }
+    }
+    std::vector<Vec3> centers;
+    map.voxelCenters(centers);
+    Aabb cube = map.bounds();
+    std::vector<Aabb> voxels(centers.size());
+    Vec3 half = Vec3(voxelSize, voxelSize, voxelSize) * 0.5f;
+    for (size_t i = 0; i < centers.size(); ++i) {
+        voxels[i] = Aabb{centers[i] - half, centers[i] + half};
+    }
+
+    // Every triangle passes through the voxel holding its centroid
+    size_t errors = 0;
+    for (size_t t = 0; t < triangles.size(); t += 3) {
+        errors += !map.occupied((triangles[t] + triangles[t + 1] + triangles[t + 2]) * (1.0f / 3.0f));
+    }
+
+    const size_t pointQueries = 1000000, boxQueries = 100000, rayQueries = 10000;
+    std::uniform_real_distribution<float> across(-100.0f, 100.0f), up(-1.0f, 45.0f), unit(-1.0f, 1.0f);
+    std::vector<Vec3> points(pointQueries);
+    for (Vec3& point : points) {
+        point = Vec3(across(rng), up(rng), across(rng));
+    }
+    std::vector<Ray> rays(rayQueries);
+    for (Ray& ray : rays) {
+        ray.origin = Vec3(across(rng), up(rng), across(rng));
+        ray.direction = normalize(Vec3(unit(rng), 0.3f * unit(rng), unit(rng)));
+    }
+    size_t hits = 0;
+    double start = nowMs();
+    for (const Vec3& point : points) {
+        hits += map.occupied(point);
+    }
+    double pointNs = (nowMs() - start) * 1e6 / pointQueries;
+    start = nowMs();
+    for (size_t i = 0; i < boxQueries; ++i) {
+        hits += map.occupied(Aabb{points[i] - Vec3(0.5f, 0.2f, 0.5f), points[i] + Vec3(0.5f, 0.2f, 0.5f)});
+    }
+    double boxNs = (nowMs() - start) * 1e6 / boxQueries;
+    start = nowMs();
+    for (const Ray& ray : rays) {
+        hits += map.raycast(ray, 200.0f);
+    }
+    double rayNs = (nowMs() - start) * 1e6 / rayQueries;
+
+    // References over a sample of the queries
+    auto enters = [](const Ray& ray, const Aabb& box, float maxT, float& tEnter) {
+        float t0 = 0.0f, t1 = maxT;
+        for (int axis = 0; axis < 3; ++axis) {
+            float inv = 1.0f / ray.direction[axis];
+            float tNear = (box.min[axis] - ray.origin[axis]) * inv, tFar = (box.max[axis] - ray.origin[axis]) * inv;
+            t0 = std::max(t0, std::min(tNear, tFar));
+            t1 = std::min(t1, std::max(tNear, tFar));
+        }
+        tEnter = t0;
+        return t0 <= t1;
+    };
+    double bruteStart = nowMs();
+    for (size_t i = 0; i < 200; ++i) {
+        bool point = false, box = false;
+        Aabb query{points[i] - Vec3(0.5f, 0.2f, 0.5f), points[i] + Vec3(0.5f, 0.2f, 0.5f)};
+        for (const Aabb& voxel : voxels) {
+            point = point || (points[i].x >= voxel.min.x && points[i].x < voxel.max.x && points[i].y >= voxel.min.y &&
+                              points[i].y < voxel.max.y && points[i].z >= voxel.min.z && points[i].z < voxel.max.z);
+            box = box || overlaps(query, voxel);
+        }
+        errors += point != map.occupied(points[i]);
+        errors += box != map.occupied(query);
+
+        float nearest = FLT_MAX, t;
+        for (const Aabb& voxel : voxels) {
+            if (enters(rays[i], voxel, 200.0f, t)) {
+                nearest = std::min(nearest, t);
+            }
+        }
+        float hit = FLT_MAX;
+        bool found = map.raycast(rays[i], 200.0f, &hit);
+        errors += found != (nearest < FLT_MAX) || (found && std::fabs(hit - nearest) > 1e-3f);
+    }
+    double bruteRayNs = (nowMs() - bruteStart) * 1e6 / 200.0;
+
+    size_t bytes = map.memoryBytes();
+    double side = std::ldexp(1.0, map.depth());
+    std::printf("%zu triangles, %.1f m voxels, depth %d (%.0f m cube), %u threads\n", triangles.size() / 3,
+                voxelSize, map.depth(), cube.max.x - cube.min.x, threads);
+    std::printf("%zu occupied voxels in %.1f KB: %.2f bytes per voxel (Morton list 8, dense bitmap %.0f KB)\n",
+                map.voxelCount(), bytes / 1024.0, static_cast<double>(bytes) / map.voxelCount(),
+                side * side * side / 8.0 / 1024.0);
+    std::printf("build %.2f ms, %.2f ms over the job system\n", median(buildMs), median(parallelBuildMs));
+    std::printf("query   ns/query\n");
+    std::printf("point   %8.1f\n", pointNs);
+    std::printf("box     %8.1f\n", boxNs);
+    std::printf("ray     %8.1f\n", rayNs);
+    std::printf("references testing every voxel: %.1f ms per point, box and ray\n", bruteRayNs * 1e-6);
+    std::printf("%zu occupied answers, %zu disagreements with the references\n", hits, errors);
+
+    if (errors > 0) {
+        std::fprintf(stderr, "The occupancy map disagrees with its references\n");
+    }
+    return errors == 0;
+}
+
+bool writeReportFile(const std::string& path, const BenchReport& report) {
+    if (path.empty()) {
+        writeReport(std::cout, report);
+        return true;
+    }
+    std::ofstream out(path);
+    writeReport(out, report);
+    if (!out) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--scaling") {
+            // Many small meshes: the per-mesh passes dominate, not vertex processing
+            options.config.meshes = 100000;
+            options.config.triangles = 4;
+            options.config.frames = 10;
+        }
+        if (std::string(argv[i]) == "--math") {
+            options.config.meshes = 100000;
+            options.config.frames = 20;
+        }
+        if (std::string(argv[i]) == "--flightlog") {
+            options.config.meshes = 4000000;
+        }
+        if (std::string(argv[i]) == "--occupancy") {
+            options.config.meshes = 500;
+            options.config.frames = 5;
+        }
+        if (std::string(argv[i]) == "--broadphase") {
+            options.config.meshes = 10000;
+            options.config.frames = 20;
+        }
+        if (std::string(argv[i]) == "--quadrotor") {
+            options.config.meshes = 4096;
+            options.config.frames = 1000;
+        }
+        if (std::string(argv[i]) == "--swarm") {
+            options.config.meshes = 100000;
+            options.config.frames = 100;
+        }
+        if (std::string(argv[i]) == "--rotors") {
+            options.config.meshes = 4096;
+            options.config.triangles = 32;
+            options.config.frames = 100;
+        }
+    }
+    if (!parseArguments(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+    if (options.scaling) {
+        return runScaling(options.config) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (options.math) {
+        return runMathComparison(options.config) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (options.rotors) {
+        return runRotorBenchmark(options.config) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (options.occupancy) {
+        return runOccupancyBenchmark(options.config) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (options.broadphase) {
+        return runBroadphaseBenchmark(options.config) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (options.quadrotor) {
+        return runQuadrotorBenchmark(options.config) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (options.swarm) {
+        return runSwarmBenchmark(options.config) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (options.flightLog) {
+        std::string path = options.outputPath.empty() ? "drone_bench_flight.bin" : options.outputPath;
+        return runFlightLogBenchmark(options.config, path) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (options.baselinePath.empty()) {
+        BenchReport report;
+        if (!runBenchmark(options.config, report)) {
+            return EXIT_FAILURE;
+        }
+        return writeReportFile(options.outputPath, report) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    BenchReport baseline, candidate;
+    std::string error;
+    if (!readReport(options.baselinePath, baseline, error)) {
+        std::cerr << error << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!options.candidatePath.empty()) {
+        if (!readReport(options.candidatePath, candidate, error)) {
+            std::cerr << error << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else {
+        // Rerun with the baseline's workload unless the command line asks for another one
+        BenchConfig config = options.configOverridden ? options.config : baseline.config;
+        config.label = options.config.label;
+        if (!runBenchmark(config, candidate) ||
+            (!options.outputPath.empty() && !writeReportFile(options.outputPath, candidate))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    const BenchConfig& a = baseline.config;
+    const BenchConfig& b = candidate.config;
+    if (a.meshes != b.meshes || a.triangles != b.triangles || a.depth != b.depth || a.frames != b.frames ||
+        a.seed != b.seed || a.threads != b.threads || a.model != b.model) {
+        std::cerr << "Warning: baseline and candidate ran different workloads" << std::endl;
+    }
+    if (a.repeat < 3 || b.repeat < 3) {
+        std::cerr << "Warning: fewer than 3 runs per side, confidence intervals are unreliable" << std::endl;
+    }
+
+    std::vector<StageComparison> comparisons = compareReports(baseline, candidate, options.threshold);
+    printComparison(std::cout, comparisons);
+    bool regressed = std::any_of(comparisons.begin(), comparisons.end(),
+                                 [](const StageComparison& c) { return c.regression; });
+    return regressed ? 2 : EXIT_SUCCESS;
+}
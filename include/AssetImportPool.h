@@ -0,0 +1,60 @@
+#ifndef ASSET_IMPORT_POOL_H
+#define ASSET_IMPORT_POOL_H
+
+#include <assimp/scene.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One finished import; the scene is detached from its importer and owned here
+struct ImportedAsset {
+    std::string path;
+    std::unique_ptr<aiScene> scene;  // Null when the import failed
+    std::string error;
+    double importMs = 0.0;
+    size_t importerBytes = 0;        // aiMemoryInfo::total while the importer held the scene
+    // Growth of the process's current resident size across the import, in KB. Imports on the
+    // other workers overlap it when there are several. False where it can't be read.
+    bool residentMeasured = false;
+    long residentDeltaKb = 0;
+};
+
+// Imports a list of files on worker threads. Assimp::Importer is not thread-safe, so every
+// worker owns its own; results come back in completion order through next().
+class AssetImportPool {
+public:
+    // At most maxPending finished scenes wait for the consumer, which bounds memory use
+    AssetImportPool(std::vector<std::string> paths, unsigned workerCount, unsigned postProcessFlags,
+                    size_t maxPending);
+    ~AssetImportPool();
+
+    AssetImportPool(const AssetImportPool&) = delete;
+    AssetImportPool& operator=(const AssetImportPool&) = delete;
+
+    // Blocks until the next import finishes; returns false once every path has been delivered
+    bool next(ImportedAsset& out);
+
+private:
+    void workerLoop(unsigned workerIndex);
+
+    std::vector<std::string> paths;
+    unsigned flags;
+    size_t maxPending;
+    std::atomic<size_t> nextPath{0};
+    size_t delivered = 0;
+    bool stopping = false;
+
+    std::mutex mutex;
+    std::condition_variable resultReady;
+    std::condition_variable slotFree;
+    std::deque<ImportedAsset> results;
+    std::vector<std::thread> workers;
+};
+
+#endif // ASSET_IMPORT_POOL_H
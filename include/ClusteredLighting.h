@@ -0,0 +1,115 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <GL/gl.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Point light used by the clustered forward path (world space)
+struct PointLight {
+    float position[3] = {0.0f, 0.0f, 0.0f};
+    float radius = 5.0f;                      // Light has no influence beyond this distance
+    float color[3] = {1.0f, 1.0f, 1.0f};
+    float intensity = 1.0f;
+};
+
+// View frustum split into tilesX * tilesY screen tiles and slicesZ exponential depth slices
+struct ClusterGridConfig {
+    int tilesX = 16;
+    int tilesY = 9;
+    int slicesZ = 24;
+    float fovY = 45.0f;        // Degrees, same convention as gluPerspective
+    float aspect = 4.0f / 3.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+    int maxLightsPerCluster = 128;
+};
+
+// CPU light binner: assigns view-space light spheres to cluster AABBs.
+// Each depth slice is owned by one worker, so workers never write the same cluster.
+class ClusterBinner {
+public:
+    explicit ClusterBinner(unsigned threadCount = 0);
+    ~ClusterBinner();
+
+    ClusterBinner(const ClusterBinner&) = delete;
+    ClusterBinner& operator=(const ClusterBinner&) = delete;
+
+    // Rebuild cluster bounds; cheap to call every frame, only recomputes on change
+    void setGrid(const ClusterGridConfig& config);
+    const ClusterGridConfig& grid() const { return config; }
+
+    // Bin lights given a column-major view matrix (as returned by GL_MODELVIEW_MATRIX)
+    void bin(const std::vector<PointLight>& lights, const float viewMatrix[16]);
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+    int clusterCount() const { return config.tilesX * config.tilesY * config.slicesZ; }
+
+    // Results of the last bin() call
+    const std::vector<uint32_t>& clusterOffsets() const { return offsets; }  // Per cluster
+    const std::vector<uint32_t>& clusterCounts() const { return counts; }    // Per cluster
+    const std::vector<uint32_t>& lightIndices() const { return indices; }
+    const std::vector<float>& viewSpaceLights() const { return lightView; }  // x, y, z, radius
+    uint32_t overflowCount() const { return overflow; }
+
+private:
+    void buildClusterBounds();
+    void binSlice(int slice);
+    void runParallel(const std::function<void(unsigned)>& task);
+    void workerLoop(unsigned workerIndex);
+
+    ClusterGridConfig config;
+    bool boundsValid = false;
+
+    // Cluster AABBs in view space, structure of arrays per slice, padded to a multiple of 4 tiles
+    int tilesPerSlicePadded = 0;
+    std::vector<float> boundsMinX, boundsMaxX, boundsMinY, boundsMaxY;
+    std::vector<float> sliceNear, sliceFar;  // Positive view depths
+    float sliceScale = 0.0f;                 // slicesZ / log(far / near)
+
+    std::vector<float> lightView;
+    std::vector<int> lightSliceRange;        // First and last slice per light
+    std::vector<uint32_t> scratch;           // maxLightsPerCluster entries per cluster
+    std::vector<uint32_t> offsets, counts, indices;
+    uint32_t overflow = 0;
+    std::vector<uint32_t> sliceOverflow;
+
+    // Persistent workers so small light counts don't pay thread creation per frame
+    std::vector<std::thread> workers;
+    std::mutex workMutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    std::function<void(unsigned)> currentTask;
+    uint64_t generation = 0;
+    unsigned pendingWorkers = 0;
+    bool stopping = false;
+};
+
+// GPU side: uploads the binned clusters and owns the shading program
+bool initClusteredLighting();
+void shutdownClusteredLighting();
+bool clusteredLightingAvailable();
+
+// Bin and upload lights for this frame; viewMatrix must be the camera's modelview matrix
+void updateClusteredLights(const std::vector<PointLight>& lights, const float viewMatrix[16],
+                           const ClusterGridConfig& config, int viewportWidth, int viewportHeight);
+void beginClusteredLighting(float shininess);
+void setClusteredLightingTextured(bool textured);
+
+// GPU skinning in the lighting program: boneCount column-major matrices, 0 turns it off.
+// Returns false when the program is not active or the palette is too big. While on, every
+// vertex needs its four palette indices and weights, set before its glVertex call.
+const int kMaxGpuSkinBones = 24;
+bool setClusteredLightingSkin(const float* palette, int boneCount);
+void setClusteredLightingBoneWeights(const uint16_t indices[4], const float weights[4]);
+void endClusteredLighting();
+ClusterBinner& clusteredLightBinner();
+
+// Prints binning timings for 16/256/4096 lights, single and multithreaded
+void runClusterBinningBenchmark();
+
+#endif // CLUSTERED_LIGHTING_H
@@ -0,0 +1,101 @@
+#ifndef FLIGHT_LOG_H
+#define FLIGHT_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "VecMath.h"
+
+// Binary flight log: a header followed by fixed-size records in ascending time order, written
+// in the host's byte order. Positions are metres in a y-up world, attitudes unit quaternions.
+const char kFlightLogMagic[8] = {'D', 'R', 'O', 'N', 'E', 'L', 'O', 'G'};
+const uint32_t kFlightLogVersion = 1;
+const int kFlightLogRotors = 4;
+
+struct FlightLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;   // sizeof(FlightLogRecord) of the writer
+    uint64_t recordCount;
+};
+
+struct FlightLogRecord {
+    double time;                        // Seconds
+    float position[3];
+    float attitude[4];                  // x, y, z, w
+    float rotorRpm[kFlightLogRotors];
+    uint32_t flags;                     // Reserved, 0
+};
+
+static_assert(sizeof(FlightLogHeader) == 24, "flight log header layout");
+static_assert(sizeof(FlightLogRecord) == 56, "flight log record layout");
+
+// One interpolated state
+struct FlightSample {
+    double time = 0.0;
+    Vec3 position;
+    Quat attitude;
+    float rotorRpm[kFlightLogRotors] = {};
+};
+
+// Read-only view of a flight log through a memory mapping, so logs far larger than RAM replay
+// with only the pages being read resident. open() reads the header and every kIndexStride-th
+// timestamp into a small in-memory index; seek() searches that index, then one stride of the
+// mapped records. Records are trusted to be in time order.
+class FlightLog {
+public:
+    static const size_t kIndexStride = 4096;  // Records per index entry
+
+    FlightLog() = default;
+    ~FlightLog();
+
+    FlightLog(const FlightLog&) = delete;
+    FlightLog& operator=(const FlightLog&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return records != nullptr; }
+    size_t size() const { return count; }
+    const FlightLogRecord& record(size_t index) const { return records[index]; }
+    double startTime() const { return count ? records[0].time : 0.0; }
+    double endTime() const { return count ? records[count - 1].time : 0.0; }
+
+    // Last record at or before time (0 before the first); O(log n). A hint at or before the
+    // answer makes it O(log distance), as when playback moves forward a little at a time.
+    size_t seek(double time, size_t hint = SIZE_MAX) const;
+
+    // Position and rotor speeds interpolated linearly, attitude by slerp; clamped to the log.
+    // cursor carries the seek hint from one call to the next.
+    FlightSample sample(double time, size_t& cursor) const;
+
+private:
+    const FlightLogRecord* records = nullptr;
+    size_t count = 0;
+    std::vector<double> indexTimes;  // Time of every kIndexStride-th record
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Appends records to a new flight log; the header's count is filled in by close()
+class FlightLogWriter {
+public:
+    ~FlightLogWriter() { close(); }
+
+    bool open(const std::string& path);
+    bool append(const FlightLogRecord& record);
+    bool close();
+
+private:
+    std::FILE* file = nullptr;
+    uint64_t written = 0;
+    bool failed = false;
+};
+
+#endif // FLIGHT_LOG_H
@@ -0,0 +1,58 @@
+#ifndef FLIGHT_MODEL_THREAD_H
+#define FLIGHT_MODEL_THREAD_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "QuadrotorDynamics.h"
+#include "TripleBuffer.h"
+
+// Circuit the controller flies, in metres: a loop of the given radius starting where the drone
+// takes off, at a constant height above it
+struct FlightPlan {
+    float radius = 2.0f;
+    float height = 1.0f;
+    float period = 12.0f;            // Seconds per loop
+};
+
+// State published after each batch of steps
+struct FlightModelSnapshot {
+    uint64_t steps = 0;
+    double time = 0.0;               // Simulated seconds
+    QuadrotorState state;
+    float rotorSpeeds[kQuadrotorRotors] = {};  // rad/s
+};
+
+// Flies one quadrotor on its own thread at a fixed rate (1 kHz by default), independent of
+// the frame rate: controlQuadrotor follows the plan and stepQuadrotor integrates. Plans go in
+// and snapshots come out through triple buffers, so neither thread waits for the other. When
+// the thread falls behind it runs up to 50 steps at once, then drops the rest of the backlog.
+class FlightModelThread {
+public:
+    FlightModelThread(const QuadrotorParameters& parameters, const FlightPlan& plan, double rateHz = 1000.0);
+    ~FlightModelThread();
+
+    FlightModelThread(const FlightModelThread&) = delete;
+    FlightModelThread& operator=(const FlightModelThread&) = delete;
+
+    // Main thread: takes effect within a step
+    void setPlan(const FlightPlan& plan);
+
+    // Main thread: switches snapshot() to the newest state; false if none arrived since
+    bool poll() { return snapshots.update(); }
+    const FlightModelSnapshot& snapshot() const { return snapshots.front(); }
+
+    const QuadrotorParameters& parameters() const { return model; }
+
+private:
+    void run();
+
+    QuadrotorParameters model;
+    double rate;
+    TripleBuffer<FlightPlan> plans;
+    TripleBuffer<FlightModelSnapshot> snapshots;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
+
+#endif // FLIGHT_MODEL_THREAD_H
@@ -0,0 +1,102 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Bump allocator for data that only lives until the end of the frame: draw-list pieces,
+// collision sort keys, pick candidates. Each thread bumps through its own block, so jobs need
+// no locking per allocation and freeing is a no-op; a full block is replaced from a shared
+// pool. reset() rewinds everything and must be called by the frame's owner while no other
+// thread allocates. When the pool ran dry during the frame, reset() refills it with twice the
+// blocks the frame took plus one per thread, sized for its largest request, so a steady
+// workload stops touching the heap after its first frames however the jobs are spread over
+// threads.
+class FrameArena {
+public:
+    static const unsigned kMaxThreads = 64;  // Later threads share one sub-arena under a mutex
+
+    FrameArena() = default;
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+    void reset();
+
+    // Bytes handed out since the last reset, over all threads
+    size_t bytesUsed() const;
+
+    // Heap blocks allocated over the arena's lifetime; stops growing once the workload is steady
+    uint64_t blockAllocations() const { return blockAllocationCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Block {
+        char* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct alignas(64) SubArena {
+        Block block;      // Being filled; also listed in takenBlocks
+        size_t offset = 0;
+        size_t used = 0;  // Since the last reset, alignment padding included
+    };
+
+    void* allocateFrom(SubArena& arena, size_t bytes, size_t alignment);
+    Block takeBlock(size_t minSize);
+    Block newBlock(size_t size);
+
+    SubArena subArenas[kMaxThreads];
+    SubArena overflow;
+    std::mutex overflowMutex;
+
+    std::mutex poolMutex;  // Guards the members below
+    std::vector<Block> freeBlocks;
+    std::vector<Block> takenBlocks;
+    size_t blockSize = 64 * 1024;
+    size_t largestRequest = 0;
+    bool ranShort = false;  // A block had to come from the heap this frame
+    std::atomic<uint64_t> blockAllocationCount{0};
+};
+
+// Standard allocator over a frame arena, or over the heap when the arena is null, so the same
+// container code serves callers with and without one
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator(FrameArena* arena = nullptr) : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        if (arena) {
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (!arena) {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+    FrameArena* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // FRAME_ARENA_H
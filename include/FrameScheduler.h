@@ -0,0 +1,70 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct FrameTimeStats {
+    double p50 = 0.0, p95 = 0.0, p99 = 0.0;  // Frame duration percentiles (ms)
+    double intervalP99 = 0.0;                // Start-to-start interval percentile (ms)
+    double averageFps = 0.0;
+    uint64_t frames = 0;
+    uint64_t coalescedRequests = 0;          // Redraw requests merged into an already pending frame
+};
+
+// Decides when the next frame should start. Redraw requests made while a frame is already
+// pending are merged, and frames are spaced at the target interval (snapped to whole vsync
+// intervals when vsync is on). The windowing glue turns the returned delay into a timer.
+class FrameScheduler {
+public:
+    static const int kAlreadyPending = -1;
+
+    explicit FrameScheduler(double targetFps = 60.0, double refreshHz = 60.0);
+
+    void setTargetFps(double fps);          // 0 = unthrottled
+    void setRefreshRate(double hz);
+    void setVsync(bool enabled);
+    bool vsync() const { return vsyncEnabled; }
+
+    // Continuous mode requests the next frame automatically when the current one finishes
+    void setContinuous(bool enabled) { continuous = enabled; }
+    bool isContinuous() const { return continuous; }
+
+    // Returns kAlreadyPending, 0 to draw immediately, or the delay in ms before drawing
+    int requestFrame();
+    int requestFrame(double nowSeconds);
+
+    void frameStarted();
+    void frameStarted(double nowSeconds);
+    void frameFinished();
+    void frameFinished(double nowSeconds);
+
+    // Percentiles over the last sampleCapacity frames
+    FrameTimeStats stats() const;
+    double frameInterval() const;           // Effective seconds between frame starts
+
+private:
+    static double percentile(std::vector<double>& values, double p);
+
+    double targetFps;
+    double refreshHz;
+    bool vsyncEnabled = false;
+    bool continuous = false;
+    bool framePending = false;
+    double nextFrameTime = 0.0;
+    double currentFrameStart = -1.0;
+    double previousFrameStart = -1.0;
+
+    static const size_t sampleCapacity = 512;
+    std::vector<double> durations;          // Ring buffers (ms)
+    std::vector<double> intervals;
+    size_t sampleCursor = 0;
+    uint64_t frameCount = 0;
+    uint64_t coalesced = 0;
+};
+
+// Sets the swap interval of the current context through the platform swap control extension
+bool setSwapInterval(int interval);
+
+#endif // FRAME_SCHEDULER_H
@@ -0,0 +1,32 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+// GPU passes measured with GL_TIME_ELAPSED queries
+enum class GpuPass {
+    Shadows,
+    Scene,
+    CollisionHighlight,
+    UserInterface,
+    Count
+};
+
+const char* gpuPassName(GpuPass pass);
+
+// Returns false when the context has no timer queries (GL < 3.3 without ARB_timer_query)
+bool initGpuTimers();
+void shutdownGpuTimers();
+bool gpuTimersAvailable();
+
+// Call once per frame before any pass; reads back the results of the frame issued
+// kGpuTimerLatency frames ago if they are ready, and never waits for them.
+void gpuTimerBeginFrame();
+
+// Time elapsed queries can't nest: beginning a pass inside another pauses the outer one,
+// so each pass reports only its own GPU time.
+void gpuTimerBegin(GpuPass pass);
+void gpuTimerEnd(GpuPass pass);
+
+// Smoothed milliseconds per frame, or -1 when not measured
+float gpuPassTime(GpuPass pass);
+
+#endif // GPU_TIMER_H
@@ -0,0 +1,36 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <cstdint>
+#include <vector>
+
+// Offscreen OpenGL context for rendering without a window or X server. Uses an EGL pbuffer,
+// preferring Mesa's surfaceless platform so it runs on CPU-only machines (llvmpipe).
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Creates a compatibility-profile context with a width x height color/depth surface and
+    // makes it current; returns false (with a message on stderr) if that isn't possible
+    bool create(int width, int height);
+    void destroy();
+
+    // Tightly packed, top-down RGB8 copy of the current color buffer
+    void readPixels(std::vector<uint8_t>& rgb) const;
+
+    int width() const { return surfaceWidth; }
+    int height() const { return surfaceHeight; }
+
+private:
+    void* display = nullptr;
+    void* surface = nullptr;
+    void* context = nullptr;
+    int surfaceWidth = 0;
+    int surfaceHeight = 0;
+};
+
+#endif // HEADLESS_CONTEXT_H
@@ -0,0 +1,69 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Work-stealing scheduler for per-frame CPU work over mesh ranges. Each thread owns a
+// Chase-Lev deque: the owner pushes and pops at the bottom, idle threads steal from the top
+// of a random victim. parallelFor splits its range lazily in halves, so thieves take the
+// largest pending pieces while the owner keeps working through contiguous memory. The calling
+// thread runs chunks too until its loop is finished, which makes nested calls from inside a
+// chunk safe. Up to kMaxExternalThreads non-worker threads may call parallelFor at once;
+// further callers run their loop serially.
+class JobSystem {
+public:
+    // threadCount includes the calling thread; 0 = hardware threads
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Runs body(begin, end) over [0, count) in chunks of at most grain items and returns
+    // once every chunk has finished. Chunks may run in any order on any thread. The body is
+    // called through a plain function pointer, so scheduling a loop never allocates.
+    template <typename Body>
+    void parallelFor(size_t count, size_t grain, const Body& body) {
+        run(count, grain, &invokeBody<Body>, &body);
+    }
+
+    static const unsigned kMaxExternalThreads = 4;
+
+private:
+    using BodyFunction = void (*)(const void* body, size_t begin, size_t end);
+
+    template <typename Body>
+    static void invokeBody(const void* body, size_t begin, size_t end) {
+        (*static_cast<const Body*>(body))(begin, end);
+    }
+
+    void run(size_t count, size_t grain, BodyFunction function, const void* body);
+
+    struct Task;
+    struct Range {
+        Task* task;
+        size_t begin;
+        size_t end;
+    };
+    class Deque;
+
+    bool findWork(unsigned queueIndex, Range& out);
+    void execute(unsigned queueIndex, Range range);
+    void workerLoop(unsigned workerIndex);
+
+    std::vector<std::unique_ptr<Deque>> queues;  // Workers first, then the external slots
+    std::unique_ptr<std::atomic<bool>[]> externalInUse;
+    std::vector<std::thread> workers;
+    std::atomic<int> activeTasks{0};             // parallelFor calls in progress
+    std::atomic<uint32_t> wakeCounter{0};        // Bumped to wake sleeping workers
+    std::atomic<bool> stopping{false};
+};
+
+#endif // JOB_SYSTEM_H
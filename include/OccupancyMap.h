@@ -0,0 +1,75 @@
+#ifndef OCCUPANCY_MAP_H
+#define OCCUPANCY_MAP_H
+
+#include <assimp/scene.h>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "SceneQueries.h"
+#include "VecMath.h"
+
+class JobSystem;
+
+// Sparse octree of the space the environment's triangles pass through, for collision checks
+// and path planning. The cube the triangles span is split into 2^depth voxels a side (depth
+// at most 21); a voxel is occupied when a triangle touches it (separating axis test against
+// the voxel box). The tree is pointerless: the occupied nodes are stored level by level from
+// the root, in Morton order within a level, as an 8-bit mask of their occupied children plus
+// the index of the first of those, so a child's index is that plus the number of occupied
+// children before it. Voxels are the bits of the last level's masks and take no storage of
+// their own, which leaves well under a byte per voxel for surfaces.
+class OccupancyMap {
+public:
+    // Voxelizes triangles, three vertices each, into voxels of voxelSize. Triangles are split
+    // over the job system in blocks. False (with a message) when there is nothing to voxelize
+    // or the triangles span more than 2^21 voxels.
+    bool build(std::span<const Vec3> triangles, float voxelSize, JobSystem* jobs = nullptr);
+
+    // Every triangle face of the meshes with visible[i] != 0 (all of them if visible is
+    // empty), placed by transforms[i]
+    bool build(const aiScene* scene, std::span<const Mat4> transforms, const std::vector<uint8_t>& visible,
+               float voxelSize, JobSystem* jobs = nullptr);
+
+    // The triangles the scene build() voxelizes, so a build can run on a thread that does not
+    // touch the scene
+    static void collectTriangles(const aiScene* scene, std::span<const Mat4> transforms,
+                                 const std::vector<uint8_t>& visible, std::vector<Vec3>& out);
+
+    void clear();
+    bool empty() const { return voxels == 0; }
+
+    size_t voxelCount() const { return voxels; }
+    int depth() const { return levels; }
+    float voxelSize() const { return voxel; }
+    Aabb bounds() const;             // The cube the tree covers
+    size_t memoryBytes() const;
+
+    // Whether the voxel containing point is occupied
+    bool occupied(const Vec3& point) const;
+
+    // Whether any occupied voxel overlaps box
+    bool occupied(const Aabb& box) const;
+
+    // Entry distance of the first occupied voxel the ray passes within maxDistance, in units
+    // of the ray direction (like pickMesh), or false. A ray starting inside an occupied voxel
+    // hits it at 0.
+    bool raycast(const Ray& ray, float maxDistance, float* hitDistance = nullptr) const;
+
+    // Centres of every occupied voxel, in Morton order
+    void voxelCenters(std::vector<Vec3>& out) const;
+
+private:
+    // Index of an occupied child of a node
+    uint32_t childIndex(uint32_t node, unsigned octant) const;
+    Aabb nodeBox(uint32_t x, uint32_t y, uint32_t z, int level) const;
+
+    Vec3 origin;                                // Lower corner of the cube
+    float voxel = 1.0f;
+    size_t voxels = 0;
+    int levels = 0;
+    std::vector<uint8_t> childMasks;            // Per node
+    std::vector<uint32_t> firstChild;           // Per node above the last level
+};
+
+#endif // OCCUPANCY_MAP_H
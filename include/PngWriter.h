@@ -0,0 +1,10 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <cstdint>
+#include <string>
+
+// Writes a top-down 8-bit RGB image as PNG; returns false if encoding or the file write fails
+bool writePng(const std::string& path, int width, int height, const uint8_t* rgb);
+
+#endif // PNG_WRITER_H
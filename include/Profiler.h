@@ -0,0 +1,82 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include "TraceRecorder.h"
+
+// Frame stages instrumented in display()
+enum class ProfileStage : uint8_t {
+    Frame,       // Everything in display() not covered by a nested stage
+    Lighting,
+    Shadows,
+    Traversal,
+    Collision,
+    Submission,
+    TweakBar,
+    Swap,
+    Count
+};
+
+const char* profileStageName(ProfileStage stage);
+
+#ifdef DRONE_ENABLE_PROFILER
+
+// Records one stage on scope exit into the lock-free sample ring (and the trace, while recording).
+// Time spent in nested scopes is subtracted from the exclusive time of the parent.
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileStage stage);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileStage stage;
+    uint64_t start;
+    uint64_t childTime;
+    ProfileScope* parent;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(stage)
+
+// Marks the start of a new frame; samples are tagged with the current frame number
+void profilerBeginFrame();
+uint32_t profilerFrame();
+
+// Samples of the calling thread are tagged with frame instead of the current one (0 goes back
+// to the current one), for work a render thread does on behalf of an earlier frame
+void profilerSetThreadFrame(uint32_t frame);
+
+// Average exclusive milliseconds per stage over the recent frames
+void profilerStageTimes(float outMs[static_cast<int>(ProfileStage::Count)]);
+
+// Optional GPU milliseconds shown next to the CPU bars (negative = not measured)
+void profilerSetGpuTime(ProfileStage stage, float ms);
+
+void drawProfilerOverlay(int windowWidth, int windowHeight);
+
+// Writes every sample still in the ring as CSV; returns false if the file can't be written
+bool exportProfile(const std::string& path);
+
+#else
+
+// Stages still show up in recorded traces
+#define PROFILE_SCOPE(stage) TRACE_SCOPE(profileStageName(stage), "frame")
+
+inline void profilerBeginFrame() {}
+inline uint32_t profilerFrame() { return 0; }
+inline void profilerSetThreadFrame(uint32_t) {}
+inline void profilerStageTimes(float outMs[static_cast<int>(ProfileStage::Count)]) {
+    for (int i = 0; i < static_cast<int>(ProfileStage::Count); ++i) outMs[i] = 0.0f;
+}
+inline void profilerSetGpuTime(ProfileStage, float) {}
+inline void drawProfilerOverlay(int, int) {}
+inline bool exportProfile(const std::string&) { return false; }
+
+#endif // DRONE_ENABLE_PROFILER
+
+#endif // PROFILER_H
@@ -0,0 +1,85 @@
+#ifndef QUADROTOR_DYNAMICS_H
+#define QUADROTOR_DYNAMICS_H
+
+#include <cstddef>
+#include <vector>
+#include "VecMath.h"
+
+class JobSystem;
+
+const int kQuadrotorRotors = 4;
+
+// Rigid-body quadrotor in SI units, y up. Body axes: x right, y up (thrust), z forward. Each
+// rotor pushes kT * w^2 along body y at its arm and twists the body by kQ * w^2 against its
+// spin; the body has a diagonal inertia, linear plus quadratic air drag and rotational damping.
+struct QuadrotorParameters {
+    float mass = 1.0f;                          // kg
+    Vec3 inertia = Vec3(0.01f, 0.02f, 0.01f);   // kg m^2 about the body axes
+    Vec3 arms[kQuadrotorRotors] = {             // Rotor hubs relative to the centre of mass, m
+        Vec3(0.12f, 0.0f, 0.12f), Vec3(-0.12f, 0.0f, 0.12f), Vec3(-0.12f, 0.0f, -0.12f), Vec3(0.12f, 0.0f, -0.12f)};
+    float spin[kQuadrotorRotors] = {1.0f, -1.0f, 1.0f, -1.0f};  // +1: counter-clockwise from above
+    float thrustCoefficient = 1e-5f;            // kT, N / (rad/s)^2
+    float torqueCoefficient = 1.6e-7f;          // kQ, N m / (rad/s)^2
+    float linearDrag = 0.05f;                   // N / (m/s)
+    float quadraticDrag = 0.02f;                // N / (m/s)^2
+    float angularDrag = 1e-3f;                  // N m / (rad/s)
+    float maxRotorSpeed = 1200.0f;              // rad/s
+    float gravity = 9.81f;
+
+    float hoverRotorSpeed() const;
+};
+
+// A quadrotor the size of bounds (model units, in the model's rest frame), with its rotors at
+// rotorHubs if there are four of them, otherwise in an X at the corners. Mass follows the
+// volume of the bounds, inertia is that of a solid box, and the rotors can lift twice the
+// weight. unitsPerMetre converts model units to metres.
+QuadrotorParameters quadrotorFromBounds(const Aabb& bounds, const std::vector<Vec3>& rotorHubs,
+                                        float unitsPerMetre);
+
+struct QuadrotorState {
+    Vec3 position;
+    Vec3 velocity;
+    Quat attitude;                              // Body to world
+    Vec3 angularVelocity;                       // Body axes, rad/s
+};
+
+// One RK4 step of length dt; rotor speeds (rad/s) are held over the step
+void stepQuadrotor(const QuadrotorParameters& parameters, QuadrotorState& state,
+                   const float rotorSpeeds[kQuadrotorRotors], float dt);
+
+// Cascaded PD position and attitude control with yaw held at zero: the position error gives
+// the thrust vector, the tilt to it and the yaw error give body torques, and the mixer turns
+// thrust and torques into rotor speeds within [0, maxRotorSpeed].
+void controlQuadrotor(const QuadrotorParameters& parameters, const QuadrotorState& state, const Vec3& target,
+                      float rotorSpeeds[kQuadrotorRotors]);
+
+// Many quadrotors of the same parameters in structure-of-arrays layout, padded to four lanes.
+// step() integrates four drones per Float4 operation with the same RK4 as stepQuadrotor, split
+// over the job system in blocks.
+class QuadrotorBatch {
+public:
+    static const size_t kLanes = 4;
+
+    explicit QuadrotorBatch(const QuadrotorParameters& parameters = QuadrotorParameters());
+
+    void resize(size_t count);
+    size_t size() const { return count; }
+
+    void setState(size_t index, const QuadrotorState& state);
+    QuadrotorState state(size_t index) const;
+    void setRotorSpeeds(size_t index, const float rotorSpeeds[kQuadrotorRotors]);
+
+    void step(float dt, JobSystem* jobs = nullptr);
+
+    static const int kStateSize = 13;           // Position, velocity, attitude (x y z w), body rates
+
+private:
+    void stepLanes(size_t begin, size_t end, float dt);
+
+    QuadrotorParameters parameters;
+    size_t count = 0;
+    std::vector<float> states[kStateSize];
+    std::vector<float> rotorSpeeds[kQuadrotorRotors];
+};
+
+#endif // QUADROTOR_DYNAMICS_H
@@ -0,0 +1,77 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include <assimp/scene.h>
+#include <cstdint>
+#include <vector>
+#include "VecMath.h"
+
+const int kMaxRenderLights = 8;
+
+// Fixed-function style light, already in eye space (position w = 0: directional)
+struct RenderLight {
+    float position[4] = {0.0f, 0.0f, 1.0f, 0.0f};
+    float ambient[3] = {0.0f, 0.0f, 0.0f};
+    float diffuse[3] = {1.0f, 1.0f, 1.0f};
+    float specular[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// Per-frame state; the lighting model is OpenGL's fixed-function one with GL_COLOR_MATERIAL
+struct RenderFrame {
+    int width = 0;
+    int height = 0;
+    Mat4 projection;
+    float clearColor[3] = {0.0f, 0.0f, 0.0f};
+    float globalAmbient[3] = {0.2f, 0.2f, 0.2f};  // GL_LIGHT_MODEL_AMBIENT default
+    float specular[3] = {1.0f, 1.0f, 1.0f};       // Material specular
+    float shininess = 50.0f;
+    int lightCount = 0;
+    RenderLight lights[kMaxRenderLights];
+    bool perPixelLighting = false;                // Phong instead of Gouraud (software backend)
+};
+
+struct RenderMesh {
+    const aiMesh* mesh = nullptr;
+    const aiVector3D* positions = nullptr;        // Skinned vertices replacing the mesh's own
+    const aiVector3D* normals = nullptr;          // when set; same count and order
+    Mat4 modelView;
+    float color[3] = {0.8f, 0.8f, 0.8f};          // Ambient and diffuse material color
+};
+
+// Draws triangle meshes for one frame. Implementations: GlRenderBackend (fixed-function
+// OpenGL) and SoftwareRasterizer (CPU only, see SoftwareRasterizer.h).
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual void beginFrame(const RenderFrame& frame) = 0;
+    virtual void submit(const RenderMesh& mesh) = 0;
+    virtual void endFrame() = 0;
+
+    // Shows the finished frame in the current GL framebuffer
+    virtual void present() = 0;
+
+    // Top-down RGB8 copy of the finished frame
+    virtual void readPixels(std::vector<uint8_t>& rgb) = 0;
+};
+
+// Immediate-mode OpenGL with the fixed-function pipeline; the reference for pixel comparisons.
+// Saves and restores the GL state it touches between beginFrame() and endFrame().
+class GlRenderBackend : public RenderBackend {
+public:
+    const char* name() const override { return "opengl"; }
+
+    void beginFrame(const RenderFrame& frame) override;
+    void submit(const RenderMesh& mesh) override;
+    void endFrame() override;
+    void present() override {}
+    void readPixels(std::vector<uint8_t>& rgb) override;
+
+private:
+    int width = 0;
+    int height = 0;
+};
+
+#endif // RENDER_BACKEND_H
@@ -0,0 +1,107 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <assimp/scene.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "FrameArena.h"
+#include "RenderBackend.h"
+#include "SkeletalAnimation.h"
+#include "TripleBuffer.h"
+
+class JobSystem;
+class SoftwareRasterizer;
+
+// Per-mesh state copied out of the viewer's meshInfoMap and transform hierarchy
+struct MeshState {
+    Aabb localBounds;
+    Mat4 world;  // Local to world, offset included (TransformHierarchy::meshWorld)
+    bool visible = true;
+};
+
+// Snapshot of everything frame preparation reads, built by the main thread. Once submitted it
+// is never modified, so the render thread reads it without locks.
+struct FramePacket {
+    uint64_t serial = 0;             // Assigned by RenderThread::submit
+    uint32_t profileFrame = 0;       // Profiler frame the packet was built in; tags its samples
+    const aiScene* scene = nullptr;  // Read only; must outlive the render thread
+    uint64_t sceneRevision = 0;
+    RenderFrame frame;               // Viewport, projection, eye-space lights and material
+    Mat4 view;
+    float materialColor[3] = {0.8f, 0.8f, 0.8f};
+    std::vector<MeshState> meshes;   // Indexed by mesh id
+    std::shared_ptr<const SkinnedVertices> skinning;  // CPU-skinned meshes; null when none
+    bool findCollisions = true;
+    bool softwareRendering = false;  // Also rasterize the frame on the render thread
+    uint64_t pickId = 0;             // Non-zero: pick the mesh under pickNdc
+    float pickNdc[2] = {0.0f, 0.0f};
+};
+
+// Result of preparing one packet
+struct FrameOutput {
+    uint64_t packetSerial = 0;
+    uint64_t sceneRevision = 0;
+    Mat4 viewProjection;
+    std::vector<Aabb> worldBounds;   // Empty box for hidden meshes
+    std::vector<uint8_t> inView;
+    std::vector<uint8_t> colliding;  // Empty unless the packet asked for collisions
+    uint64_t pickId = 0;             // Pick request that pickedMesh answers
+    int pickedMesh = -1;
+    int width = 0;                   // Software frame, packed RGBA8 bottom row first;
+    int height = 0;                  // empty when the packet was not rasterized
+    std::vector<uint32_t> pixels;
+};
+
+// True when both packets produce the same output; serials and profile frames are ignored
+bool sameFrameState(const FramePacket& a, const FramePacket& b);
+
+// World bounds, frustum culling, collisions and picking for one packet. With a backend the
+// visible meshes are drawn through it as well. Called on the render thread, or inline when
+// there is none (headless rendering). Per-mesh passes are split over jobs when given, and
+// their scratch buffers come from arena when given; the caller resets it afterwards.
+void prepareFrame(const FramePacket& packet, FrameOutput& output, RenderBackend* backend,
+                  JobSystem* jobs = nullptr, FrameArena* arena = nullptr);
+
+// Runs prepareFrame, and the software rasterizer when asked to, on a dedicated thread so
+// picking, collision passes and CPU rendering no longer stall input handling. Packets and
+// outputs each pass through a triple buffer: the main thread never waits for the render
+// thread and always reads the newest finished output, which may lag the last packet.
+class RenderThread {
+public:
+    // jobs (optional, shared with other threads) runs the per-mesh passes of each frame
+    explicit RenderThread(JobSystem* jobs = nullptr);
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Main thread: fill packet() completely, then submit() it; returns the packet serial
+    FramePacket& packet() { return packets.back(); }
+    uint64_t submit();
+
+    // Main thread: switches output() to the newest result; false if none arrived since
+    bool poll() { return outputs.update(); }
+    const FrameOutput& output() const { return outputs.front(); }
+
+    uint64_t submittedSerial() const { return lastSerial; }
+    uint64_t completedSerial() const { return completed.load(std::memory_order_acquire); }
+
+private:
+    void run();
+
+    TripleBuffer<FramePacket> packets;
+    TripleBuffer<FrameOutput> outputs;
+    uint64_t lastSerial = 0;                   // Main thread only
+    std::atomic<uint64_t> submitted{0};        // Bumped on every submit, waited on by run()
+    std::atomic<uint64_t> completed{0};        // Serial of the last published output
+    std::atomic<bool> stopping{false};
+    JobSystem* jobs;
+    FrameArena arena;                          // Render thread only, reset after each packet
+    std::unique_ptr<SoftwareRasterizer> rasterizer;  // Render thread only, created on demand
+    std::thread thread;
+};
+
+#endif // RENDER_THREAD_H
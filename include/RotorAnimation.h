@@ -0,0 +1,52 @@
+#ifndef ROTOR_ANIMATION_H
+#define ROTOR_ANIMATION_H
+
+#include <assimp/scene.h>
+#include <vector>
+#include "VecMath.h"
+
+class TransformHierarchy;
+
+// Spinning rotors as rigid parts: each rotor is a mesh turned about its own pivot through the
+// hierarchy's per-mesh transform, so neither the vertices nor the node tree change. Angles
+// advance on the fixed simulation steps and are interpolated for drawing like the other
+// animated state. Rotors spin independently: each has its own RPM, negative for clockwise.
+class RotorAnimation {
+public:
+    struct Rotor {
+        unsigned int mesh = 0;
+        Vec3 pivot;              // Mesh space
+        int axis = 1;            // Mesh space x, y or z
+        float rpm = 0.0f;
+        float angle = 0.0f;      // Degrees, at the current simulation step
+        float previousAngle = 0.0f;
+    };
+
+    // Meshes whose own name or whose node's name has a word "rotor", "prop", "propeller" or
+    // "blade", singular or plural, in any case (words split at non-letters and camelCase humps).
+    // The pivot is the centre of the mesh's bounds and the axis their thinnest extent, which is
+    // the disc normal of a rotor or propeller. Returns the number of rotors found.
+    size_t detect(const aiScene* scene, const TransformHierarchy& hierarchy, const std::vector<Aabb>& meshBounds);
+
+    void add(unsigned int mesh, const Aabb& bounds, float rpm = 0.0f);
+    void clear() { rotors.clear(); }
+
+    size_t size() const { return rotors.size(); }
+    const Rotor& rotor(size_t index) const { return rotors[index]; }
+    void setRpm(size_t index, float rpm) { rotors[index].rpm = rpm; }
+
+    // Advances every angle by one fixed step
+    void step(float dt);
+
+    // Sets the mesh transform of every rotor at the angle alpha of the way from the previous
+    // step to the current one; only those meshes' matrices change on the next update()
+    void apply(TransformHierarchy& hierarchy, float alpha) const;
+
+    // Rotors stop where they are; drawing them again needs no interpolation
+    void settle();
+
+private:
+    std::vector<Rotor> rotors;
+};
+
+#endif // ROTOR_ANIMATION_H
@@ -0,0 +1,74 @@
+#ifndef SCENE_QUERIES_H
+#define SCENE_QUERIES_H
+
+#include <assimp/scene.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "VecMath.h"
+
+class FrameArena;
+class JobSystem;
+class TransformHierarchy;
+
+// CPU-side scene work with no OpenGL dependency: hierarchy traversal, culling, collision
+// and picking. Shared by the viewer and the benchmark target. Functions taking a JobSystem
+// split their work into chunks over mesh ranges; null runs them on the calling thread.
+// Functions taking a FrameArena put their scratch buffers there instead of on the heap; the
+// arena must not be reset before they return.
+
+// Row-major aiMatrix4x4 to the column-major Mat4 layout
+Mat4 toMat4(const aiMatrix4x4& m);
+
+// Local-space bounds of the mesh vertices
+Aabb computeMeshBounds(const aiMesh* mesh);
+
+// One mesh reference reached by the hierarchy walk
+struct DrawItem {
+    unsigned int mesh;
+    Mat4 world;  // Node world transformation with the mesh offset applied
+};
+
+// Every mesh reference of the flattened hierarchy in depth-first order; meshes with
+// visible[mesh] == 0 are skipped (an empty visible vector means every mesh is drawn). In
+// parallel, node ranges are collected as separate jobs and concatenated in order.
+void collectDrawItems(const TransformHierarchy& hierarchy, const std::vector<uint8_t>& visible,
+                      std::vector<DrawItem>& out, JobSystem* jobs = nullptr, FrameArena* arena = nullptr);
+
+// Clip-space planes (ax + by + cz + d >= 0 inside) of a projection * view matrix
+struct Frustum {
+    float planes[6][4];
+};
+
+Frustum frustumFromMatrix(const Mat4& viewProjection);
+
+// Conservative: a box straddling a corner of the frustum may be reported visible. Scalar
+// reference; cullBounds tests four planes per step
+bool intersectsFrustum(const Frustum& frustum, const Aabb& box);
+
+// visible[i] = 1 for boxes inside or crossing the frustum; empty boxes are never visible
+void cullBounds(const Frustum& frustum, const std::vector<Aabb>& bounds, std::vector<uint8_t>& visible,
+                JobSystem* jobs = nullptr);
+
+// colliding[i] = 1 when box i overlaps any other non-empty box. Sweep and prune along x,
+// so well-separated scenes cost O(n log n) rather than testing every pair. In parallel the
+// broadphase sort runs as per-chunk sorts plus merges and the sweep is split by start box.
+void findCollisions(const std::vector<Aabb>& bounds, std::vector<uint8_t>& colliding, JobSystem* jobs = nullptr,
+                    FrameArena* arena = nullptr);
+
+struct Ray {
+    Vec3 origin;
+    Vec3 direction;  // Need not be normalized
+};
+
+// Ray through normalized device coordinates (x, y in [-1, 1]) from the near to the far plane
+Ray rayFromNdc(const Mat4& viewProjection, float ndcX, float ndcY);
+
+// Closest mesh hit by the ray, or -1. Triangles are only tested for meshes whose world bounds
+// the ray enters; transforms[i] (if present) takes mesh i from local to world space, and
+// positions[i] (if present and not null) replaces the vertices of mesh i, e.g. when skinned.
+int pickMesh(const aiScene* scene, const std::vector<Aabb>& worldBounds, std::span<const Mat4> transforms,
+             const Ray& ray, float* hitDistance = nullptr, FrameArena* arena = nullptr,
+             std::span<const aiVector3D* const> positions = {});
+
+#endif // SCENE_QUERIES_H
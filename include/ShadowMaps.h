@@ -0,0 +1,58 @@
+#ifndef SHADOW_MAPS_H
+#define SHADOW_MAPS_H
+
+#include <GL/gl.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "VecMath.h"
+
+const int kMaxShadowCascades = 4;
+
+// Quality/frame time knobs for the directional light shadows
+struct ShadowSettings {
+    int resolution = 2048;     // Per cascade, square
+    int cascadeCount = 3;      // 1..kMaxShadowCascades
+    float splitLambda = 0.75f; // 0 = uniform splits, 1 = logarithmic splits
+};
+
+// Camera description used to build the cascade slices
+struct ShadowCamera {
+    Mat4 view;                 // World to eye
+    float fovY = 45.0f;
+    float aspect = 1.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+};
+
+// Shader inputs for the current frame
+struct ShadowFrameData {
+    GLuint depthTexture = 0;
+    int cascadeCount = 0;
+    float atlasTexelSize[2] = {0.0f, 0.0f};
+    float splitDepths[kMaxShadowCascades] = {};    // Far eye depth of each cascade
+    Mat4 eyeToShadow[kMaxShadowCascades];          // Eye space to atlas texture coordinates
+};
+
+// Draws every shadow caster with the given mesh index filter; the modelview already holds the light view
+using ShadowCasterCallback = std::function<void(const std::vector<unsigned int>& meshes)>;
+
+bool initShadowMaps();
+void shutdownShadowMaps();
+
+// Fits each cascade to the visible mesh bounds. The depth of the static casters (meshes with
+// dynamicMeshes[i] == 0) is cached per cascade and re-rendered only when it no longer covers
+// the slice, or when the light direction, staticRevision or the set of dynamic meshes changed.
+// The dynamic casters are drawn every update over a copy of it.
+void updateShadowMaps(const ShadowSettings& settings, const Vec3& lightDirection, const ShadowCamera& camera,
+                      const std::vector<Aabb>& meshBounds, const std::vector<uint8_t>& dynamicMeshes,
+                      uint64_t staticRevision, const ShadowCasterCallback& drawCasters);
+
+// Null when shadows are unavailable or nothing was rendered this frame
+const ShadowFrameData* currentShadowFrame();
+void disableShadowFrame();
+
+// Number of cascades whose static depth the last update re-rendered (0 when all were reused)
+int shadowCascadesRendered();
+
+#endif // SHADOW_MAPS_H
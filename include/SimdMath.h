@@ -0,0 +1,109 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+// Four-lane float vector over SSE (x86-64), NEON (ARM) or plain floats, so the matrix and
+// culling code is written once. A column-major 4x4 matrix is one Float4 per column; wider
+// registers (AVX) would only pair up columns, so four lanes is the unit everywhere.
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SIMD_MATH_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_MATH_NEON 1
+#endif
+
+struct Float4 {
+#if defined(SIMD_MATH_SSE)
+    __m128 v;
+#elif defined(SIMD_MATH_NEON)
+    float32x4_t v;
+#else
+    float v[4];
+#endif
+};
+
+#if defined(SIMD_MATH_SSE)
+
+inline Float4 load4(const float* p) { return {_mm_loadu_ps(p)}; }  // No alignment needed
+inline void store4(float* p, Float4 a) { _mm_storeu_ps(p, a.v); }
+inline Float4 splat4(float s) { return {_mm_set1_ps(s)}; }
+inline Float4 set4(float x, float y, float z, float w) { return {_mm_setr_ps(x, y, z, w)}; }
+inline Float4 add4(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Float4 sub4(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Float4 mul4(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Float4 madd4(Float4 a, Float4 b, Float4 c) { return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; }
+inline Float4 min4(Float4 a, Float4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline Float4 max4(Float4 a, Float4 b) { return {_mm_max_ps(a.v, b.v)}; }
+inline Float4 abs4(Float4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline Float4 div4(Float4 a, Float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+inline Float4 sqrt4(Float4 a) { return {_mm_sqrt_ps(a.v)}; }
+inline int negativeMask4(Float4 a) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, _mm_setzero_ps())); }
+
+#elif defined(SIMD_MATH_NEON)
+
+inline Float4 load4(const float* p) { return {vld1q_f32(p)}; }
+inline void store4(float* p, Float4 a) { vst1q_f32(p, a.v); }
+inline Float4 splat4(float s) { return {vdupq_n_f32(s)}; }
+inline Float4 set4(float x, float y, float z, float w) {
+    const float values[4] = {x, y, z, w};
+    return {vld1q_f32(values)};
+}
+inline Float4 add4(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+inline Float4 sub4(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+inline Float4 mul4(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+inline Float4 madd4(Float4 a, Float4 b, Float4 c) { return {vmlaq_f32(c.v, a.v, b.v)}; }
+inline Float4 min4(Float4 a, Float4 b) { return {vminq_f32(a.v, b.v)}; }
+inline Float4 max4(Float4 a, Float4 b) { return {vmaxq_f32(a.v, b.v)}; }
+inline Float4 abs4(Float4 a) { return {vabsq_f32(a.v)}; }
+inline Float4 div4(Float4 a, Float4 b) { return {vdivq_f32(a.v, b.v)}; }  // AArch64
+inline Float4 sqrt4(Float4 a) { return {vsqrtq_f32(a.v)}; }
+inline int negativeMask4(Float4 a) {
+    uint32x4_t negative = vcltq_f32(a.v, vdupq_n_f32(0.0f));
+    return static_cast<int>((vgetq_lane_u32(negative, 0) & 1) | (vgetq_lane_u32(negative, 1) & 2) |
+                            (vgetq_lane_u32(negative, 2) & 4) | (vgetq_lane_u32(negative, 3) & 8));
+}
+
+#else
+
+inline Float4 load4(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store4(float* p, Float4 a) {
+    for (int i = 0; i < 4; ++i) p[i] = a.v[i];
+}
+inline Float4 splat4(float s) { return {{s, s, s, s}}; }
+inline Float4 set4(float x, float y, float z, float w) { return {{x, y, z, w}}; }
+inline Float4 add4(Float4 a, Float4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+inline Float4 sub4(Float4 a, Float4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+inline Float4 mul4(Float4 a, Float4 b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+inline Float4 madd4(Float4 a, Float4 b, Float4 c) { return add4(mul4(a, b), c); }
+inline Float4 min4(Float4 a, Float4 b) {
+    Float4 r;
+    for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+    return r;
+}
+inline Float4 max4(Float4 a, Float4 b) {
+    Float4 r;
+    for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+    return r;
+}
+inline Float4 abs4(Float4 a) {
+    Float4 r;
+    for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < 0.0f ? -a.v[i] : a.v[i];
+    return r;
+}
+inline Float4 div4(Float4 a, Float4 b) { return {{a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]}}; }
+inline Float4 sqrt4(Float4 a) {
+    Float4 r;
+    for (int i = 0; i < 4; ++i) r.v[i] = std::sqrt(a.v[i]);
+    return r;
+}
+inline int negativeMask4(Float4 a) {
+    int mask = 0;
+    for (int i = 0; i < 4; ++i) mask |= a.v[i] < 0.0f ? 1 << i : 0;
+    return mask;
+}
+
+#endif
+
+#endif // SIMD_MATH_H
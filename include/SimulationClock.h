@@ -0,0 +1,35 @@
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+// Fixed-timestep clock: the simulation always advances in whole steps of stepSeconds,
+// and rendering interpolates between the last two states with alpha().
+class SimulationClock {
+public:
+    explicit SimulationClock(double stepSeconds = 1.0 / 120.0, int maxStepsPerFrame = 8);
+
+    // Accumulates real time since the last call and returns how many steps to run now
+    int advance();
+    int advance(double nowSeconds);
+
+    // Forget accumulated time, e.g. after the scene has been idle
+    void reset();
+
+    // Fraction of a step between the previous and current simulation state
+    double alpha() const { return accumulator / step; }
+    double stepSeconds() const { return step; }
+    double simulationTime() const { return simulated; }
+    long long stepCount() const { return steps; }
+
+    // Monotonic wall clock in seconds
+    static double now();
+
+private:
+    double step;
+    int maxSteps;
+    double accumulator = 0.0;
+    double lastTime = -1.0;
+    double simulated = 0.0;
+    long long steps = 0;
+};
+
+#endif // SIMULATION_CLOCK_H
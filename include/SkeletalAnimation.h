@@ -0,0 +1,125 @@
+#ifndef SKELETAL_ANIMATION_H
+#define SKELETAL_ANIMATION_H
+
+#include <assimp/scene.h>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "VecMath.h"
+
+class JobSystem;
+class TransformHierarchy;
+
+// Local transform of every hierarchy node as translation, rotation and scale
+struct Pose {
+    std::vector<Vec3> translations;
+    std::vector<Quat> rotations;
+    std::vector<Vec3> scales;
+};
+
+// weight 0 gives a, 1 gives b; rotations are slerped. out may be a or b.
+void blendPoses(const Pose& a, const Pose& b, float weight, Pose& out);
+
+// Skinned positions and normals of one pose, indexed by mesh id; empty for meshes that were
+// not skinned on the CPU. Never modified once skin() returns it, so frame packets can share it.
+struct SkinnedVertices {
+    std::vector<std::vector<aiVector3D>> positions;
+    std::vector<std::vector<aiVector3D>> normals;
+    std::vector<Aabb> bounds;  // Mesh space, of the skinned positions
+};
+
+// Keyframed node animation and linear blend skinning for the meshes of one scene. Clips come
+// from aiAnimation channels bound to the TransformHierarchy's nodes by name; a sampled pose
+// is written back as local matrices, so bones are ordinary hierarchy nodes and their world
+// matrices come from the hierarchy's dirty-subtree update. Skins come from aiMesh bones with
+// up to kMaxInfluences weights per vertex. Bone matrices take a vertex from the bind pose to
+// the current pose in the space of the first node instancing the mesh, so a skinned mesh is
+// drawn with the same world matrix as a rigid one.
+class SkeletalAnimation {
+public:
+    static const int kMaxInfluences = 4;
+
+    void build(const aiScene* scene, const TransformHierarchy& hierarchy);
+    void clear();
+
+    size_t clipCount() const { return clips.size(); }
+    const std::string& clipName(size_t clip) const { return clips[clip].name; }
+    double clipDuration(size_t clip) const { return clips[clip].duration; }  // Seconds
+    bool hasSkins() const { return !skins.empty(); }
+    bool isSkinned(unsigned int mesh) const { return mesh < skinOfMesh.size() && skinOfMesh[mesh] >= 0; }
+
+    const Pose& restPose() const { return rest; }
+
+    // Pose at seconds into the clip, looping; nodes the clip does not animate keep the rest pose
+    void sample(size_t clip, double seconds, Pose& out) const;
+
+    // Sets the local matrix of every node some clip animates; the others are left alone
+    void apply(const Pose& pose, TransformHierarchy& hierarchy) const;
+
+    // Bone matrices of every skin from the hierarchy's current world matrices (after update())
+    void updatePalettes(const TransformHierarchy& hierarchy);
+
+    // Bone matrices of the mesh, bone order plus an identity entry last for unweighted
+    // vertices; empty for rigid meshes
+    std::span<const Mat4> palette(unsigned int mesh) const;
+
+    // Per vertex, kMaxInfluences palette indices and weights summing to one (GPU skinning)
+    const uint16_t* boneIndices(unsigned int mesh) const;
+    const float* boneWeights(unsigned int mesh) const;
+
+    // Skins every mesh on the CPU with the current palettes, one job per mesh, vectorized per
+    // vertex. Meshes whose palette has at most gpuPaletteLimit entries are left to the GPU
+    // and get no vertices. Buffers are recycled once no caller holds them any more.
+    std::shared_ptr<const SkinnedVertices> skin(JobSystem* jobs = nullptr, size_t gpuPaletteLimit = 0);
+
+    // Mesh space bounds under the current palettes without skinning: the union of every
+    // bone's bind pose bounds moved by its matrix, which holds every blend of them
+    Aabb paletteBounds(unsigned int mesh) const;
+
+private:
+    struct Track {
+        std::vector<float> times;  // Seconds, ascending
+        std::vector<Vec3> values;
+    };
+
+    struct Channel {
+        uint32_t node;
+        Track positions;
+        Track scales;
+        std::vector<float> rotationTimes;
+        std::vector<Quat> rotations;
+    };
+
+    struct Clip {
+        std::string name;
+        double duration = 0.0;
+        std::vector<Channel> channels;
+    };
+
+    struct Skin {
+        unsigned int mesh = 0;
+        int node = -1;                      // Hierarchy node the vertices are relative to
+        std::vector<int> boneNodes;
+        std::vector<Mat4> offsets;          // Mesh space to bone space in the bind pose
+        std::vector<Mat4> palette;          // One per bone plus the identity
+        std::vector<Aabb> boneBounds;       // Bind pose positions each palette entry moves
+        std::vector<uint16_t> joints;       // kMaxInfluences per vertex
+        std::vector<float> weights;
+    };
+
+    void buildSkin(const aiScene* scene, unsigned int mesh, const TransformHierarchy& hierarchy,
+                   const std::unordered_map<std::string, uint32_t>& nodeByName);
+
+    std::vector<Clip> clips;
+    std::vector<uint32_t> animatedNodes;
+    Pose rest;
+    std::vector<Skin> skins;
+    std::vector<int> skinOfMesh;
+    const aiScene* sourceScene = nullptr;
+    std::vector<std::shared_ptr<SkinnedVertices>> skinnedPool;  // Recycled when only the pool holds one
+};
+
+#endif // SKELETAL_ANIMATION_H
@@ -0,0 +1,86 @@
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RenderBackend.h"
+
+// CPU rasterizer for hosts without a GPU. submit() transforms, lights (Gouraud) and clips
+// triangles and bins them into 64x64 pixel tiles; endFrame() rasterizes the tiles in parallel
+// with SSE edge functions (4 pixels per step), a GL_LESS depth test and either interpolated
+// vertex colors or per-pixel Phong shading. Rows are stored bottom-up like OpenGL.
+class SoftwareRasterizer : public RenderBackend {
+public:
+    explicit SoftwareRasterizer(unsigned threadCount = 0);
+    ~SoftwareRasterizer() override;
+
+    SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+    SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+    const char* name() const override { return "software"; }
+
+    void beginFrame(const RenderFrame& frame) override;
+    void submit(const RenderMesh& mesh) override;
+    void endFrame() override;
+
+    // glDrawPixels into the current framebuffer
+    void present() override;
+    void readPixels(std::vector<uint8_t>& rgb) override;
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+    size_t trianglesLastFrame() const { return trianglesRasterized; }
+
+    // Packed RGBA8 (R in the lowest byte), bottom row first
+    const std::vector<uint32_t>& colorBuffer() const { return color; }
+
+    static const int kTileSize = 64;
+
+    struct Vertex {
+        float x, y, z, invW;    // Window coordinates, depth in [0, 1], 1 / clip w
+        float attributes[9];    // Gouraud: RGB; Phong: eye position, eye normal, material color
+    };
+
+    struct Triangle {
+        Vertex v[3];
+        int minX, minY, maxX, maxY;  // Pixel bounds, inclusive
+    };
+
+private:
+    void emitClipped(const float clip[3][4], const float attributes[3][9]);
+    void setupTriangle(const Vertex& a, const Vertex& b, const Vertex& c);
+    void rasterizeTile(int tileIndex);
+    void runParallel(const std::function<void(unsigned)>& task);
+    void workerLoop(unsigned workerIndex);
+
+    RenderFrame frame;
+    int width = 0, height = 0;
+    int tilesX = 0, tilesY = 0;
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+    std::vector<Triangle> triangles;
+    std::vector<float> vertexClip;        // Per vertex of the mesh being submitted, kept
+    std::vector<float> vertexAttributes;  // across submits so they stop allocating
+    std::vector<std::vector<uint32_t>> tileBins;  // Triangle indices per tile, in submission order
+    size_t trianglesRasterized = 0;
+    std::atomic<int> nextTile{0};
+
+    // Persistent workers, same scheme as the light binner
+    std::vector<std::thread> workers;
+    std::mutex workMutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    std::function<void(unsigned)> currentTask;
+    uint64_t generation = 0;
+    unsigned pendingWorkers = 0;
+    bool stopping = false;
+};
+
+// glDrawPixels of a packed RGBA8 frame (bottom row first) over the whole viewport; also used
+// for frames rasterized on the render thread
+void presentColorBuffer(int width, int height, const uint32_t* rgba);
+
+#endif // SOFTWARE_RASTERIZER_H
@@ -0,0 +1,74 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SwarmSimulation.h"
+#include "VecMath.h"
+
+class JobSystem;
+
+// Two indices found near each other: two points (first < second), or a point and an obstacle
+struct ProximityPair {
+    uint32_t first;
+    uint32_t second;
+
+    bool operator==(const ProximityPair& other) const { return first == other.first && second == other.second; }
+};
+
+// Uniform grid broadphase for point sets such as a swarm. Points are binned into cubic cells
+// of cellSize, and cells into a hash table of at least twice as many buckets as points, so the
+// grid needs no bounds and empty space costs nothing. build() is a counting sort: bucket
+// counts, an exclusive scan into bucket starts, a scatter of the point indices. With cellSize
+// >= radius, the neighbours of a point lie in the 27 cells around it; findPairs looks at its
+// own cell and half of the others, so a pass over all points costs O(n + pairs) instead of
+// the O(n^2) of testing every pair. Buckets shared by several cells
+// are told apart by a cell key kept next to each entry; cell coordinates wrap every 2^21
+// cells, which only costs extra distance tests.
+class SpatialHashGrid {
+public:
+    // Bins the first count points, which the queries read until the next build. In parallel,
+    // counts and the scatter use atomics, and each bucket is then put back in index order, so
+    // the result does not depend on scheduling.
+    void build(const SwarmVectors& points, size_t count, float cellSize, JobSystem* jobs = nullptr);
+
+    size_t size() const { return count; }
+    float cellSize() const { return cell; }
+
+    // Every pair of points at most radius apart (radius <= cellSize), ordered by first, then
+    // second: the same list findPairsBruteForce returns
+    void findPairs(float radius, std::vector<ProximityPair>& out, JobSystem* jobs = nullptr) const;
+
+    // Every (obstacle, point) with the point at most radius from the box, ordered by obstacle,
+    // then point. Boxes spanning more cells than there are points are tested against every
+    // point instead; empty boxes never touch anything.
+    void findObstacleContacts(const std::vector<Aabb>& obstacles, float radius, std::vector<ProximityPair>& out,
+                              JobSystem* jobs = nullptr) const;
+
+private:
+    uint64_t cellKey(float x, float y, float z) const;
+    uint64_t cellKey(int64_t x, int64_t y, int64_t z) const;
+    uint32_t bucket(uint64_t key) const;
+    void collectPairs(size_t begin, size_t end, float radius, std::vector<ProximityPair>& out) const;
+    void collectContacts(const Aabb& box, uint32_t obstacle, float radius, std::vector<ProximityPair>& out) const;
+
+    const SwarmVectors* points = nullptr;
+    size_t count = 0;
+    float cell = 1.0f;
+    float inverseCell = 1.0f;
+    int bucketBits = 0;
+    std::vector<uint32_t> bucketStarts;  // Bucket b holds entries [bucketStarts[b], bucketStarts[b + 1])
+    std::vector<uint32_t> entries;       // Point indices sorted by bucket
+    std::vector<uint64_t> entryKeys;     // Cell key of each entry
+    std::vector<uint32_t> pointBuckets;  // Scratch: bucket of each point
+};
+
+// Reference for findPairs: tests every pair
+void findPairsBruteForce(const SwarmVectors& points, size_t count, float radius, std::vector<ProximityPair>& out);
+
+// Reference for findObstacleContacts: tests every point against every box
+void findObstacleContactsBruteForce(const SwarmVectors& points, size_t count, const std::vector<Aabb>& obstacles,
+                                    float radius, std::vector<ProximityPair>& out);
+
+#endif // SPATIAL_HASH_H
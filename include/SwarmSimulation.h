@@ -0,0 +1,76 @@
+#ifndef SWARM_SIMULATION_H
+#define SWARM_SIMULATION_H
+
+#include <cstddef>
+#include <vector>
+#include "VecMath.h"
+
+class JobSystem;
+
+const int kSwarmRotors = 4;
+
+// Three coordinates as separate arrays, so four drones load into one Float4 per axis
+struct SwarmVectors {
+    std::vector<float> x, y, z;
+};
+
+// Formation flight: each drone is pulled towards its slot around a shared formation centre by a
+// damped spring, with the acceleration clamped to what the rotors can add to a hover
+struct SwarmParameters {
+    float stiffness = 2.0f;          // 1/s^2: acceleration per metre away from the slot
+    float damping = 2.5f;            // 1/s
+    float maxAcceleration = 6.0f;    // m/s^2, kept below gravity so thrust always points up
+    float gravity = 9.81f;
+    float hoverRpm = 5200.0f;
+    float tiltRpm = 0.08f;           // Rotor speed differential per g of horizontal acceleration
+};
+
+// Swarm state in structure-of-arrays layout. The arrays are padded to a multiple of kLanes;
+// padding drones are integrated with the rest, flying to the formation centre (their slot is
+// zero), and never reported. step() is a fixed-step semi-implicit Euler integrator that
+// advances kLanes drones per Float4 operation, split over the job system in blocks. Attitude
+// is the tilt that points the thrust (acceleration plus gravity) up through the body, without
+// yaw; rotor speeds follow the thrust it needs.
+class Swarm {
+public:
+    static const size_t kLanes = 4;
+
+    // Drones placed with place() before stepping; new ones start at the origin
+    void resize(size_t count);
+    size_t size() const { return count; }
+
+    // Puts a drone at rest, level, at position, flying towards slot (relative to the centre)
+    void place(size_t index, const Vec3& position, const Vec3& slot);
+
+    Vec3 position(size_t index) const;
+    Vec3 velocity(size_t index) const;
+    Quat orientation(size_t index) const;
+    float rotorRpm(size_t index, int rotor) const { return rotorSpeeds[rotor][index]; }
+
+    const SwarmVectors& positions() const { return currentPositions; }
+    const SwarmVectors& velocities() const { return currentVelocities; }
+
+    // One fixed step towards formationCenter + slot
+    void step(float dt, const Vec3& formationCenter, const SwarmParameters& parameters, JobSystem* jobs = nullptr);
+
+    // Same integration one drone at a time, the reference step() is checked and timed against
+    void stepScalar(float dt, const Vec3& formationCenter, const SwarmParameters& parameters);
+
+    // out[i] = translate(position alpha of the way from the previous step, times unitScale)
+    // * rotate(orientation) * model, for drawing every drone as an instance of the model
+    void writeInstances(std::vector<Mat4>& out, float alpha, const Mat4& model, float unitScale = 1.0f,
+                        JobSystem* jobs = nullptr) const;
+
+private:
+    void stepLanes(size_t begin, size_t end, float dt, const Vec3& center, const SwarmParameters& parameters);
+
+    size_t count = 0;
+    SwarmVectors currentPositions;
+    SwarmVectors previousPositions;  // At the previous step, for interpolation
+    SwarmVectors currentVelocities;
+    SwarmVectors slots;
+    std::vector<float> attitudes[4]; // x, y, z, w
+    std::vector<float> rotorSpeeds[kSwarmRotors];
+};
+
+#endif // SWARM_SIMULATION_H
@@ -0,0 +1,73 @@
+#ifndef TELEMETRY_RING_H
+#define TELEMETRY_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+const char* const kDefaultTelemetryRing = "/drone_telemetry";
+const int kTelemetryRotors = 4;
+
+// One pose from the producer. timestampNs is taken when the pose was sampled, on the same
+// monotonic clock as telemetryNowNs() and traceNowNs(), which every process on the machine shares.
+struct TelemetrySample {
+    uint64_t timestampNs;
+    uint64_t sequence;
+    float position[3];                  // Metres, y up
+    float attitude[4];                  // x, y, z, w
+    float rotorRpm[kTelemetryRotors];
+    uint32_t droneId;
+    uint32_t flags;                     // Reserved, 0
+};
+
+uint64_t telemetryNowNs();
+
+// Single-producer / single-consumer ring of TelemetrySamples in named shared memory (shm_open,
+// or a named file mapping on Windows). The producer creates it; the viewer opens it by name.
+// Neither side ever waits: push() drops the sample and counts it when the ring is full, pop()
+// returns what is there. head and tail are the only shared writes, each owned by one side and
+// on its own cache line; a sample is published by the release store of head after it is copied.
+class TelemetryRing {
+public:
+    TelemetryRing() = default;
+    ~TelemetryRing();
+
+    TelemetryRing(const TelemetryRing&) = delete;
+    TelemetryRing& operator=(const TelemetryRing&) = delete;
+
+    // Producer: a new ring of capacity samples (rounded up to a power of two), replacing any
+    // ring left under that name; close() removes the name again
+    bool create(const std::string& name, uint32_t capacity);
+
+    // Consumer: attaches to a ring some producer created; false, quietly, if there is none yet
+    bool open(const std::string& name);
+
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    // Producer side
+    bool push(const TelemetrySample& sample);
+
+    // Consumer side: copies up to maxCount of the oldest samples and returns how many
+    size_t pop(TelemetrySample* out, size_t maxCount);
+
+    uint32_t capacity() const;
+    uint64_t pushed() const;   // Samples accepted since create()
+    uint64_t dropped() const;  // Samples refused because the consumer fell behind
+
+private:
+    struct Header;
+
+    bool map(const std::string& name, size_t size, bool creating);
+
+    Header* header = nullptr;
+    TelemetrySample* samples = nullptr;
+    size_t mappingSize = 0;
+    std::string ownedName;  // Set on the producer, which unlinks it
+#ifdef _WIN32
+    void* mappingHandle = nullptr;
+#endif
+};
+
+#endif // TELEMETRY_RING_H
@@ -0,0 +1,49 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <cstdint>
+#include <string>
+
+// Chrome Trace Event / Perfetto timeline recorder. Every thread appends to its own buffer,
+// so recording threads never contend with each other; buffers are merged only on export.
+
+uint64_t traceNowNs();
+
+void traceStart();
+void traceStop();
+bool traceRecording();
+
+// Names shown for the calling thread's track
+void traceSetThreadName(const std::string& name);
+
+// name and category must outlive the recorder (string literals)
+void traceComplete(const char* name, const char* category, uint64_t startNs, uint64_t durationNs);
+void traceInstant(const char* name, const char* category);
+
+// Writes a Chrome Trace Event JSON file loadable in chrome://tracing or ui.perfetto.dev
+bool traceExport(const std::string& path);
+
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* category)
+        : name(name), category(category), start(traceRecording() ? traceNowNs() : 0) {}
+    ~TraceScope() {
+        if (start != 0) {
+            traceComplete(name, category, start, traceNowNs() - start);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name, category)
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,80 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <assimp/scene.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "VecMath.h"
+
+// The aiNode tree flattened into depth-first order: a node's descendants directly follow it,
+// and every parent comes before its children, so world matrices are one linear pass of
+// parent * local products over contiguous arrays. Only subtrees marked dirty are recomputed.
+//
+// Meshes moved in the viewer carry a world-space offset on top of their node's transform, and
+// animated parts (rotors) a mesh-space transform below it. meshWorld(mesh) caches
+// translate(offset) * world * transform for the first node that references the mesh; per-mesh
+// queries (bounds, picking) use that instance. Changing only a mesh transform recomputes that
+// one matrix, not the node's subtree.
+class TransformHierarchy {
+public:
+    void build(const aiScene* scene);
+    void clear();
+
+    size_t size() const { return parents.size(); }
+    size_t meshCount() const { return meshOffsets.size(); }
+
+    int parent(size_t index) const { return parents[index]; }             // -1 for the root
+    size_t subtreeEnd(size_t index) const { return subtreeEnds[index]; }  // One past the last descendant
+    int object(size_t index) const { return objects[index]; }  // Root child it belongs to; 0 at the root
+    const aiNode* node(size_t index) const { return nodes[index]; }
+    std::span<const unsigned int> meshes(size_t index) const {
+        return {meshIds.data() + meshBegin[index], meshIds.data() + meshBegin[index + 1]};
+    }
+
+    const Mat4& local(size_t index) const { return locals[index]; }
+    const Mat4& world(size_t index) const { return worlds[index]; }
+    const Mat4& meshWorld(unsigned int mesh) const { return meshWorldMatrices[mesh]; }
+    std::span<const Mat4> meshWorlds() const { return meshWorldMatrices; }
+    const Vec3& meshOffset(unsigned int mesh) const { return meshOffsets[mesh]; }
+    const Mat4& meshTransform(unsigned int mesh) const { return meshTransforms[mesh]; }
+    int meshNode(unsigned int mesh) const { return meshNodes[mesh]; }  // -1 if no node references it
+
+    // translate(offset of mesh) * world(node) * transform of mesh: the mesh as instanced by that node
+    Mat4 instanceWorld(size_t index, unsigned int mesh) const;
+
+    // The matrices change on the next update()
+    void setLocal(size_t index, const Mat4& local);
+    void setMeshOffset(unsigned int mesh, const Vec3& offset);
+    void setMeshTransform(unsigned int mesh, const Mat4& transform);
+
+    // Recomputes the world matrices of dirty subtrees and the mesh matrices of changed mesh
+    // transforms; returns the number of nodes updated
+    size_t update();
+
+private:
+    void append(const aiNode* node, int parent, int object);
+    void markDirty(size_t index);
+    Mat4 meshMatrix(const Mat4& world, unsigned int mesh) const;
+
+    std::vector<int> parents;
+    std::vector<uint32_t> subtreeEnds;
+    std::vector<int> objects;
+    std::vector<const aiNode*> nodes;
+    std::vector<uint32_t> meshBegin;  // size() + 1 entries into meshIds
+    std::vector<unsigned int> meshIds;
+    std::vector<Mat4> locals;
+    std::vector<Mat4> worlds;
+    std::vector<uint8_t> dirty;       // Node and its subtree need new world matrices
+    bool anyDirty = false;
+
+    std::vector<Vec3> meshOffsets;
+    std::vector<int> meshNodes;
+    std::vector<Mat4> meshWorldMatrices;
+    std::vector<Mat4> meshTransforms;
+    std::vector<uint8_t> meshTransformed;      // Transform is not the identity
+    std::vector<uint8_t> meshDirty;            // In dirtyMeshes
+    std::vector<unsigned int> dirtyMeshes;     // Transform changed since the last update()
+};
+
+#endif // TRANSFORM_HIERARCHY_H
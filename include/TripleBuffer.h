@@ -0,0 +1,45 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer between one writer and one reader thread. The writer fills back()
+// and publish()es it; the reader calls update() to make the newest published slot its front().
+// Neither side ever waits: values the reader did not get to are dropped, and the three slots
+// are reused, so containers inside T keep their capacity from frame to frame.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer side. Holds whatever was last written to this slot, so overwrite every field.
+    T& back() { return slots[backIndex]; }
+
+    // Writer: hands back() to the reader and continues in the slot the reader released
+    void publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(backIndex | kFresh), std::memory_order_acq_rel);
+        backIndex = previous & kIndexMask;
+    }
+
+    // Reader: switches front() to the newest published slot; false if nothing new arrived
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & kFresh)) {
+            return false;
+        }
+        uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & kIndexMask;
+        return true;
+    }
+
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static const uint8_t kIndexMask = 0x3;
+    static const uint8_t kFresh = 0x4;  // Middle slot was published and not yet taken
+
+    T slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t backIndex = 0;   // Writer only
+    uint8_t frontIndex = 2;  // Reader only
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -0,0 +1,308 @@
+#ifndef VEC_MATH_H
+#define VEC_MATH_H
+
+#include <cmath>
+#include "SimdMath.h"
+
+// Small vector/matrix/quaternion helpers. Matrices are column-major like OpenGL
+// (m[col * 4 + row]); products and box transforms run one Float4 per column.
+
+struct Vec3 {
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+
+    Vec3() = default;
+    Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+    Vec3 operator+(const Vec3& o) const { return {x + o.x, y + o.y, z + o.z}; }
+    Vec3 operator-(const Vec3& o) const { return {x - o.x, y - o.y, z - o.z}; }
+    Vec3 operator*(float s) const { return {x * s, y * s, z * s}; }
+    Vec3 operator-() const { return {-x, -y, -z}; }
+    float operator[](int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+};
+
+inline float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 cross(const Vec3& a, const Vec3& b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+inline float length(const Vec3& v) { return std::sqrt(dot(v, v)); }
+inline Vec3 normalize(const Vec3& v) {
+    float len = length(v);
+    return len > 0.0f ? v * (1.0f / len) : v;
+}
+
+struct Mat4 {
+    float m[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+    static Mat4 fromArray(const float values[16]) {
+        Mat4 r;
+        for (int i = 0; i < 16; ++i) r.m[i] = values[i];
+        return r;
+    }
+};
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b) {
+    Float4 a0 = load4(a.m), a1 = load4(a.m + 4), a2 = load4(a.m + 8), a3 = load4(a.m + 12);
+    Mat4 r;
+    for (int col = 0; col < 4; ++col) {
+        const float* c = b.m + col * 4;
+        Float4 sum = mul4(a0, splat4(c[0]));
+        sum = madd4(a1, splat4(c[1]), sum);
+        sum = madd4(a2, splat4(c[2]), sum);
+        sum = madd4(a3, splat4(c[3]), sum);
+        store4(r.m + col * 4, sum);
+    }
+    return r;
+}
+
+// Element-by-element product, the reference the vector version is checked and timed against
+inline Mat4 multiplyScalar(const Mat4& a, const Mat4& b) {
+    Mat4 r;
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            r.m[col * 4 + row] = a.m[row] * b.m[col * 4] + a.m[4 + row] * b.m[col * 4 + 1] +
+                                 a.m[8 + row] * b.m[col * 4 + 2] + a.m[12 + row] * b.m[col * 4 + 3];
+        }
+    }
+    return r;
+}
+
+inline Vec3 transformPoint(const Mat4& a, const Vec3& p) {
+    return {a.m[0] * p.x + a.m[4] * p.y + a.m[8] * p.z + a.m[12],
+            a.m[1] * p.x + a.m[5] * p.y + a.m[9] * p.z + a.m[13],
+            a.m[2] * p.x + a.m[6] * p.y + a.m[10] * p.z + a.m[14]};
+}
+
+inline Vec3 transformDirection(const Mat4& a, const Vec3& d) {
+    return {a.m[0] * d.x + a.m[4] * d.y + a.m[8] * d.z,
+            a.m[1] * d.x + a.m[5] * d.y + a.m[9] * d.z,
+            a.m[2] * d.x + a.m[6] * d.y + a.m[10] * d.z};
+}
+
+inline Mat4 makeTranslation(const Vec3& t) {
+    Mat4 r;
+    r.m[12] = t.x;
+    r.m[13] = t.y;
+    r.m[14] = t.z;
+    return r;
+}
+
+inline Mat4 makeScale(const Vec3& s) {
+    Mat4 r;
+    r.m[0] = s.x;
+    r.m[5] = s.y;
+    r.m[10] = s.z;
+    return r;
+}
+
+// Same matrix as glRotatef (angle in degrees around a unit axis)
+inline Mat4 makeRotation(float angleDegrees, const Vec3& axis) {
+    Vec3 a = normalize(axis);
+    float radians = angleDegrees * static_cast<float>(M_PI) / 180.0f;
+    float c = std::cos(radians), s = std::sin(radians), t = 1.0f - c;
+    Mat4 r;
+    r.m[0] = t * a.x * a.x + c;       r.m[4] = t * a.x * a.y - s * a.z; r.m[8] = t * a.x * a.z + s * a.y;
+    r.m[1] = t * a.x * a.y + s * a.z; r.m[5] = t * a.y * a.y + c;       r.m[9] = t * a.y * a.z - s * a.x;
+    r.m[2] = t * a.x * a.z - s * a.y; r.m[6] = t * a.y * a.z + s * a.x; r.m[10] = t * a.z * a.z + c;
+    return r;
+}
+
+// Same matrix as gluLookAt
+inline Mat4 makeLookAt(const Vec3& eye, const Vec3& center, const Vec3& up) {
+    Vec3 f = normalize(center - eye);
+    Vec3 s = normalize(cross(f, up));
+    Vec3 u = cross(s, f);
+    Mat4 r;
+    r.m[0] = s.x;  r.m[4] = s.y;  r.m[8] = s.z;
+    r.m[1] = u.x;  r.m[5] = u.y;  r.m[9] = u.z;
+    r.m[2] = -f.x; r.m[6] = -f.y; r.m[10] = -f.z;
+    r.m[12] = -dot(s, eye);
+    r.m[13] = -dot(u, eye);
+    r.m[14] = dot(f, eye);
+    return r;
+}
+
+// Same matrix as glOrtho
+inline Mat4 makeOrtho(float left, float right, float bottom, float top, float nearPlane, float farPlane) {
+    Mat4 r;
+    r.m[0] = 2.0f / (right - left);
+    r.m[5] = 2.0f / (top - bottom);
+    r.m[10] = -2.0f / (farPlane - nearPlane);
+    r.m[12] = -(right + left) / (right - left);
+    r.m[13] = -(top + bottom) / (top - bottom);
+    r.m[14] = -(farPlane + nearPlane) / (farPlane - nearPlane);
+    return r;
+}
+
+// Same matrix as gluPerspective (fovY in degrees)
+inline Mat4 makePerspective(float fovY, float aspect, float nearPlane, float farPlane) {
+    float f = 1.0f / std::tan(fovY * 0.5f * static_cast<float>(M_PI) / 180.0f);
+    Mat4 r;
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+    r.m[11] = -1.0f;
+    r.m[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+    r.m[15] = 0.0f;
+    return r;
+}
+
+// Unit quaternion (w + xi + yj + zk); the identity by default
+struct Quat {
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+
+    Quat() = default;
+    Quat(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+};
+
+// Same rotation as makeRotation (angle in degrees around an axis)
+inline Quat makeQuat(float angleDegrees, const Vec3& axis) {
+    Vec3 a = normalize(axis);
+    float half = angleDegrees * static_cast<float>(M_PI) / 360.0f;
+    float s = std::sin(half);
+    return {a.x * s, a.y * s, a.z * s, std::cos(half)};
+}
+
+// a * b rotates by b first, like the matrix product
+inline Quat operator*(const Quat& a, const Quat& b) {
+    return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+inline Quat normalize(const Quat& q) {
+    float len = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    return len > 0.0f ? Quat(q.x / len, q.y / len, q.z / len, q.w / len) : Quat();
+}
+
+inline Vec3 rotate(const Quat& q, const Vec3& v) {
+    Vec3 u(q.x, q.y, q.z);
+    Vec3 t = cross(u, v) * 2.0f;
+    return v + t * q.w + cross(u, t);
+}
+
+inline Mat4 makeRotation(const Quat& q) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    Mat4 r;
+    r.m[0] = 1.0f - 2.0f * (yy + zz); r.m[4] = 2.0f * (xy - wz);        r.m[8] = 2.0f * (xz + wy);
+    r.m[1] = 2.0f * (xy + wz);        r.m[5] = 1.0f - 2.0f * (xx + zz); r.m[9] = 2.0f * (yz - wx);
+    r.m[2] = 2.0f * (xz - wy);        r.m[6] = 2.0f * (yz + wx);        r.m[10] = 1.0f - 2.0f * (xx + yy);
+    return r;
+}
+
+// Shortest-arc interpolation at constant angular speed; falls back to a normalized lerp when
+// the two rotations are almost equal
+inline Quat slerp(const Quat& a, const Quat& b, float t) {
+    float cosine = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    Quat to = b;
+    if (cosine < 0.0f) {
+        cosine = -cosine;
+        to = Quat(-b.x, -b.y, -b.z, -b.w);
+    }
+    float wa = 1.0f - t, wb = t;
+    if (cosine < 0.9995f) {
+        float angle = std::acos(cosine);
+        float s = 1.0f / std::sin(angle);
+        wa = std::sin(wa * angle) * s;
+        wb = std::sin(wb * angle) * s;
+    }
+    return normalize(Quat(a.x * wa + to.x * wb, a.y * wa + to.y * wb, a.z * wa + to.z * wb, a.w * wa + to.w * wb));
+}
+
+// General 4x4 inverse (cofactor expansion); returns identity for singular input
+inline Mat4 inverse(const Mat4& a) {
+    const float* m = a.m;
+    float inv[16];
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (det == 0.0f) {
+        return Mat4();
+    }
+    Mat4 r;
+    det = 1.0f / det;
+    for (int i = 0; i < 16; ++i) r.m[i] = inv[i] * det;
+    return r;
+}
+
+// Axis-aligned bounding box
+struct Aabb {
+    Vec3 min{1e30f, 1e30f, 1e30f};
+    Vec3 max{-1e30f, -1e30f, -1e30f};
+
+    bool empty() const { return min.x > max.x; }
+    void expand(const Vec3& p) {
+        min = {std::fmin(min.x, p.x), std::fmin(min.y, p.y), std::fmin(min.z, p.z)};
+        max = {std::fmax(max.x, p.x), std::fmax(max.y, p.y), std::fmax(max.z, p.z)};
+    }
+    void expand(const Aabb& b) {
+        if (!b.empty()) {
+            expand(b.min);
+            expand(b.max);
+        }
+    }
+    Vec3 center() const { return (min + max) * 0.5f; }
+    Vec3 corner(int i) const { return {(i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z}; }
+};
+
+inline bool overlaps(const Aabb& a, const Aabb& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// AABB of the eight transformed corners (affine m), via the transformed center and the
+// absolute matrix applied to the half extents (Arvo) instead of transforming every corner
+inline Aabb transformAabb(const Mat4& m, const Aabb& box) {
+    Aabb r;
+    if (box.empty()) return r;
+    Vec3 c = box.center();
+    Vec3 half = (box.max - box.min) * 0.5f;
+    Float4 col0 = load4(m.m), col1 = load4(m.m + 4), col2 = load4(m.m + 8);
+    Float4 center = mul4(col0, splat4(c.x));
+    center = madd4(col1, splat4(c.y), center);
+    center = madd4(col2, splat4(c.z), center);
+    center = add4(center, load4(m.m + 12));
+    Float4 extent = mul4(abs4(col0), splat4(half.x));
+    extent = madd4(abs4(col1), splat4(half.y), extent);
+    extent = madd4(abs4(col2), splat4(half.z), extent);
+    float lo[4], hi[4];
+    store4(lo, sub4(center, extent));
+    store4(hi, add4(center, extent));
+    r.min = {lo[0], lo[1], lo[2]};
+    r.max = {hi[0], hi[1], hi[2]};
+    return r;
+}
+
+// Same box one component at a time; the reference for transformAabb
+inline Aabb transformAabbScalar(const Mat4& m, const Aabb& box) {
+    Aabb r;
+    if (box.empty()) return r;
+    Vec3 center = transformPoint(m, box.center());
+    Vec3 half = (box.max - box.min) * 0.5f;
+    Vec3 extent(std::fabs(m.m[0]) * half.x + std::fabs(m.m[4]) * half.y + std::fabs(m.m[8]) * half.z,
+                std::fabs(m.m[1]) * half.x + std::fabs(m.m[5]) * half.y + std::fabs(m.m[9]) * half.z,
+                std::fabs(m.m[2]) * half.x + std::fabs(m.m[6]) * half.y + std::fabs(m.m[10]) * half.z);
+    r.min = center - extent;
+    r.max = center + extent;
+    return r;
+}
+
+#endif // VEC_MATH_H
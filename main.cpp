@@ -11,6 +11,42 @@
 #include "bin/Debug/stb_image.h"
 #include <map>
 #include <algorithm>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include "ClusteredLighting.h"
+#include "ShadowMaps.h"
+#include "SimulationClock.h"
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
+#include "TraceRecorder.h"
+#include "HeadlessContext.h"
+#include "PngWriter.h"
+#include "AssetImportPool.h"
+#include "SceneQueries.h"
+#include "RenderBackend.h"
+#include "SoftwareRasterizer.h"
+#include "RenderThread.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "TransformHierarchy.h"
+#include "SkeletalAnimation.h"
+#include "RotorAnimation.h"
+#include "FlightLog.h"
+#include "TelemetryRing.h"
+#include "SpatialHash.h"
+#include "SwarmSimulation.h"
+#include "FlightModelThread.h"
+#include "OccupancyMap.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 
 // Existing camera settings
 float cameraDistance = 5.0f;
@@ -34,6 +70,9 @@ int selectedMeshIndex = -1;
 const aiScene* scene = nullptr;
 Assimp::Importer importer;
 std::string modelPath = "/home/bakr/Drone.obj";
+// At most four bone weights per vertex, as the skinning code expects
+const unsigned kModelImportFlags =
+    aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_LimitBoneWeights;
 
 // Texture variables
 GLuint textureID;
@@ -52,6 +91,57 @@ float lightColor[3][3] = {{1.0f, 1.0f, 1.0f}, // Light 0 color (white)
                           {1.0f, 0.5f, 0.0f}, // Light 1 color (orange)
                           {0.0f, 0.0f, 1.0f}}; // Light 2 color (blue)
 
+// Clustered point lights (landing-pad and navigation lights on top of the legacy lights 1 and 2)
+bool useClusteredLighting = true;
+int navigationLightCount = 0;
+std::vector<PointLight> pointLights;
+ClusterGridConfig clusterGrid;
+
+// Projection settings shared by reshape and the light clusters
+const float projectionFovY = 45.0f;
+const float projectionNear = 0.1f;
+const float projectionFar = 100.0f;
+int windowWidth = 800;
+int windowHeight = 600;
+float sceneRadius = 1.0f;
+
+// Cascaded shadow maps for the directional light (shader path only)
+bool shadowsEnabled = true;
+ShadowSettings shadowSettings;
+uint64_t sceneRevision = 0;           // Bumped when placement or visibility changes outside markAnimatedMeshes
+uint64_t geometryRevision = 0;        // Bumped when the model, a mesh's visibility or its offset changes
+std::vector<uint8_t> meshAnimated;    // Per mesh: moved by a running animation, drawn over the cached shadows
+std::vector<Aabb> meshLocalBounds;    // Per mesh; skinned meshes follow their current pose
+TransformHierarchy sceneTransforms;   // Node tree of the active scene with cached world matrices
+std::vector<Aabb> meshWorldBounds;    // Per mesh, empty when hidden
+
+// Per-frame scene queries (see SceneQueries.h)
+Mat4 cameraViewProjection;            // Projection * view of the last drawn frame, used for picking
+std::vector<uint8_t> meshInView;      // Frustum culling result per mesh
+std::vector<uint8_t> meshColliding;   // Bounds overlap another visible mesh
+
+// CPU rendering through the RenderBackend interface ('b' toggles, --software starts with it).
+// Covers the fixed-function lighting path only: no textures, shadows or clustered lights.
+bool softwareRendering = false;
+bool softwarePerPixelLighting = false;
+std::unique_ptr<SoftwareRasterizer> softwareRasterizer;
+
+// Culling, collisions, picking and software frames run on a render thread fed with per-frame
+// packets (--no-render-thread keeps everything on the GLUT thread). GL calls stay on this thread.
+bool useRenderThread = true;
+unsigned frameJobThreads = 0;          // --frame-jobs N: 0 = hardware threads, 1 = serial
+std::unique_ptr<JobSystem> frameJobs;  // Work-stealing pool for the per-mesh passes
+std::unique_ptr<RenderThread> renderThread;
+FramePacket lastSubmittedPacket;      // To skip packets that would not change the output
+FramePacket inlinePacket;             // Used when there is no render thread
+FrameOutput inlineOutput;
+uint64_t preparedSceneRevision = 0;   // Scene revision the adopted bounds were computed for
+uint64_t nextPickId = 0;
+uint64_t pendingPickId = 0;           // Pick sent to the render thread and not answered yet
+float pendingPickNdc[2] = {0.0f, 0.0f};
+bool renderThreadPollArmed = false;
+FrameArena frameArena;                // Scratch of the frame on this thread, reset at the end of display()
+
 // AntTweakBar handle
 TwBar* tweakBar;
 
@@ -63,8 +153,6 @@ int lastMouseY = 0;
 
 bool showCollisionHighlights = true;
 
-// Selection buffer
-GLuint selectBuf[512];
 
 // Lighting settings
 void setupLighting() {
@@ -74,105 +162,770 @@ void setupLighting() {
 }
 // Function prototypes
 void toggleCollisionHighlights();
-bool checkCollision(const aiMesh* mesh1, const aiMesh* mesh2);
-void drawCollisionHighlight(const aiMesh* mesh);
+void drawCollisionHighlight(unsigned int meshID, const aiMesh* mesh);
+void requestRedraw();
 
 
 int selectedObjectIndex = -1; // No object selected by default
 bool animateSelectedObject = false;
-float animationAngle = 0.0f; // Rotation angle
-const float animationSpeed = 2.0f; // Speed of rotation (degrees per frame)
+float animationAngle = 0.0f;         // Rotation angle at the current simulation step
+float previousAnimationAngle = 0.0f; // Rotation angle at the previous simulation step
+float renderAnimationAngle = 0.0f;   // Interpolated angle used for drawing
+float animationSpeed = 120.0f;       // Speed of rotation (degrees per second)
+
+// Fixed-timestep simulation and redraw control
+SimulationClock simulationClock(1.0 / 120.0);
+bool onDemandRedraw = true;          // Only redraw on input or while something animates
+
+// Frame pacing: redraw requests are coalesced and spaced at the target frame rate
+FrameScheduler frameScheduler;
+float targetFrameRate = 60.0f;       // 0 = unthrottled
+float displayRefreshRate = 60.0f;
+bool vsyncEnabled = true;
+int appliedSwapInterval = -1;
+float frameTimeP50 = 0.0f, frameTimeP95 = 0.0f, frameTimeP99 = 0.0f, measuredFps = 0.0f;
+
+// Per-stage CPU profiler overlay (compiled in with DRONE_ENABLE_PROFILER)
+bool showProfilerOverlay = false;
+
+// Chrome trace recording ('t' toggles, --trace records from startup)
+const std::string tracePath = "drone_trace.json";
+
+// Keyframed clips of the loaded file and skinned meshes (see SkeletalAnimation.h). The clip
+// time advances with the fixed simulation steps; the pose drawn is interpolated between them.
+SkeletalAnimation skeletalAnimation;
+bool playSkeletalAnimation = true;
+int animationClip = 0;
+int blendClip = 0;                   // Mixed in with blendWeight
+float blendWeight = 0.0f;
+float clipSpeed = 1.0f;              // Playback rate
+bool gpuSkinning = false;            // Skin in the lighting shader when nothing else needs the vertices
+double clipTime = 0.0, previousClipTime = 0.0, renderClipTime = 0.0;
+Pose clipPose, blendPose;
+std::shared_ptr<const SkinnedVertices> skinnedVertices;  // CPU-skinned meshes of the drawn pose
+bool skinnedPoseStale = true;
+bool gpuSkinningActive = false;      // For the frame being drawn
+
+// Rotor meshes found by name, spun about their own pivots (see RotorAnimation.h). They turn at
+// the flown speeds while a replay, telemetry or the flight model flies the model, and at the
+// RPM setting when Spin Rotors is on. Alternate rotors turn in opposite directions; the yaw
+// differential speeds up one direction and slows the other by that fraction, as a multirotor
+// does to yaw.
+RotorAnimation rotorAnimation;
+bool spinRotors = false;
+float rotorRpm = 2400.0f;
+float rotorYawDifferential = 0.0f;
+
+// Recorded flight replayed onto the model (--replay log.bin, see FlightLog.h). The pose moves
+// the root node relative to the first record, so the flight starts where the model sits; the
+// log's rotor speeds replace the RPM setting while it plays.
+FlightLog flightLog;
+bool replayFlight = true;
+bool replayLoop = true;
+float replaySpeed = 1.0f;
+float replayScale = 1.0f;            // Model units per metre
+double replayTime = 0.0, previousReplayTime = 0.0, renderReplayTime = 0.0;  // Seconds into the log
+size_t replayCursor = 0;
+FlightSample replaySample;
+Mat4 replayRootRest;                 // Root transform of the model without the flight pose
+
+// Live poses from a local producer (--telemetry [ring], e.g. TelemetrySim) through a shared
+// memory ring, drained without waiting once per frame. The newest sample places the model like
+// a replayed log and takes precedence over it. Latency runs from the sample's timestamp to the
+// swap of the frame that shows it.
+TelemetryRing telemetryRing;
+std::string telemetryRingName;       // Empty without --telemetry
+TelemetrySample telemetrySample;
+bool telemetryReceived = false;      // telemetrySample is valid
+Vec3 telemetryOrigin;                // First position received
+uint64_t telemetryLastSampleNs = 0;  // Local time the last sample arrived
+uint64_t telemetryNextAttemptNs = 0;
+uint64_t telemetryFrameSampleNs = 0; // Timestamp of the sample drawn this frame, 0 if none new
+uint64_t telemetrySamplesSinceStats = 0;
+std::vector<float> telemetryLatencies;  // Milliseconds, since the last stats refresh
+float telemetryLatencyP50 = 0.0f, telemetryLatencyP99 = 0.0f, telemetryRate = 0.0f;
+unsigned telemetryDropped = 0;
+
+// Quadrotor flight model flying the model round a circuit (--fly, see QuadrotorDynamics.h),
+// stepped at 1 kHz on its own thread. Mass, inertia and rotor layout come from the model's
+// bounds and rotors; it takes precedence over a replay, and live telemetry over it.
+std::unique_ptr<FlightModelThread> flightModel;
+bool flyModel = false;
+FlightPlan flightPlan, sentFlightPlan;
+bool flightPlanFitted = false;       // Circuit sized to the model once
+bool flightReceived = false;         // The model is at a flight model pose
+Vec3 flightPivot;                    // Centre of mass in the model's rest frame, model units
+float flightRotorRpm[kQuadrotorRotors] = {};
+float flightMass = 0.0f, flightHoverRpm = 0.0f;
+
+// Copies of the model flying in formation around it (--swarm N, see SwarmSimulation.h), stepped
+// with the other fixed-step state in metres (Replay's units per metre scale them to the model).
+// The OpenGL path draws each visible drone as an instance of one display list of the model,
+// recompiled only when the model's geometry changes.
+Swarm swarm;
+int swarmSize = 0;                   // Drones asked for; the swarm is laid out again on change
+int swarmLayoutSize = -1;
+const aiScene* swarmLayoutScene = nullptr;
+bool flySwarm = true;
+float swarmSpacing = 3.0f;           // Slot spacing in model sizes
+SwarmParameters swarmParameters;
+double swarmTime = 0.0;
+std::vector<Mat4> swarmInstances;
+GLuint swarmList = 0;
+uint64_t swarmListRevision = UINT64_MAX;
+Aabb swarmModelBounds;               // Model bounds in the space of its root node
+
+// Swarm broadphase, rebuilt after every swarm step (see SpatialHash.h): drones within a model
+// size of each other, or within half of one of a mesh of the model, are near something and
+// get outlined with the collision highlights
+SpatialHashGrid swarmGrid;
+std::vector<ProximityPair> swarmNearPairs;
+std::vector<ProximityPair> swarmContacts;
+std::vector<Aabb> swarmObstacles;    // Mesh world bounds in metres
+std::vector<uint8_t> swarmNear;      // Per drone
+int swarmNearPairCount = 0;
+int swarmContactCount = 0;
+
+// Occupancy octree of the model (see OccupancyMap.h) in its rest frame, where it sits without a
+// flight pose, rebuilt when a model is loaded or the resolution changes. Swarm drones within
+// the bounds of a mesh only count as touching the model when the map has an occupied voxel in
+// their contact box, taken into the rest frame through the current root pose. Builds run on
+// their own thread over a copy of the triangles and replace the map when they finish, so
+// dragging the resolution never stalls this thread; a new model drops the old map at once.
+struct OccupancyBuild {
+    std::vector<Vec3> triangles;
+    float voxelSize = 1.0f;
+    bool stale = false;              // The model changed since the build started
+    OccupancyMap map;
+    std::atomic<bool> done{false};
+    std::thread thread;
+
+    ~OccupancyBuild() {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+};
+OccupancyMap occupancyMap;
+std::unique_ptr<OccupancyBuild> occupancyBuild;
+float occupancyResolution = 64.0f;   // Voxels across the model's largest extent
+float occupancyBuiltResolution = 0.0f;  // Of the map, or of the build in flight
+const aiScene* occupancyScene = nullptr;
+bool showOccupancy = false;
+std::vector<Vec3> occupancyCenters;
+int occupancyVoxelCount = 0;
+float occupancyKilobytes = 0.0f;
+
+// Vertices to draw: the CPU-skinned ones when the current pose has them
+const aiVector3D* meshPositions(unsigned int meshID, const aiMesh* mesh) {
+    if (skinnedVertices && meshID < skinnedVertices->positions.size() && !skinnedVertices->positions[meshID].empty()) {
+        return skinnedVertices->positions[meshID].data();
+    }
+    return mesh->mVertices;
+}
 
-void renderSelectedObject(const aiMesh* mesh) {
-    glPushMatrix();
+const aiVector3D* meshNormals(unsigned int meshID, const aiMesh* mesh) {
+    if (skinnedVertices && meshID < skinnedVertices->normals.size() && !skinnedVertices->normals[meshID].empty()) {
+        return skinnedVertices->normals[meshID].data();
+    }
+    return mesh->mNormals;
+}
 
-    // Rotate around the object's center
-    if (animateSelectedObject) {
-        glRotatef(animationAngle, 0.0f, 1.0f, 0.0f);
+// Immediate-mode triangles with normals and texture coordinates. A skinned mesh without CPU
+// vertices is skinned by the lighting shader from its palette and per-vertex weights, unless
+// gpuSkin is off (display lists), which leaves it in its bind pose.
+void drawMeshTriangles(unsigned int meshID, const aiMesh* mesh, bool gpuSkin = true) {
+    const aiVector3D* positions = meshPositions(meshID, mesh);
+    const aiVector3D* normals = meshNormals(meshID, mesh);
+    const uint16_t* boneIndices = nullptr;
+    const float* boneWeights = nullptr;
+    if (gpuSkin && positions == mesh->mVertices && skeletalAnimation.isSkinned(meshID)) {
+        std::span<const Mat4> palette = skeletalAnimation.palette(meshID);
+        if (setClusteredLightingSkin(palette.front().m, static_cast<int>(palette.size()))) {
+            boneIndices = skeletalAnimation.boneIndices(meshID);
+            boneWeights = skeletalAnimation.boneWeights(meshID);
+        }
     }
 
-    glColor3f(0.5f, 0.8f, 1.0f); // Highlight color for the selected object
+    const int influences = SkeletalAnimation::kMaxInfluences;
     glBegin(GL_TRIANGLES);
     for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-        aiFace face = mesh->mFaces[j];
+        const aiFace& face = mesh->mFaces[j];
         for (unsigned int k = 0; k < face.mNumIndices; k++) {
             unsigned int index = face.mIndices[k];
-            if (mesh->HasNormals()) {
-                aiVector3D normal = mesh->mNormals[index];
-                glNormal3f(normal.x, normal.y, normal.z);
+            if (normals) {
+                glNormal3fv(&normals[index].x);
             }
             if (mesh->HasTextureCoords(0)) {
-                aiVector3D texCoord = mesh->mTextureCoords[0][index];
-                glTexCoord2f(texCoord.x, texCoord.y);
+                glTexCoord2fv(&mesh->mTextureCoords[0][index].x);
             }
-            aiVector3D vertex = mesh->mVertices[index];
-            glVertex3f(vertex.x, vertex.y, vertex.z);
+            if (boneIndices) {
+                setClusteredLightingBoneWeights(boneIndices + index * influences, boneWeights + index * influences);
+            }
+            glVertex3fv(&positions[index].x);
         }
     }
     glEnd();
 
+    if (boneIndices) {
+        setClusteredLightingSkin(nullptr, 0);
+    }
+}
+
+void renderSelectedObject(unsigned int meshID, const aiMesh* mesh) {
+    glPushMatrix();
+
+    // Rotate around the mesh's own center rather than its origin
+    if (animateSelectedObject) {
+        Vec3 pivot = meshID < meshLocalBounds.size() && !meshLocalBounds[meshID].empty()
+            ? meshLocalBounds[meshID].center() : Vec3();
+        glTranslatef(pivot.x, pivot.y, pivot.z);
+        glRotatef(renderAnimationAngle, 0.0f, 1.0f, 0.0f);
+        glTranslatef(-pivot.x, -pivot.y, -pivot.z);
+    }
+
+    glColor3f(0.5f, 0.8f, 1.0f); // Highlight color for the selected object
+    drawMeshTriangles(meshID, mesh);
+
     glPopMatrix();
 }
 
-// Update animation angle
-void updateAnimation(int value) {
+bool clipIsPlaying() {
+    return playSkeletalAnimation && skeletalAnimation.clipCount() > 0;
+}
+
+bool replayIsPlaying() {
+    return replayFlight && flightLog.size() > 0;
+}
+
+bool rotorsSpinning() {
+    if (rotorAnimation.size() == 0) {
+        return false;
+    }
+    return replayIsPlaying() || telemetryReceived || flightReceived || (spinRotors && rotorRpm != 0.0f);
+}
+
+bool telemetryConnected() {
+    return telemetryRing.isOpen();
+}
+
+bool swarmFlying() {
+    return flySwarm && swarm.size() > 0;
+}
+
+bool sceneIsAnimating() {
+    return animateSelectedObject || clipIsPlaying() || rotorsSpinning() || replayIsPlaying() || telemetryConnected() ||
+           swarmFlying() || flightModel != nullptr;
+}
+
+// Size of the model in metres, the unit the swarm and the flight model fly in
+float modelSizeMetres() {
+    return 2.0f * sceneRadius / std::max(replayScale, 1e-3f);
+}
+
+// The formation circles the model once a minute, above it
+Vec3 swarmCenter(double time) {
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(swarm.size()))));
+    float spacing = swarmSpacing * modelSizeMetres();
+    float radius = spacing * (side * 0.5f + 2.0f);
+    float angle = static_cast<float>(time * 2.0 * M_PI / 60.0);
+    return Vec3(radius * std::cos(angle), spacing * 2.0f, radius * std::sin(angle));
+}
+
+// Slots on a square grid, two layers deep; drones start scattered around them and gather
+void layoutSwarm() {
+    swarmLayoutSize = swarmSize;
+    swarmLayoutScene = scene;
+    swarm.resize(static_cast<size_t>(std::max(0, swarmSize)));
+    swarmTime = 0.0;
+    swarmNear.clear();
+    swarmNearPairCount = swarmContactCount = 0;
+    size_t layer = (swarm.size() + 1) / 2;
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(layer))));
+    float spacing = swarmSpacing * modelSizeMetres();
+    Vec3 center = swarmCenter(0.0);
+    unsigned seed = 12345;
+    auto scatter = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (static_cast<float>(seed >> 8) / 16777216.0f - 0.5f) * spacing * side;
+    };
+    for (size_t i = 0; i < swarm.size(); ++i) {
+        size_t cell = i % layer;
+        float column = static_cast<float>(cell % side) - 0.5f * (side - 1);
+        float row = static_cast<float>(cell / side) - 0.5f * (side - 1);
+        Vec3 slot(spacing * column, spacing * static_cast<float>(i / layer), spacing * row);
+        swarm.place(i, center + slot + Vec3(scatter(), 0.25f * scatter(), scatter()), slot);
+    }
+    swarm.writeInstances(swarmInstances, 1.0f, replayRootRest, replayScale, frameJobs.get());
+    if (swarmSize > 0) {
+        std::cout << "Swarm: " << swarm.size() << " drones" << std::endl;
+    }
+}
+
+// World to the model's rest frame: undoes the flight pose on the root
+Mat4 modelRestFromWorld() {
+    sceneTransforms.update();
+    return replayRootRest * inverse(sceneTransforms.world(0));
+}
+
+void showOccupancyMap() {
+    occupancyMap.voxelCenters(occupancyCenters);
+    occupancyVoxelCount = static_cast<int>(occupancyMap.voxelCount());
+    occupancyKilobytes = occupancyMap.memoryBytes() / 1024.0f;
+}
+
+// Redraws once the build in flight has finished
+void pollOccupancyBuild(int value) {
+    if (occupancyBuild && !occupancyBuild->done.load(std::memory_order_acquire)) {
+        glutTimerFunc(50, pollOccupancyBuild, 0);
+        return;
+    }
+    requestRedraw();
+}
+
+void startOccupancyBuild() {
+    occupancyBuiltResolution = occupancyResolution;
+    Mat4 toRest = modelRestFromWorld();
+    std::span<const Mat4> worlds = sceneTransforms.meshWorlds();
+    std::vector<Mat4> restWorlds(worlds.size());
+    for (size_t i = 0; i < worlds.size(); ++i) {
+        restWorlds[i] = toRest * worlds[i];
+    }
+    occupancyBuild = std::make_unique<OccupancyBuild>();
+    OccupancyMap::collectTriangles(scene, restWorlds, {}, occupancyBuild->triangles);
+    occupancyBuild->voxelSize = 2.0f * sceneRadius / occupancyResolution;
+    occupancyBuild->thread = std::thread([build = occupancyBuild.get(), jobs = frameJobs.get()] {
+        traceSetThreadName("occupancy");
+        build->map.build(build->triangles, build->voxelSize, jobs);
+        build->done.store(true, std::memory_order_release);
+    });
+    glutTimerFunc(50, pollOccupancyBuild, 0);
+}
+
+// Takes a finished build and starts the next one the model or the resolution needs
+void updateOccupancyMap() {
+    if (occupancyBuild && occupancyBuild->done.load(std::memory_order_acquire)) {
+        if (!occupancyBuild->stale) {
+            occupancyMap = std::move(occupancyBuild->map);
+            showOccupancyMap();
+        }
+        occupancyBuild.reset();
+    }
+    if (occupancyScene != scene) {
+        occupancyScene = scene;
+        occupancyBuiltResolution = 0.0f;
+        occupancyMap.clear();
+        showOccupancyMap();
+        if (occupancyBuild) {
+            occupancyBuild->stale = true;
+        }
+    }
+    if (!occupancyBuild && scene && sceneTransforms.size() > 0 && occupancyBuiltResolution != occupancyResolution) {
+        startOccupancyBuild();
+    }
+}
+
+void findSwarmProximity() {
+    float size = modelSizeMetres();
+    swarmObstacles.resize(meshWorldBounds.size());
+    for (size_t i = 0; i < meshWorldBounds.size(); ++i) {
+        swarmObstacles[i] = Aabb();
+        if (!meshWorldBounds[i].empty()) {
+            swarmObstacles[i].min = meshWorldBounds[i].min * (1.0f / replayScale);
+            swarmObstacles[i].max = meshWorldBounds[i].max * (1.0f / replayScale);
+        }
+    }
+    swarmGrid.build(swarm.positions(), swarm.size(), size, frameJobs.get());
+    swarmGrid.findPairs(size, swarmNearPairs, frameJobs.get());
+    swarmGrid.findObstacleContacts(swarmObstacles, 0.5f * size, swarmContacts, frameJobs.get());
+    if (!occupancyMap.empty() && sceneTransforms.size() > 0) {
+        Vec3 half = Vec3(size, size, size) * (0.5f * replayScale);
+        Mat4 toRest = modelRestFromWorld();
+        auto clear = [&half, &toRest](const ProximityPair& contact) {
+            Vec3 at = swarm.position(contact.second) * replayScale;
+            return !occupancyMap.occupied(transformAabb(toRest, Aabb{at - half, at + half}));
+        };
+        swarmContacts.erase(std::remove_if(swarmContacts.begin(), swarmContacts.end(), clear), swarmContacts.end());
+    }
+    swarmNear.assign(swarm.size(), 0);
+    for (const ProximityPair& pair : swarmNearPairs) {
+        swarmNear[pair.first] = swarmNear[pair.second] = 1;
+    }
+    for (const ProximityPair& contact : swarmContacts) {
+        swarmNear[contact.second] = 1;
+    }
+    swarmNearPairCount = static_cast<int>(swarmNearPairs.size());
+    swarmContactCount = static_cast<int>(swarmContacts.size());
+}
+
+void stepRotors(float dt) {
+    for (size_t i = 0; i < rotorAnimation.size(); ++i) {
+        float direction = i % 2 == 0 ? 1.0f : -1.0f;
+        float rpm = rotorRpm * (1.0f + direction * rotorYawDifferential);
+        if (telemetryReceived) {
+            rpm = telemetrySample.rotorRpm[i % kTelemetryRotors];
+        } else if (flightReceived) {
+            direction = flightModel->parameters().spin[i % kQuadrotorRotors];
+            rpm = flightRotorRpm[i % kQuadrotorRotors];
+        } else if (replayIsPlaying()) {
+            rpm = replaySample.rotorRpm[i % kFlightLogRotors];
+        }
+        rotorAnimation.setRpm(i, direction * rpm);
+    }
+    rotorAnimation.step(dt);
+}
+
+// Advance the simulation by one fixed step
+void simulationStep(float dt) {
+    previousAnimationAngle = animationAngle;
+    previousClipTime = clipTime;
+    previousReplayTime = replayTime;
+    if (replayIsPlaying()) {
+        replayTime += replaySpeed * dt;
+    }
+    if (rotorsSpinning()) {
+        stepRotors(dt);
+    }
+    if (clipIsPlaying()) {
+        clipTime += clipSpeed * dt;
+    }
+    if (swarmFlying()) {
+        swarmTime += dt;
+        swarm.step(dt, swarmCenter(swarmTime), swarmParameters, frameJobs.get());
+        findSwarmProximity();
+    }
     if (animateSelectedObject) {
-        animationAngle += animationSpeed;
+        animationAngle += animationSpeed * dt;
         if (animationAngle >= 360.0f) {
-            animationAngle -= 360.0f; // Keep the angle within [0, 360]
+            animationAngle -= 360.0f;          // Keep the angle within [0, 360]
+            previousAnimationAngle -= 360.0f;  // and the interpolation continuous across the wrap
         }
     }
-    glutPostRedisplay(); // Request a redraw
-    glutTimerFunc(16, updateAnimation, 0); // ~60 FPS (16 ms interval)
 }
 
-// Function to toggle object selection
-void toggleObjectSelection(int objectIndex) {
-    if (selectedObjectIndex == objectIndex) {
-        selectedObjectIndex = -1; // Deselect
-    } else {
-        selectedObjectIndex = objectIndex; // Select object
+// Meshes the running animations move from frame to frame: every mesh while a clip plays or a
+// replay, telemetry or the flight model poses the root, otherwise the spinning rotors. Their
+// motion needs no sceneRevision bump; the shadow cascades cache the depth of the others only.
+void markAnimatedMeshes() {
+    bool all = clipIsPlaying() || replayIsPlaying() || telemetryReceived || flightReceived;
+    meshAnimated.assign(meshLocalBounds.size(), all ? 1 : 0);
+    if (!all && rotorsSpinning()) {
+        for (size_t i = 0; i < rotorAnimation.size(); ++i) {
+            unsigned int mesh = rotorAnimation.rotor(i).mesh;
+            if (mesh < meshAnimated.size()) {
+                meshAnimated[mesh] = 1;
+            }
+        }
+    }
+}
+
+// Run the fixed steps that are due and interpolate the state that gets drawn
+void updateSimulation() {
+    if (!sceneIsAnimating()) {
+        // Idle: nothing to integrate, and idle time must not turn into a burst of steps later
+        simulationClock.reset();
+        previousAnimationAngle = animationAngle;
+        renderAnimationAngle = animationAngle;
+        previousClipTime = renderClipTime = clipTime;
+        previousReplayTime = renderReplayTime = replayTime;
+        rotorAnimation.settle();
+        return;
+    }
+
+    int steps = simulationClock.advance();
+    for (int i = 0; i < steps; ++i) {
+        simulationStep(static_cast<float>(simulationClock.stepSeconds()));
+    }
+    float alpha = static_cast<float>(simulationClock.alpha());
+    renderAnimationAngle = previousAnimationAngle + (animationAngle - previousAnimationAngle) * alpha;
+    renderClipTime = previousClipTime + (clipTime - previousClipTime) * alpha;
+    renderReplayTime = previousReplayTime + (replayTime - previousReplayTime) * alpha;
+    if (rotorsSpinning()) {
+        rotorAnimation.apply(sceneTransforms, alpha);
+    }
+    if (swarmFlying()) {
+        swarm.writeInstances(swarmInstances, alpha, replayRootRest, replayScale, frameJobs.get());
+    }
+}
+
+// Moves the model's root by a flight pose, relative to where the flight started, turning it
+// about pivot (model units, rest frame)
+void placeModel(const Vec3& position, const Quat& attitude, const Vec3& origin, const Vec3& pivot = Vec3()) {
+    Mat4 pose = makeTranslation((position - origin) * replayScale + pivot) * makeRotation(attitude) *
+                makeTranslation(-pivot);
+    sceneTransforms.setLocal(0, pose * replayRootRest);
+}
+
+// Places the model at the logged pose for the interpolated replay time
+void updateFlightReplay() {
+    if (!scene || !replayIsPlaying() || telemetryReceived || flightReceived || sceneTransforms.size() == 0) {
+        return;
+    }
+    double duration = flightLog.endTime() - flightLog.startTime();
+    double elapsed = renderReplayTime;
+    if (replayLoop && duration > 0.0) {
+        elapsed = std::fmod(elapsed, duration);
+    }
+    replaySample = flightLog.sample(flightLog.startTime() + elapsed, replayCursor);
+    const FlightLogRecord& first = flightLog.record(0);
+    placeModel(replaySample.position, replaySample.attitude,
+               Vec3(first.position[0], first.position[1], first.position[2]));
+}
+
+// Drains the telemetry ring and places the model at the newest pose. Attaches once a second
+// until a producer exists, and again when one goes quiet (it may have restarted with a new ring).
+void pollTelemetry() {
+    if (telemetryRingName.empty()) {
+        return;
+    }
+    uint64_t now = telemetryNowNs();
+    const uint64_t second = 1000000000ull;
+    if (telemetryRing.isOpen() && telemetryLastSampleNs != 0 && now - telemetryLastSampleNs > 2 * second) {
+        telemetryRing.close();
+        telemetryReceived = false;
+        std::cout << "Telemetry: producer went quiet" << std::endl;
+    }
+    if (!telemetryRing.isOpen()) {
+        if (now < telemetryNextAttemptNs) {
+            return;
+        }
+        telemetryNextAttemptNs = now + second;
+        if (!telemetryRing.open(telemetryRingName)) {
+            return;
+        }
+        telemetryLastSampleNs = now;
+        std::cout << "Telemetry: attached to " << telemetryRingName << std::endl;
+    }
+
+    TelemetrySample batch[64];
+    size_t received = 0, count;
+    while ((count = telemetryRing.pop(batch, 64)) > 0) {
+        received += count;
+        if (!telemetryReceived) {
+            telemetryOrigin = Vec3(batch[0].position[0], batch[0].position[1], batch[0].position[2]);
+        }
+        telemetrySample = batch[count - 1];
+        telemetryReceived = true;
+    }
+    telemetryDropped = static_cast<unsigned>(telemetryRing.dropped());
+    if (received == 0 || !scene || sceneTransforms.size() == 0) {
+        return;
     }
+    telemetryLastSampleNs = now;
+    telemetrySamplesSinceStats += received;
+    telemetryFrameSampleNs = telemetrySample.timestampNs;
+    const TelemetrySample& s = telemetrySample;
+    placeModel(Vec3(s.position[0], s.position[1], s.position[2]),
+               normalize(Quat(s.attitude[0], s.attitude[1], s.attitude[2], s.attitude[3])), telemetryOrigin);
+}
+
+// Flight model for the loaded model: bounds and rotor hubs in its rest frame, the frame the
+// flight pose is applied in
+void startFlightModel() {
+    Mat4 toRest = modelRestFromWorld();
+    Aabb bounds;
+    for (unsigned int mesh = 0; mesh < meshLocalBounds.size(); ++mesh) {
+        bounds.expand(transformAabb(toRest * sceneTransforms.meshWorld(mesh), meshLocalBounds[mesh]));
+    }
+    std::vector<Vec3> hubs;
+    for (size_t i = 0; i < rotorAnimation.size(); ++i) {
+        const RotorAnimation::Rotor& rotor = rotorAnimation.rotor(i);
+        hubs.push_back(transformPoint(toRest * sceneTransforms.meshWorld(rotor.mesh), rotor.pivot));
+    }
+    QuadrotorParameters parameters = quadrotorFromBounds(bounds, hubs, replayScale);
+    flightPivot = bounds.empty() ? Vec3() : bounds.center();
+    flightMass = parameters.mass;
+    flightHoverRpm = parameters.hoverRotorSpeed() * 60.0f / (2.0f * static_cast<float>(M_PI));
+    if (!flightPlanFitted) {
+        flightPlanFitted = true;
+        flightPlan.radius = 3.0f * modelSizeMetres();
+        flightPlan.height = modelSizeMetres();
+    }
+    sentFlightPlan = flightPlan;
+    flightModel = std::make_unique<FlightModelThread>(parameters, flightPlan);
+    std::cout << "Flight model: " << parameters.mass << " kg, hover at " << flightHoverRpm << " rpm" << std::endl;
+}
+
+// Newest flight model state onto the model; starts and stops the thread with the toggle
+void updateFlightModel() {
+    bool canFly = flyModel && scene && sceneTransforms.size() > 0;
+    if (canFly != (flightModel != nullptr)) {
+        flightModel.reset();
+        flightReceived = false;
+        if (canFly) {
+            startFlightModel();
+        } else if (scene && sceneTransforms.size() > 0 && !telemetryReceived) {
+            sceneTransforms.setLocal(0, replayRootRest);  // Back on the ground
+            ++sceneRevision;
+        }
+    }
+    if (!flightModel) {
+        return;
+    }
+    if (flightPlan.radius != sentFlightPlan.radius || flightPlan.height != sentFlightPlan.height ||
+        flightPlan.period != sentFlightPlan.period) {
+        sentFlightPlan = flightPlan;
+        flightModel->setPlan(flightPlan);
+    }
+    if (!flightModel->poll()) {
+        return;
+    }
+    const FlightModelSnapshot& snapshot = flightModel->snapshot();
+    for (int r = 0; r < kQuadrotorRotors; ++r) {
+        flightRotorRpm[r] = snapshot.rotorSpeeds[r] * 60.0f / (2.0f * static_cast<float>(M_PI));
+    }
+    flightReceived = true;
+    if (!telemetryReceived) {
+        placeModel(snapshot.state.position, snapshot.state.attitude, Vec3(), flightPivot);
+    }
+}
+
+// After the swap: how old the newest sample drawn in this frame is
+void recordTelemetryLatency() {
+    if (telemetryFrameSampleNs != 0) {
+        telemetryLatencies.push_back(static_cast<float>((telemetryNowNs() - telemetryFrameSampleNs) * 1e-6));
+        telemetryFrameSampleNs = 0;
+    }
+}
+
+void updateTelemetryStats(double seconds) {
+    if (!telemetryLatencies.empty()) {
+        std::sort(telemetryLatencies.begin(), telemetryLatencies.end());
+        telemetryLatencyP50 = telemetryLatencies[telemetryLatencies.size() / 2];
+        telemetryLatencyP99 = telemetryLatencies[(telemetryLatencies.size() * 99) / 100];
+        telemetryLatencies.clear();
+    }
+    telemetryRate = seconds > 0.0 ? static_cast<float>(telemetrySamplesSinceStats / seconds) : 0.0f;
+    telemetrySamplesSinceStats = 0;
+}
+
+// Poses the hierarchy at the interpolated clip time (blended with a second clip when asked)
+// and skins the meshes for the frame about to be drawn. With GPU skinning the CPU only
+// computes the bone palettes and conservative bounds; shadows, collision outlines, picking
+// and the software rasterizer read vertices, so any of them being on keeps the CPU path.
+void updateSkeletalPose() {
+    if (!scene || (skeletalAnimation.clipCount() == 0 && !skeletalAnimation.hasSkins())) {
+        return;
+    }
+    bool gpu = gpuSkinning && useClusteredLighting && clusteredLightingAvailable() && !softwareRendering &&
+               !(shadowsEnabled && lightEnabled[0]) && !showCollisionHighlights && pendingPickId == 0;
+    bool playing = clipIsPlaying();
+    if (playing) {
+        int clips = static_cast<int>(skeletalAnimation.clipCount());
+        animationClip = std::clamp(animationClip, 0, clips - 1);
+        blendClip = std::clamp(blendClip, 0, clips - 1);
+        skeletalAnimation.sample(animationClip, renderClipTime, clipPose);
+        if (blendWeight > 0.0f && blendClip != animationClip) {
+            skeletalAnimation.sample(blendClip, renderClipTime, blendPose);
+            blendPoses(clipPose, blendPose, std::min(blendWeight, 1.0f), clipPose);
+        }
+        skeletalAnimation.apply(clipPose, sceneTransforms);
+    }
+    if (!playing && !skinnedPoseStale && gpu == gpuSkinningActive) {
+        return;
+    }
+    gpuSkinningActive = gpu;
+    skinnedPoseStale = false;
+    if (!skeletalAnimation.hasSkins()) {
+        return;
+    }
+
+    TRACE_SCOPE("skinning", "animation");
+    sceneTransforms.update();
+    skeletalAnimation.updatePalettes(sceneTransforms);
+    skinnedVertices = skeletalAnimation.skin(frameJobs.get(), gpu ? kMaxGpuSkinBones : 0);
+    for (unsigned int i = 0; i < meshLocalBounds.size(); ++i) {
+        if (skeletalAnimation.isSkinned(i)) {
+            bool cpu = !skinnedVertices->positions[i].empty();
+            meshLocalBounds[i] = cpu ? skinnedVertices->bounds[i] : skeletalAnimation.paletteBounds(i);
+        }
+    }
+}
+
+void scheduledRedraw(int value) {
     glutPostRedisplay();
 }
 
-// Function to render and animate a selected object
+// Ask for a frame; requests made before it starts are merged into it
+void requestRedraw() {
+    int delay = frameScheduler.requestFrame();
+    if (delay == FrameScheduler::kAlreadyPending) {
+        return;
+    }
+    if (delay == 0) {
+        glutPostRedisplay();
+    } else {
+        glutTimerFunc(delay, scheduledRedraw, 0);
+    }
+}
 
-// Helper function to calculate bounding boxes
-void calculateBoundingBox(const aiMesh* mesh, aiVector3D& min, aiVector3D& max) {
-    min = aiVector3D(FLT_MAX, FLT_MAX, FLT_MAX);
-    max = aiVector3D(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+// Apply the pacing settings and keep frames coming while the scene animates
+// (or always when on-demand redraw is off); an idle scene waits for input
+void updateRedrawLoop() {
+    int swapInterval = vsyncEnabled ? 1 : 0;
+    if (swapInterval != appliedSwapInterval) {
+        appliedSwapInterval = swapInterval;
+        if (!setSwapInterval(swapInterval) && vsyncEnabled) {
+            std::cerr << "Swap control not available, pacing without vsync" << std::endl;
+        }
+    }
+    frameScheduler.setVsync(vsyncEnabled);
+    frameScheduler.setTargetFps(targetFrameRate);
+    frameScheduler.setRefreshRate(displayRefreshRate);
+    frameScheduler.setContinuous(!onDemandRedraw || sceneIsAnimating());
 
-    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-        aiVector3D vertex = mesh->mVertices[i];
-        min.x = std::min(min.x, vertex.x);
-        min.y = std::min(min.y, vertex.y);
-        min.z = std::min(min.z, vertex.z);
-        max.x = std::max(max.x, vertex.x);
-        max.y = std::max(max.y, vertex.y);
-        max.z = std::max(max.z, vertex.z);
+    if (frameScheduler.isContinuous()) {
+        requestRedraw();
     }
 }
 
-// Collision detection
-bool checkCollision(const aiMesh* mesh1, const aiMesh* mesh2) {
-    aiVector3D min1, max1, min2, max2;
-    calculateBoundingBox(mesh1, min1, max1);
-    calculateBoundingBox(mesh2, min2, max2);
+void printFrameStats() {
+    FrameTimeStats stats = frameScheduler.stats();
+    std::cout << "Frames: " << stats.frames
+              << "  p50: " << stats.p50 << " ms  p95: " << stats.p95 << " ms  p99: " << stats.p99
+              << " ms  interval p99: " << stats.intervalP99 << " ms  fps: " << stats.averageFps
+              << "  coalesced requests: " << stats.coalescedRequests << std::endl;
+
+    if (gpuTimersAvailable()) {
+        std::cout << "GPU:";
+        for (int i = 0; i < static_cast<int>(GpuPass::Count); ++i) {
+            GpuPass pass = static_cast<GpuPass>(i);
+            std::cout << "  " << gpuPassName(pass) << ": " << gpuPassTime(pass) << " ms";
+        }
+        std::cout << std::endl;
+    }
+}
 
-    return (min1.x <= max2.x && max1.x >= min2.x) &&
-           (min1.y <= max2.y && max1.y >= min2.y) &&
-           (min1.z <= max2.z && max1.z >= min2.z);
+// GPU timings are shown next to the CPU stage that issues the pass
+void reportGpuTimes() {
+    profilerSetGpuTime(ProfileStage::Shadows, gpuPassTime(GpuPass::Shadows));
+    profilerSetGpuTime(ProfileStage::Submission, gpuPassTime(GpuPass::Scene));
+    profilerSetGpuTime(ProfileStage::Collision, gpuPassTime(GpuPass::CollisionHighlight));
+    profilerSetGpuTime(ProfileStage::TweakBar, gpuPassTime(GpuPass::UserInterface));
+}
+
+// Function to toggle object selection
+void toggleObjectSelection(int objectIndex) {
+    if (selectedObjectIndex == objectIndex) {
+        selectedObjectIndex = -1; // Deselect
+    } else {
+        selectedObjectIndex = objectIndex; // Select object
+    }
+    requestRedraw();
 }
 
+// Function to render and animate a selected object
+
 // Toggle collision highlights
 void toggleCollisionHighlights() {
     showCollisionHighlights = !showCollisionHighlights;
-    glutPostRedisplay();
+    requestRedraw();
 }
 
 // Render collision highlights
-void drawCollisionHighlight(const aiMesh* mesh) {
+void drawCollisionHighlight(unsigned int meshID, const aiMesh* mesh) {
+    const aiVector3D* positions = meshPositions(meshID, mesh);
+    gpuTimerBegin(GpuPass::CollisionHighlight);
     glColor3f(1.0f, 0.0f, 0.0f);
     glLineWidth(2.0f);
 
@@ -183,25 +936,28 @@ void drawCollisionHighlight(const aiMesh* mesh) {
             unsigned int index1 = face.mIndices[j];
             unsigned int index2 = face.mIndices[(j + 1) % face.mNumIndices];
 
-            aiVector3D vertex1 = mesh->mVertices[index1];
-            aiVector3D vertex2 = mesh->mVertices[index2];
+            aiVector3D vertex1 = positions[index1];
+            aiVector3D vertex2 = positions[index2];
 
             glVertex3f(vertex1.x, vertex1.y, vertex1.z);
             glVertex3f(vertex2.x, vertex2.y, vertex2.z);
         }
     }
     glEnd();
+    gpuTimerEnd(GpuPass::CollisionHighlight);
 }
 
-// Function to load the model and calculate bounding box
+// Function to load the model and calculate bounding box (meshes placed by their nodes)
 float calculateInitialDistance(const aiScene* scene) {
     aiVector3D min(FLT_MAX, FLT_MAX, FLT_MAX);
     aiVector3D max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
     for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
         aiMesh* mesh = scene->mMeshes[i];
+        const Mat4& world = sceneTransforms.meshWorld(i);
         for (unsigned int j = 0; j < mesh->mNumVertices; ++j) {
-            aiVector3D vertex = mesh->mVertices[j];
+            Vec3 p = transformPoint(world, Vec3(mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z));
+            aiVector3D vertex(p.x, p.y, p.z);
             min.x = std::min(min.x, vertex.x);
             min.y = std::min(min.y, vertex.y);
             min.z = std::min(min.z, vertex.z);
@@ -215,20 +971,68 @@ float calculateInitialDistance(const aiScene* scene) {
     return std::max({size.x, size.y, size.z}) * 2.0f; // Set distance based on model size
 }
 
+// Makes loaded the scene that gets drawn and fits the camera, bounds and light radii to it
+void setActiveScene(const aiScene* loaded) {
+    scene = loaded;
+    meshInfoMap.clear();
+    selectedMeshIndex = -1;
+    ++sceneRevision;
+    ++geometryRevision;
+    if (!scene) {
+        meshLocalBounds.clear();
+        sceneTransforms.clear();
+        skeletalAnimation.clear();
+        skinnedVertices.reset();
+        rotorAnimation.clear();
+        return;
+    }
+
+    sceneTransforms.build(scene);
+    replayRootRest = sceneTransforms.size() ? sceneTransforms.local(0) : Mat4();
+    replayCursor = 0;
+    swarmLayoutScene = nullptr;  // Spacing follows the model size
+    flightModel.reset();         // Restarted with the new model's parameters
+    flightReceived = false;
+    cameraDistance = calculateInitialDistance(scene); // Adjust camera distance
+    sceneRadius = cameraDistance * 0.25f;              // Half of the largest extent
+
+    meshLocalBounds.resize(scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+        meshLocalBounds[i] = computeMeshBounds(scene->mMeshes[i]);
+    }
+
+    skeletalAnimation.build(scene, sceneTransforms);
+    skinnedVertices.reset();
+    skinnedPoseStale = true;
+    clipTime = previousClipTime = renderClipTime = 0.0;
+    if (skeletalAnimation.clipCount() > 0) {
+        std::cout << "Animation clips: " << skeletalAnimation.clipCount() << " (first: "
+                  << skeletalAnimation.clipName(0) << ", " << skeletalAnimation.clipDuration(0) << " s)" << std::endl;
+    }
+    if (rotorAnimation.detect(scene, sceneTransforms, meshLocalBounds) > 0) {
+        std::cout << "Rotors: " << rotorAnimation.size() << std::endl;
+    }
+}
+
 void loadModel(const std::string& path) {
-    scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+    TRACE_SCOPE("loadModel", "load");
+    const aiScene* loaded = importer.ReadFile(path, kModelImportFlags);
+    if (!loaded || loaded->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !loaded->mRootNode) {
         std::cerr << "Error loading model: " << importer.GetErrorString() << std::endl;
         exit(EXIT_FAILURE);
     }
     std::cout << "Model loaded successfully: " << path << std::endl;
-    cameraDistance = calculateInitialDistance(scene); // Adjust camera distance
+    setActiveScene(loaded);
 }
 
 // Function to load a texture using stb_image
 GLuint loadTexture(const std::string& path) {
     int width, height, channels;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    unsigned char* data;
+    {
+        TRACE_SCOPE("decodeTexture", "load");
+        data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    }
     if (!data) {
         std::cerr << "Failed to load texture: " << path << std::endl;
         exit(EXIT_FAILURE);
@@ -250,116 +1054,203 @@ GLuint loadTexture(const std::string& path) {
 }
 
 
-// Updated renderNode function to apply textures
-void renderNode(const aiNode* node, const aiScene* scene, int nodeIndex = 0,bool selectMode = false) {
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        unsigned int meshID = node->mMeshes[i];
+// Draws every mesh of the flattened hierarchy with textures, placed by its node's world matrix.
+// nodeIndex is the top-level object the node belongs to (see toggleObjectSelection).
+void renderNodes(const aiScene* scene, bool selectMode = false) {
+    sceneTransforms.update();
+    for (size_t node = 0; node < sceneTransforms.size(); ++node) {
+        int nodeIndex = sceneTransforms.object(node);
+        for (unsigned int meshID : sceneTransforms.meshes(node)) {
+            if (meshID >= scene->mNumMeshes) {
+                continue;
+            }
+            const aiMesh* mesh = scene->mMeshes[meshID];
 
-        if (!meshInfoMap.count(meshID)) {
-            meshInfoMap[meshID] = MeshInfo();
-        }
+            if (!meshInfoMap.count(meshID)) {
+                meshInfoMap[meshID] = MeshInfo();
+            }
 
-        if (!meshInfoMap[meshID].isVisible) {
-            continue;
-        }
+            if (!meshInfoMap[meshID].isVisible) {
+                continue;
+            }
 
-        if (selectMode) {
-            glLoadName(meshID);
-        }
+            // Outside the view frustum; the animated selection may rotate beyond its bounds
+            if (!selectMode && meshID < meshInView.size() && !meshInView[meshID] && selectedObjectIndex != nodeIndex) {
+                continue;
+            }
 
-        glPushMatrix();
-        glTranslatef(meshInfoMap[meshID].position[0],
-                     meshInfoMap[meshID].position[1],
-                     meshInfoMap[meshID].position[2]);
+            if (selectMode) {
+                glLoadName(meshID);
+            }
 
-        glPolygonMode(GL_FRONT_AND_BACK, meshInfoMap[meshID].displayMode);
+            glPushMatrix();
+            glMultMatrixf(sceneTransforms.instanceWorld(node, meshID).m);
 
-        if (!selectMode) {
-            if (meshInfoMap[meshID].isSelected) {
-                glColor3f(1.0f, 0.5f, 0.0f);
-            } else {
-                glColor3f(0.8f, 0.8f, 0.8f);
-            }
-        }
-        mesh = scene->mMeshes[node->mMeshes[i]];
-
-        // Render selected object in isolation
-        if (selectedObjectIndex == nodeIndex) {
-            renderSelectedObject(mesh);
-        } else if (selectedObjectIndex == -1) { // Render all objects if no selection
-            glColor3f(materialColor[0], materialColor[1], materialColor[2]);
-
-            glEnable(GL_TEXTURE_2D); // Enable texturing
-            glBindTexture(GL_TEXTURE_2D, textureID);
-
-            glBegin(GL_TRIANGLES);
-            for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-                aiFace face = mesh->mFaces[j];
-                for (unsigned int k = 0; k < face.mNumIndices; k++) {
-                    unsigned int index = face.mIndices[k];
-                    if (mesh->HasNormals()) {
-                        aiVector3D normal = mesh->mNormals[index];
-                        glNormal3f(normal.x, normal.y, normal.z);
-                    }
-                    if (mesh->HasTextureCoords(0)) {
-                        aiVector3D texCoord = mesh->mTextureCoords[0][index];
-                        glTexCoord2f(texCoord.x, texCoord.y);
-                    }
-                    aiVector3D vertex = mesh->mVertices[index];
-                    glVertex3f(vertex.x, vertex.y, vertex.z);
+            glPolygonMode(GL_FRONT_AND_BACK, meshInfoMap[meshID].displayMode);
+
+            if (!selectMode) {
+                if (meshInfoMap[meshID].isSelected) {
+                    glColor3f(1.0f, 0.5f, 0.0f);
+                } else {
+                    glColor3f(0.8f, 0.8f, 0.8f);
                 }
             }
-            glEnd();
+            // Render selected object in isolation
+            if (selectedObjectIndex == nodeIndex) {
+                renderSelectedObject(meshID, mesh);
+            } else if (selectedObjectIndex == -1) { // Render all objects if no selection
+                glColor3f(materialColor[0], materialColor[1], materialColor[2]);
+
+                glEnable(GL_TEXTURE_2D); // Enable texturing
+                glBindTexture(GL_TEXTURE_2D, textureID);
+                setClusteredLightingTextured(true);
+
+                {
+                    PROFILE_SCOPE(ProfileStage::Submission);
+                    drawMeshTriangles(meshID, mesh);
+                }
 
-            glDisable(GL_TEXTURE_2D); // Disable texturing after use
+                glDisable(GL_TEXTURE_2D); // Disable texturing after use
+                setClusteredLightingTextured(false);
 
-            // Highlight collisions
-            if (showCollisionHighlights) {
-                for (unsigned int j = 0; j < scene->mNumMeshes; ++j) {
-                    if (mesh != scene->mMeshes[j] && checkCollision(mesh, scene->mMeshes[j])) {
-                        drawCollisionHighlight(mesh);
-                    }
+                // Highlight collisions
+                if (showCollisionHighlights && meshID < meshColliding.size() && meshColliding[meshID]) {
+                    drawCollisionHighlight(meshID, mesh);
                 }
             }
+            {
+                PROFILE_SCOPE(ProfileStage::Submission);
+                drawMeshTriangles(meshID, mesh);
+            }
+
+            glPopMatrix();
         }
-        glBegin(GL_TRIANGLES);
-        for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-            const aiFace& face = mesh->mFaces[j];
-            for (unsigned int k = 0; k < face.mNumIndices; k++) {
-                int index = face.mIndices[k];
-                if (mesh->HasNormals()) {
-                    glNormal3fv(&mesh->mNormals[index].x);
-                }
-                if (mesh->HasTextureCoords(0)) {
-                    glTexCoord2fv(&mesh->mTextureCoords[0][index].x);
-                }
-                glVertex3fv(&mesh->mVertices[index].x);
+    }
+}
+
+
+// The model as one display list in the space of its root node, so a swarm instance matrix
+// (which includes the root's rest transform) places it. Recompiled when geometryRevision
+// changes; moving the root or animating the model does not touch it, so the drones keep the
+// pose the model had then.
+void compileSwarmModel() {
+    if (swarmList == 0) {
+        swarmList = glGenLists(1);
+    }
+    swarmListRevision = geometryRevision;
+    sceneTransforms.update();
+    Mat4 toRoot = inverse(sceneTransforms.world(0));
+    swarmModelBounds = Aabb();
+    glNewList(swarmList, GL_COMPILE);
+    for (size_t node = 0; node < sceneTransforms.size(); ++node) {
+        for (unsigned int meshID : sceneTransforms.meshes(node)) {
+            auto it = meshInfoMap.find(meshID);
+            if (meshID >= scene->mNumMeshes || (it != meshInfoMap.end() && !it->second.isVisible)) {
+                continue;
+            }
+            Mat4 placement = toRoot * sceneTransforms.instanceWorld(node, meshID);
+            if (meshID < meshLocalBounds.size() && !meshLocalBounds[meshID].empty()) {
+                swarmModelBounds.expand(transformAabb(placement, meshLocalBounds[meshID]));
             }
+            glPushMatrix();
+            glMultMatrixf(placement.m);
+            drawMeshTriangles(meshID, scene->mMeshes[meshID], false);
+            glPopMatrix();
         }
-        glEnd();
+    }
+    glEndList();
+}
 
-        glPopMatrix();
+// Outline of the model bounds of a swarm drone that is near another drone or the model
+void drawSwarmHighlight() {
+    const Aabb& box = swarmModelBounds;
+    glColor3f(1.0f, 0.0f, 0.0f);
+    glLineWidth(2.0f);
+    glBegin(GL_LINES);
+    for (int i = 0; i < 8; ++i) {
+        for (int axis = 1; axis < 8; axis <<= 1) {
+            if ((i & axis) == 0) {
+                Vec3 from = box.corner(i), to = box.corner(i | axis);
+                glVertex3f(from.x, from.y, from.z);
+                glVertex3f(to.x, to.y, to.z);
+            }
+        }
     }
+    glEnd();
+    glColor3f(materialColor[0], materialColor[1], materialColor[2]);
+}
 
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        renderNode(node->mChildren[i], scene, selectMode);
-        renderNode(node->mChildren[i], scene, i);
+// Centres of the occupied voxels, moved with the model
+void drawOccupancy() {
+    if (!showOccupancy || occupancyCenters.empty() || sceneTransforms.size() == 0) {
+        return;
+    }
+    glPushMatrix();
+    glMultMatrixf(inverse(modelRestFromWorld()).m);
+    glDisable(GL_LIGHTING);
+    glColor3f(0.0f, 0.8f, 1.0f);
+    glPointSize(3.0f);
+    glBegin(GL_POINTS);
+    for (const Vec3& center : occupancyCenters) {
+        glVertex3f(center.x, center.y, center.z);
     }
+    glEnd();
+    glEnable(GL_LIGHTING);
+    glPopMatrix();
+    glColor3f(materialColor[0], materialColor[1], materialColor[2]);
 }
 
+// Every swarm drone inside the view frustum
+void drawSwarm() {
+    if (swarmInstances.empty() || !scene || sceneTransforms.size() == 0) {
+        return;
+    }
+    if (swarmListRevision != geometryRevision) {
+        compileSwarmModel();
+    }
+    Frustum frustum = frustumFromMatrix(cameraViewProjection);
+    glColor3f(materialColor[0], materialColor[1], materialColor[2]);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    for (size_t drone = 0; drone < swarmInstances.size(); ++drone) {
+        const Mat4& instance = swarmInstances[drone];
+        if (!intersectsFrustum(frustum, transformAabb(instance, swarmModelBounds))) {
+            continue;
+        }
+        glPushMatrix();
+        glMultMatrixf(instance.m);
+        glCallList(swarmList);
+        if (showCollisionHighlights && drone < swarmNear.size() && swarmNear[drone]) {
+            drawSwarmHighlight();
+        }
+        glPopMatrix();
+    }
+}
 
 // Initialize OpenGL settings
 void initOpenGL() {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_LIGHTING);
     glEnable(GL_COLOR_MATERIAL);
+    glEnable(GL_NORMALIZE);  // Node transforms may scale
 
     GLfloat materialSpecular[] = {1.0f, 1.0f, 1.0f, 1.0f};
     glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, materialSpecular);
 
-    // Load texture
-    textureID = loadTexture(texturePath);
+    // Load texture (headless runs may render untextured)
+    if (!texturePath.empty()) {
+        textureID = loadTexture(texturePath);
+    }
+
+    // Clustered lighting needs GLSL and float data textures; fall back to fixed-function lights without them
+    if (!initClusteredLighting()) {
+        useClusteredLighting = false;
+    }
+    if (!initShadowMaps()) {
+        shadowsEnabled = false;
+    }
+    if (!initGpuTimers()) {
+        std::cerr << "GPU timer queries not available, GPU pass timings disabled" << std::endl;
+    }
 }
 
 // Initialize AntTweakBar
@@ -376,11 +1267,67 @@ void initTweakBar() {
     TwAddVarRW(tweakBar, "Light 1", TW_TYPE_BOOL32, &lightEnabled[1], " label='Point Light 1' ");
     TwAddVarRW(tweakBar, "Light 2", TW_TYPE_BOOL32, &lightEnabled[2], " label='Point Light 2' ");
     TwAddVarRW(tweakBar, "Highlight Collisions", TW_TYPE_BOOL32, &showCollisionHighlights, " label='Highlight Collisions' ");
+    TwAddVarRW(tweakBar, "Animation Speed", TW_TYPE_FLOAT, &animationSpeed, " label='Animation Speed (deg/s)' min=0 max=720 step=10 ");
+    TwAddVarRW(tweakBar, "Play Clip", TW_TYPE_BOOL32, &playSkeletalAnimation, " label='Play Clip' group='Animation' ");
+    TwAddVarRW(tweakBar, "Clip", TW_TYPE_INT32, &animationClip, " label='Clip' group='Animation' min=0 ");
+    TwAddVarRW(tweakBar, "Blend Clip", TW_TYPE_INT32, &blendClip, " label='Blend Clip' group='Animation' min=0 ");
+    TwAddVarRW(tweakBar, "Blend Weight", TW_TYPE_FLOAT, &blendWeight, " label='Blend Weight' group='Animation' min=0 max=1 step=0.05 ");
+    TwAddVarRW(tweakBar, "Clip Speed", TW_TYPE_FLOAT, &clipSpeed, " label='Clip Speed' group='Animation' min=0 max=4 step=0.1 ");
+    TwAddVarRW(tweakBar, "GPU Skinning", TW_TYPE_BOOL32, &gpuSkinning, " label='GPU Skinning' group='Animation' ");
+    TwAddVarRW(tweakBar, "Spin Rotors", TW_TYPE_BOOL32, &spinRotors, " label='Spin Rotors' group='Rotors' ");
+    TwAddVarRW(tweakBar, "Rotor RPM", TW_TYPE_FLOAT, &rotorRpm, " label='RPM' group='Rotors' min=0 max=12000 step=100 ");
+    TwAddVarRW(tweakBar, "Yaw Differential", TW_TYPE_FLOAT, &rotorYawDifferential, " label='Yaw Differential' group='Rotors' min=-0.5 max=0.5 step=0.05 ");
+    TwAddVarRW(tweakBar, "Play Log", TW_TYPE_BOOL32, &replayFlight, " label='Play Log' group='Replay' ");
+    TwAddVarRW(tweakBar, "Loop Log", TW_TYPE_BOOL32, &replayLoop, " label='Loop' group='Replay' ");
+    TwAddVarRW(tweakBar, "Replay Speed", TW_TYPE_FLOAT, &replaySpeed, " label='Speed' group='Replay' min=0 max=16 step=0.25 ");
+    TwAddVarRW(tweakBar, "Replay Scale", TW_TYPE_FLOAT, &replayScale, " label='Units per Metre' group='Replay' min=0.001 max=1000 step=0.1 ");
+    TwAddVarRO(tweakBar, "Replay Time", TW_TYPE_DOUBLE, &replaySample.time, " label='Log Time (s)' group='Replay' precision=2 ");
+    TwAddVarRW(tweakBar, "Fly Model", TW_TYPE_BOOL32, &flyModel, " label='Fly' group='Flight Model' ");
+    TwAddVarRW(tweakBar, "Flight Radius", TW_TYPE_FLOAT, &flightPlan.radius, " label='Circuit Radius (m)' group='Flight Model' min=0 max=1000 step=0.1 ");
+    TwAddVarRW(tweakBar, "Flight Height", TW_TYPE_FLOAT, &flightPlan.height, " label='Height (m)' group='Flight Model' min=0 max=1000 step=0.1 ");
+    TwAddVarRW(tweakBar, "Flight Period", TW_TYPE_FLOAT, &flightPlan.period, " label='Lap Time (s)' group='Flight Model' min=2 max=120 step=1 ");
+    TwAddVarRO(tweakBar, "Flight Mass", TW_TYPE_FLOAT, &flightMass, " label='Mass (kg)' group='Flight Model' precision=3 ");
+    TwAddVarRO(tweakBar, "Flight Hover", TW_TYPE_FLOAT, &flightHoverRpm, " label='Hover RPM' group='Flight Model' precision=0 ");
+    TwAddVarRW(tweakBar, "Swarm Size", TW_TYPE_INT32, &swarmSize, " label='Drones' group='Swarm' min=0 max=100000 step=100 ");
+    TwAddVarRW(tweakBar, "Fly Swarm", TW_TYPE_BOOL32, &flySwarm, " label='Fly' group='Swarm' ");
+    TwAddVarRW(tweakBar, "Swarm Spacing", TW_TYPE_FLOAT, &swarmSpacing, " label='Spacing' group='Swarm' min=1 max=20 step=0.5 ");
+    TwAddVarRW(tweakBar, "Swarm Stiffness", TW_TYPE_FLOAT, &swarmParameters.stiffness, " label='Stiffness' group='Swarm' min=0.1 max=20 step=0.1 ");
+    TwAddVarRW(tweakBar, "Swarm Damping", TW_TYPE_FLOAT, &swarmParameters.damping, " label='Damping' group='Swarm' min=0 max=20 step=0.1 ");
+    TwAddVarRO(tweakBar, "Swarm Near Pairs", TW_TYPE_INT32, &swarmNearPairCount, " label='Near Pairs' group='Swarm' ");
+    TwAddVarRO(tweakBar, "Swarm Contacts", TW_TYPE_INT32, &swarmContactCount, " label='Model Contacts' group='Swarm' ");
+    TwAddVarRW(tweakBar, "Show Occupancy", TW_TYPE_BOOL32, &showOccupancy, " label='Show Voxels' group='Occupancy' ");
+    TwAddVarRW(tweakBar, "Occupancy Resolution", TW_TYPE_FLOAT, &occupancyResolution, " label='Voxels Across' group='Occupancy' min=4 max=1024 step=8 ");
+    TwAddVarRO(tweakBar, "Occupancy Voxels", TW_TYPE_INT32, &occupancyVoxelCount, " label='Occupied' group='Occupancy' ");
+    TwAddVarRO(tweakBar, "Occupancy Memory", TW_TYPE_FLOAT, &occupancyKilobytes, " label='Memory (KB)' group='Occupancy' precision=1 ");
+    TwAddVarRO(tweakBar, "Telemetry p50", TW_TYPE_FLOAT, &telemetryLatencyP50, " label='Latency p50 (ms)' group='Telemetry' precision=2 ");
+    TwAddVarRO(tweakBar, "Telemetry p99", TW_TYPE_FLOAT, &telemetryLatencyP99, " label='Latency p99 (ms)' group='Telemetry' precision=2 ");
+    TwAddVarRO(tweakBar, "Telemetry Rate", TW_TYPE_FLOAT, &telemetryRate, " label='Samples/s' group='Telemetry' precision=0 ");
+    TwAddVarRO(tweakBar, "Telemetry Dropped", TW_TYPE_UINT32, &telemetryDropped, " label='Dropped' group='Telemetry' ");
+    TwAddVarRW(tweakBar, "On-demand Redraw", TW_TYPE_BOOL32, &onDemandRedraw, " label='On-demand Redraw' ");
+
+    // Frame pacing
+    TwAddVarRW(tweakBar, "Target FPS", TW_TYPE_FLOAT, &targetFrameRate, " label='Target FPS' group='Frame Pacing' min=0 max=240 step=5 ");
+    TwAddVarRW(tweakBar, "Refresh Rate", TW_TYPE_FLOAT, &displayRefreshRate, " label='Refresh Rate (Hz)' group='Frame Pacing' min=30 max=240 step=1 ");
+    TwAddVarRW(tweakBar, "VSync", TW_TYPE_BOOL32, &vsyncEnabled, " label='VSync' group='Frame Pacing' ");
+    TwAddVarRO(tweakBar, "Frame p50", TW_TYPE_FLOAT, &frameTimeP50, " label='Frame p50 (ms)' group='Frame Pacing' precision=2 ");
+    TwAddVarRO(tweakBar, "Frame p95", TW_TYPE_FLOAT, &frameTimeP95, " label='Frame p95 (ms)' group='Frame Pacing' precision=2 ");
+    TwAddVarRO(tweakBar, "Frame p99", TW_TYPE_FLOAT, &frameTimeP99, " label='Frame p99 (ms)' group='Frame Pacing' precision=2 ");
+    TwAddVarRO(tweakBar, "FPS", TW_TYPE_FLOAT, &measuredFps, " label='FPS' group='Frame Pacing' precision=1 ");
+    TwAddVarRW(tweakBar, "Clustered Lighting", TW_TYPE_BOOL32, &useClusteredLighting, " label='Clustered Lighting' ");
+    TwAddVarRW(tweakBar, "Navigation Lights", TW_TYPE_INT32, &navigationLightCount, " label='Navigation Lights' min=0 max=4096 step=16 ");
+
+    // Shadow quality
+    TwAddVarRW(tweakBar, "Software Rasterizer", TW_TYPE_BOOL32, &softwareRendering, " label='Software Rasterizer' group='Backend' ");
+    TwAddVarRW(tweakBar, "Per-pixel Lighting", TW_TYPE_BOOL32, &softwarePerPixelLighting, " label='Per-pixel Lighting' group='Backend' ");
+    TwAddVarRW(tweakBar, "Shadows", TW_TYPE_BOOL32, &shadowsEnabled, " label='Shadows' group='Shadows' ");
+    TwAddVarRW(tweakBar, "Shadow Resolution", TW_TYPE_INT32, &shadowSettings.resolution, " label='Resolution' group='Shadows' min=256 max=4096 step=256 ");
+    TwAddVarRW(tweakBar, "Shadow Cascades", TW_TYPE_INT32, &shadowSettings.cascadeCount, " label='Cascades' group='Shadows' min=1 max=4 ");
 
 }
 
 // Set light properties
 void setLights() {
+    PROFILE_SCOPE(ProfileStage::Lighting);
     // Light 0 (Directional Light)
     if (lightEnabled[0]) {
         glEnable(GL_LIGHT0);
@@ -409,46 +1356,84 @@ void setLights() {
     }
 }
 
-// Process selection using OpenGL's selection mechanism
-void processSelection(int x, int y) {
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-
-    glSelectBuffer(512, selectBuf);
-    glRenderMode(GL_SELECT);
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-
-    gluPickMatrix(x, viewport[3] - y, 5.0, 5.0, viewport);
-    gluPerspective(45.0, (double)viewport[2] / viewport[3], 1.0, 100.0);
-
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-
-    gluLookAt(cameraDistance * sin(cameraAngleY) * cos(cameraAngleX),
-              cameraDistance * sin(cameraAngleX),
-              cameraDistance * cos(cameraAngleY) * cos(cameraAngleX),
-              cameraPosX, cameraPosY, 0.0f,
-              0.0f, 1.0f, 0.0f);
+// Collect the point lights for the clusters: legacy point lights plus generated navigation lights.
+// The legacy lights are placed under the camera light matrix like GL_POSITION in setLights;
+// worldFromLight takes them from that frame to the world frame the clusters are binned from.
+void gatherPointLights(const Mat4& worldFromLight) {
+    PROFILE_SCOPE(ProfileStage::Lighting);
+    pointLights.clear();
+
+    for (int i = 1; i < 3; ++i) {
+        if (lightEnabled[i]) {
+            PointLight light;
+            Vec3 world = transformPoint(worldFromLight, Vec3(lightPosition[i][0], lightPosition[i][1],
+                                                             lightPosition[i][2]));
+            light.position[0] = world.x;
+            light.position[1] = world.y;
+            light.position[2] = world.z;
+            std::memcpy(light.color, lightColor[i], sizeof(light.color));
+            light.radius = sceneRadius * 8.0f;
+            pointLights.push_back(light);
+        }
+    }
 
-    glInitNames();
-    glPushName(0);
+    // Landing-pad pattern: golden-angle spiral under the model, red/green/white like nav lights
+    const float navColors[3][3] = {{1.0f, 0.1f, 0.1f}, {0.1f, 1.0f, 0.1f}, {1.0f, 1.0f, 1.0f}};
+    const float goldenAngle = 2.39996323f;
+    for (int i = 0; i < navigationLightCount; ++i) {
+        float r = sceneRadius * 3.0f * std::sqrt((i + 0.5f) / navigationLightCount);
+        float angle = i * goldenAngle;
+        PointLight light;
+        light.position[0] = r * std::cos(angle);
+        light.position[1] = -sceneRadius;
+        light.position[2] = r * std::sin(angle);
+        light.radius = sceneRadius * 0.75f;
+        std::memcpy(light.color, navColors[i % 3], sizeof(light.color));
+        pointLights.push_back(light);
+    }
+}
 
-    renderNode(scene->mRootNode, scene, true);
+// Depth-only geometry for the shadow cascades
+void drawShadowCasters(const std::vector<unsigned int>& meshes) {
+    for (unsigned int meshID : meshes) {
+        const aiMesh* mesh = scene->mMeshes[meshID];
+        const aiVector3D* positions = meshPositions(meshID, mesh);
 
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glMultMatrixf(sceneTransforms.meshWorld(meshID).m);
+        glBegin(GL_TRIANGLES);
+        for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
+            const aiFace& face = mesh->mFaces[j];
+            for (unsigned int k = 0; k < face.mNumIndices; k++) {
+                glVertex3fv(&positions[face.mIndices[k]].x);
+            }
+        }
+        glEnd();
+        glPopMatrix();
+    }
+}
 
-    GLint hits = glRenderMode(GL_RENDER);
+// Pick the mesh under the cursor by casting a ray against the last drawn frame
+void processSelection(int x, int y) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    float ndcX = 2.0f * (x - viewport[0]) / viewport[2] - 1.0f;
+    float ndcY = 1.0f - 2.0f * (y - viewport[1]) / viewport[3];
+
+    // Answered by a later render thread output, see adoptFrameOutput
+    if (renderThread) {
+        pendingPickId = ++nextPickId;
+        pendingPickNdc[0] = ndcX;
+        pendingPickNdc[1] = ndcY;
+        requestRedraw();
+        return;
+    }
 
-    if (hits > 0) {
-        selectedMeshIndex = selectBuf[3];
+    sceneTransforms.update();
+    selectedMeshIndex = pickMesh(scene, meshWorldBounds, sceneTransforms.meshWorlds(),
+                                 rayFromNdc(cameraViewProjection, ndcX, ndcY), nullptr, &frameArena);
+    if (selectedMeshIndex >= 0) {
         meshInfoMap[selectedMeshIndex].isSelected = true;
-    } else {
-        selectedMeshIndex = -1;
     }
 }
 
@@ -469,26 +1454,189 @@ bool initialize() {
     return true;
 }
 
-// Display callback
-// Render scene
-void display() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glLoadIdentity();
+// Camera transform applied before the lights are positioned (see drawScene): the orbit
+// rotation (angles in degrees) between two translations
+Mat4 cameraLightMatrix() {
+    Quat orbit = makeQuat(cameraAngleX, Vec3(1.0f, 0.0f, 0.0f)) * makeQuat(cameraAngleY, Vec3(0.0f, 1.0f, 0.0f));
+    return makeTranslation(Vec3(0.0f, 0.0f, -cameraDistance)) * makeRotation(orbit) *
+           makeTranslation(Vec3(-cameraPosX, -cameraPosY, 0.0f));
+}
+
+// The full camera modelview: the light matrix followed by a look-at whose eye position reads
+// the same angles as radians
+Mat4 cameraViewMatrix() {
+    Vec3 eye(cameraDistance * std::sin(cameraAngleY) * std::cos(cameraAngleX), cameraDistance * std::sin(cameraAngleX),
+             cameraDistance * std::cos(cameraAngleY) * std::cos(cameraAngleX));
+    return cameraLightMatrix() * makeLookAt(eye, Vec3(cameraPosX, cameraPosY, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+}
+
+// Camera, projection and the three legacy lights in the form the render backends take
+RenderFrame buildRenderFrame(int width, int height) {
+    RenderFrame frame;
+    frame.width = width;
+    frame.height = height;
+    frame.projection = makePerspective(projectionFovY, static_cast<float>(width) / height, projectionNear, projectionFar);
+    frame.shininess = materialShininess;
+    frame.perPixelLighting = softwarePerPixelLighting;
+
+    Mat4 lightMatrix = cameraLightMatrix();
+    for (int i = 0; i < 3; ++i) {
+        if (!lightEnabled[i]) {
+            continue;
+        }
+        RenderLight& light = frame.lights[frame.lightCount++];
+        Vec3 position(lightPosition[i][0], lightPosition[i][1], lightPosition[i][2]);
+        Vec3 eye = lightPosition[i][3] == 0.0f ? transformDirection(lightMatrix, position)
+                                               : transformPoint(lightMatrix, position);
+        light.position[0] = eye.x;
+        light.position[1] = eye.y;
+        light.position[2] = eye.z;
+        light.position[3] = lightPosition[i][3];
+        std::memcpy(light.diffuse, lightColor[i], sizeof(light.diffuse));
+        // GL defaults: only GL_LIGHT0 has a specular term
+        float specular = i == 0 ? 1.0f : 0.0f;
+        light.specular[0] = light.specular[1] = light.specular[2] = specular;
+    }
+    return frame;
+}
+
+// Snapshot of the scene state for prepareFrame
+void fillFramePacket(FramePacket& packet, int width, int height) {
+    packet.scene = scene;
+    packet.sceneRevision = sceneRevision;
+    packet.profileFrame = profilerFrame();
+    packet.frame = buildRenderFrame(width, height);
+    packet.view = cameraViewMatrix();
+    std::memcpy(packet.materialColor, materialColor, sizeof(packet.materialColor));
+    sceneTransforms.update();
+    packet.skinning = skinnedVertices;
+    packet.meshes.resize(meshLocalBounds.size());
+    for (size_t i = 0; i < meshLocalBounds.size(); ++i) {
+        MeshState& mesh = packet.meshes[i];
+        mesh = MeshState();
+        mesh.localBounds = meshLocalBounds[i];
+        mesh.world = sceneTransforms.meshWorld(static_cast<unsigned int>(i));
+        auto it = meshInfoMap.find(static_cast<unsigned int>(i));
+        if (it != meshInfoMap.end()) {
+            mesh.visible = it->second.isVisible;
+        }
+    }
+    packet.findCollisions = showCollisionHighlights;
+    packet.softwareRendering = softwareRendering;
+    packet.pickId = pendingPickId;
+    packet.pickNdc[0] = pendingPickNdc[0];
+    packet.pickNdc[1] = pendingPickNdc[1];
+}
+
+// Culling for an output that lags the current state: kept for the meshes that have not moved
+// since, tested again against their current bounds for the animated ones, and for all of them
+// after a camera or scene change
+void cullLaggingOutput(const FrameOutput& output) {
+    bool sameView = output.sceneRevision == sceneRevision && output.inView.size() == meshLocalBounds.size() &&
+                    std::memcmp(output.viewProjection.m, cameraViewProjection.m, sizeof(cameraViewProjection.m)) == 0;
+    Frustum frustum = frustumFromMatrix(cameraViewProjection);
+    markAnimatedMeshes();
+    sceneTransforms.update();
+    meshInView.resize(meshLocalBounds.size());
+    for (unsigned int i = 0; i < meshLocalBounds.size(); ++i) {
+        if (sameView && !meshAnimated[i]) {
+            meshInView[i] = output.inView[i];
+        } else {
+            Aabb bounds = transformAabb(sceneTransforms.meshWorld(i), meshLocalBounds[i]);
+            meshInView[i] = intersectsFrustum(frustum, bounds) ? 1 : 0;
+        }
+    }
+}
+
+// Takes over the bounds and collision results of a prepared frame; see cullLaggingOutput for
+// the culling of an output that lags the current state. cameraViewProjection must be current.
+void adoptFrameOutput(const FrameOutput& output, bool current) {
+    meshWorldBounds = output.worldBounds;
+    meshColliding = output.colliding;
+    preparedSceneRevision = output.sceneRevision;
+    if (current) {
+        meshInView = output.inView;
+    } else {
+        cullLaggingOutput(output);
+    }
+    if (pendingPickId != 0 && output.pickId == pendingPickId) {
+        pendingPickId = 0;
+        selectedMeshIndex = output.pickedMesh;
+        if (selectedMeshIndex >= 0) {
+            meshInfoMap[selectedMeshIndex].isSelected = true;
+        }
+    }
+}
+
+// Redraws once the render thread has caught up with the last packet
+void pollRenderThread(int value) {
+    renderThreadPollArmed = false;
+    if (renderThread->completedSerial() < renderThread->submittedSerial()) {
+        renderThreadPollArmed = true;
+        glutTimerFunc(1, pollRenderThread, 0);
+        return;
+    }
+    requestRedraw();
+}
+
+// Hands the current state to the render thread unless it matches the last packet sent
+void submitFramePacket() {
+    FramePacket& packet = renderThread->packet();
+    fillFramePacket(packet, windowWidth, windowHeight);
+    if (renderThread->submittedSerial() != 0 && sameFrameState(packet, lastSubmittedPacket)) {
+        return;
+    }
+    lastSubmittedPacket = packet;
+    renderThread->submit();
+    if (!renderThreadPollArmed) {
+        renderThreadPollArmed = true;
+        glutTimerFunc(1, pollRenderThread, 0);
+    }
+}
+
+// Bounds, culling, collisions and picks for the frame being drawn: the newest render thread
+// output when it runs, otherwise prepared inline from the current state
+void updateSceneQueries(int width, int height) {
+    cameraViewProjection = makePerspective(projectionFovY, static_cast<float>(width) / height, projectionNear,
+                                           projectionFar) * cameraViewMatrix();
+    if (renderThread) {
+        renderThread->poll();
+        const FrameOutput& output = renderThread->output();
+        adoptFrameOutput(output, output.packetSerial == renderThread->submittedSerial());
+    } else {
+        fillFramePacket(inlinePacket, width, height);
+        prepareFrame(inlinePacket, inlineOutput, nullptr, frameJobs.get(), &frameArena);
+        adoptFrameOutput(inlineOutput, true);
+    }
+}
+
+// The model through a RenderBackend instead of the GL immediate-mode path in renderNodes
+void drawSceneWithBackend(RenderBackend& backend, int width, int height) {
+    fillFramePacket(inlinePacket, width, height);
+    prepareFrame(inlinePacket, inlineOutput, &backend, frameJobs.get(), &frameArena);
+    adoptFrameOutput(inlineOutput, true);
+    cameraViewProjection = inlineOutput.viewProjection;
+}
+
+SoftwareRasterizer& softwareRenderer() {
+    if (!softwareRasterizer) {
+        softwareRasterizer = std::make_unique<SoftwareRasterizer>();
+    }
+    return *softwareRasterizer;
+}
 
-    // Set camera position
-    glTranslatef(0.0f, 0.0f, -cameraDistance);
-    glRotatef(cameraAngleX, 1.0f, 0.0f, 0.0f);
-    glRotatef(cameraAngleY, 0.0f, 1.0f, 0.0f);
-    glTranslatef(-cameraPosX, -cameraPosY, 0.0f);
+// Camera, lights, shadows and the model; shared by the window and the headless renderer
+void drawScene() {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Set lights
+    // Lights are positioned under the camera orbit, then the look-at completes the view
+    glLoadMatrixf(cameraLightMatrix().m);
     setLights();
-    // Set camera position
-    gluLookAt(cameraDistance * sin(cameraAngleY) * cos(cameraAngleX),
-              cameraDistance * sin(cameraAngleX),
-              cameraDistance * cos(cameraAngleY) * cos(cameraAngleX),
-              cameraPosX, cameraPosY, 0.0f,
-              0.0f, 1.0f, 0.0f);
+    const Mat4 view = cameraViewMatrix();
+    glLoadMatrixf(view.m);
+
+    // Frustum culling and collision tests on the world-space mesh bounds
+    updateSceneQueries(windowWidth, windowHeight);
 
     // Update material properties based on the tweak bar values
     GLfloat materialShininessValue[] = {materialShininess};
@@ -497,25 +1645,143 @@ void display() {
     // Set the diffuse material color
     glColor3f(materialColor[0], materialColor[1], materialColor[2]);
 
+    // Bin point lights into view-space clusters for the lighting shader
+    bool clustered = useClusteredLighting && clusteredLightingAvailable();
+    if (clustered) {
+        // Shadow cascades for the directional light, fitted to the visible meshes
+        if (shadowsEnabled && lightEnabled[0] && scene) {
+            ShadowCamera shadowCamera;
+            shadowCamera.view = view;
+            shadowCamera.fovY = projectionFovY;
+            shadowCamera.aspect = static_cast<float>(windowWidth) / windowHeight;
+            shadowCamera.nearPlane = projectionNear;
+            shadowCamera.farPlane = projectionFar;
+
+            // GL_POSITION reads back in eye space; shadows need the world direction
+            GLfloat eyeLight[4];
+            glGetLightfv(GL_LIGHT0, GL_POSITION, eyeLight);
+            Vec3 lightDirection = transformDirection(inverse(shadowCamera.view),
+                                                     Vec3(eyeLight[0], eyeLight[1], eyeLight[2]));
+
+            PROFILE_SCOPE(ProfileStage::Shadows);
+            gpuTimerBegin(GpuPass::Shadows);
+            markAnimatedMeshes();
+            updateShadowMaps(shadowSettings, lightDirection, shadowCamera, meshWorldBounds, meshAnimated,
+                             preparedSceneRevision, drawShadowCasters);
+            gpuTimerEnd(GpuPass::Shadows);
+        } else {
+            disableShadowFrame();
+        }
+
+        gatherPointLights(inverse(view) * cameraLightMatrix());
+        {
+            PROFILE_SCOPE(ProfileStage::Lighting);
+            clusterGrid.fovY = projectionFovY;
+            clusterGrid.aspect = static_cast<float>(windowWidth) / windowHeight;
+            clusterGrid.nearPlane = projectionNear;
+            clusterGrid.farPlane = projectionFar;
+            updateClusteredLights(pointLights, view.m, clusterGrid, windowWidth, windowHeight);
+            beginClusteredLighting(materialShininess);
+        }
+    }
+
     // Render the model
     if (scene && scene->mRootNode) {
-        renderNode(scene->mRootNode, scene);
+        PROFILE_SCOPE(ProfileStage::Traversal);
+        gpuTimerBegin(GpuPass::Scene);
+        renderNodes(scene);
+        drawSwarm();
+        drawOccupancy();
+        gpuTimerEnd(GpuPass::Scene);
+    }
+
+    if (clustered) {
+        endClusteredLighting();
+    }
+}
+
+// Display callback
+// Render scene
+void display() {
+    frameScheduler.frameStarted();
+    profilerBeginFrame();
+    PROFILE_SCOPE(ProfileStage::Frame);
+    gpuTimerBeginFrame();
+    reportGpuTimes();
+    updateOccupancyMap();
+    if (swarmLayoutSize != swarmSize || swarmLayoutScene != scene) {
+        layoutSwarm();
+    }
+    updateSimulation();
+    pollTelemetry();
+    updateFlightModel();
+    updateFlightReplay();
+    updateSkeletalPose();
+    if (renderThread) {
+        submitFramePacket();
+    }
+
+    if (softwareRendering && renderThread) {
+        // Newest frame the render thread finished; black until the first one arrives
+        updateSceneQueries(windowWidth, windowHeight);
+        const FrameOutput& output = renderThread->output();
+        if (!output.pixels.empty()) {
+            presentColorBuffer(output.width, output.height, output.pixels.data());
+        } else {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+    } else if (softwareRendering) {
+        drawSceneWithBackend(softwareRenderer(), windowWidth, windowHeight);
+        softwareRenderer().present();
+    } else {
+        drawScene();
     }
 
     // Draw AntTweakBar
-    TwDraw();
+    {
+        PROFILE_SCOPE(ProfileStage::TweakBar);
+        gpuTimerBegin(GpuPass::UserInterface);
+        TwDraw();
+        gpuTimerEnd(GpuPass::UserInterface);
+    }
 
-    glutSwapBuffers();
+    if (showProfilerOverlay) {
+        drawProfilerOverlay(windowWidth, windowHeight);
+    }
+
+    {
+        PROFILE_SCOPE(ProfileStage::Swap);
+        glutSwapBuffers();
+    }
+    recordTelemetryLatency();
+    frameScheduler.frameFinished();
+    frameArena.reset();
+
+    // Refresh the percentiles shown in the tweak bar a few times per second
+    static int framesSinceStats = 0;
+    if (++framesSinceStats >= 30) {
+        framesSinceStats = 0;
+        FrameTimeStats stats = frameScheduler.stats();
+        frameTimeP50 = static_cast<float>(stats.p50);
+        frameTimeP95 = static_cast<float>(stats.p95);
+        frameTimeP99 = static_cast<float>(stats.p99);
+        measuredFps = static_cast<float>(stats.averageFps);
+        updateTelemetryStats(stats.averageFps > 0.0 ? 30.0 / stats.averageFps : 0.0);
+    }
+
+    // Animation toggles and tweak bar changes take effect here
+    updateRedrawLoop();
 }
 
 // Window reshape callback
 void reshape(int w, int h) {
     if (h == 0) h = 1;  // Prevent division by zero
+    windowWidth = w;
+    windowHeight = h;
 
     glViewport(0, 0, w, h);
     glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0f, (float)w / h, 0.1f, 100.0f);
+    glLoadMatrixf(makePerspective(projectionFovY, (float)w / h, projectionNear, projectionFar).m);
     glMatrixMode(GL_MODELVIEW);
 }
 
@@ -535,12 +1801,13 @@ void mouseButton(int button, int state, int x, int y) {
 // Mouse motion callback
 // Handle mouse motion for AntTweakBar and camera
 void mouseMotion(int x, int y) {
+    TRACE_SCOPE("mouseMotion", "input");
     if (!TwEventMouseMotionGLUT(x, y) && isDragging) {
         cameraAngleY += (x - lastMouseX) * 0.2f;
         cameraAngleX += (y - lastMouseY) * 0.2f;
         lastMouseX = x;
         lastMouseY = y;
-        glutPostRedisplay();
+        requestRedraw();
     }
     static int lastX = 0, lastY = 0;
 
@@ -563,11 +1830,12 @@ void mouseMotion(int x, int y) {
 
     lastX = x;
     lastY = y;
-    glutPostRedisplay();
+    requestRedraw();
 }
 
 // Handle mouse events
 void mouse(int button, int state, int x, int y) {
+    TRACE_SCOPE("mouse", "input");
     if (!TwEventMouseButtonGLUT(button, state, x, y)) {
         if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
             isDragging = true;
@@ -578,14 +1846,30 @@ void mouse(int button, int state, int x, int y) {
         } else if (button == GLUT_RIGHT_BUTTON) {
             cameraDistance += (state == GLUT_DOWN) ? -0.5f : 0.5f;
             if (cameraDistance < 1.0f) cameraDistance = 1.0f;
-            glutPostRedisplay();
+            requestRedraw();
         }
     }
 }
 
+// World-space nudge of the selected mesh; only its node's subtree gets new world matrices
+void moveSelectedMesh(float dx, float dy) {
+    if (selectedMeshIndex < 0) {
+        return;
+    }
+    float* position = meshInfoMap[selectedMeshIndex].position;
+    position[0] += dx;
+    position[1] += dy;
+    if (static_cast<size_t>(selectedMeshIndex) < sceneTransforms.meshCount()) {
+        sceneTransforms.setMeshOffset(selectedMeshIndex, Vec3(position[0], position[1], position[2]));
+    }
+    ++sceneRevision;
+    ++geometryRevision;
+}
+
 // Handle keyboard inputs
 // Keyboard callback
 void keyboard(unsigned char key, int x, int y) {
+    TRACE_SCOPE("keyboard", "input");
     switch (key) {
         // Camera movement
         case 'w': cameraPosY += 0.1f; break;
@@ -598,6 +1882,8 @@ void keyboard(unsigned char key, int x, int y) {
             if (selectedMeshIndex >= 0) {
                 meshInfoMap[selectedMeshIndex].isVisible =
                     !meshInfoMap[selectedMeshIndex].isVisible;
+                ++sceneRevision;
+                ++geometryRevision;
             }
             break;
 
@@ -612,20 +1898,16 @@ void keyboard(unsigned char key, int x, int y) {
 
         // Selected object movement
         case 'i':  // Up
-            if (selectedMeshIndex >= 0)
-                meshInfoMap[selectedMeshIndex].position[1] += 0.1f;
+            moveSelectedMesh(0.0f, 0.1f);
             break;
         case 'k':  // Down
-            if (selectedMeshIndex >= 0)
-                meshInfoMap[selectedMeshIndex].position[1] -= 0.1f;
+            moveSelectedMesh(0.0f, -0.1f);
             break;
         case 'j':  // Left
-            if (selectedMeshIndex >= 0)
-                meshInfoMap[selectedMeshIndex].position[0] -= 0.1f;
+            moveSelectedMesh(-0.1f, 0.0f);
             break;
         case 'l':  // Right
-            if (selectedMeshIndex >= 0)
-                meshInfoMap[selectedMeshIndex].position[0] += 0.1f;
+            moveSelectedMesh(0.1f, 0.0f);
             break;
 
         case 27:  // ESC key
@@ -633,7 +1915,7 @@ void keyboard(unsigned char key, int x, int y) {
             break;
     }
 
-    glutPostRedisplay();
+    requestRedraw();
     if (!TwEventKeyboardGLUT(key, x, y)) {
         switch (key) {
             case 'w': cameraPosY += 0.1f; break;
@@ -670,6 +1952,34 @@ void keyboard(unsigned char key, int x, int y) {
             case 'l': // Toggle animation
                 animateSelectedObject = !animateSelectedObject;
                 break;
+            case 'p': // Print frame time percentiles
+                printFrameStats();
+                break;
+            case 't': // Start/stop trace recording; stopping writes the file
+                if (traceRecording()) {
+                    traceStop();
+                    if (traceExport(tracePath)) {
+                        std::cout << "Trace written to " << tracePath << std::endl;
+                    }
+                } else {
+                    traceStart();
+                    std::cout << "Trace recording started" << std::endl;
+                }
+                break;
+            case 'b': // Switch between the OpenGL and software renderers
+                softwareRendering = !softwareRendering;
+                std::cout << (softwareRendering ? "Software rasterizer" : "OpenGL renderer") << std::endl;
+                break;
+            case 'o': // Toggle profiler overlay
+                showProfilerOverlay = !showProfilerOverlay;
+                break;
+            case 'e': // Export profiler samples
+                if (exportProfile("frame_profile.csv")) {
+                    std::cout << "Profile written to frame_profile.csv" << std::endl;
+                } else {
+                    std::cerr << "Profile export failed (profiler disabled or file not writable)" << std::endl;
+                }
+                break;
             case 'r': // Reset camera
                 cameraAngleX = 0.0f;
                 cameraAngleY = 0.0f;
@@ -681,17 +1991,541 @@ void keyboard(unsigned char key, int x, int y) {
                 TwTerminate();
                 exit(0);
         }
-        glutPostRedisplay();
+        requestRedraw();
     }
 }
 
+// Headless thumbnail rendering: no window, GLUT callbacks or tweak bar
+
+struct CameraPose {
+    float angleX = 15.0f;
+    float angleY = 0.0f;
+    float distance = 0.0f;  // <= 0 uses the distance fitted to the model
+    float posX = 0.0f;
+    float posY = 0.0f;
+};
+
+struct HeadlessOptions {
+    std::string outputDir = ".";
+    std::string posesPath;
+    int turntableCount = 8;
+    int width = 512;
+    int height = 512;
+    unsigned jobs = 0;  // Batch import workers, 0 = hardware threads
+    bool softwareBackend = false;
+    bool compareBackends = false;  // Render every pose with both backends and write a diff image
+};
+
+// One pose per line: "angleX angleY [distance [posX posY]]"; '#' starts a comment
+bool loadCameraPoses(const std::string& path, std::vector<CameraPose>& poses) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open camera poses: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        CameraPose pose;
+        if (!(fields >> pose.angleX >> pose.angleY)) {
+            continue;
+        }
+        fields >> pose.distance >> pose.posX >> pose.posY;
+        poses.push_back(pose);
+    }
+    return true;
+}
+
+// Evenly spaced orbit around the model
+std::vector<CameraPose> turntablePoses(int count) {
+    std::vector<CameraPose> poses(count);
+    for (int i = 0; i < count; ++i) {
+        poses[i].angleY = 360.0f * i / count;
+    }
+    return poses;
+}
+
+// Options shared by --headless and --batch; the value after modeFlag is the model or directory
+bool parseHeadlessOptions(int argc, char** argv, const std::string& modeFlag, std::string& input,
+                          HeadlessOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == modeFlag && hasValue) {
+            input = argv[++i];
+        } else if (arg == "--poses" && hasValue) {
+            options.posesPath = argv[++i];
+        } else if (arg == "--turntable" && hasValue) {
+            options.turntableCount = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 ||
+                options.height <= 0) {
+                std::cerr << "Invalid --size, expected WxH" << std::endl;
+                return false;
+            }
+        } else if (arg == "--out" && hasValue) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--texture" && hasValue) {
+            texturePath = argv[++i];
+        } else if (arg == "--jobs" && hasValue) {
+            options.jobs = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--backend" && hasValue) {
+            std::string backend = argv[++i];
+            if (backend != "gl" && backend != "software") {
+                std::cerr << "Invalid --backend, expected gl or software" << std::endl;
+                return false;
+            }
+            options.softwareBackend = backend == "software";
+        } else if (arg == "--compare-backends") {
+            options.compareBackends = true;
+        } else if (arg == "--per-pixel") {
+            softwarePerPixelLighting = true;
+        }
+    }
+    return true;
+}
+
+bool headlessPoses(const HeadlessOptions& options, std::vector<CameraPose>& poses) {
+    if (!options.posesPath.empty()) {
+        if (!loadCameraPoses(options.posesPath, poses)) {
+            return false;
+        }
+    } else {
+        poses = turntablePoses(options.turntableCount);
+    }
+    if (poses.empty()) {
+        std::cerr << "No camera poses to render" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// GL state for offscreen frames; the model is loaded separately
+bool initHeadlessRendering(HeadlessContext& context, const HeadlessOptions& options) {
+    if (!context.create(options.width, options.height)) {
+        return false;
+    }
+    initOpenGL();
+    reshape(options.width, options.height);
+    showCollisionHighlights = false;
+    std::filesystem::create_directories(options.outputDir);
+    return true;
+}
+
+void shutdownHeadlessRendering() {
+    shutdownGpuTimers();
+    shutdownShadowMaps();
+    shutdownClusteredLighting();
+}
+
+// Renders every pose of the active scene to <outputDir>/<stem>_NNN.png.
+// renderSeconds covers drawing only, encodeSeconds readback and PNG encoding.
+// Headless frames go through drawScene, or through the software rasterizer when one is given
+bool renderPosesToPng(HeadlessContext& context, SoftwareRasterizer* software, const std::vector<CameraPose>& poses,
+                      const std::string& outputDir, const std::string& stem, double& renderSeconds,
+                      double& encodeSeconds) {
+    const float fitDistance = cameraDistance;
+    std::vector<uint8_t> pixels;
+    for (size_t i = 0; i < poses.size(); ++i) {
+        const CameraPose& pose = poses[i];
+        cameraAngleX = pose.angleX;
+        cameraAngleY = pose.angleY;
+        cameraDistance = pose.distance > 0.0f ? pose.distance : fitDistance;
+        cameraPosX = pose.posX;
+        cameraPosY = pose.posY;
+
+        double frameStart = SimulationClock::now();
+        if (software) {
+            drawSceneWithBackend(*software, context.width(), context.height());
+            software->readPixels(pixels);
+        } else {
+            drawScene();
+            glFinish();
+        }
+        frameArena.reset();
+        double frameEnd = SimulationClock::now();
+        renderSeconds += frameEnd - frameStart;
+
+        if (!software) {
+            context.readPixels(pixels);
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "_%03zu.png", i);
+        std::string path = (std::filesystem::path(outputDir) / (stem + name)).string();
+        if (!writePng(path, context.width(), context.height(), pixels.data())) {
+            std::cerr << "Failed to write " << path << std::endl;
+            cameraDistance = fitDistance;
+            return false;
+        }
+        encodeSeconds += SimulationClock::now() - frameEnd;
+    }
+    cameraDistance = fitDistance;
+    return true;
+}
+
+// Renders every pose through GlRenderBackend and the software rasterizer and writes the absolute
+// difference as <stem>_NNN_diff.png. Fails if more than 1% of the pixels differ by over 16 levels.
+bool compareBackendsToPng(HeadlessContext& context, const std::vector<CameraPose>& poses,
+                          const std::string& outputDir, const std::string& stem) {
+    const float fitDistance = cameraDistance;
+    const int width = context.width(), height = context.height();
+    GlRenderBackend glBackend;
+    SoftwareRasterizer software;
+    std::vector<uint8_t> glPixels, softwarePixels, diff;
+    size_t totalPixels = 0, totalMismatched = 0;
+    bool written = true;
+    for (size_t i = 0; i < poses.size() && written; ++i) {
+        const CameraPose& pose = poses[i];
+        cameraAngleX = pose.angleX;
+        cameraAngleY = pose.angleY;
+        cameraDistance = pose.distance > 0.0f ? pose.distance : fitDistance;
+        cameraPosX = pose.posX;
+        cameraPosY = pose.posY;
+
+        drawSceneWithBackend(glBackend, width, height);
+        glFinish();
+        context.readPixels(glPixels);
+        drawSceneWithBackend(software, width, height);
+        software.readPixels(softwarePixels);
+        frameArena.reset();
+
+        diff.resize(glPixels.size());
+        double sumDiff = 0.0;
+        size_t mismatched = 0;
+        for (size_t p = 0; p < glPixels.size(); p += 3) {
+            int worst = 0;
+            for (size_t c = 0; c < 3; ++c) {
+                int d = std::abs(static_cast<int>(glPixels[p + c]) - static_cast<int>(softwarePixels[p + c]));
+                diff[p + c] = static_cast<uint8_t>(d);
+                sumDiff += d;
+                worst = std::max(worst, d);
+            }
+            mismatched += worst > 16 ? 1 : 0;
+        }
+        size_t pixelCount = glPixels.size() / 3;
+        totalPixels += pixelCount;
+        totalMismatched += mismatched;
+        std::cout << "Pose " << i << ": mean abs diff " << sumDiff / glPixels.size() << ", "
+                  << 100.0 * mismatched / pixelCount << "% of pixels off by more than 16" << std::endl;
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "_%03zu_diff.png", i);
+        std::string path = (std::filesystem::path(outputDir) / (stem + name)).string();
+        if (!writePng(path, width, height, diff.data())) {
+            std::cerr << "Failed to write " << path << std::endl;
+            written = false;
+        }
+    }
+    cameraDistance = fitDistance;
+    if (!written) {
+        return false;
+    }
+    double mismatchPercent = totalPixels ? 100.0 * totalMismatched / totalPixels : 0.0;
+    std::cout << "Backends differ on " << mismatchPercent << "% of pixels" << std::endl;
+    return mismatchPercent <= 1.0;
+}
+
+// --headless <model> [--poses file] [--turntable N] [--size WxH] [--out dir] [--texture image]
+//            [--backend gl|software] [--per-pixel] [--compare-backends]
+int runHeadless(int argc, char** argv) {
+    HeadlessOptions options;
+    std::vector<CameraPose> poses;
+    texturePath.clear();
+    if (!parseHeadlessOptions(argc, argv, "--headless", modelPath, options) || !headlessPoses(options, poses)) {
+        return EXIT_FAILURE;
+    }
+
+    HeadlessContext context;
+    if (!initHeadlessRendering(context, options)) {
+        return EXIT_FAILURE;
+    }
+    loadModel(modelPath);
+
+    std::string stem = std::filesystem::path(modelPath).stem().string();
+    if (options.compareBackends) {
+        bool matched = compareBackendsToPng(context, poses, options.outputDir, stem);
+        shutdownHeadlessRendering();
+        return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    double renderSeconds = 0.0, encodeSeconds = 0.0;
+    std::unique_ptr<SoftwareRasterizer> software;
+    if (options.softwareBackend) {
+        software = std::make_unique<SoftwareRasterizer>();
+    }
+    bool written = renderPosesToPng(context, software.get(), poses, options.outputDir, stem, renderSeconds,
+                                    encodeSeconds);
+    double totalSeconds = renderSeconds + encodeSeconds;
+    if (written) {
+        std::cout << "Headless: rendered " << poses.size() << " frames at " << options.width << "x"
+                  << options.height << " in " << totalSeconds << " s (" << poses.size() / renderSeconds
+                  << " frames/s rendering, " << poses.size() / totalSeconds
+                  << " frames/s including readback and PNG encode)" << std::endl;
+    }
+    shutdownHeadlessRendering();
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Peak resident set size of the whole process so far, or -1 where it can't be queried. It
+// never goes down, so it is not a per-asset figure.
+long peakResidentKb() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// --batch <dir> [--jobs N] plus the --headless options. Imports run in parallel, one
+// Assimp::Importer per worker; rendering stays on this thread, which owns the GL context.
+int runBatch(int argc, char** argv) {
+    HeadlessOptions options;
+    std::vector<CameraPose> poses;
+    std::string inputDir;
+    texturePath.clear();
+    if (!parseHeadlessOptions(argc, argv, "--batch", inputDir, options) || !headlessPoses(options, poses)) {
+        return EXIT_FAILURE;
+    }
+
+    std::error_code walkError;
+    std::vector<std::string> assets;
+    for (std::filesystem::recursive_directory_iterator it(inputDir, walkError), end; !walkError && it != end;
+         it.increment(walkError)) {
+        std::string extension = it->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (it->is_regular_file() && (extension == ".obj" || extension == ".fbx")) {
+            assets.push_back(it->path().string());
+        }
+    }
+    if (walkError || assets.empty()) {
+        std::cerr << "No OBJ/FBX assets found in " << inputDir << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::sort(assets.begin(), assets.end());
+
+    HeadlessContext context;
+    if (!initHeadlessRendering(context, options)) {
+        return EXIT_FAILURE;
+    }
+
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    std::string manifestPath = (std::filesystem::path(options.outputDir) / "manifest.json").string();
+    std::ofstream manifest(manifestPath);
+    manifest << "{\n  \"size\": [" << options.width << ", " << options.height << "],\n  \"poses\": " << poses.size()
+             << ",\n  \"jobs\": " << jobs << ",\n  \"assets\": [";
+
+    std::unique_ptr<SoftwareRasterizer> software;
+    if (options.softwareBackend) {
+        software = std::make_unique<SoftwareRasterizer>();
+    }
+
+    size_t rendered = 0, failed = 0;
+    double start = SimulationClock::now();
+    {
+        AssetImportPool pool(assets, jobs, kModelImportFlags, jobs * 2);
+        ImportedAsset asset;
+        for (size_t index = 0; pool.next(asset); ++index) {
+            double renderSeconds = 0.0, encodeSeconds = 0.0;
+            if (asset.scene) {
+                // Unique output names even when two directories hold files with the same stem
+                std::string stem = std::filesystem::relative(asset.path, inputDir).replace_extension().string();
+                std::replace_if(stem.begin(), stem.end(), [](char c) { return c == '/' || c == '\\'; }, '_');
+
+                setActiveScene(asset.scene.get());
+                if (!renderPosesToPng(context, software.get(), poses, options.outputDir, stem, renderSeconds,
+                                      encodeSeconds)) {
+                    asset.error = "failed to write thumbnails";
+                }
+                setActiveScene(nullptr);
+            }
+            asset.error.empty() ? ++rendered : ++failed;
+
+            manifest << (index ? "," : "") << "\n    {\"path\": \"" << jsonEscape(asset.path) << "\", \"ok\": "
+                     << (asset.error.empty() ? "true" : "false");
+            if (!asset.error.empty()) {
+                manifest << ", \"error\": \"" << jsonEscape(asset.error) << "\"";
+            } else {
+                manifest << ", \"meshes\": " << asset.scene->mNumMeshes;
+            }
+            manifest << ", \"import_ms\": " << asset.importMs << ", \"render_ms\": " << renderSeconds * 1000.0
+                     << ", \"encode_ms\": " << encodeSeconds * 1000.0 << ", \"importer_bytes\": "
+                     << asset.importerBytes << ", \"import_rss_delta_kb\": ";
+            if (asset.residentMeasured) {
+                manifest << asset.residentDeltaKb;
+            } else {
+                manifest << "null";
+            }
+            manifest << ", \"process_peak_rss_kb\": " << peakResidentKb() << "}";
+            asset.scene.reset();
+        }
+    }
+    double totalSeconds = SimulationClock::now() - start;
+    manifest << "\n  ],\n  \"total_seconds\": " << totalSeconds << "\n}\n";
+
+    std::cout << "Batch: " << rendered << " assets rendered, " << failed << " failed, "
+              << rendered * poses.size() / totalSeconds << " thumbnails/s with " << jobs
+              << " import workers; manifest at " << manifestPath << std::endl;
+    shutdownHeadlessRendering();
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 // Main function and setup
 
+// Flush a recording still running when the viewer exits
+void exportTraceAtExit() {
+    if (traceRecording()) {
+        traceStop();
+        traceExport(tracePath);
+    }
+}
+
+// Largest element difference relative to the reference, which is the matrix GL built
+float matrixError(const Mat4& m, const GLfloat reference[16]) {
+    float error = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        error = std::max(error, std::fabs(m.m[i] - reference[i]) / std::max(1.0f, std::fabs(reference[i])));
+    }
+    return error;
+}
+
+// --check-math: the camera and projection matrices built with VecMath against the ones the
+// fixed-function stack and GLU produce (glTranslate/glRotate, gluLookAt, gluPerspective)
+// over a sweep of poses. Needs a headless GL context; fails on any relative error above 1e-4.
+int runMathCheck() {
+    HeadlessContext context;
+    if (!context.create(64, 64)) {
+        return EXIT_FAILURE;
+    }
+    const float savedDistance = cameraDistance, savedAngleX = cameraAngleX, savedAngleY = cameraAngleY;
+    const float savedPosX = cameraPosX, savedPosY = cameraPosY;
+    float viewError = 0.0f, projectionError = 0.0f;
+    GLfloat reference[16];
+    glMatrixMode(GL_MODELVIEW);
+    for (float angleX = -1.5f; angleX <= 1.5f; angleX += 0.25f) {
+        for (float angleY = -3.0f; angleY <= 3.0f; angleY += 0.375f) {
+            for (float distance : {1.0f, 5.0f, 40.0f}) {
+                cameraAngleX = angleX;
+                cameraAngleY = angleY;
+                cameraDistance = distance;
+                cameraPosX = 0.3f * angleY;
+                cameraPosY = -0.2f * angleX;
+                glLoadIdentity();
+                glTranslatef(0.0f, 0.0f, -cameraDistance);
+                glRotatef(cameraAngleX, 1.0f, 0.0f, 0.0f);
+                glRotatef(cameraAngleY, 0.0f, 1.0f, 0.0f);
+                glTranslatef(-cameraPosX, -cameraPosY, 0.0f);
+                glGetFloatv(GL_MODELVIEW_MATRIX, reference);
+                viewError = std::max(viewError, matrixError(cameraLightMatrix(), reference));
+                gluLookAt(cameraDistance * std::sin(cameraAngleY) * std::cos(cameraAngleX),
+                          cameraDistance * std::sin(cameraAngleX),
+                          cameraDistance * std::cos(cameraAngleY) * std::cos(cameraAngleX), cameraPosX, cameraPosY,
+                          0.0f, 0.0f, 1.0f, 0.0f);
+                glGetFloatv(GL_MODELVIEW_MATRIX, reference);
+                viewError = std::max(viewError, matrixError(cameraViewMatrix(), reference));
+            }
+        }
+    }
+    glMatrixMode(GL_PROJECTION);
+    for (float fovY : {30.0f, 45.0f, 60.0f, 90.0f}) {
+        for (float aspect : {0.5f, 1.0f, 16.0f / 9.0f}) {
+            glLoadIdentity();
+            gluPerspective(fovY, aspect, projectionNear, projectionFar);
+            glGetFloatv(GL_PROJECTION_MATRIX, reference);
+            Mat4 projection = makePerspective(fovY, aspect, projectionNear, projectionFar);
+            projectionError = std::max(projectionError, matrixError(projection, reference));
+        }
+    }
+    glMatrixMode(GL_MODELVIEW);
+    cameraDistance = savedDistance;
+    cameraAngleX = savedAngleX;
+    cameraAngleY = savedAngleY;
+    cameraPosX = savedPosX;
+    cameraPosY = savedPosY;
+
+    std::cout << "Largest relative error: view " << viewError << ", projection " << projectionError << std::endl;
+    return viewError <= 1e-4f && projectionError <= 1e-4f ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 void initAnimation() {
-    glutTimerFunc(16, updateAnimation, 0); // Start animation timer
+    updateRedrawLoop(); // Only runs a redraw timer if something animates
 }
 
 int main(int argc, char** argv) {
+    // Light binning benchmark runs without a window
+    if (argc > 1 && std::string(argv[1]) == "--bench-lights") {
+        runClusterBinningBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--check-math") {
+        return runMathCheck();
+    }
+
+    traceSetThreadName("main");
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--trace") {
+            traceStart();  // Captures model load and texture decode too
+        }
+        if (std::string(argv[i]) == "--software") {
+            softwareRendering = true;
+        }
+        if (std::string(argv[i]) == "--no-render-thread") {
+            useRenderThread = false;
+        }
+        if (std::string(argv[i]) == "--frame-jobs" && i + 1 < argc) {
+            frameJobThreads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        }
+        if (std::string(argv[i]) == "--fly") {
+            flyModel = true;
+        }
+        if (std::string(argv[i]) == "--swarm" && i + 1 < argc) {
+            swarmSize = std::max(0, std::atoi(argv[++i]));
+        }
+        if (std::string(argv[i]) == "--telemetry") {
+            telemetryRingName = i + 1 < argc && argv[i + 1][0] == '/' ? argv[++i] : kDefaultTelemetryRing;
+        }
+        if (std::string(argv[i]) == "--replay" && i + 1 < argc) {
+            if (!flightLog.open(argv[++i])) {
+                return EXIT_FAILURE;
+            }
+            std::cout << "Flight log: " << flightLog.size() << " records, "
+                      << flightLog.endTime() - flightLog.startTime() << " s" << std::endl;
+        }
+    }
+    atexit(exportTraceAtExit);
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--headless") {
+            return runHeadless(argc, argv);
+        }
+        if (std::string(argv[i]) == "--batch") {
+            return runBatch(argc, argv);
+        }
+    }
+
     // Initialize GLUT
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
@@ -707,6 +2541,14 @@ int main(int argc, char** argv) {
     // Load the drone model
     loadModel(modelPath);
 
+    // Started once the scene is loaded; it only reads the scene from here on
+    if (frameJobThreads != 1) {
+        frameJobs = std::make_unique<JobSystem>(frameJobThreads);
+    }
+    if (useRenderThread) {
+        renderThread = std::make_unique<RenderThread>(frameJobs.get());
+    }
+
     // Register callbacks
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
@@ -0,0 +1,108 @@
+#include "AssetImportPool.h"
+#include "SimulationClock.h"
+#include "TraceRecorder.h"
+#include <assimp/Importer.hpp>
+#include <algorithm>
+#include <cstdio>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Current resident set size of the process from /proc/self/statm, or -1 where there is none
+long currentResidentKb() {
+#ifdef __linux__
+    long pages = -1;
+    if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+        long size = 0;
+        if (std::fscanf(statm, "%ld %ld", &size, &pages) != 2) {
+            pages = -1;
+        }
+        std::fclose(statm);
+    }
+    if (pages >= 0) {
+        return pages * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+#endif
+    return -1;
+}
+
+} // namespace
+
+AssetImportPool::AssetImportPool(std::vector<std::string> paths, unsigned workerCount, unsigned postProcessFlags,
+                                 size_t maxPending)
+    : paths(std::move(paths)), flags(postProcessFlags), maxPending(std::max<size_t>(1, maxPending)) {
+    workerCount = std::max(1u, std::min<unsigned>(workerCount, static_cast<unsigned>(this->paths.size())));
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&AssetImportPool::workerLoop, this, i);
+    }
+}
+
+AssetImportPool::~AssetImportPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    slotFree.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+bool AssetImportPool::next(ImportedAsset& out) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (delivered == paths.size()) {
+        return false;
+    }
+    resultReady.wait(lock, [this] { return !results.empty(); });
+    out = std::move(results.front());
+    results.pop_front();
+    ++delivered;
+    lock.unlock();
+    slotFree.notify_one();
+    return true;
+}
+
+void AssetImportPool::workerLoop(unsigned workerIndex) {
+    traceSetThreadName("importer " + std::to_string(workerIndex));
+    Assimp::Importer importer;
+
+    for (;;) {
+        size_t index = nextPath.fetch_add(1, std::memory_order_relaxed);
+        if (index >= paths.size()) {
+            return;
+        }
+
+        ImportedAsset asset;
+        asset.path = paths[index];
+        {
+            TRACE_SCOPE("importAsset", "load");
+            long residentBefore = currentResidentKb();
+            double start = SimulationClock::now();
+            const aiScene* loaded = importer.ReadFile(asset.path, flags);
+            asset.importMs = (SimulationClock::now() - start) * 1000.0;
+            long residentAfter = currentResidentKb();
+            asset.residentMeasured = residentBefore >= 0 && residentAfter >= 0;
+            asset.residentDeltaKb = residentAfter - residentBefore;
+            if (!loaded || (loaded->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !loaded->mRootNode) {
+                asset.error = importer.GetErrorString();
+                importer.FreeScene();
+            } else {
+                aiMemoryInfo memory;
+                importer.GetMemoryRequirements(memory);
+                asset.importerBytes = memory.total;
+                asset.scene.reset(importer.GetOrphanedScene());
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        slotFree.wait(lock, [this] { return stopping || results.size() < maxPending; });
+        if (stopping) {
+            return;
+        }
+        results.push_back(std::move(asset));
+        lock.unlock();
+        resultReady.notify_one();
+    }
+}
@@ -0,0 +1,778 @@
+#define GL_GLEXT_PROTOTYPES
+#include "ClusteredLighting.h"
+#include "ShadowMaps.h"
+#include "TraceRecorder.h"
+#include <GL/glext.h>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CLUSTER_BINNER_SSE 1
+#endif
+
+// ---------------------------------------------------------------------------
+// CPU binner
+// ---------------------------------------------------------------------------
+
+ClusterBinner::ClusterBinner(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+    }
+    // The calling thread acts as worker 0
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ClusterBinner::workerLoop, this, i);
+    }
+}
+
+ClusterBinner::~ClusterBinner() {
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ClusterBinner::setGrid(const ClusterGridConfig& newConfig) {
+    if (boundsValid &&
+        newConfig.tilesX == config.tilesX && newConfig.tilesY == config.tilesY &&
+        newConfig.slicesZ == config.slicesZ && newConfig.fovY == config.fovY &&
+        newConfig.aspect == config.aspect && newConfig.nearPlane == config.nearPlane &&
+        newConfig.farPlane == config.farPlane &&
+        newConfig.maxLightsPerCluster == config.maxLightsPerCluster) {
+        return;
+    }
+    config = newConfig;
+    buildClusterBounds();
+}
+
+void ClusterBinner::buildClusterBounds() {
+    const int tilesPerSlice = config.tilesX * config.tilesY;
+    tilesPerSlicePadded = (tilesPerSlice + 3) & ~3;
+
+    const size_t total = static_cast<size_t>(tilesPerSlicePadded) * config.slicesZ;
+    boundsMinX.assign(total, FLT_MAX);
+    boundsMaxX.assign(total, -FLT_MAX);
+    boundsMinY.assign(total, FLT_MAX);
+    boundsMaxY.assign(total, -FLT_MAX);
+    sliceNear.resize(config.slicesZ);
+    sliceFar.resize(config.slicesZ);
+
+    const float tanHalfFov = std::tan(config.fovY * 0.5f * static_cast<float>(M_PI) / 180.0f);
+    const float depthRatio = config.farPlane / config.nearPlane;
+    sliceScale = config.slicesZ / std::log(depthRatio);
+
+    for (int s = 0; s < config.slicesZ; ++s) {
+        float dNear = config.nearPlane * std::pow(depthRatio, static_cast<float>(s) / config.slicesZ);
+        float dFar = config.nearPlane * std::pow(depthRatio, static_cast<float>(s + 1) / config.slicesZ);
+        sliceNear[s] = dNear;
+        sliceFar[s] = dFar;
+
+        float halfHeightNear = dNear * tanHalfFov, halfHeightFar = dFar * tanHalfFov;
+        float halfWidthNear = halfHeightNear * config.aspect, halfWidthFar = halfHeightFar * config.aspect;
+
+        for (int ty = 0; ty < config.tilesY; ++ty) {
+            float ndcY0 = -1.0f + 2.0f * ty / config.tilesY;
+            float ndcY1 = -1.0f + 2.0f * (ty + 1) / config.tilesY;
+            for (int tx = 0; tx < config.tilesX; ++tx) {
+                float ndcX0 = -1.0f + 2.0f * tx / config.tilesX;
+                float ndcX1 = -1.0f + 2.0f * (tx + 1) / config.tilesX;
+
+                size_t i = static_cast<size_t>(s) * tilesPerSlicePadded + ty * config.tilesX + tx;
+                boundsMinX[i] = std::min(ndcX0 * halfWidthNear, ndcX0 * halfWidthFar);
+                boundsMaxX[i] = std::max(ndcX1 * halfWidthNear, ndcX1 * halfWidthFar);
+                boundsMinY[i] = std::min(ndcY0 * halfHeightNear, ndcY0 * halfHeightFar);
+                boundsMaxY[i] = std::max(ndcY1 * halfHeightNear, ndcY1 * halfHeightFar);
+            }
+        }
+    }
+
+    scratch.assign(static_cast<size_t>(clusterCount()) * config.maxLightsPerCluster, 0);
+    counts.assign(clusterCount(), 0);
+    offsets.assign(clusterCount(), 0);
+    sliceOverflow.assign(config.slicesZ, 0);
+    boundsValid = true;
+}
+
+void ClusterBinner::bin(const std::vector<PointLight>& lights, const float m[16]) {
+    if (!boundsValid) {
+        buildClusterBounds();
+    }
+
+    // Transform lights to view space and find the depth slices each one touches
+    const size_t lightCount = lights.size();
+    lightView.resize(lightCount * 4);
+    lightSliceRange.resize(lightCount * 2);
+    for (size_t i = 0; i < lightCount; ++i) {
+        const float* p = lights[i].position;
+        float x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+        float y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+        float z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+        float r = lights[i].radius;
+        lightView[i * 4 + 0] = x;
+        lightView[i * 4 + 1] = y;
+        lightView[i * 4 + 2] = z;
+        lightView[i * 4 + 3] = r;
+
+        float depthMin = -z - r, depthMax = -z + r;
+        if (depthMax < config.nearPlane || depthMin > config.farPlane) {
+            lightSliceRange[i * 2] = 1;
+            lightSliceRange[i * 2 + 1] = 0;  // Empty range
+            continue;
+        }
+        depthMin = std::max(depthMin, config.nearPlane);
+        depthMax = std::min(depthMax, config.farPlane);
+        int first = static_cast<int>(std::log(depthMin / config.nearPlane) * sliceScale);
+        int last = static_cast<int>(std::log(depthMax / config.nearPlane) * sliceScale);
+        lightSliceRange[i * 2] = std::clamp(first, 0, config.slicesZ - 1);
+        lightSliceRange[i * 2 + 1] = std::clamp(last, 0, config.slicesZ - 1);
+    }
+
+    // Workers take interleaved slices; near slices are usually denser
+    const unsigned threads = threadCount();
+    runParallel([this, threads](unsigned worker) {
+        for (int s = static_cast<int>(worker); s < config.slicesZ; s += static_cast<int>(threads)) {
+            binSlice(s);
+        }
+    });
+
+    // Compact the fixed-capacity per-cluster lists into one index list
+    const int clusters = clusterCount();
+    indices.clear();
+    overflow = 0;
+    for (int s = 0; s < config.slicesZ; ++s) {
+        overflow += sliceOverflow[s];
+    }
+    for (int c = 0; c < clusters; ++c) {
+        offsets[c] = static_cast<uint32_t>(indices.size());
+        const uint32_t* list = &scratch[static_cast<size_t>(c) * config.maxLightsPerCluster];
+        indices.insert(indices.end(), list, list + counts[c]);
+    }
+}
+
+void ClusterBinner::binSlice(int s) {
+    TRACE_SCOPE("binSlice", "lighting");
+    const int tilesPerSlice = config.tilesX * config.tilesY;
+    const int cap = config.maxLightsPerCluster;
+    const size_t boundsBase = static_cast<size_t>(s) * tilesPerSlicePadded;
+    const int clusterBase = s * tilesPerSlice;
+    const float zNear = sliceNear[s], zFar = sliceFar[s];
+
+    std::fill(counts.begin() + clusterBase, counts.begin() + clusterBase + tilesPerSlice, 0u);
+    uint32_t lost = 0;
+
+    const size_t lightCount = lightView.size() / 4;
+    for (size_t i = 0; i < lightCount; ++i) {
+        if (s < lightSliceRange[i * 2] || s > lightSliceRange[i * 2 + 1]) {
+            continue;
+        }
+        const float px = lightView[i * 4], py = lightView[i * 4 + 1];
+        const float depth = -lightView[i * 4 + 2], r = lightView[i * 4 + 3];
+
+        // Depth distance is shared by every tile in the slice
+        float dz = std::max({zNear - depth, depth - zFar, 0.0f});
+        float remaining = r * r - dz * dz;
+        if (remaining < 0.0f) {
+            continue;
+        }
+
+        auto accept = [&](int tile) {
+            uint32_t& count = counts[clusterBase + tile];
+            if (count < static_cast<uint32_t>(cap)) {
+                scratch[static_cast<size_t>(clusterBase + tile) * cap + count++] = static_cast<uint32_t>(i);
+            } else {
+                ++lost;
+            }
+        };
+
+#ifdef CLUSTER_BINNER_SSE
+        const __m128 vx = _mm_set1_ps(px), vy = _mm_set1_ps(py);
+        const __m128 vRemaining = _mm_set1_ps(remaining), zero = _mm_setzero_ps();
+        for (int t = 0; t < tilesPerSlicePadded; t += 4) {
+            __m128 minX = _mm_loadu_ps(&boundsMinX[boundsBase + t]);
+            __m128 maxX = _mm_loadu_ps(&boundsMaxX[boundsBase + t]);
+            __m128 minY = _mm_loadu_ps(&boundsMinY[boundsBase + t]);
+            __m128 maxY = _mm_loadu_ps(&boundsMaxY[boundsBase + t]);
+            __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, vx), _mm_sub_ps(vx, maxX)), zero);
+            __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, vy), _mm_sub_ps(vy, maxY)), zero);
+            __m128 dist = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(dist, vRemaining));
+            while (mask) {
+                int lane = std::countr_zero(static_cast<unsigned>(mask));
+                mask &= mask - 1;
+                // Padding lanes have inverted bounds and never pass
+                accept(t + lane);
+            }
+        }
+#else
+        for (int t = 0; t < tilesPerSlice; ++t) {
+            size_t b = boundsBase + t;
+            float dx = std::max({boundsMinX[b] - px, px - boundsMaxX[b], 0.0f});
+            float dy = std::max({boundsMinY[b] - py, py - boundsMaxY[b], 0.0f});
+            if (dx * dx + dy * dy <= remaining) {
+                accept(t);
+            }
+        }
+#endif
+    }
+    sliceOverflow[s] = lost;
+}
+
+void ClusterBinner::runParallel(const std::function<void(unsigned)>& task) {
+    if (workers.empty()) {
+        task(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        currentTask = task;
+        pendingWorkers = static_cast<unsigned>(workers.size());
+        ++generation;
+    }
+    workReady.notify_all();
+    task(0);
+
+    std::unique_lock<std::mutex> lock(workMutex);
+    workDone.wait(lock, [this] { return pendingWorkers == 0; });
+}
+
+void ClusterBinner::workerLoop(unsigned workerIndex) {
+    traceSetThreadName("light binner " + std::to_string(workerIndex));
+    uint64_t seenGeneration = 0;
+    for (;;) {
+        std::function<void(unsigned)> task;
+        {
+            std::unique_lock<std::mutex> lock(workMutex);
+            workReady.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+            task = currentTask;
+        }
+        task(workerIndex);
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            --pendingWorkers;
+        }
+        workDone.notify_one();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GPU side
+// ---------------------------------------------------------------------------
+
+namespace {
+
+const int kIndexTextureWidth = 1024;
+const int kLightsPerRow = 512;   // Two RGBA texels per light
+
+// Generic vertex attributes of the optional linear blend skinning in the vertex shader
+const GLuint kBoneIndexAttribute = 6;
+const GLuint kBoneWeightAttribute = 7;
+
+const char* kVertexShader = R"(
+#version 120
+const int MAX_SKIN_BONES = 24;  // kMaxGpuSkinBones
+
+uniform bool skinned;
+uniform mat4 bones[MAX_SKIN_BONES];
+attribute vec4 boneIndices;
+attribute vec4 boneWeights;
+
+varying vec3 viewPos;
+varying vec3 viewNormal;
+varying vec4 vertexColor;
+varying vec2 texCoord;
+
+void main() {
+    vec4 vertex = gl_Vertex;
+    vec3 normal = gl_Normal;
+    if (skinned) {
+        mat4 skin = bones[int(boneIndices.x)] * boneWeights.x + bones[int(boneIndices.y)] * boneWeights.y +
+                    bones[int(boneIndices.z)] * boneWeights.z + bones[int(boneIndices.w)] * boneWeights.w;
+        vertex = skin * gl_Vertex;
+        normal = mat3(skin[0].xyz, skin[1].xyz, skin[2].xyz) * gl_Normal;
+    }
+    vec4 p = gl_ModelViewMatrix * vertex;
+    viewPos = p.xyz;
+    viewNormal = gl_NormalMatrix * normal;
+    vertexColor = gl_Color;
+    texCoord = gl_MultiTexCoord0.xy;
+    gl_Position = gl_ProjectionMatrix * p;
+}
+)";
+
+const char* kFragmentShader = R"(
+#version 120
+const int MAX_CLUSTER_LIGHTS = 128;
+
+uniform sampler2D diffuseMap;
+uniform sampler2D clusterTex;   // r = offset, g = count
+uniform sampler2D indexTex;     // r = light index
+uniform sampler2D lightTex;     // texel 0: view position + radius, texel 1: color
+uniform bool textured;
+uniform bool directionalEnabled;
+uniform vec3 gridSize;
+uniform vec2 tileSize;
+uniform float sliceScale;
+uniform float sliceBias;
+uniform vec2 indexTexSize;
+uniform vec2 lightTexSize;
+uniform float shininess;
+
+// Cascaded shadow maps for the directional light, packed side by side in one atlas
+uniform sampler2DShadow shadowMap;
+uniform int shadowCascades;
+uniform vec4 shadowSplits;
+uniform mat4 shadowMatrices[4];
+uniform vec2 shadowTexel;
+
+varying vec3 viewPos;
+varying vec3 viewNormal;
+varying vec4 vertexColor;
+varying vec2 texCoord;
+
+vec2 texelCoord(float index, vec2 size) {
+    float row = floor(index / size.x);
+    return vec2((index - row * size.x + 0.5) / size.x, (row + 0.5) / size.y);
+}
+
+vec3 shade(vec3 n, vec3 v, vec3 l, vec3 lightColor, vec3 base) {
+    float diffuse = max(dot(n, l), 0.0);
+    vec3 color = diffuse * lightColor * base;
+    if (diffuse > 0.0) {
+        vec3 h = normalize(l + v);
+        color += pow(max(dot(n, h), 0.0), shininess) * lightColor * gl_FrontMaterial.specular.rgb;
+    }
+    return color;
+}
+
+float shadowFactor() {
+    if (shadowCascades == 0) return 1.0;
+
+    float depth = -viewPos.z;
+    int cascade = shadowCascades - 1;
+    for (int i = 0; i < 4; ++i) {
+        if (i < shadowCascades && depth <= shadowSplits[i]) {
+            cascade = i;
+            break;
+        }
+    }
+    vec4 coord = shadowMatrices[cascade] * vec4(viewPos, 1.0);
+    // Outside the cascade's own tile (inset by the filter footprint) the atlas holds a neighbour
+    float tileMin = float(cascade) / float(shadowCascades) + shadowTexel.x;
+    float tileMax = float(cascade + 1) / float(shadowCascades) - shadowTexel.x;
+    if (coord.x < tileMin || coord.x > tileMax || coord.y < 0.0 || coord.y > 1.0 || coord.z > 1.0) return 1.0;
+
+    // 2x2 PCF on top of the hardware comparison
+    float lit = 0.0;
+    lit += shadow2D(shadowMap, coord.xyz + vec3(-0.5 * shadowTexel.x, -0.5 * shadowTexel.y, 0.0)).r;
+    lit += shadow2D(shadowMap, coord.xyz + vec3(0.5 * shadowTexel.x, -0.5 * shadowTexel.y, 0.0)).r;
+    lit += shadow2D(shadowMap, coord.xyz + vec3(-0.5 * shadowTexel.x, 0.5 * shadowTexel.y, 0.0)).r;
+    lit += shadow2D(shadowMap, coord.xyz + vec3(0.5 * shadowTexel.x, 0.5 * shadowTexel.y, 0.0)).r;
+    return lit * 0.25;
+}
+
+void main() {
+    vec3 n = normalize(viewNormal);
+    if (!gl_FrontFacing) n = -n;
+    vec3 v = normalize(-viewPos);
+
+    vec3 base = vertexColor.rgb;
+    if (textured) base *= texture2D(diffuseMap, texCoord).rgb;
+
+    vec3 color = gl_LightModel.ambient.rgb * base;
+    if (directionalEnabled) {
+        color += shadowFactor() * shade(n, v, normalize(gl_LightSource[0].position.xyz), gl_LightSource[0].diffuse.rgb, base);
+    }
+
+    vec2 tile = min(floor(gl_FragCoord.xy / tileSize), gridSize.xy - 1.0);
+    float slice = clamp(floor(log(-viewPos.z) * sliceScale + sliceBias), 0.0, gridSize.z - 1.0);
+    vec2 cluster = texture2D(clusterTex, vec2((tile.y * gridSize.x + tile.x + 0.5) / (gridSize.x * gridSize.y),
+                                              (slice + 0.5) / gridSize.z)).rg;
+
+    for (int k = 0; k < MAX_CLUSTER_LIGHTS; ++k) {
+        if (float(k) >= cluster.y) break;
+        float lightIndex = texture2D(indexTex, texelCoord(cluster.x + float(k), indexTexSize)).r;
+        vec4 positionRadius = texture2D(lightTex, texelCoord(lightIndex * 2.0, lightTexSize));
+        vec3 lightColor = texture2D(lightTex, texelCoord(lightIndex * 2.0 + 1.0, lightTexSize)).rgb;
+
+        vec3 toLight = positionRadius.xyz - viewPos;
+        float dist = length(toLight);
+        float falloff = clamp(1.0 - (dist * dist) / (positionRadius.w * positionRadius.w), 0.0, 1.0);
+        if (falloff <= 0.0) continue;
+        color += falloff * falloff * shade(n, v, toLight / dist, lightColor, base);
+    }
+
+    gl_FragColor = vec4(color, vertexColor.a);
+}
+)";
+
+GLuint lightingProgram = 0;
+GLuint clusterTexture = 0, indexTexture = 0, lightTexture = 0;
+int clusterTexWidth = 0, clusterTexHeight = 0;
+int indexTexHeight = 0, lightTexHeight = 0;
+bool programActive = false;
+
+struct UniformLocations {
+    GLint diffuseMap, clusterTex, indexTex, lightTex;
+    GLint textured, directionalEnabled, gridSize, tileSize;
+    GLint sliceScale, sliceBias, indexTexSize, lightTexSize, shininess;
+    GLint shadowMap, shadowCascades, shadowSplits, shadowMatrices, shadowTexel;
+    GLint skinned, bones;
+} uniforms;
+
+// Per-frame values captured by updateClusteredLights for beginClusteredLighting
+ClusterGridConfig frameGrid;
+float frameTileSize[2] = {1.0f, 1.0f};
+
+std::vector<float> clusterData, indexData, lightData;
+
+GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[2048];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cerr << "Clustered lighting shader failed to compile: " << log << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint createDataTexture() {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return tex;
+}
+
+bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions) {
+        return false;
+    }
+    size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The cluster, index and light data live in one- and two-channel float textures: core in
+// GL 3.0, ARB_texture_rg plus ARB_texture_float before it
+bool hasFloatDataTextures() {
+    int major = 0, minor = 0;
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (version) {
+        std::sscanf(version, "%d.%d", &major, &minor);
+    }
+    if (major >= 3) {
+        return true;
+    }
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    return hasExtension(extensions, "GL_ARB_texture_rg") && hasExtension(extensions, "GL_ARB_texture_float");
+}
+
+// Reallocates only when the texture has to grow
+void uploadTexture(GLuint tex, GLint internalFormat, GLenum format, int width, int height,
+                   int& allocatedHeight, const std::vector<float>& data) {
+    glBindTexture(GL_TEXTURE_2D, tex);
+    if (height > allocatedHeight) {
+        allocatedHeight = height;
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, nullptr);
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_FLOAT, data.data());
+}
+
+} // namespace
+
+ClusterBinner& clusteredLightBinner() {
+    static ClusterBinner binner;
+    return binner;
+}
+
+bool initClusteredLighting() {
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_SHADING_LANGUAGE_VERSION));
+    if (!version) {
+        std::cerr << "GLSL not available, clustered lighting disabled" << std::endl;
+        return false;
+    }
+    if (!hasFloatDataTextures()) {
+        std::cerr << "Float RG textures not available (GL 3.0 or ARB_texture_rg and ARB_texture_float), "
+                     "clustered lighting disabled" << std::endl;
+        return false;
+    }
+
+    GLuint vs = compileShader(GL_VERTEX_SHADER, kVertexShader);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, kFragmentShader);
+    if (!vs || !fs) {
+        return false;
+    }
+
+    lightingProgram = glCreateProgram();
+    glAttachShader(lightingProgram, vs);
+    glAttachShader(lightingProgram, fs);
+    glBindAttribLocation(lightingProgram, kBoneIndexAttribute, "boneIndices");
+    glBindAttribLocation(lightingProgram, kBoneWeightAttribute, "boneWeights");
+    glLinkProgram(lightingProgram);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(lightingProgram, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[2048];
+        glGetProgramInfoLog(lightingProgram, sizeof(log), nullptr, log);
+        std::cerr << "Clustered lighting program failed to link: " << log << std::endl;
+        glDeleteProgram(lightingProgram);
+        lightingProgram = 0;
+        return false;
+    }
+
+    uniforms.diffuseMap = glGetUniformLocation(lightingProgram, "diffuseMap");
+    uniforms.clusterTex = glGetUniformLocation(lightingProgram, "clusterTex");
+    uniforms.indexTex = glGetUniformLocation(lightingProgram, "indexTex");
+    uniforms.lightTex = glGetUniformLocation(lightingProgram, "lightTex");
+    uniforms.textured = glGetUniformLocation(lightingProgram, "textured");
+    uniforms.directionalEnabled = glGetUniformLocation(lightingProgram, "directionalEnabled");
+    uniforms.gridSize = glGetUniformLocation(lightingProgram, "gridSize");
+    uniforms.tileSize = glGetUniformLocation(lightingProgram, "tileSize");
+    uniforms.sliceScale = glGetUniformLocation(lightingProgram, "sliceScale");
+    uniforms.sliceBias = glGetUniformLocation(lightingProgram, "sliceBias");
+    uniforms.indexTexSize = glGetUniformLocation(lightingProgram, "indexTexSize");
+    uniforms.lightTexSize = glGetUniformLocation(lightingProgram, "lightTexSize");
+    uniforms.shininess = glGetUniformLocation(lightingProgram, "shininess");
+    uniforms.shadowMap = glGetUniformLocation(lightingProgram, "shadowMap");
+    uniforms.shadowCascades = glGetUniformLocation(lightingProgram, "shadowCascades");
+    uniforms.shadowSplits = glGetUniformLocation(lightingProgram, "shadowSplits");
+    uniforms.shadowMatrices = glGetUniformLocation(lightingProgram, "shadowMatrices");
+    uniforms.shadowTexel = glGetUniformLocation(lightingProgram, "shadowTexel");
+    uniforms.skinned = glGetUniformLocation(lightingProgram, "skinned");
+    uniforms.bones = glGetUniformLocation(lightingProgram, "bones");
+
+    clusterTexture = createDataTexture();
+    indexTexture = createDataTexture();
+    lightTexture = createDataTexture();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void shutdownClusteredLighting() {
+    if (lightingProgram) {
+        glDeleteProgram(lightingProgram);
+        lightingProgram = 0;
+    }
+    GLuint textures[] = {clusterTexture, indexTexture, lightTexture};
+    glDeleteTextures(3, textures);
+    clusterTexture = indexTexture = lightTexture = 0;
+}
+
+bool clusteredLightingAvailable() {
+    return lightingProgram != 0;
+}
+
+void updateClusteredLights(const std::vector<PointLight>& lights, const float viewMatrix[16],
+                           const ClusterGridConfig& config, int viewportWidth, int viewportHeight) {
+    ClusterBinner& binner = clusteredLightBinner();
+    binner.setGrid(config);
+    binner.bin(lights, viewMatrix);
+
+    frameGrid = config;
+    frameTileSize[0] = static_cast<float>(std::max(viewportWidth, 1)) / config.tilesX;
+    frameTileSize[1] = static_cast<float>(std::max(viewportHeight, 1)) / config.tilesY;
+
+    // Cluster table: one texel per cluster, one row per depth slice
+    const int clusters = binner.clusterCount();
+    clusterData.resize(static_cast<size_t>(clusters) * 2);
+    for (int c = 0; c < clusters; ++c) {
+        clusterData[c * 2] = static_cast<float>(binner.clusterOffsets()[c]);
+        clusterData[c * 2 + 1] = static_cast<float>(binner.clusterCounts()[c]);
+    }
+    int width = config.tilesX * config.tilesY;
+    if (width != clusterTexWidth || config.slicesZ != clusterTexHeight) {
+        clusterTexWidth = width;
+        clusterTexHeight = 0;  // Force reallocation
+    }
+    uploadTexture(clusterTexture, GL_RG32F, GL_RG, width, config.slicesZ, clusterTexHeight, clusterData);
+
+    // Light index list
+    const auto& indices = binner.lightIndices();
+    int indexRows = std::max(1, static_cast<int>((indices.size() + kIndexTextureWidth - 1) / kIndexTextureWidth));
+    indexData.assign(static_cast<size_t>(indexRows) * kIndexTextureWidth, 0.0f);
+    std::copy(indices.begin(), indices.end(), indexData.begin());
+    uploadTexture(indexTexture, GL_R32F, GL_RED, kIndexTextureWidth, indexRows, indexTexHeight, indexData);
+
+    // View space light data
+    const auto& view = binner.viewSpaceLights();
+    int lightRows = std::max(1, static_cast<int>((lights.size() + kLightsPerRow - 1) / kLightsPerRow));
+    lightData.assign(static_cast<size_t>(lightRows) * kLightsPerRow * 8, 0.0f);
+    for (size_t i = 0; i < lights.size(); ++i) {
+        float* texel = &lightData[i * 8];
+        std::copy(&view[i * 4], &view[i * 4] + 4, texel);
+        texel[4] = lights[i].color[0] * lights[i].intensity;
+        texel[5] = lights[i].color[1] * lights[i].intensity;
+        texel[6] = lights[i].color[2] * lights[i].intensity;
+    }
+    uploadTexture(lightTexture, GL_RGBA32F, GL_RGBA, kLightsPerRow * 2, lightRows, lightTexHeight, lightData);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void beginClusteredLighting(float shininess) {
+    if (!lightingProgram) {
+        return;
+    }
+    glUseProgram(lightingProgram);
+    programActive = true;
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, clusterTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, indexTexture);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, lightTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    const float scale = frameGrid.slicesZ / std::log(frameGrid.farPlane / frameGrid.nearPlane);
+    glUniform1i(uniforms.diffuseMap, 0);
+    glUniform1i(uniforms.clusterTex, 1);
+    glUniform1i(uniforms.indexTex, 2);
+    glUniform1i(uniforms.lightTex, 3);
+    glUniform1i(uniforms.textured, 0);
+    glUniform1i(uniforms.skinned, 0);
+    glUniform1i(uniforms.directionalEnabled, glIsEnabled(GL_LIGHT0) ? 1 : 0);
+    glUniform3f(uniforms.gridSize, static_cast<float>(frameGrid.tilesX),
+                static_cast<float>(frameGrid.tilesY), static_cast<float>(frameGrid.slicesZ));
+    glUniform2f(uniforms.tileSize, frameTileSize[0], frameTileSize[1]);
+    glUniform1f(uniforms.sliceScale, scale);
+    glUniform1f(uniforms.sliceBias, -std::log(frameGrid.nearPlane) * scale);
+    glUniform2f(uniforms.indexTexSize, static_cast<float>(kIndexTextureWidth), static_cast<float>(indexTexHeight));
+    glUniform2f(uniforms.lightTexSize, static_cast<float>(kLightsPerRow * 2), static_cast<float>(lightTexHeight));
+    glUniform1f(uniforms.shininess, std::max(shininess, 1.0f));
+
+    const ShadowFrameData* shadows = currentShadowFrame();
+    glUniform1i(uniforms.shadowMap, 4);
+    if (shadows) {
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_2D, shadows->depthTexture);
+        glActiveTexture(GL_TEXTURE0);
+
+        float splits[kMaxShadowCascades] = {};
+        float matrices[kMaxShadowCascades * 16] = {};
+        for (int c = 0; c < shadows->cascadeCount; ++c) {
+            splits[c] = shadows->splitDepths[c];
+            std::copy(shadows->eyeToShadow[c].m, shadows->eyeToShadow[c].m + 16, matrices + c * 16);
+        }
+        glUniform1i(uniforms.shadowCascades, shadows->cascadeCount);
+        glUniform4fv(uniforms.shadowSplits, 1, splits);
+        glUniformMatrix4fv(uniforms.shadowMatrices, kMaxShadowCascades, GL_FALSE, matrices);
+        glUniform2f(uniforms.shadowTexel, shadows->atlasTexelSize[0], shadows->atlasTexelSize[1]);
+    } else {
+        glUniform1i(uniforms.shadowCascades, 0);
+    }
+}
+
+void setClusteredLightingTextured(bool textured) {
+    if (programActive) {
+        glUniform1i(uniforms.textured, textured ? 1 : 0);
+    }
+}
+
+bool setClusteredLightingSkin(const float* palette, int boneCount) {
+    if (!programActive || boneCount > kMaxGpuSkinBones) {
+        return false;
+    }
+    if (boneCount > 0) {
+        glUniformMatrix4fv(uniforms.bones, boneCount, GL_FALSE, palette);
+    }
+    glUniform1i(uniforms.skinned, boneCount > 0 ? 1 : 0);
+    return true;
+}
+
+void setClusteredLightingBoneWeights(const uint16_t indices[4], const float weights[4]) {
+    glVertexAttrib4f(kBoneIndexAttribute, indices[0], indices[1], indices[2], indices[3]);
+    glVertexAttrib4fv(kBoneWeightAttribute, weights);
+}
+
+void endClusteredLighting() {
+    if (!programActive) {
+        return;
+    }
+    glUseProgram(0);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    programActive = false;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+void runClusterBinningBenchmark() {
+    const int lightCounts[] = {16, 256, 4096};
+    const int iterations = 200;
+    const unsigned autoThreads = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+    const unsigned threadCounts[] = {1u, autoThreads};
+
+    ClusterGridConfig config;
+    const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+    std::cout << "lights,threads,avg_us,assigned_indices,overflow" << std::endl;
+    for (int lightCount : lightCounts) {
+        // Deterministic lights scattered through the first 50 units of the frustum
+        std::vector<PointLight> lights(lightCount);
+        uint32_t seed = 12345u;
+        auto random01 = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 8) * (1.0f / 16777216.0f);
+        };
+        for (auto& light : lights) {
+            float depth = 1.0f + random01() * 49.0f;
+            light.position[0] = (random01() * 2.0f - 1.0f) * depth * 0.5f;
+            light.position[1] = (random01() * 2.0f - 1.0f) * depth * 0.4f;
+            light.position[2] = -depth;
+            light.radius = 0.5f + random01() * 2.5f;
+        }
+
+        for (unsigned threads : threadCounts) {
+            ClusterBinner binner(threads);
+            binner.setGrid(config);
+            for (int i = 0; i < 10; ++i) {
+                binner.bin(lights, identity);
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                binner.bin(lights, identity);
+            }
+            auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+            std::cout << lightCount << "," << threads << "," << elapsed.count() / iterations << ","
+                      << binner.lightIndices().size() << "," << binner.overflowCount() << std::endl;
+            if (autoThreads == 1) {
+                break;
+            }
+        }
+    }
+}
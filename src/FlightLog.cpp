@@ -0,0 +1,192 @@
+#include "FlightLog.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FlightLog::~FlightLog() {
+    close();
+}
+
+bool FlightLog::open(const std::string& path) {
+    close();
+    size_t fileSize = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        std::cerr << "Failed to open flight log: " << path << std::endl;
+        return false;
+    }
+    fileSize = static_cast<size_t>(size.QuadPart);
+    HANDLE view = fileSize ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    void* data = view ? MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data) {
+        if (view) CloseHandle(view);
+        CloseHandle(file);
+        std::cerr << "Failed to map flight log: " << path << std::endl;
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = view;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        if (fd >= 0) ::close(fd);
+        std::cerr << "Failed to open flight log: " << path << std::endl;
+        return false;
+    }
+    fileSize = static_cast<size_t>(info.st_size);
+    void* data = fileSize ? mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);  // The mapping keeps the file alive
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map flight log: " << path << std::endl;
+        return false;
+    }
+#endif
+    mapping = data;
+    mappingSize = fileSize;
+
+    FlightLogHeader header;
+    if (fileSize < sizeof(header)) {
+        std::cerr << "Flight log too short: " << path << std::endl;
+        close();
+        return false;
+    }
+    std::memcpy(&header, mapping, sizeof(header));
+    uint64_t available = (fileSize - sizeof(header)) / sizeof(FlightLogRecord);
+    if (std::memcmp(header.magic, kFlightLogMagic, sizeof(header.magic)) != 0 || header.version != kFlightLogVersion ||
+        header.recordSize != sizeof(FlightLogRecord) || header.recordCount > available) {
+        std::cerr << "Not a version " << kFlightLogVersion << " flight log, or truncated: " << path << std::endl;
+        close();
+        return false;
+    }
+    count = static_cast<size_t>(header.recordCount);
+    records = reinterpret_cast<const FlightLogRecord*>(static_cast<const char*>(mapping) + sizeof(header));
+
+    // One record per stride: pages between them are not touched until playback reaches them
+    indexTimes.reserve(count / kIndexStride + 1);
+    for (size_t i = 0; i < count; i += kIndexStride) {
+        indexTimes.push_back(records[i].time);
+    }
+    return true;
+}
+
+void FlightLog::close() {
+    if (mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping);
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        mappingHandle = fileHandle = nullptr;
+#else
+        munmap(mapping, mappingSize);
+#endif
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    records = nullptr;
+    count = 0;
+    indexTimes.clear();
+}
+
+size_t FlightLog::seek(double time, size_t hint) const {
+    if (count == 0 || time <= records[0].time) {
+        return 0;
+    }
+    const FlightLogRecord* begin;
+    const FlightLogRecord* end;
+    if (hint < count && records[hint].time <= time) {
+        // Gallop forward from the hint: the range grows 1, 2, 4 ... records until it passes time
+        size_t step = 1, last = hint;
+        while (last + step < count && records[last + step].time <= time) {
+            last += step;
+            step *= 2;
+        }
+        begin = records + last;
+        end = records + std::min(count, last + step);
+    } else {
+        // Index entry at or before time, then the records up to the next entry
+        size_t block = std::upper_bound(indexTimes.begin(), indexTimes.end(), time) - indexTimes.begin() - 1;
+        begin = records + block * kIndexStride;
+        end = records + std::min(count, (block + 1) * kIndexStride);
+    }
+    const FlightLogRecord* after = std::upper_bound(begin, end, time, [](double t, const FlightLogRecord& record) {
+        return t < record.time;
+    });
+    return static_cast<size_t>(after - records) - 1;
+}
+
+FlightSample FlightLog::sample(double time, size_t& cursor) const {
+    FlightSample out;
+    if (count == 0) {
+        return out;
+    }
+    size_t i = seek(time, cursor);
+    cursor = i;
+    const FlightLogRecord& a = records[i];
+    const FlightLogRecord& b = records[std::min(i + 1, count - 1)];
+    float t = 0.0f;
+    if (b.time > a.time) {
+        t = static_cast<float>(std::clamp((time - a.time) / (b.time - a.time), 0.0, 1.0));
+    }
+    out.time = a.time + (b.time - a.time) * t;
+    Vec3 pa(a.position[0], a.position[1], a.position[2]);
+    Vec3 pb(b.position[0], b.position[1], b.position[2]);
+    out.position = pa + (pb - pa) * t;
+    out.attitude = slerp(normalize(Quat(a.attitude[0], a.attitude[1], a.attitude[2], a.attitude[3])),
+                         normalize(Quat(b.attitude[0], b.attitude[1], b.attitude[2], b.attitude[3])), t);
+    for (int r = 0; r < kFlightLogRotors; ++r) {
+        out.rotorRpm[r] = a.rotorRpm[r] + (b.rotorRpm[r] - a.rotorRpm[r]) * t;
+    }
+    return out;
+}
+
+bool FlightLogWriter::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to create flight log: " << path << std::endl;
+        return false;
+    }
+    written = 0;
+    failed = false;
+    FlightLogHeader header = {};
+    std::memcpy(header.magic, kFlightLogMagic, sizeof(header.magic));
+    header.version = kFlightLogVersion;
+    header.recordSize = sizeof(FlightLogRecord);
+    failed = std::fwrite(&header, sizeof(header), 1, file) != 1;
+    return !failed;
+}
+
+bool FlightLogWriter::append(const FlightLogRecord& record) {
+    if (!file || failed) {
+        return false;
+    }
+    failed = std::fwrite(&record, sizeof(record), 1, file) != 1;
+    written += failed ? 0 : 1;
+    return !failed;
+}
+
+bool FlightLogWriter::close() {
+    if (!file) {
+        return true;
+    }
+    // Patch the record count now that it is known
+    bool ok = !failed && std::fseek(file, offsetof(FlightLogHeader, recordCount), SEEK_SET) == 0 &&
+              std::fwrite(&written, sizeof(written), 1, file) == 1;
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
@@ -0,0 +1,74 @@
+#include "FlightModelThread.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+const int kMaxCatchUpSteps = 50;
+
+// The loop starts at the take-off point and circles round a centre one radius to its +x side
+Vec3 planTarget(const FlightPlan& plan, double time) {
+    double angle = plan.period > 0.0f ? 2.0 * M_PI * time / plan.period : 0.0;
+    return Vec3(plan.radius * (1.0f - static_cast<float>(std::cos(angle))), plan.height,
+                plan.radius * static_cast<float>(std::sin(angle)));
+}
+
+} // namespace
+
+FlightModelThread::FlightModelThread(const QuadrotorParameters& parameters, const FlightPlan& plan, double rateHz)
+    : model(parameters), rate(rateHz) {
+    plans.back() = plan;
+    plans.publish();
+    thread = std::thread(&FlightModelThread::run, this);
+}
+
+FlightModelThread::~FlightModelThread() {
+    stopping.store(true, std::memory_order_release);
+    thread.join();
+}
+
+void FlightModelThread::setPlan(const FlightPlan& plan) {
+    plans.back() = plan;
+    plans.publish();
+}
+
+void FlightModelThread::run() {
+    traceSetThreadName("flight model");
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    const float dt = static_cast<float>(1.0 / rate);
+
+    QuadrotorState state;
+    float rotorSpeeds[kQuadrotorRotors] = {};
+    uint64_t steps = 0;
+    auto next = Clock::now();
+    while (!stopping.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_until(next);
+        plans.update();
+        const FlightPlan& plan = plans.front();
+
+        int due = 0;
+        auto now = Clock::now();
+        while (next <= now && due < kMaxCatchUpSteps) {
+            next += period;
+            ++due;
+        }
+        if (next <= now) {
+            next = now + period;  // Too far behind: simulated time slips rather than spiralling
+        }
+        for (int i = 0; i < due; ++i) {
+            controlQuadrotor(model, state, planTarget(plan, steps * static_cast<double>(dt)), rotorSpeeds);
+            stepQuadrotor(model, state, rotorSpeeds, dt);
+            ++steps;
+        }
+
+        FlightModelSnapshot& snapshot = snapshots.back();
+        snapshot.steps = steps;
+        snapshot.time = steps * static_cast<double>(dt);
+        snapshot.state = state;
+        std::copy(rotorSpeeds, rotorSpeeds + kQuadrotorRotors, snapshot.rotorSpeeds);
+        snapshots.publish();
+    }
+}
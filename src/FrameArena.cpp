@@ -0,0 +1,109 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <new>
+
+namespace {
+
+// Process-wide slot per thread; the same index is used in every arena
+std::atomic<unsigned> nextThreadSlot{0};
+thread_local unsigned threadSlot = nextThreadSlot.fetch_add(1, std::memory_order_relaxed);
+
+} // namespace
+
+FrameArena::~FrameArena() {
+    for (const Block& block : freeBlocks) {
+        ::operator delete(block.data);
+    }
+    for (const Block& block : takenBlocks) {
+        ::operator delete(block.data);
+    }
+}
+
+FrameArena::Block FrameArena::newBlock(size_t size) {
+    blockAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return {static_cast<char*>(::operator new(size)), size};
+}
+
+FrameArena::Block FrameArena::takeBlock(size_t minSize) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    largestRequest = std::max(largestRequest, minSize);
+    Block block;
+    if (minSize <= blockSize && !freeBlocks.empty()) {
+        block = freeBlocks.back();
+        freeBlocks.pop_back();
+    } else {
+        block = newBlock(std::max(blockSize, minSize));
+        ranShort = true;
+    }
+    takenBlocks.push_back(block);
+    return block;
+}
+
+void* FrameArena::allocateFrom(SubArena& arena, size_t bytes, size_t alignment) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(arena.block.data) + arena.offset;
+    size_t padding = (alignment - start % alignment) % alignment;
+    if (!arena.block.data || arena.offset + padding + bytes > arena.block.size) {
+        // Whatever is left of the old block is wasted until reset
+        arena.block = takeBlock(bytes + alignment);
+        arena.offset = 0;
+        padding = (alignment - reinterpret_cast<uintptr_t>(arena.block.data) % alignment) % alignment;
+    }
+    char* p = arena.block.data + arena.offset + padding;
+    arena.offset += padding + bytes;
+    arena.used += padding + bytes;
+    return p;
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+    if (threadSlot < kMaxThreads) {
+        return allocateFrom(subArenas[threadSlot], bytes, alignment);
+    }
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    return allocateFrom(overflow, bytes, alignment);
+}
+
+void FrameArena::reset() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    while (blockSize < largestRequest) {
+        blockSize *= 2;
+    }
+
+    size_t taken = takenBlocks.size();
+    freeBlocks.insert(freeBlocks.end(), takenBlocks.begin(), takenBlocks.end());
+    takenBlocks.clear();
+    // Blocks too small for the largest request are useless from now on
+    freeBlocks.erase(std::remove_if(freeBlocks.begin(), freeBlocks.end(),
+                                    [this](const Block& block) {
+                                        if (block.size < blockSize) {
+                                            ::operator delete(block.data);
+                                            return true;
+                                        }
+                                        return false;
+                                    }),
+                     freeBlocks.end());
+    if (ranShort) {
+        // Room for twice the frame, plus a partly filled block for every thread
+        unsigned threads = std::min(nextThreadSlot.load(std::memory_order_relaxed), kMaxThreads) + 1;
+        while (freeBlocks.size() < taken * 2 + threads) {
+            freeBlocks.push_back(newBlock(blockSize));
+        }
+        // Taking every block next frame must not grow the list
+        takenBlocks.reserve(freeBlocks.size());
+        ranShort = false;
+    }
+
+    for (SubArena& arena : subArenas) {
+        arena.block = Block();
+        arena.offset = arena.used = 0;
+    }
+    overflow.block = Block();
+    overflow.offset = overflow.used = 0;
+}
+
+size_t FrameArena::bytesUsed() const {
+    size_t total = overflow.used;
+    for (const SubArena& arena : subArenas) {
+        total += arena.used;
+    }
+    return total;
+}
@@ -0,0 +1,182 @@
+#include "FrameScheduler.h"
+#include "SimulationClock.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <GL/glx.h>
+#endif
+
+namespace {
+
+bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions) {
+        return false;
+    }
+    size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+FrameScheduler::FrameScheduler(double targetFps, double refreshHz)
+    : targetFps(targetFps), refreshHz(refreshHz) {
+    durations.reserve(sampleCapacity);
+    intervals.reserve(sampleCapacity);
+}
+
+void FrameScheduler::setTargetFps(double fps) {
+    targetFps = std::max(fps, 0.0);
+}
+
+void FrameScheduler::setRefreshRate(double hz) {
+    refreshHz = hz > 1.0 ? hz : 60.0;
+}
+
+void FrameScheduler::setVsync(bool enabled) {
+    vsyncEnabled = enabled;
+}
+
+double FrameScheduler::frameInterval() const {
+    double interval = targetFps > 0.0 ? 1.0 / targetFps : 0.0;
+    if (vsyncEnabled) {
+        // Swaps complete on vblank: ask for a whole number of refresh intervals
+        double refresh = 1.0 / refreshHz;
+        double vblanks = std::max(1.0, std::ceil(interval / refresh - 0.05));
+        interval = vblanks * refresh;
+    }
+    return interval;
+}
+
+int FrameScheduler::requestFrame() {
+    return requestFrame(SimulationClock::now());
+}
+
+int FrameScheduler::requestFrame(double now) {
+    if (framePending) {
+        ++coalesced;
+        return kAlreadyPending;
+    }
+    framePending = true;
+
+    double delay = nextFrameTime - now;
+    if (vsyncEnabled) {
+        // Wake a little early; the swap itself waits for the vblank
+        delay -= 0.002;
+    }
+    return delay > 0.0 ? static_cast<int>(delay * 1000.0 + 0.5) : 0;
+}
+
+void FrameScheduler::frameStarted() {
+    frameStarted(SimulationClock::now());
+}
+
+void FrameScheduler::frameStarted(double now) {
+    framePending = false;
+    previousFrameStart = currentFrameStart;
+    currentFrameStart = now;
+    nextFrameTime = now + frameInterval();
+}
+
+void FrameScheduler::frameFinished() {
+    frameFinished(SimulationClock::now());
+}
+
+void FrameScheduler::frameFinished(double now) {
+    if (currentFrameStart < 0.0) {
+        return;
+    }
+    double duration = (now - currentFrameStart) * 1000.0;
+    double interval = previousFrameStart >= 0.0 ? (currentFrameStart - previousFrameStart) * 1000.0 : duration;
+
+    if (durations.size() < sampleCapacity) {
+        durations.push_back(duration);
+        intervals.push_back(interval);
+    } else {
+        durations[sampleCursor] = duration;
+        intervals[sampleCursor] = interval;
+    }
+    sampleCursor = (sampleCursor + 1) % sampleCapacity;
+    ++frameCount;
+}
+
+double FrameScheduler::percentile(std::vector<double>& values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * values.size())) - 1;
+    rank = std::min(rank, values.size() - 1);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+FrameTimeStats FrameScheduler::stats() const {
+    FrameTimeStats result;
+    result.frames = frameCount;
+    result.coalescedRequests = coalesced;
+
+    std::vector<double> sorted = durations;
+    result.p50 = percentile(sorted, 0.50);
+    result.p95 = percentile(sorted, 0.95);
+    result.p99 = percentile(sorted, 0.99);
+
+    std::vector<double> sortedIntervals = intervals;
+    result.intervalP99 = percentile(sortedIntervals, 0.99);
+
+    double total = 0.0;
+    for (double interval : intervals) {
+        total += interval;
+    }
+    result.averageFps = total > 0.0 ? 1000.0 * intervals.size() / total : 0.0;
+    return result;
+}
+
+bool setSwapInterval(int interval) {
+#ifdef _WIN32
+    typedef BOOL (WINAPI *SwapIntervalProc)(int);
+    auto swapInterval = reinterpret_cast<SwapIntervalProc>(wglGetProcAddress("wglSwapIntervalEXT"));
+    return swapInterval && swapInterval(interval);
+#else
+    typedef int (*SwapIntervalMesa)(unsigned int);
+    typedef int (*SwapIntervalSgi)(int);
+    typedef void (*SwapIntervalExt)(Display*, GLXDrawable, int);
+
+    Display* display = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    if (!display || !drawable) {
+        return false;
+    }
+    // With GLVND glXGetProcAddress returns a dispatch stub for any glX name, so only the
+    // extension string tells whether the driver implements one; calling it otherwise may
+    // raise an X error
+    const char* extensions = glXQueryExtensionsString(display, DefaultScreen(display));
+    if (hasExtension(extensions, "GLX_EXT_swap_control")) {
+        if (auto ext = reinterpret_cast<SwapIntervalExt>(
+                glXGetProcAddress(reinterpret_cast<const GLubyte*>("glXSwapIntervalEXT")))) {
+            ext(display, drawable, interval);
+            return true;
+        }
+    }
+    if (hasExtension(extensions, "GLX_MESA_swap_control")) {
+        if (auto mesa = reinterpret_cast<SwapIntervalMesa>(
+                glXGetProcAddress(reinterpret_cast<const GLubyte*>("glXSwapIntervalMESA")))) {
+            return mesa(static_cast<unsigned int>(interval)) == 0;
+        }
+    }
+    if (hasExtension(extensions, "GLX_SGI_swap_control")) {
+        if (auto sgi = reinterpret_cast<SwapIntervalSgi>(
+                glXGetProcAddress(reinterpret_cast<const GLubyte*>("glXSwapIntervalSGI")))) {
+            return sgi(interval) == 0;
+        }
+    }
+    return false;
+#endif
+}
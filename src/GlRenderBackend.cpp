@@ -0,0 +1,106 @@
+#include "RenderBackend.h"
+#include <GL/gl.h>
+#include <cstring>
+
+void GlRenderBackend::beginFrame(const RenderFrame& frame) {
+    width = frame.width;
+    height = frame.height;
+
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadMatrixf(frame.projection.m);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glViewport(0, 0, width, height);
+    glClearColor(frame.clearColor[0], frame.clearColor[1], frame.clearColor[2], 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glShadeModel(GL_SMOOTH);
+
+    glEnable(GL_LIGHTING);
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+    glLightModeli(GL_LIGHT_MODEL_LOCAL_VIEWER, GL_FALSE);
+    glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_FALSE);
+    const float globalAmbient[4] = {frame.globalAmbient[0], frame.globalAmbient[1], frame.globalAmbient[2], 1.0f};
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, globalAmbient);
+
+    const float specular[4] = {frame.specular[0], frame.specular[1], frame.specular[2], 1.0f};
+    const float noEmission[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
+    glMaterialfv(GL_FRONT_AND_BACK, GL_EMISSION, noEmission);
+    glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, frame.shininess);
+
+    // Positions are given in eye space, so they are set with an identity modelview
+    for (int i = 0; i < kMaxRenderLights; ++i) {
+        GLenum light = GL_LIGHT0 + i;
+        if (i >= frame.lightCount) {
+            glDisable(light);
+            continue;
+        }
+        const RenderLight& source = frame.lights[i];
+        const float ambient[4] = {source.ambient[0], source.ambient[1], source.ambient[2], 1.0f};
+        const float diffuse[4] = {source.diffuse[0], source.diffuse[1], source.diffuse[2], 1.0f};
+        const float lightSpecular[4] = {source.specular[0], source.specular[1], source.specular[2], 1.0f};
+        glEnable(light);
+        glLightfv(light, GL_POSITION, source.position);
+        glLightfv(light, GL_AMBIENT, ambient);
+        glLightfv(light, GL_DIFFUSE, diffuse);
+        glLightfv(light, GL_SPECULAR, lightSpecular);
+        glLightf(light, GL_CONSTANT_ATTENUATION, 1.0f);
+        glLightf(light, GL_LINEAR_ATTENUATION, 0.0f);
+        glLightf(light, GL_QUADRATIC_ATTENUATION, 0.0f);
+    }
+    glEnable(GL_NORMALIZE);
+}
+
+void GlRenderBackend::submit(const RenderMesh& item) {
+    const aiMesh* mesh = item.mesh;
+    const aiVector3D* positions = item.positions ? item.positions : mesh->mVertices;
+    const aiVector3D* normals = item.normals ? item.normals : mesh->mNormals;
+    glLoadMatrixf(item.modelView.m);
+    glColor3fv(item.color);
+    glBegin(GL_TRIANGLES);
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        const aiFace& face = mesh->mFaces[f];
+        if (face.mNumIndices != 3) {
+            continue;
+        }
+        for (unsigned int k = 0; k < 3; ++k) {
+            unsigned int index = face.mIndices[k];
+            if (normals) {
+                glNormal3fv(&normals[index].x);
+            }
+            glVertex3fv(&positions[index].x);
+        }
+    }
+    glEnd();
+}
+
+void GlRenderBackend::endFrame() {
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+}
+
+void GlRenderBackend::readPixels(std::vector<uint8_t>& rgb) {
+    size_t rowBytes = static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> bottomUp(rowBytes * height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, bottomUp.data());
+    rgb.resize(bottomUp.size());
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(rgb.data() + y * rowBytes, bottomUp.data() + (height - 1 - y) * rowBytes, rowBytes);
+    }
+}
@@ -0,0 +1,170 @@
+#define GL_GLEXT_PROTOTYPES
+#include "GpuTimer.h"
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int kPassCount = static_cast<int>(GpuPass::Count);
+const int kGpuTimerLatency = 4;    // Frames between issuing a query and reading it
+const float kSmoothing = 0.1f;
+const GLuint64 kMaxPlausibleNs = 1000000000ull;
+
+struct TimedInterval {
+    GpuPass pass;
+    GLuint query;
+};
+
+// Queries issued during one frame; reused kGpuTimerLatency frames later
+struct FrameQueries {
+    std::vector<GLuint> pool;
+    std::vector<TimedInterval> intervals;
+    bool pending = false;
+};
+
+bool timersAvailable = false;
+FrameQueries frames[kGpuTimerLatency];
+int currentSlot = 0;
+std::vector<GpuPass> passStack;
+float smoothedMs[kPassCount] = {-1.0f, -1.0f, -1.0f, -1.0f};
+
+GLuint nextQuery() {
+    FrameQueries& frame = frames[currentSlot];
+    size_t used = frame.intervals.size();
+    if (used == frame.pool.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.pool.push_back(query);
+    }
+    return frame.pool[used];
+}
+
+void startInterval(GpuPass pass) {
+    GLuint query = nextQuery();
+    frames[currentSlot].intervals.push_back({pass, query});
+    glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+// Non-blocking: results that are not ready yet are dropped rather than waited for
+void collect(FrameQueries& frame) {
+    if (!frame.pending || frame.intervals.empty()) {
+        frame.pending = false;
+        return;
+    }
+    GLint available = 0;
+    glGetQueryObjectiv(frame.intervals.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+        double totals[kPassCount] = {};
+        bool seen[kPassCount] = {};
+        for (const TimedInterval& interval : frame.intervals) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(interval.query, GL_QUERY_RESULT, &elapsed);
+            if (elapsed > kMaxPlausibleNs) {
+                continue;  // Some drivers report garbage for the first query of a context
+            }
+            int index = static_cast<int>(interval.pass);
+            totals[index] += elapsed * 1.0e-6;
+            seen[index] = true;
+        }
+        for (int i = 0; i < kPassCount; ++i) {
+            if (!seen[i]) continue;
+            float ms = static_cast<float>(totals[i]);
+            smoothedMs[i] = smoothedMs[i] < 0.0f ? ms : smoothedMs[i] + (ms - smoothedMs[i]) * kSmoothing;
+        }
+    }
+    frame.pending = false;
+}
+
+} // namespace
+
+const char* gpuPassName(GpuPass pass) {
+    switch (pass) {
+        case GpuPass::Shadows: return "Shadows";
+        case GpuPass::Scene: return "Scene";
+        case GpuPass::CollisionHighlight: return "Collision";
+        case GpuPass::UserInterface: return "UI";
+        default: return "?";
+    }
+}
+
+bool initGpuTimers() {
+    int major = 0, minor = 0;
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (version) {
+        std::sscanf(version, "%d.%d", &major, &minor);
+    }
+    bool hasTimerQuery = major > 3 || (major == 3 && minor >= 3);
+    if (!hasTimerQuery) {
+        const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        hasTimerQuery = extensions && std::strstr(extensions, "GL_ARB_timer_query");
+    }
+    if (hasTimerQuery) {
+        GLint bits = 0;
+        glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &bits);
+        hasTimerQuery = bits > 0;
+    }
+    timersAvailable = hasTimerQuery;
+    return timersAvailable;
+}
+
+void shutdownGpuTimers() {
+    for (FrameQueries& frame : frames) {
+        if (!frame.pool.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(frame.pool.size()), frame.pool.data());
+        }
+        frame.pool.clear();
+        frame.intervals.clear();
+        frame.pending = false;
+    }
+    timersAvailable = false;
+}
+
+bool gpuTimersAvailable() {
+    return timersAvailable;
+}
+
+void gpuTimerBeginFrame() {
+    if (!timersAvailable) {
+        return;
+    }
+    if (!passStack.empty()) {
+        // A pass was left open last frame; close it so the next query can begin
+        glEndQuery(GL_TIME_ELAPSED);
+        passStack.clear();
+    }
+    frames[currentSlot].pending = true;
+    currentSlot = (currentSlot + 1) % kGpuTimerLatency;
+
+    // This slot was issued kGpuTimerLatency frames ago
+    collect(frames[currentSlot]);
+    frames[currentSlot].intervals.clear();
+}
+
+void gpuTimerBegin(GpuPass pass) {
+    if (!timersAvailable) {
+        return;
+    }
+    if (!passStack.empty()) {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+    passStack.push_back(pass);
+    startInterval(pass);
+}
+
+void gpuTimerEnd(GpuPass pass) {
+    if (!timersAvailable || passStack.empty() || passStack.back() != pass) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    passStack.pop_back();
+    if (!passStack.empty()) {
+        startInterval(passStack.back());  // Resume the outer pass
+    }
+}
+
+float gpuPassTime(GpuPass pass) {
+    return smoothedMs[static_cast<int>(pass)];
+}
@@ -0,0 +1,144 @@
+#include "HeadlessContext.h"
+#include <GL/gl.h>
+#include <cstring>
+#include <iostream>
+
+#ifdef DRONE_HAS_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace {
+
+bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions) {
+        return false;
+    }
+    size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Surfaceless needs no display server; fall back to whatever the default platform is
+EGLDisplay openDisplay() {
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) {
+                return display;
+            }
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+} // namespace
+
+HeadlessContext::~HeadlessContext() {
+    destroy();
+}
+
+bool HeadlessContext::create(int width, int height) {
+    destroy();
+
+    EGLDisplay eglDisplay = openDisplay();
+    EGLint major = 0, minor = 0;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        std::cerr << "Headless: no EGL display available" << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE};
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "Headless: no pbuffer config with desktop OpenGL support" << std::endl;
+        destroy();
+        return false;
+    }
+
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+    surface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttributes);
+    if (surface == EGL_NO_SURFACE) {
+        std::cerr << "Headless: failed to create a " << width << "x" << height << " pbuffer" << std::endl;
+        surface = nullptr;
+        destroy();
+        return false;
+    }
+
+    // The viewer uses immediate mode and fixed-function state, so ask for a compatibility context
+    eglBindAPI(EGL_OPENGL_API);
+    context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, nullptr);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, surface, surface, context)) {
+        std::cerr << "Headless: failed to create an OpenGL context" << std::endl;
+        if (context == EGL_NO_CONTEXT) {
+            context = nullptr;
+        }
+        destroy();
+        return false;
+    }
+
+    surfaceWidth = width;
+    surfaceHeight = height;
+    std::cout << "Headless: EGL " << major << "." << minor << ", " << glGetString(GL_RENDERER) << std::endl;
+    return true;
+}
+
+void HeadlessContext::destroy() {
+    if (!display) {
+        return;
+    }
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context) {
+        eglDestroyContext(display, context);
+    }
+    if (surface) {
+        eglDestroySurface(display, surface);
+    }
+    eglTerminate(display);
+    display = surface = context = nullptr;
+    surfaceWidth = surfaceHeight = 0;
+}
+
+#else
+
+HeadlessContext::~HeadlessContext() {}
+
+bool HeadlessContext::create(int, int) {
+    std::cerr << "Headless: this build has no EGL support" << std::endl;
+    return false;
+}
+
+void HeadlessContext::destroy() {}
+
+#endif // DRONE_HAS_EGL
+
+void HeadlessContext::readPixels(std::vector<uint8_t>& rgb) const {
+    size_t rowBytes = static_cast<size_t>(surfaceWidth) * 3;
+    rgb.resize(rowBytes * surfaceHeight);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, surfaceWidth, surfaceHeight, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+
+    // OpenGL rows start at the bottom
+    std::vector<uint8_t> row(rowBytes);
+    for (int top = 0, bottom = surfaceHeight - 1; top < bottom; ++top, --bottom) {
+        uint8_t* a = rgb.data() + top * rowBytes;
+        uint8_t* b = rgb.data() + bottom * rowBytes;
+        std::memcpy(row.data(), a, rowBytes);
+        std::memcpy(a, b, rowBytes);
+        std::memcpy(b, row.data(), rowBytes);
+    }
+}
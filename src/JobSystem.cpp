@@ -0,0 +1,227 @@
+#include "JobSystem.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <functional>
+#include <string>
+
+struct JobSystem::Task {
+    BodyFunction function;
+    const void* body;
+    size_t grain;
+    std::atomic<size_t> remaining;  // Items not yet processed; the caller returns at zero
+};
+
+// Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+// A slot is only reused once top has moved past it, so a thief that read a stale slot always
+// loses the compare-exchange on top and drops what it read.
+class JobSystem::Deque {
+public:
+    bool push(const Range& range) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= kCapacity) {
+            return false;
+        }
+        Slot& slot = slots[b & (kCapacity - 1)];
+        slot.task.store(range.task, std::memory_order_relaxed);
+        slot.begin.store(range.begin, std::memory_order_relaxed);
+        slot.end.store(range.end, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only
+    bool pop(Range& out) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        read(b, out);
+        if (t == b) {
+            // Last item: race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool steal(Range& out) {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b) {
+            return false;
+        }
+        read(t, out);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+private:
+    static const int64_t kCapacity = 1024;  // Power of two; splitting depth per loop is log2(count / grain)
+
+    struct Slot {
+        std::atomic<Task*> task{nullptr};
+        std::atomic<size_t> begin{0};
+        std::atomic<size_t> end{0};
+    };
+
+    void read(int64_t index, Range& out) const {
+        const Slot& slot = slots[index & (kCapacity - 1)];
+        out.task = slot.task.load(std::memory_order_relaxed);
+        out.begin = slot.begin.load(std::memory_order_relaxed);
+        out.end = slot.end.load(std::memory_order_relaxed);
+    }
+
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    Slot slots[kCapacity];
+};
+
+namespace {
+
+// Queue of the current thread, if it belongs to (or currently calls into) a job system
+thread_local const JobSystem* currentSystem = nullptr;
+thread_local unsigned currentQueue = 0;
+
+uint32_t nextRandom() {
+    thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+} // namespace
+
+JobSystem::JobSystem(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    unsigned workerCount = threadCount - 1;
+    for (unsigned i = 0; i < workerCount + kMaxExternalThreads; ++i) {
+        queues.push_back(std::make_unique<Deque>());
+    }
+    externalInUse = std::make_unique<std::atomic<bool>[]>(kMaxExternalThreads);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    stopping.store(true, std::memory_order_release);
+    wakeCounter.fetch_add(1, std::memory_order_release);
+    wakeCounter.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+bool JobSystem::findWork(unsigned queueIndex, Range& out) {
+    if (queues[queueIndex]->pop(out)) {
+        return true;
+    }
+    unsigned count = static_cast<unsigned>(queues.size());
+    unsigned start = nextRandom() % count;
+    for (unsigned i = 0; i < count; ++i) {
+        unsigned victim = (start + i) % count;
+        if (victim != queueIndex && queues[victim]->steal(out)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(unsigned queueIndex, Range range) {
+    Task* task = range.task;
+    // Keep the first half, offer the second to thieves, until the piece fits in one chunk
+    while (range.end - range.begin > task->grain) {
+        size_t middle = range.begin + (range.end - range.begin) / 2;
+        if (!queues[queueIndex]->push({task, middle, range.end})) {
+            break;
+        }
+        range.end = middle;
+    }
+    task->function(task->body, range.begin, range.end);
+    // The task may be gone as soon as remaining reaches zero
+    task->remaining.fetch_sub(range.end - range.begin, std::memory_order_acq_rel);
+}
+
+void JobSystem::run(size_t count, size_t grain, BodyFunction function, const void* body) {
+    grain = std::max<size_t>(grain, 1);
+    if (count == 0) {
+        return;
+    }
+    if (count <= grain || workers.empty()) {
+        function(body, 0, count);
+        return;
+    }
+
+    // Nested calls reuse the thread's queue; outer calls from other threads borrow an external one
+    bool borrowed = false;
+    unsigned queueIndex = currentQueue;
+    if (currentSystem != this) {
+        unsigned slot = 0;
+        bool expected = false;
+        while (slot < kMaxExternalThreads && !externalInUse[slot].compare_exchange_strong(expected, true)) {
+            expected = false;
+            ++slot;
+        }
+        if (slot == kMaxExternalThreads) {
+            function(body, 0, count);
+            return;
+        }
+        borrowed = true;
+        queueIndex = static_cast<unsigned>(workers.size()) + slot;
+        currentSystem = this;
+        currentQueue = queueIndex;
+    }
+
+    Task task;
+    task.function = function;
+    task.body = body;
+    task.grain = grain;
+    task.remaining.store(count, std::memory_order_relaxed);
+
+    activeTasks.fetch_add(1, std::memory_order_acq_rel);
+    wakeCounter.fetch_add(1, std::memory_order_release);
+    wakeCounter.notify_all();
+
+    execute(queueIndex, {&task, 0, count});
+    Range range;
+    while (task.remaining.load(std::memory_order_acquire) != 0) {
+        if (findWork(queueIndex, range)) {
+            execute(queueIndex, range);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    activeTasks.fetch_sub(1, std::memory_order_acq_rel);
+
+    if (borrowed) {
+        currentSystem = nullptr;
+        externalInUse[queueIndex - workers.size()].store(false, std::memory_order_release);
+    }
+}
+
+void JobSystem::workerLoop(unsigned workerIndex) {
+    traceSetThreadName("job worker " + std::to_string(workerIndex));
+    currentSystem = this;
+    currentQueue = workerIndex;
+    Range range;
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (findWork(workerIndex, range)) {
+            execute(workerIndex, range);
+            continue;
+        }
+        // Keep looking while a loop is running; sleep once all of them have finished
+        uint32_t seen = wakeCounter.load(std::memory_order_acquire);
+        if (activeTasks.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        wakeCounter.wait(seen, std::memory_order_acquire);
+    }
+}
@@ -0,0 +1,431 @@
+#include "OccupancyMap.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+const int kMaxDepth = 21;           // Three coordinates of 21 bits fill a 64-bit Morton code
+const size_t kVoxelizeGrain = 512;  // Triangles per job
+
+// Spreads the low 21 bits of v three apart
+uint64_t spreadBits(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+uint32_t compactBits(uint64_t v) {
+    v &= 0x1249249249249249ull;
+    v = (v | v >> 2) & 0x10c30c30c30c30c3ull;
+    v = (v | v >> 4) & 0x100f00f00f00f00full;
+    v = (v | v >> 8) & 0x1f0000ff0000ffull;
+    v = (v | v >> 16) & 0x1f00000000ffffull;
+    v = (v | v >> 32) & 0x1fffff;
+    return static_cast<uint32_t>(v);
+}
+
+// x in bit 0 of each octant, y in bit 1, z in bit 2
+uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z) {
+    return spreadBits(x) | spreadBits(y) << 1 | spreadBits(z) << 2;
+}
+
+// Akenine-Moller: a triangle and a box overlap unless one of 13 axes separates them: the box
+// normals, the triangle normal and the cross products of their edges. The box normals are
+// left to the caller, which only tests voxels inside the triangle's bounds. The triangle's
+// extent along the other ten axes is computed once, so testing a voxel of a given half size
+// is a dot product per axis. Touching counts as overlapping.
+struct TriangleAxes {
+    Vec3 axes[10];
+    float lo[10], hi[10], radius[10];
+
+    TriangleAxes(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& half) {
+        const Vec3 edges[3] = {b - a, c - b, a - c};
+        int n = 0;
+        for (const Vec3& edge : edges) {
+            axes[n++] = Vec3(0.0f, -edge.z, edge.y);  // x cross edge
+            axes[n++] = Vec3(edge.z, 0.0f, -edge.x);  // y cross edge
+            axes[n++] = Vec3(-edge.y, edge.x, 0.0f);  // z cross edge
+        }
+        axes[n++] = cross(edges[0], edges[1]);
+        for (int k = 0; k < n; ++k) {
+            float p0 = dot(axes[k], a), p1 = dot(axes[k], b), p2 = dot(axes[k], c);
+            lo[k] = std::min({p0, p1, p2});
+            hi[k] = std::max({p0, p1, p2});
+            radius[k] = half.x * std::fabs(axes[k].x) + half.y * std::fabs(axes[k].y) + half.z * std::fabs(axes[k].z);
+        }
+    }
+
+    bool overlapsBox(const Vec3& center) const {
+        for (int k = 0; k < 10; ++k) {
+            float offset = dot(axes[k], center);
+            if (lo[k] - offset > radius[k] || hi[k] - offset < -radius[k]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+void OccupancyMap::clear() {
+    voxels = 0;
+    levels = 0;
+    childMasks.clear();
+    firstChild.clear();
+}
+
+bool OccupancyMap::build(std::span<const Vec3> triangles, float voxelSize, JobSystem* jobs) {
+    clear();
+    voxel = voxelSize;
+    size_t triangleCount = triangles.size() / 3;
+    if (triangleCount == 0 || !(voxelSize > 0.0f)) {
+        std::cerr << "Occupancy map: nothing to voxelize" << std::endl;
+        return false;
+    }
+    Aabb extent;
+    for (const Vec3& vertex : triangles.first(triangleCount * 3)) {
+        extent.expand(vertex);
+    }
+    Vec3 size = extent.max - extent.min;
+    double cells = std::ceil(std::max({size.x, size.y, size.z}) / voxelSize) + 2.0;
+    int treeLevels = 1;
+    while (treeLevels <= kMaxDepth && static_cast<double>(uint32_t(1) << treeLevels) < cells) {
+        ++treeLevels;
+    }
+    if (treeLevels > kMaxDepth) {
+        std::cerr << "Occupancy map: " << cells << " voxels a side is more than 2^" << kMaxDepth << std::endl;
+        return false;
+    }
+    // Half a voxel of margin, so geometry on the bounds is not on the edge of the cube
+    origin = extent.min - Vec3(voxelSize, voxelSize, voxelSize) * 0.5f;
+    const uint32_t last = (uint32_t(1) << treeLevels) - 1;
+    const float inverseVoxel = 1.0f / voxelSize;
+    // A hair larger than a voxel, so triangles lying on a voxel face touch both sides
+    const Vec3 half = Vec3(voxelSize, voxelSize, voxelSize) * 0.50001f;
+
+    // Morton codes of the voxels each block of triangles touches, sorted and unique per block
+    auto voxelize = [&](size_t begin, size_t end, std::vector<uint64_t>& codes) {
+        auto cellOf = [&](float v, float lower) {
+            return static_cast<uint32_t>(std::clamp((v - lower) * inverseVoxel, 0.0f, static_cast<float>(last)));
+        };
+        for (size_t t = begin; t < end; ++t) {
+            const Vec3& a = triangles[t * 3];
+            const Vec3& b = triangles[t * 3 + 1];
+            const Vec3& c = triangles[t * 3 + 2];
+            uint32_t lo[3], hi[3];
+            for (int axis = 0; axis < 3; ++axis) {
+                lo[axis] = cellOf(std::min({a[axis], b[axis], c[axis]}), origin[axis]);
+                hi[axis] = cellOf(std::max({a[axis], b[axis], c[axis]}), origin[axis]);
+            }
+            TriangleAxes triangle(a, b, c, half);
+            for (uint32_t z = lo[2]; z <= hi[2]; ++z) {
+                for (uint32_t y = lo[1]; y <= hi[1]; ++y) {
+                    for (uint32_t x = lo[0]; x <= hi[0]; ++x) {
+                        Vec3 center = origin + Vec3(x + 0.5f, y + 0.5f, z + 0.5f) * voxelSize;
+                        if (triangle.overlapsBox(center)) {
+                            codes.push_back(mortonCode(x, y, z));
+                        }
+                    }
+                }
+            }
+        }
+        std::sort(codes.begin(), codes.end());
+        codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+    };
+    std::vector<uint64_t> leaves;
+    if (!jobs || triangleCount <= kVoxelizeGrain) {
+        voxelize(0, triangleCount, leaves);
+    } else {
+        size_t blocks = (triangleCount + kVoxelizeGrain - 1) / kVoxelizeGrain;
+        std::vector<std::vector<uint64_t>> pieces(blocks);
+        jobs->parallelFor(blocks, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                voxelize(i * kVoxelizeGrain, std::min(triangleCount, (i + 1) * kVoxelizeGrain), pieces[i]);
+            }
+        });
+        for (const std::vector<uint64_t>& piece : pieces) {
+            leaves.insert(leaves.end(), piece.begin(), piece.end());
+        }
+        std::sort(leaves.begin(), leaves.end());
+        leaves.erase(std::unique(leaves.begin(), leaves.end()), leaves.end());
+    }
+    voxels = leaves.size();
+
+    // Bottom-up: the parent of a node is its code shifted down by one octant, and the children
+    // of a parent are consecutive in Morton order. Child indices are within the level below
+    // until the levels are laid out from the root.
+    std::vector<std::vector<uint8_t>> levelMasks(treeLevels);
+    std::vector<std::vector<uint32_t>> levelChildren(treeLevels);
+    std::vector<uint64_t> codes = std::move(leaves), parents;
+    for (int level = treeLevels - 1; level >= 0; --level) {
+        parents.clear();
+        for (size_t i = 0; i < codes.size(); ++i) {
+            uint64_t parent = codes[i] >> 3;
+            if (parents.empty() || parents.back() != parent) {
+                parents.push_back(parent);
+                levelMasks[level].push_back(0);
+                levelChildren[level].push_back(static_cast<uint32_t>(i));
+            }
+            levelMasks[level].back() |= static_cast<uint8_t>(1u << (codes[i] & 7));
+        }
+        std::swap(codes, parents);
+    }
+    levels = treeLevels;
+    uint32_t nextLevel = 0;
+    for (int level = 0; level < levels; ++level) {
+        nextLevel += static_cast<uint32_t>(levelMasks[level].size());
+        childMasks.insert(childMasks.end(), levelMasks[level].begin(), levelMasks[level].end());
+        if (level < levels - 1) {
+            for (uint32_t child : levelChildren[level]) {
+                firstChild.push_back(nextLevel + child);
+            }
+        }
+    }
+    return true;
+}
+
+bool OccupancyMap::build(const aiScene* scene, std::span<const Mat4> transforms, const std::vector<uint8_t>& visible,
+                         float voxelSize, JobSystem* jobs) {
+    std::vector<Vec3> triangles;
+    collectTriangles(scene, transforms, visible, triangles);
+    return build(triangles, voxelSize, jobs);
+}
+
+void OccupancyMap::collectTriangles(const aiScene* scene, std::span<const Mat4> transforms,
+                                    const std::vector<uint8_t>& visible, std::vector<Vec3>& triangles) {
+    triangles.clear();
+    for (unsigned int i = 0; scene && i < scene->mNumMeshes; ++i) {
+        if (i < visible.size() && !visible[i]) {
+            continue;
+        }
+        const aiMesh* mesh = scene->mMeshes[i];
+        Mat4 world = i < transforms.size() ? transforms[i] : Mat4();
+        for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+            const aiFace& face = mesh->mFaces[f];
+            if (face.mNumIndices != 3) {
+                continue;
+            }
+            for (unsigned int k = 0; k < 3; ++k) {
+                const aiVector3D& v = mesh->mVertices[face.mIndices[k]];
+                triangles.push_back(transformPoint(world, Vec3(v.x, v.y, v.z)));
+            }
+        }
+    }
+}
+
+Aabb OccupancyMap::bounds() const {
+    if (levels == 0) {
+        return Aabb();
+    }
+    return nodeBox(0, 0, 0, 0);
+}
+
+size_t OccupancyMap::memoryBytes() const {
+    return childMasks.size() * sizeof(uint8_t) + firstChild.size() * sizeof(uint32_t);
+}
+
+uint32_t OccupancyMap::childIndex(uint32_t node, unsigned octant) const {
+    unsigned before = childMasks[node] & ((1u << octant) - 1);
+    return firstChild[node] + static_cast<uint32_t>(std::popcount(before));
+}
+
+Aabb OccupancyMap::nodeBox(uint32_t x, uint32_t y, uint32_t z, int level) const {
+    float size = std::ldexp(voxel, levels - level);
+    Aabb box;
+    box.min = origin + Vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) * size;
+    box.max = box.min + Vec3(size, size, size);
+    return box;
+}
+
+bool OccupancyMap::occupied(const Vec3& point) const {
+    if (empty()) {
+        return false;
+    }
+    float limit = static_cast<float>(uint32_t(1) << levels);
+    Vec3 cell = (point - origin) * (1.0f / voxel);
+    if (!(cell.x >= 0.0f && cell.y >= 0.0f && cell.z >= 0.0f && cell.x < limit && cell.y < limit && cell.z < limit)) {
+        return false;
+    }
+    uint32_t x = static_cast<uint32_t>(cell.x), y = static_cast<uint32_t>(cell.y), z = static_cast<uint32_t>(cell.z);
+    uint32_t node = 0;
+    for (int level = 0; level < levels; ++level) {
+        int shift = levels - 1 - level;
+        unsigned octant = (x >> shift & 1) | (y >> shift & 1) << 1 | (z >> shift & 1) << 2;
+        uint8_t mask = childMasks[node];
+        if (!(mask & (1u << octant))) {
+            return false;
+        }
+        if (level == levels - 1) {
+            return true;
+        }
+        node = childIndex(node, octant);
+    }
+    return false;
+}
+
+bool OccupancyMap::occupied(const Aabb& box) const {
+    if (empty() || box.empty()) {
+        return false;
+    }
+    // The voxels the box touches, clamped to the tree
+    float limit = static_cast<float>((uint32_t(1) << levels) - 1);
+    uint32_t lo[3], hi[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        float from = std::floor((box.min[axis] - origin[axis]) / voxel);
+        float to = std::floor((box.max[axis] - origin[axis]) / voxel);
+        if (to < 0.0f || from > limit) {
+            return false;
+        }
+        lo[axis] = static_cast<uint32_t>(std::max(from, 0.0f));
+        hi[axis] = static_cast<uint32_t>(std::min(to, limit));
+    }
+
+    struct Entry {
+        int level;
+        uint32_t node, x, y, z;
+    };
+    std::array<Entry, 8 * (kMaxDepth + 1)> stack;
+    size_t top = 0;
+    stack[top++] = {0, 0, 0, 0, 0};
+    while (top > 0) {
+        Entry entry = stack[--top];
+        uint8_t mask = childMasks[entry.node];
+        int shift = levels - 1 - entry.level;  // Voxels a child spans, as a power of two
+        for (unsigned octant = 0; octant < 8; ++octant) {
+            if (!(mask & (1u << octant))) {
+                continue;
+            }
+            uint32_t child[3] = {entry.x << 1 | (octant & 1), entry.y << 1 | (octant >> 1 & 1),
+                                 entry.z << 1 | (octant >> 2 & 1)};
+            bool overlapping = true;
+            for (int axis = 0; axis < 3 && overlapping; ++axis) {
+                uint32_t first = child[axis] << shift, lastVoxel = first + ((uint32_t(1) << shift) - 1);
+                overlapping = first <= hi[axis] && lastVoxel >= lo[axis];
+            }
+            if (!overlapping) {
+                continue;
+            }
+            if (shift == 0) {
+                return true;
+            }
+            uint32_t index = childIndex(entry.node, octant);
+            stack[top++] = {entry.level + 1, index, child[0], child[1], child[2]};
+        }
+    }
+    return false;
+}
+
+bool OccupancyMap::raycast(const Ray& ray, float maxDistance, float* hitDistance) const {
+    if (empty()) {
+        return false;
+    }
+    // Slab test against node boxes with the reciprocal direction computed once; an axis the
+    // ray runs parallel to only needs the origin inside the slab
+    float inverse[3];
+    bool parallel[3];
+    unsigned flip = 0;  // Octant bits of the axes the ray runs down, for front-to-back order
+    for (int axis = 0; axis < 3; ++axis) {
+        parallel[axis] = std::fabs(ray.direction[axis]) < 1e-12f;
+        inverse[axis] = parallel[axis] ? 0.0f : 1.0f / ray.direction[axis];
+        if (ray.direction[axis] < 0.0f) {
+            flip |= 1u << axis;
+        }
+    }
+    auto hits = [&](const Aabb& box, float& tEnter) {
+        float t0 = 0.0f, t1 = maxDistance;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (parallel[axis]) {
+                if (ray.origin[axis] < box.min[axis] || ray.origin[axis] > box.max[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            float tNear = (box.min[axis] - ray.origin[axis]) * inverse[axis];
+            float tFar = (box.max[axis] - ray.origin[axis]) * inverse[axis];
+            if (tNear > tFar) std::swap(tNear, tFar);
+            t0 = std::max(t0, tNear);
+            t1 = std::min(t1, tFar);
+            if (t0 > t1) {
+                return false;
+            }
+        }
+        tEnter = t0;
+        return true;
+    };
+    float tEnter;
+    if (!hits(bounds(), tEnter)) {
+        return false;
+    }
+
+    // Depth first, nearest child first: a ray crosses the octants of a node in increasing
+    // order of octant ^ flip, so the first voxel reached is the closest one
+    struct Entry {
+        int level;
+        uint32_t node, x, y, z;
+    };
+    std::array<Entry, 8 * (kMaxDepth + 1)> stack;
+    size_t top = 0;
+    stack[top++] = {0, 0, 0, 0, 0};
+    while (top > 0) {
+        Entry entry = stack[--top];
+        uint8_t mask = childMasks[entry.node];
+        bool voxelChildren = entry.level == levels - 1;
+        // Voxels are tested nearest first; nodes are pushed farthest first so the nearest pops next
+        for (unsigned i = 0; i < 8; ++i) {
+            unsigned octant = voxelChildren ? i ^ flip : (7 - i) ^ flip;
+            if (!(mask & (1u << octant))) {
+                continue;
+            }
+            uint32_t x = entry.x << 1 | (octant & 1), y = entry.y << 1 | (octant >> 1 & 1);
+            uint32_t z = entry.z << 1 | (octant >> 2 & 1);
+            if (!hits(nodeBox(x, y, z, entry.level + 1), tEnter)) {
+                continue;
+            }
+            if (voxelChildren) {
+                if (hitDistance) {
+                    *hitDistance = tEnter;
+                }
+                return true;
+            }
+            uint32_t index = childIndex(entry.node, octant);
+            stack[top++] = {entry.level + 1, index, x, y, z};
+        }
+    }
+    return false;
+}
+
+void OccupancyMap::voxelCenters(std::vector<Vec3>& out) const {
+    out.clear();
+    if (empty()) {
+        return;
+    }
+    // Codes level by level; expanding the masks in order keeps each level in Morton order
+    std::vector<uint64_t> codes = {0}, children;
+    size_t levelStart = 0;
+    for (int level = 0; level < levels; ++level) {
+        children.clear();
+        for (size_t node = 0; node < codes.size(); ++node) {
+            for (unsigned octant = 0; octant < 8; ++octant) {
+                if (childMasks[levelStart + node] & (1u << octant)) {
+                    children.push_back(codes[node] << 3 | octant);
+                }
+            }
+        }
+        levelStart += codes.size();
+        std::swap(codes, children);
+    }
+    out.reserve(codes.size());
+    for (uint64_t code : codes) {
+        Vec3 cell(compactBits(code) + 0.5f, compactBits(code >> 1) + 0.5f, compactBits(code >> 2) + 0.5f);
+        out.push_back(origin + cell * voxel);
+    }
+}
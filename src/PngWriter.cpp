@@ -0,0 +1,59 @@
+#include "PngWriter.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void putChunk(std::vector<uint8_t>& out, const char type[4], const uint8_t* data, size_t size) {
+    putU32(out, static_cast<uint32_t>(size));
+    size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    uLong crc = crc32(0L, out.data() + typeOffset, static_cast<uInt>(size + 4));
+    putU32(out, static_cast<uint32_t>(crc));
+}
+
+} // namespace
+
+bool writePng(const std::string& path, int width, int height, const uint8_t* rgb) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    // Every scanline gets filter type 0 (none); thumbnails favour encode speed over size
+    size_t rowBytes = static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> raw((rowBytes + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = raw.data() + y * (rowBytes + 1);
+        row[0] = 0;
+        std::copy(rgb + y * rowBytes, rgb + (y + 1) * rowBytes, row + 1);
+    }
+
+    uLongf compressedSize = compressBound(static_cast<uLong>(raw.size()));
+    std::vector<uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, raw.data(), static_cast<uLong>(raw.size()), Z_BEST_SPEED) != Z_OK) {
+        return false;
+    }
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> header;
+    putU32(header, static_cast<uint32_t>(width));
+    putU32(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, 2, 0, 0, 0});  // 8-bit, truecolor, deflate, adaptive filtering, no interlace
+    putChunk(png, "IHDR", header.data(), header.size());
+    putChunk(png, "IDAT", compressed.data(), compressedSize);
+    putChunk(png, "IEND", nullptr, 0);
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+    return static_cast<bool>(out);
+}
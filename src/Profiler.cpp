@@ -0,0 +1,274 @@
+#include "Profiler.h"
+
+const char* profileStageName(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::Frame: return "Other";
+        case ProfileStage::Lighting: return "Lighting";
+        case ProfileStage::Shadows: return "Shadows";
+        case ProfileStage::Traversal: return "Traversal";
+        case ProfileStage::Collision: return "Collision";
+        case ProfileStage::Submission: return "Submission";
+        case ProfileStage::TweakBar: return "TwDraw";
+        case ProfileStage::Swap: return "Swap";
+        default: return "?";
+    }
+}
+
+#ifdef DRONE_ENABLE_PROFILER
+
+#include <GL/glut.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+const int kStageCount = static_cast<int>(ProfileStage::Count);
+const uint64_t kRingCapacity = 1u << 14;  // Power of two
+const uint32_t kAveragedFrames = 60;
+
+// Seqlock slot: sequence is odd while a writer fills it and 2 * ticket + 2 once complete,
+// so a reader can tell torn or overwritten slots from valid ones without locking.
+struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> duration{0};
+    std::atomic<uint64_t> exclusive{0};
+    std::atomic<uint64_t> tag{0};  // frame << 16 | thread << 8 | stage
+};
+
+struct Sample {
+    uint64_t start, duration, exclusive;
+    uint32_t frame;
+    uint8_t thread;
+    ProfileStage stage;
+};
+
+Slot ring[kRingCapacity];
+std::atomic<uint64_t> writeCursor{0};
+std::atomic<uint32_t> currentFrame{0};
+std::atomic<uint32_t> nextThreadIndex{0};
+
+thread_local ProfileScope* activeScope = nullptr;
+thread_local uint32_t threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+thread_local uint32_t threadFrame = 0;  // Set by profilerSetThreadFrame
+
+float stageAverages[kStageCount] = {};
+float gpuTimes[kStageCount] = {-1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f};
+
+uint64_t nowNs() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void pushSample(ProfileStage stage, uint64_t start, uint64_t duration, uint64_t exclusive) {
+    uint64_t ticket = writeCursor.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring[ticket & (kRingCapacity - 1)];
+    slot.sequence.store(ticket * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t frame = threadFrame != 0 ? threadFrame : currentFrame.load(std::memory_order_relaxed);
+    uint64_t tag = (static_cast<uint64_t>(frame) << 16) |
+                   ((threadIndex & 0xFFu) << 8) | static_cast<uint64_t>(stage);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(duration, std::memory_order_relaxed);
+    slot.exclusive.store(exclusive, std::memory_order_relaxed);
+    slot.tag.store(tag, std::memory_order_relaxed);
+    slot.sequence.store(ticket * 2 + 2, std::memory_order_release);
+}
+
+bool readSample(uint64_t ticket, Sample& out) {
+    const Slot& slot = ring[ticket & (kRingCapacity - 1)];
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before != ticket * 2 + 2) {
+        return false;  // Still being written or already overwritten
+    }
+    out.start = slot.start.load(std::memory_order_relaxed);
+    out.duration = slot.duration.load(std::memory_order_relaxed);
+    out.exclusive = slot.exclusive.load(std::memory_order_relaxed);
+    uint64_t tag = slot.tag.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != before) {
+        return false;
+    }
+    out.frame = static_cast<uint32_t>(tag >> 16);
+    out.thread = static_cast<uint8_t>((tag >> 8) & 0xFFu);
+    out.stage = static_cast<ProfileStage>(tag & 0xFFu);
+    return true;
+}
+
+// Average exclusive time per stage over the last complete frames
+void aggregate() {
+    uint32_t frame = currentFrame.load(std::memory_order_relaxed);
+    if (frame < 2) {
+        return;
+    }
+    uint32_t lastFrame = frame - 1;
+    uint32_t firstFrame = lastFrame >= kAveragedFrames ? lastFrame - kAveragedFrames + 1 : 1;
+
+    double totals[kStageCount] = {};
+    uint32_t oldestSeen = lastFrame;
+    uint64_t end = writeCursor.load(std::memory_order_acquire);
+    uint64_t begin = end > kRingCapacity ? end - kRingCapacity : 0;
+    Sample sample;
+    for (uint64_t ticket = begin; ticket < end; ++ticket) {
+        if (!readSample(ticket, sample) || sample.frame < firstFrame || sample.frame > lastFrame) {
+            continue;
+        }
+        totals[static_cast<int>(sample.stage)] += sample.exclusive;
+        oldestSeen = std::min(oldestSeen, sample.frame);
+    }
+
+    double frames = static_cast<double>(lastFrame - oldestSeen + 1);
+    for (int i = 0; i < kStageCount; ++i) {
+        stageAverages[i] = static_cast<float>(totals[i] / frames / 1.0e6);
+    }
+}
+
+void drawText(int x, int y, const char* text) {
+    glRasterPos2i(x, y);
+    for (const char* c = text; *c; ++c) {
+        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+    }
+}
+
+} // namespace
+
+ProfileScope::ProfileScope(ProfileStage stage)
+    : stage(stage), start(nowNs()), childTime(0), parent(activeScope) {
+    activeScope = this;
+}
+
+ProfileScope::~ProfileScope() {
+    uint64_t duration = nowNs() - start;
+    activeScope = parent;
+    if (parent) {
+        parent->childTime += duration;
+    }
+    pushSample(stage, start, duration, duration > childTime ? duration - childTime : 0);
+    if (traceRecording()) {
+        traceComplete(profileStageName(stage), "frame", start, duration);
+    }
+}
+
+void profilerBeginFrame() {
+    uint32_t frame = currentFrame.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (frame % 15 == 0) {
+        aggregate();
+    }
+}
+
+uint32_t profilerFrame() {
+    return currentFrame.load(std::memory_order_relaxed);
+}
+
+void profilerSetThreadFrame(uint32_t frame) {
+    threadFrame = frame;
+}
+
+void profilerStageTimes(float outMs[kStageCount]) {
+    for (int i = 0; i < kStageCount; ++i) {
+        outMs[i] = stageAverages[i];
+    }
+}
+
+void profilerSetGpuTime(ProfileStage stage, float ms) {
+    gpuTimes[static_cast<int>(stage)] = ms;
+}
+
+void drawProfilerOverlay(int windowWidth, int windowHeight) {
+    const float barScale = 300.0f / 16.667f;  // 300 px per 60 Hz frame
+    const float colors[kStageCount][3] = {
+        {0.6f, 0.6f, 0.6f}, {1.0f, 0.8f, 0.2f}, {0.5f, 0.5f, 1.0f}, {0.3f, 0.9f, 0.3f},
+        {1.0f, 0.3f, 0.3f}, {0.2f, 0.8f, 0.9f}, {0.9f, 0.5f, 0.9f}, {1.0f, 0.6f, 0.3f}};
+    const int rowHeight = 16, left = 10, bottom = 10;
+    const int panelHeight = rowHeight * (kStageCount + 1) + 8;
+
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, windowWidth, 0, windowHeight, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+    glRectf(left - 4.0f, bottom - 4.0f, left + 460.0f, static_cast<float>(bottom + panelHeight));
+
+    float total = 0.0f;
+    char label[96];
+    for (int i = 0; i < kStageCount; ++i) {
+        int y = bottom + i * rowHeight;
+        float ms = stageAverages[i];
+        total += ms;
+
+        glColor3fv(colors[i]);
+        glRectf(left + 150.0f, y + 2.0f, left + 150.0f + std::min(ms * barScale, 300.0f), y + rowHeight - 4.0f);
+        if (gpuTimes[i] >= 0.0f) {
+            glColor3f(1.0f, 1.0f, 1.0f);
+            glRectf(left + 150.0f, y + rowHeight - 4.0f, left + 150.0f + std::min(gpuTimes[i] * barScale, 300.0f),
+                    y + rowHeight - 2.0f);
+            std::snprintf(label, sizeof(label), "%-10s %5.2f | GPU %5.2f", profileStageName(static_cast<ProfileStage>(i)),
+                          ms, gpuTimes[i]);
+        } else {
+            std::snprintf(label, sizeof(label), "%-10s %5.2f ms", profileStageName(static_cast<ProfileStage>(i)), ms);
+        }
+        glColor3f(1.0f, 1.0f, 1.0f);
+        drawText(left, y + 3, label);
+    }
+    float gpuTotal = 0.0f;
+    bool gpuMeasured = false;
+    for (float ms : gpuTimes) {
+        if (ms >= 0.0f) {
+            gpuTotal += ms;
+            gpuMeasured = true;
+        }
+    }
+    if (gpuMeasured) {
+        std::snprintf(label, sizeof(label), "CPU frame %.2f ms | GPU %.2f ms (%s-bound)", total, gpuTotal,
+                      gpuTotal > total ? "GPU" : "CPU");
+    } else {
+        std::snprintf(label, sizeof(label), "CPU frame %.2f ms", total);
+    }
+    drawText(left, bottom + kStageCount * rowHeight + 3, label);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+}
+
+bool exportProfile(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "frame,thread,stage,start_us,duration_us,exclusive_us\n";
+    out << std::fixed << std::setprecision(3);
+
+    uint64_t end = writeCursor.load(std::memory_order_acquire);
+    uint64_t begin = end > kRingCapacity ? end - kRingCapacity : 0;
+    Sample sample;
+    for (uint64_t ticket = begin; ticket < end; ++ticket) {
+        if (!readSample(ticket, sample)) {
+            continue;
+        }
+        out << sample.frame << ',' << static_cast<int>(sample.thread) << ',' << profileStageName(sample.stage) << ','
+            << sample.start / 1000.0 << ',' << sample.duration / 1000.0 << ',' << sample.exclusive / 1000.0 << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+#endif // DRONE_ENABLE_PROFILER
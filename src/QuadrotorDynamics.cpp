@@ -0,0 +1,351 @@
+#include "QuadrotorDynamics.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float kBoundsDensity = 60.0f;       // kg per m^3 of bounding box: frames are mostly air
+const float kThrustToWeight = 2.0f;
+const float kTipSpeed = 150.0f;           // m/s at full rotor speed
+const size_t kStepGrain = 1024;           // Drones per job
+
+// Scalar twins of the Float4 operations, so one template integrates one drone or four lanes
+// with the same operations in the same order
+inline float add4(float a, float b) { return a + b; }
+inline float sub4(float a, float b) { return a - b; }
+inline float mul4(float a, float b) { return a * b; }
+inline float madd4(float a, float b, float c) { return a * b + c; }
+inline float div4(float a, float b) { return a / b; }
+inline float sqrt4(float a) { return std::sqrt(a); }
+
+template <typename Real> Real broadcast(float s);
+template <> float broadcast<float>(float s) { return s; }
+template <> Float4 broadcast<Float4>(float s) { return splat4(s); }
+
+// State layout shared with QuadrotorBatch's arrays
+enum StateIndex { PX, PY, PZ, VX, VY, VZ, QX, QY, QZ, QW, WX, WY, WZ, kStateCount };
+static_assert(kStateCount == QuadrotorBatch::kStateSize, "batch state layout");
+
+// Parameters as Reals, converted once per step or lane block
+template <typename Real>
+struct Constants {
+    Real half, two, sixth, one;
+    Real inverseMass, gravity, linearDrag, quadraticDrag, angularDrag;
+    Real inertia[3], inverseInertia[3];
+    Real thrustCoefficient, torqueCoefficient;
+    Real armX[kQuadrotorRotors], armZ[kQuadrotorRotors], spin[kQuadrotorRotors];
+
+    explicit Constants(const QuadrotorParameters& p)
+        : half(broadcast<Real>(0.5f)), two(broadcast<Real>(2.0f)), sixth(broadcast<Real>(1.0f / 6.0f)),
+          one(broadcast<Real>(1.0f)), inverseMass(broadcast<Real>(1.0f / p.mass)), gravity(broadcast<Real>(p.gravity)),
+          linearDrag(broadcast<Real>(p.linearDrag)), quadraticDrag(broadcast<Real>(p.quadraticDrag)),
+          angularDrag(broadcast<Real>(p.angularDrag)), thrustCoefficient(broadcast<Real>(p.thrustCoefficient)),
+          torqueCoefficient(broadcast<Real>(p.torqueCoefficient)) {
+        for (int i = 0; i < 3; ++i) {
+            inertia[i] = broadcast<Real>(p.inertia[i]);
+            inverseInertia[i] = broadcast<Real>(1.0f / p.inertia[i]);
+        }
+        for (int r = 0; r < kQuadrotorRotors; ++r) {
+            armX[r] = broadcast<Real>(p.arms[r].x);
+            armZ[r] = broadcast<Real>(p.arms[r].z);
+            spin[r] = broadcast<Real>(p.spin[r]);
+        }
+    }
+};
+
+// Total thrust along body y and body torque, constant over a step
+template <typename Real>
+struct RotorForces {
+    Real thrust, torque[3];
+};
+
+template <typename Real>
+RotorForces<Real> rotorForces(const Constants<Real>& c, const Real* speeds) {
+    RotorForces<Real> f;
+    Real zero = sub4(c.one, c.one);
+    f.thrust = f.torque[0] = f.torque[1] = f.torque[2] = zero;
+    for (int r = 0; r < kQuadrotorRotors; ++r) {
+        Real squared = mul4(speeds[r], speeds[r]);
+        Real thrust = mul4(c.thrustCoefficient, squared);
+        f.thrust = add4(f.thrust, thrust);
+        // arm x (0, T, 0) = (-z T, 0, x T); the drag torque opposes the rotor's spin
+        f.torque[0] = sub4(f.torque[0], mul4(c.armZ[r], thrust));
+        f.torque[1] = sub4(f.torque[1], mul4(c.spin[r], mul4(c.torqueCoefficient, squared)));
+        f.torque[2] = madd4(c.armX[r], thrust, f.torque[2]);
+    }
+    return f;
+}
+
+template <typename Real>
+void derivative(const Constants<Real>& c, const RotorForces<Real>& f, const Real* s, Real* d) {
+    d[PX] = s[VX];
+    d[PY] = s[VY];
+    d[PZ] = s[VZ];
+
+    // Thrust along the body's up axis, drag against the velocity, gravity
+    Real qx = s[QX], qy = s[QY], qz = s[QZ], qw = s[QW];
+    Real upX = mul4(c.two, sub4(mul4(qx, qy), mul4(qw, qz)));
+    Real upY = sub4(c.one, mul4(c.two, madd4(qx, qx, mul4(qz, qz))));
+    Real upZ = mul4(c.two, madd4(qy, qz, mul4(qw, qx)));
+    Real speed = sqrt4(madd4(s[VX], s[VX], madd4(s[VY], s[VY], mul4(s[VZ], s[VZ]))));
+    Real drag = madd4(c.quadraticDrag, speed, c.linearDrag);
+    d[VX] = mul4(sub4(mul4(upX, f.thrust), mul4(drag, s[VX])), c.inverseMass);
+    d[VY] = sub4(mul4(sub4(mul4(upY, f.thrust), mul4(drag, s[VY])), c.inverseMass), c.gravity);
+    d[VZ] = mul4(sub4(mul4(upZ, f.thrust), mul4(drag, s[VZ])), c.inverseMass);
+
+    // q' = q * (w, 0) / 2 with body rates w
+    Real wx = s[WX], wy = s[WY], wz = s[WZ];
+    d[QX] = mul4(c.half, sub4(madd4(qw, wx, mul4(qy, wz)), mul4(qz, wy)));
+    d[QY] = mul4(c.half, madd4(qz, wx, sub4(mul4(qw, wy), mul4(qx, wz))));
+    d[QZ] = mul4(c.half, sub4(madd4(qw, wz, mul4(qx, wy)), mul4(qy, wx)));
+    d[QW] = mul4(c.half, sub4(sub4(sub4(c.one, c.one), mul4(qx, wx)), madd4(qy, wy, mul4(qz, wz))));
+
+    // Euler's equations: I w' = torque - w x (I w) - damping w
+    Real iwx = mul4(c.inertia[0], wx), iwy = mul4(c.inertia[1], wy), iwz = mul4(c.inertia[2], wz);
+    Real gyroX = sub4(mul4(wy, iwz), mul4(wz, iwy));
+    Real gyroY = sub4(mul4(wz, iwx), mul4(wx, iwz));
+    Real gyroZ = sub4(mul4(wx, iwy), mul4(wy, iwx));
+    d[WX] = mul4(sub4(sub4(f.torque[0], gyroX), mul4(c.angularDrag, wx)), c.inverseInertia[0]);
+    d[WY] = mul4(sub4(sub4(f.torque[1], gyroY), mul4(c.angularDrag, wy)), c.inverseInertia[1]);
+    d[WZ] = mul4(sub4(sub4(f.torque[2], gyroZ), mul4(c.angularDrag, wz)), c.inverseInertia[2]);
+}
+
+// Classic fourth-order Runge-Kutta, then the attitude is renormalized
+template <typename Real>
+void integrate(const Constants<Real>& c, const RotorForces<Real>& f, Real* s, Real dt) {
+    Real halfDt = mul4(c.half, dt);
+    Real k[kStateCount], sum[kStateCount], probe[kStateCount];
+    derivative(c, f, s, k);
+    for (int i = 0; i < kStateCount; ++i) {
+        sum[i] = k[i];
+        probe[i] = madd4(k[i], halfDt, s[i]);
+    }
+    derivative(c, f, probe, k);
+    for (int i = 0; i < kStateCount; ++i) {
+        sum[i] = madd4(k[i], c.two, sum[i]);
+        probe[i] = madd4(k[i], halfDt, s[i]);
+    }
+    derivative(c, f, probe, k);
+    for (int i = 0; i < kStateCount; ++i) {
+        sum[i] = madd4(k[i], c.two, sum[i]);
+        probe[i] = madd4(k[i], dt, s[i]);
+    }
+    derivative(c, f, probe, k);
+    Real scale = mul4(dt, c.sixth);
+    for (int i = 0; i < kStateCount; ++i) {
+        s[i] = madd4(add4(sum[i], k[i]), scale, s[i]);
+    }
+    Real norm = sqrt4(madd4(s[QX], s[QX], madd4(s[QY], s[QY], madd4(s[QZ], s[QZ], mul4(s[QW], s[QW])))));
+    Real inverseNorm = div4(c.one, norm);
+    for (int i = QX; i <= QW; ++i) {
+        s[i] = mul4(s[i], inverseNorm);
+    }
+}
+
+void toArray(const QuadrotorState& state, float* s) {
+    const float values[kStateCount] = {state.position.x, state.position.y, state.position.z, state.velocity.x,
+                                       state.velocity.y, state.velocity.z, state.attitude.x, state.attitude.y,
+                                       state.attitude.z, state.attitude.w, state.angularVelocity.x,
+                                       state.angularVelocity.y, state.angularVelocity.z};
+    std::copy(values, values + kStateCount, s);
+}
+
+QuadrotorState fromArray(const float* s) {
+    QuadrotorState state;
+    state.position = Vec3(s[PX], s[PY], s[PZ]);
+    state.velocity = Vec3(s[VX], s[VY], s[VZ]);
+    state.attitude = Quat(s[QX], s[QY], s[QZ], s[QW]);
+    state.angularVelocity = Vec3(s[WX], s[WY], s[WZ]);
+    return state;
+}
+
+} // namespace
+
+float QuadrotorParameters::hoverRotorSpeed() const {
+    return std::sqrt(mass * gravity / (kQuadrotorRotors * thrustCoefficient));
+}
+
+QuadrotorParameters quadrotorFromBounds(const Aabb& bounds, const std::vector<Vec3>& rotorHubs,
+                                        float unitsPerMetre) {
+    QuadrotorParameters p;
+    if (bounds.empty() || unitsPerMetre <= 0.0f) {
+        return p;
+    }
+    Vec3 size = (bounds.max - bounds.min) * (1.0f / unitsPerMetre);
+    size = Vec3(std::max(size.x, 0.02f), std::max(size.y, 0.02f), std::max(size.z, 0.02f));
+    Vec3 center = bounds.center();
+
+    p.mass = std::max(0.05f, kBoundsDensity * size.x * size.y * size.z);
+    p.inertia = Vec3(size.y * size.y + size.z * size.z, size.x * size.x + size.z * size.z,
+                     size.x * size.x + size.y * size.y) * (p.mass / 12.0f);
+
+    if (rotorHubs.size() == static_cast<size_t>(kQuadrotorRotors)) {
+        // Spin alternates going round the hubs, so diagonal rotors turn the same way
+        float angles[kQuadrotorRotors];
+        for (int r = 0; r < kQuadrotorRotors; ++r) {
+            p.arms[r] = (rotorHubs[r] - center) * (1.0f / unitsPerMetre);
+            angles[r] = std::atan2(p.arms[r].z, p.arms[r].x);
+        }
+        for (int r = 0; r < kQuadrotorRotors; ++r) {
+            int rank = static_cast<int>(std::count_if(angles, angles + kQuadrotorRotors,
+                                                      [&](float a) { return a < angles[r]; }));
+            p.spin[r] = rank % 2 == 0 ? 1.0f : -1.0f;
+        }
+    } else {
+        const float corners[kQuadrotorRotors][2] = {{1.0f, 1.0f}, {-1.0f, 1.0f}, {-1.0f, -1.0f}, {1.0f, -1.0f}};
+        for (int r = 0; r < kQuadrotorRotors; ++r) {
+            p.arms[r] = Vec3(0.35f * size.x * corners[r][0], 0.0f, 0.35f * size.z * corners[r][1]);
+        }
+    }
+
+    // Props about as long as the arms are apart, at a fixed tip speed
+    float armLength = 0.0f;
+    for (const Vec3& arm : p.arms) {
+        armLength += std::sqrt(arm.x * arm.x + arm.z * arm.z) / kQuadrotorRotors;
+    }
+    float rotorRadius = std::max(0.01f, 0.4f * armLength);
+    p.maxRotorSpeed = std::clamp(kTipSpeed / rotorRadius, 300.0f, 6000.0f);
+    p.thrustCoefficient =
+        kThrustToWeight * p.mass * p.gravity / (kQuadrotorRotors * p.maxRotorSpeed * p.maxRotorSpeed);
+    p.torqueCoefficient = p.thrustCoefficient * 0.15f * rotorRadius;
+
+    // Flat-plate drag on the top area, a little linear drag, weak rotational damping
+    p.quadraticDrag = 0.5f * 1.225f * size.x * size.z;
+    p.linearDrag = 0.1f * p.mass;
+    p.angularDrag = 0.05f * (p.inertia.x + p.inertia.y + p.inertia.z) / 3.0f;
+    return p;
+}
+
+void stepQuadrotor(const QuadrotorParameters& parameters, QuadrotorState& state,
+                   const float rotorSpeeds[kQuadrotorRotors], float dt) {
+    Constants<float> constants(parameters);
+    float s[kStateCount];
+    toArray(state, s);
+    integrate(constants, rotorForces(constants, rotorSpeeds), s, dt);
+    state = fromArray(s);
+}
+
+void controlQuadrotor(const QuadrotorParameters& parameters, const QuadrotorState& state, const Vec3& target,
+                      float rotorSpeeds[kQuadrotorRotors]) {
+    const float positionGain = 4.0f, velocityGain = 3.6f;    // 2 rad/s, damping ratio 0.9
+    const float attitudeGain = 400.0f, rateGain = 32.0f;     // 20 rad/s, 0.8
+    const float yawGain = 25.0f, yawRateGain = 8.0f;         // 5 rad/s, 0.8
+    const float g = parameters.gravity;
+
+    // Acceleration towards the target, tilt limited to about 35 degrees
+    Vec3 acceleration = (target - state.position) * positionGain - state.velocity * velocityGain;
+    float horizontal = std::sqrt(acceleration.x * acceleration.x + acceleration.z * acceleration.z);
+    if (horizontal > 0.7f * g) {
+        float scale = 0.7f * g / horizontal;
+        acceleration = Vec3(acceleration.x * scale, acceleration.y, acceleration.z * scale);
+    }
+    acceleration.y = std::clamp(acceleration.y, -0.8f * g, g);
+    Vec3 force = (acceleration + Vec3(0.0f, g, 0.0f)) * parameters.mass;
+
+    // Thrust along the current up axis; torque to turn it towards the force and hold yaw
+    Quat toBody(-state.attitude.x, -state.attitude.y, -state.attitude.z, state.attitude.w);
+    Vec3 up = rotate(state.attitude, Vec3(0.0f, 1.0f, 0.0f));
+    Vec3 forward = rotate(state.attitude, Vec3(0.0f, 0.0f, 1.0f));
+    float thrust = std::max(0.0f, dot(force, up));
+    Vec3 tiltError = rotate(toBody, cross(up, normalize(force)));
+    Vec3 yawError = rotate(toBody, Vec3(0.0f, -std::atan2(forward.x, forward.z), 0.0f));
+    const Vec3& w = state.angularVelocity;
+    Vec3 angularAcceleration(attitudeGain * tiltError.x + yawGain * yawError.x - rateGain * w.x,
+                             attitudeGain * tiltError.y + yawGain * yawError.y - yawRateGain * w.y,
+                             attitudeGain * tiltError.z + yawGain * yawError.z - rateGain * w.z);
+    const Vec3& inertia = parameters.inertia;
+    Vec3 iw(inertia.x * w.x, inertia.y * w.y, inertia.z * w.z);
+    Vec3 torque = Vec3(inertia.x * angularAcceleration.x, inertia.y * angularAcceleration.y,
+                       inertia.z * angularAcceleration.z) + cross(w, iw);
+
+    // Mixer: columns map one rotor's thrust to (total thrust, torque x, y, z)
+    Mat4 allocation;
+    float yawPerThrust = parameters.torqueCoefficient / parameters.thrustCoefficient;
+    for (int r = 0; r < kQuadrotorRotors; ++r) {
+        allocation.m[r * 4 + 0] = 1.0f;
+        allocation.m[r * 4 + 1] = -parameters.arms[r].z;
+        allocation.m[r * 4 + 2] = -parameters.spin[r] * yawPerThrust;
+        allocation.m[r * 4 + 3] = parameters.arms[r].x;
+    }
+    Mat4 mixer = inverse(allocation);
+    const float demand[4] = {thrust, torque.x, torque.y, torque.z};
+    float maxThrust = parameters.thrustCoefficient * parameters.maxRotorSpeed * parameters.maxRotorSpeed;
+    for (int r = 0; r < kQuadrotorRotors; ++r) {
+        float rotorThrust = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            rotorThrust += mixer.m[k * 4 + r] * demand[k];
+        }
+        rotorThrust = std::clamp(rotorThrust, 0.0f, maxThrust);
+        rotorSpeeds[r] = std::sqrt(rotorThrust / parameters.thrustCoefficient);
+    }
+}
+
+QuadrotorBatch::QuadrotorBatch(const QuadrotorParameters& parameters) : parameters(parameters) {}
+
+void QuadrotorBatch::resize(size_t newCount) {
+    count = newCount;
+    size_t padded = (count + kLanes - 1) / kLanes * kLanes;
+    QuadrotorState rest;
+    float s[kStateCount];
+    toArray(rest, s);
+    for (int i = 0; i < kStateCount; ++i) {
+        states[i].resize(padded, s[i]);
+        std::fill(states[i].begin() + count, states[i].end(), s[i]);
+    }
+    for (std::vector<float>& speeds : rotorSpeeds) {
+        speeds.resize(padded, 0.0f);
+        std::fill(speeds.begin() + count, speeds.end(), 0.0f);
+    }
+}
+
+void QuadrotorBatch::setState(size_t index, const QuadrotorState& state) {
+    float s[kStateCount];
+    toArray(state, s);
+    for (int i = 0; i < kStateCount; ++i) {
+        states[i][index] = s[i];
+    }
+}
+
+QuadrotorState QuadrotorBatch::state(size_t index) const {
+    float s[kStateCount];
+    for (int i = 0; i < kStateCount; ++i) {
+        s[i] = states[i][index];
+    }
+    return fromArray(s);
+}
+
+void QuadrotorBatch::setRotorSpeeds(size_t index, const float speeds[kQuadrotorRotors]) {
+    for (int r = 0; r < kQuadrotorRotors; ++r) {
+        rotorSpeeds[r][index] = speeds[r];
+    }
+}
+
+void QuadrotorBatch::step(float dt, JobSystem* jobs) {
+    size_t padded = states[0].size();
+    if (!jobs) {
+        stepLanes(0, padded, dt);
+        return;
+    }
+    jobs->parallelFor(padded / kLanes, kStepGrain / kLanes, [&](size_t begin, size_t end) {
+        stepLanes(begin * kLanes, end * kLanes, dt);
+    });
+}
+
+void QuadrotorBatch::stepLanes(size_t begin, size_t end, float dt) {
+    Constants<Float4> constants(parameters);
+    Float4 step = splat4(dt);
+    for (size_t i = begin; i < end; i += kLanes) {
+        Float4 s[kStateCount], speeds[kQuadrotorRotors];
+        for (int k = 0; k < kStateCount; ++k) {
+            s[k] = load4(&states[k][i]);
+        }
+        for (int r = 0; r < kQuadrotorRotors; ++r) {
+            speeds[r] = load4(&rotorSpeeds[r][i]);
+        }
+        integrate(constants, rotorForces(constants, speeds), s, step);
+        for (int k = 0; k < kStateCount; ++k) {
+            store4(&states[k][i], s[k]);
+        }
+    }
+}
@@ -0,0 +1,194 @@
+#include "RenderThread.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "SceneQueries.h"
+#include "SoftwareRasterizer.h"
+#include "TraceRecorder.h"
+#include <cstring>
+
+namespace {
+
+// Skinned vertices of the mesh in this packet, or null for the mesh's own
+const aiVector3D* skinnedPositions(const FramePacket& packet, unsigned int mesh) {
+    if (!packet.skinning || mesh >= packet.skinning->positions.size() || packet.skinning->positions[mesh].empty()) {
+        return nullptr;
+    }
+    return packet.skinning->positions[mesh].data();
+}
+
+bool sameMatrix(const Mat4& a, const Mat4& b) {
+    return std::memcmp(a.m, b.m, sizeof(a.m)) == 0;
+}
+
+bool sameVec3(const Vec3& a, const Vec3& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+bool sameFrame(const RenderFrame& a, const RenderFrame& b) {
+    if (a.width != b.width || a.height != b.height || !sameMatrix(a.projection, b.projection) ||
+        a.shininess != b.shininess || a.lightCount != b.lightCount || a.perPixelLighting != b.perPixelLighting ||
+        std::memcmp(a.clearColor, b.clearColor, sizeof(a.clearColor)) != 0 ||
+        std::memcmp(a.globalAmbient, b.globalAmbient, sizeof(a.globalAmbient)) != 0 ||
+        std::memcmp(a.specular, b.specular, sizeof(a.specular)) != 0) {
+        return false;
+    }
+    // RenderLight is all floats, so there is no padding to compare
+    return std::memcmp(a.lights, b.lights, sizeof(RenderLight) * a.lightCount) == 0;
+}
+
+void submitNodeMeshes(RenderBackend& backend, const FramePacket& packet, const FrameOutput& output,
+                      const aiNode* node) {
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+        unsigned int meshID = node->mMeshes[i];
+        if (meshID >= packet.meshes.size() || !packet.meshes[meshID].visible || !output.inView[meshID]) {
+            continue;
+        }
+        RenderMesh item;
+        item.mesh = packet.scene->mMeshes[meshID];
+        item.positions = skinnedPositions(packet, meshID);
+        if (item.positions && !packet.skinning->normals[meshID].empty()) {
+            item.normals = packet.skinning->normals[meshID].data();
+        }
+        item.modelView = packet.view * packet.meshes[meshID].world;
+        std::memcpy(item.color, packet.materialColor, sizeof(item.color));
+        backend.submit(item);
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+        submitNodeMeshes(backend, packet, output, node->mChildren[i]);
+    }
+}
+
+} // namespace
+
+bool sameFrameState(const FramePacket& a, const FramePacket& b) {
+    if (a.scene != b.scene || a.sceneRevision != b.sceneRevision || !sameFrame(a.frame, b.frame) ||
+        !sameMatrix(a.view, b.view) || a.skinning != b.skinning ||
+        std::memcmp(a.materialColor, b.materialColor, sizeof(a.materialColor)) != 0 ||
+        a.findCollisions != b.findCollisions || a.softwareRendering != b.softwareRendering ||
+        a.pickId != b.pickId || a.pickNdc[0] != b.pickNdc[0] || a.pickNdc[1] != b.pickNdc[1] ||
+        a.meshes.size() != b.meshes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.meshes.size(); ++i) {
+        const MeshState& x = a.meshes[i];
+        const MeshState& y = b.meshes[i];
+        if (x.visible != y.visible || !sameMatrix(x.world, y.world) ||
+            !sameVec3(x.localBounds.min, y.localBounds.min) || !sameVec3(x.localBounds.max, y.localBounds.max)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void prepareFrame(const FramePacket& packet, FrameOutput& output, RenderBackend* backend, JobSystem* jobs,
+                  FrameArena* arena) {
+    profilerSetThreadFrame(packet.profileFrame);
+    output.packetSerial = packet.serial;
+    output.sceneRevision = packet.sceneRevision;
+    output.viewProjection = packet.frame.projection * packet.view;
+
+    size_t meshCount = packet.meshes.size();
+    output.worldBounds.resize(meshCount);
+    auto updateBounds = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const MeshState& mesh = packet.meshes[i];
+            output.worldBounds[i] = mesh.visible ? transformAabb(mesh.world, mesh.localBounds) : Aabb();
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(meshCount, 2048, updateBounds);
+    } else {
+        updateBounds(0, meshCount);
+    }
+    cullBounds(frustumFromMatrix(output.viewProjection), output.worldBounds, output.inView, jobs);
+
+    if (packet.findCollisions) {
+        PROFILE_SCOPE(ProfileStage::Collision);
+        findCollisions(output.worldBounds, output.colliding, jobs, arena);
+    } else {
+        output.colliding.clear();
+    }
+
+    output.pickId = packet.pickId;
+    output.pickedMesh = -1;
+    if (packet.pickId != 0 && packet.scene) {
+        TRACE_SCOPE("pickMesh", "render");
+        FrameVector<Mat4> transforms(meshCount, Mat4(), arena);
+        FrameVector<const aiVector3D*> positions(meshCount, nullptr, arena);
+        for (size_t i = 0; i < meshCount; ++i) {
+            transforms[i] = packet.meshes[i].world;
+            positions[i] = skinnedPositions(packet, static_cast<unsigned int>(i));
+        }
+        Ray ray = rayFromNdc(output.viewProjection, packet.pickNdc[0], packet.pickNdc[1]);
+        output.pickedMesh = pickMesh(packet.scene, output.worldBounds, transforms, ray, nullptr, arena, positions);
+    }
+
+    if (backend) {
+        backend->beginFrame(packet.frame);
+        if (packet.scene && packet.scene->mRootNode) {
+            PROFILE_SCOPE(ProfileStage::Traversal);
+            submitNodeMeshes(*backend, packet, output, packet.scene->mRootNode);
+        }
+        backend->endFrame();
+    }
+    profilerSetThreadFrame(0);
+}
+
+RenderThread::RenderThread(JobSystem* jobs) : jobs(jobs) {
+    thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+    stopping.store(true, std::memory_order_release);
+    submitted.fetch_add(1, std::memory_order_release);
+    submitted.notify_one();
+    thread.join();
+}
+
+uint64_t RenderThread::submit() {
+    packets.back().serial = ++lastSerial;
+    packets.publish();
+    submitted.fetch_add(1, std::memory_order_release);
+    submitted.notify_one();
+    return lastSerial;
+}
+
+void RenderThread::run() {
+    traceSetThreadName("render");
+    uint64_t seen = 0;
+    for (;;) {
+        submitted.wait(seen, std::memory_order_acquire);
+        seen = submitted.load(std::memory_order_acquire);
+        if (stopping.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (!packets.update()) {
+            continue;
+        }
+
+        TRACE_SCOPE("prepareFrame", "render");
+        const FramePacket& packet = packets.front();
+        FrameOutput& output = outputs.back();
+        RenderBackend* backend = nullptr;
+        if (packet.softwareRendering) {
+            if (!rasterizer) {
+                rasterizer = std::make_unique<SoftwareRasterizer>();
+            }
+            backend = rasterizer.get();
+        }
+        prepareFrame(packet, output, backend, jobs, &arena);
+        arena.reset();
+
+        if (backend) {
+            output.width = packet.frame.width;
+            output.height = packet.frame.height;
+            output.pixels = rasterizer->colorBuffer();
+        } else {
+            output.width = output.height = 0;
+            output.pixels.clear();
+        }
+        outputs.publish();
+        completed.store(packet.serial, std::memory_order_release);
+    }
+}
@@ -0,0 +1,108 @@
+#include "RotorAnimation.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iterator>
+#include <string>
+
+namespace {
+
+// Whole words of a name only, so "Rotor_FL", "PropLeft" or "blade.001" count and "property"
+// does not. Words are runs of letters, also split where a capital follows a lower case letter.
+bool isRotorName(const char* name) {
+    static const char* const keywords[] = {"rotor", "rotors", "prop", "props", "propeller", "propellers",
+                                           "blade", "blades"};
+    std::string word;
+    auto matches = [&word]() {
+        return std::find(std::begin(keywords), std::end(keywords), word) != std::end(keywords);
+    };
+    for (const char* c = name;; ++c) {
+        unsigned char ch = static_cast<unsigned char>(*c);
+        bool letter = std::isalpha(ch) != 0;
+        bool split = !letter || (std::isupper(ch) && !word.empty() && std::islower(static_cast<unsigned char>(c[-1])));
+        if (split && !word.empty()) {
+            if (matches()) {
+                return true;
+            }
+            word.clear();
+        }
+        if (ch == '\0') {
+            return false;
+        }
+        if (letter) {
+            word += static_cast<char>(std::tolower(ch));
+        }
+    }
+}
+
+} // namespace
+
+size_t RotorAnimation::detect(const aiScene* scene, const TransformHierarchy& hierarchy,
+                              const std::vector<Aabb>& meshBounds) {
+    clear();
+    if (!scene) {
+        return 0;
+    }
+    for (unsigned int mesh = 0; mesh < scene->mNumMeshes && mesh < meshBounds.size(); ++mesh) {
+        int node = hierarchy.meshNode(mesh);
+        bool named = isRotorName(scene->mMeshes[mesh]->mName.C_Str()) ||
+                     (node >= 0 && isRotorName(hierarchy.node(node)->mName.C_Str()));
+        if (named && !meshBounds[mesh].empty()) {
+            add(mesh, meshBounds[mesh]);
+        }
+    }
+    return rotors.size();
+}
+
+void RotorAnimation::add(unsigned int mesh, const Aabb& bounds, float rpm) {
+    Rotor rotor;
+    rotor.mesh = mesh;
+    rotor.pivot = bounds.center();
+    Vec3 extent = bounds.max - bounds.min;
+    int thinnest = 0;
+    for (int i = 1; i < 3; ++i) {
+        if (extent[i] < extent[thinnest]) {
+            thinnest = i;
+        }
+    }
+    rotor.axis = thinnest;
+    rotor.rpm = rpm;
+    rotors.push_back(rotor);
+}
+
+void RotorAnimation::step(float dt) {
+    for (Rotor& rotor : rotors) {
+        rotor.previousAngle = rotor.angle;
+        rotor.angle += rotor.rpm * 6.0f * dt;  // 360 degrees per revolution, 60 s per minute
+        // Keep the angle within [0, 360) and the interpolation continuous across the wrap
+        float turns = std::floor(rotor.angle / 360.0f);
+        rotor.angle -= turns * 360.0f;
+        rotor.previousAngle -= turns * 360.0f;
+    }
+}
+
+void RotorAnimation::apply(TransformHierarchy& hierarchy, float alpha) const {
+    for (const Rotor& rotor : rotors) {
+        float angle = rotor.previousAngle + (rotor.angle - rotor.previousAngle) * alpha;
+        float radians = angle * static_cast<float>(M_PI) / 180.0f;
+        float c = std::cos(radians), s = std::sin(radians);
+        // translate(pivot) * rotate * translate(-pivot); the rotation turns axis u towards v
+        int u = (rotor.axis + 1) % 3, v = (rotor.axis + 2) % 3;
+        float pu = rotor.pivot[u], pv = rotor.pivot[v];
+        Mat4 spin;
+        spin.m[u * 4 + u] = c;
+        spin.m[u * 4 + v] = s;
+        spin.m[v * 4 + u] = -s;
+        spin.m[v * 4 + v] = c;
+        spin.m[12 + u] = pu - (c * pu - s * pv);
+        spin.m[12 + v] = pv - (s * pu + c * pv);
+        hierarchy.setMeshTransform(rotor.mesh, spin);
+    }
+}
+
+void RotorAnimation::settle() {
+    for (Rotor& rotor : rotors) {
+        rotor.previousAngle = rotor.angle;
+    }
+}
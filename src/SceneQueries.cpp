@@ -0,0 +1,363 @@
+#include "SceneQueries.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+
+namespace {
+
+// Items per job chunk: large enough to amortize scheduling, small enough to balance
+const size_t kBoundsGrain = 2048;
+const size_t kSweepGrain = 512;
+
+template <typename Items>
+void collectNodes(const TransformHierarchy& hierarchy, size_t begin, size_t end, const std::vector<uint8_t>& visible,
+                  Items& out) {
+    for (size_t node = begin; node < end; ++node) {
+        for (unsigned int mesh : hierarchy.meshes(node)) {
+            if (mesh < hierarchy.meshCount() && (visible.empty() || (mesh < visible.size() && visible[mesh]))) {
+                out.push_back({mesh, hierarchy.instanceWorld(node, mesh)});
+            }
+        }
+    }
+}
+
+// The six frustum planes transposed into two groups of four lanes, plus the absolute normals;
+// the two spare lanes hold 0x + 0y + 0z + 1, which every box passes
+struct FrustumLanes {
+    Float4 nx[2], ny[2], nz[2], d[2];
+    Float4 ax[2], ay[2], az[2];
+};
+
+FrustumLanes transposePlanes(const Frustum& frustum) {
+    float planes[4][8];
+    for (int i = 0; i < 8; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            planes[c][i] = i < 6 ? frustum.planes[i][c] : (c == 3 ? 1.0f : 0.0f);
+        }
+    }
+    FrustumLanes lanes;
+    for (int g = 0; g < 2; ++g) {
+        lanes.nx[g] = load4(planes[0] + g * 4);
+        lanes.ny[g] = load4(planes[1] + g * 4);
+        lanes.nz[g] = load4(planes[2] + g * 4);
+        lanes.d[g] = load4(planes[3] + g * 4);
+        lanes.ax[g] = abs4(lanes.nx[g]);
+        lanes.ay[g] = abs4(lanes.ny[g]);
+        lanes.az[g] = abs4(lanes.nz[g]);
+    }
+    return lanes;
+}
+
+// intersectsFrustum four planes at a time: the distance of the box's furthest corner along a
+// normal is n.center + |n|.halfExtent, the same value the scalar corner selection computes
+bool intersectsLanes(const FrustumLanes& lanes, const Aabb& box) {
+    if (box.empty()) {
+        return false;
+    }
+    Vec3 center = box.center();
+    Vec3 half = (box.max - box.min) * 0.5f;
+    Float4 cx = splat4(center.x), cy = splat4(center.y), cz = splat4(center.z);
+    Float4 hx = splat4(half.x), hy = splat4(half.y), hz = splat4(half.z);
+    for (int g = 0; g < 2; ++g) {
+        Float4 distance = madd4(lanes.nx[g], cx, lanes.d[g]);
+        distance = madd4(lanes.ny[g], cy, distance);
+        distance = madd4(lanes.nz[g], cz, distance);
+        distance = madd4(lanes.ax[g], hx, distance);
+        distance = madd4(lanes.ay[g], hy, distance);
+        distance = madd4(lanes.az[g], hz, distance);
+        if (negativeMask4(distance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Slab test; returns the entry distance along the ray in tEnter
+bool rayHitsBox(const Ray& ray, const Aabb& box, float maxT, float& tEnter) {
+    float t0 = 0.0f, t1 = maxT;
+    for (int axis = 0; axis < 3; ++axis) {
+        float origin = ray.origin[axis], direction = ray.direction[axis];
+        if (std::fabs(direction) < 1e-12f) {
+            if (origin < box.min[axis] || origin > box.max[axis]) {
+                return false;
+            }
+            continue;
+        }
+        float inv = 1.0f / direction;
+        float tNear = (box.min[axis] - origin) * inv;
+        float tFar = (box.max[axis] - origin) * inv;
+        if (tNear > tFar) std::swap(tNear, tFar);
+        t0 = std::max(t0, tNear);
+        t1 = std::min(t1, tFar);
+        if (t0 > t1) {
+            return false;
+        }
+    }
+    tEnter = t0;
+    return true;
+}
+
+// Moller-Trumbore, both faces
+bool rayHitsTriangle(const Ray& ray, const Vec3& a, const Vec3& b, const Vec3& c, float& t) {
+    Vec3 edge1 = b - a, edge2 = c - a;
+    Vec3 p = cross(ray.direction, edge2);
+    float det = dot(edge1, p);
+    if (std::fabs(det) < 1e-12f) {
+        return false;
+    }
+    float invDet = 1.0f / det;
+    Vec3 s = ray.origin - a;
+    float u = dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+    Vec3 q = cross(s, edge1);
+    float v = dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+    t = dot(edge2, q) * invDet;
+    return t >= 0.0f;
+}
+
+} // namespace
+
+Mat4 toMat4(const aiMatrix4x4& m) {
+    Mat4 r;
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 4; ++col) {
+            r.m[col * 4 + row] = m[row][col];
+        }
+    }
+    return r;
+}
+
+Aabb computeMeshBounds(const aiMesh* mesh) {
+    Aabb box;
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        const aiVector3D& v = mesh->mVertices[i];
+        box.expand(Vec3(v.x, v.y, v.z));
+    }
+    return box;
+}
+
+void collectDrawItems(const TransformHierarchy& hierarchy, const std::vector<uint8_t>& visible,
+                      std::vector<DrawItem>& out, JobSystem* jobs, FrameArena* arena) {
+    out.clear();
+    size_t count = hierarchy.size();
+    if (!jobs || count <= kBoundsGrain) {
+        collectNodes(hierarchy, 0, count, visible, out);
+        return;
+    }
+
+    // Fixed node ranges, each into its own list in the sub-arena of the thread running it
+    size_t chunks = (count + kBoundsGrain - 1) / kBoundsGrain;
+    FrameVector<FrameVector<DrawItem>> pieces(arena);
+    pieces.reserve(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        pieces.emplace_back(arena);
+    }
+    jobs->parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            collectNodes(hierarchy, i * kBoundsGrain, std::min(count, (i + 1) * kBoundsGrain), visible, pieces[i]);
+        }
+    });
+    for (const FrameVector<DrawItem>& items : pieces) {
+        out.insert(out.end(), items.begin(), items.end());
+    }
+}
+
+Frustum frustumFromMatrix(const Mat4& viewProjection) {
+    // Gribb/Hartmann: planes are sums/differences of the fourth row with the other rows
+    const float* m = viewProjection.m;
+    auto row = [m](int r, int c) { return m[c * 4 + r]; };
+    Frustum frustum;
+    for (int i = 0; i < 3; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            frustum.planes[i * 2][c] = row(3, c) + row(i, c);
+            frustum.planes[i * 2 + 1][c] = row(3, c) - row(i, c);
+        }
+    }
+    return frustum;
+}
+
+bool intersectsFrustum(const Frustum& frustum, const Aabb& box) {
+    if (box.empty()) {
+        return false;
+    }
+    for (const float* plane : frustum.planes) {
+        // Corner furthest along the plane normal
+        float x = plane[0] >= 0.0f ? box.max.x : box.min.x;
+        float y = plane[1] >= 0.0f ? box.max.y : box.min.y;
+        float z = plane[2] >= 0.0f ? box.max.z : box.min.z;
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void cullBounds(const Frustum& frustum, const std::vector<Aabb>& bounds, std::vector<uint8_t>& visible,
+                JobSystem* jobs) {
+    visible.resize(bounds.size());
+    FrustumLanes lanes = transposePlanes(frustum);
+    auto cull = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            visible[i] = intersectsLanes(lanes, bounds[i]) ? 1 : 0;
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(bounds.size(), kBoundsGrain, cull);
+    } else {
+        cull(0, bounds.size());
+    }
+}
+
+void findCollisions(const std::vector<Aabb>& bounds, std::vector<uint8_t>& colliding, JobSystem* jobs,
+                    FrameArena* arena) {
+    colliding.assign(bounds.size(), 0);
+    FrameVector<unsigned int> order(arena);
+    order.reserve(bounds.size());
+    for (unsigned int i = 0; i < bounds.size(); ++i) {
+        if (!bounds[i].empty()) {
+            order.push_back(i);
+        }
+    }
+    auto byMinX = [&bounds](unsigned int a, unsigned int b) { return bounds[a].min.x < bounds[b].min.x; };
+
+    if (!jobs || order.size() <= kSweepGrain) {
+        std::sort(order.begin(), order.end(), byMinX);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const Aabb& a = bounds[order[i]];
+            for (size_t j = i + 1; j < order.size() && bounds[order[j]].min.x <= a.max.x; ++j) {
+                if (overlaps(a, bounds[order[j]])) {
+                    colliding[order[i]] = 1;
+                    colliding[order[j]] = 1;
+                }
+            }
+        }
+        return;
+    }
+
+    // Broadphase: sort equal slices in parallel, then merge neighbouring runs pairwise. The
+    // merges go back and forth between order and a scratch buffer (std::inplace_merge would
+    // allocate its own).
+    size_t slices = std::min<size_t>(jobs->threadCount() * 2, order.size() / kSweepGrain);
+    FrameVector<size_t> sliceStart(slices + 1, 0, arena);
+    for (size_t s = 0; s <= slices; ++s) {
+        sliceStart[s] = order.size() * s / slices;
+    }
+    jobs->parallelFor(slices, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            std::sort(order.begin() + sliceStart[s], order.begin() + sliceStart[s + 1], byMinX);
+        }
+    });
+    FrameVector<unsigned int> scratch(order.size(), 0, arena);
+    unsigned int* source = order.data();
+    unsigned int* target = scratch.data();
+    for (size_t width = 1; width < slices; width *= 2) {
+        size_t pairs = (slices + 2 * width - 1) / (2 * width);
+        jobs->parallelFor(pairs, 1, [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                size_t first = p * 2 * width;
+                size_t middle = std::min(first + width, slices);
+                size_t last = std::min(first + 2 * width, slices);
+                // A trailing run without a partner is copied so the whole target is valid
+                std::merge(source + sliceStart[first], source + sliceStart[middle], source + sliceStart[middle],
+                           source + sliceStart[last], target + sliceStart[first], byMinX);
+            }
+        });
+        std::swap(source, target);
+    }
+    if (source != order.data()) {
+        order.swap(scratch);
+    }
+
+    // Sweep: chunks of start boxes; a box may be marked from two chunks at once
+    jobs->parallelFor(order.size(), kSweepGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const Aabb& a = bounds[order[i]];
+            for (size_t j = i + 1; j < order.size() && bounds[order[j]].min.x <= a.max.x; ++j) {
+                if (overlaps(a, bounds[order[j]])) {
+                    std::atomic_ref<uint8_t>(colliding[order[i]]).store(1, std::memory_order_relaxed);
+                    std::atomic_ref<uint8_t>(colliding[order[j]]).store(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    });
+}
+
+Ray rayFromNdc(const Mat4& viewProjection, float ndcX, float ndcY) {
+    Mat4 inv = inverse(viewProjection);
+    auto unproject = [&inv](float z, float ndcX, float ndcY) {
+        const float* m = inv.m;
+        float x = m[0] * ndcX + m[4] * ndcY + m[8] * z + m[12];
+        float y = m[1] * ndcX + m[5] * ndcY + m[9] * z + m[13];
+        float zz = m[2] * ndcX + m[6] * ndcY + m[10] * z + m[14];
+        float w = m[3] * ndcX + m[7] * ndcY + m[11] * z + m[15];
+        return Vec3(x / w, y / w, zz / w);
+    };
+    Vec3 nearPoint = unproject(-1.0f, ndcX, ndcY);
+    Vec3 farPoint = unproject(1.0f, ndcX, ndcY);
+    return {nearPoint, farPoint - nearPoint};
+}
+
+int pickMesh(const aiScene* scene, const std::vector<Aabb>& worldBounds, std::span<const Mat4> transforms,
+             const Ray& ray, float* hitDistance, FrameArena* arena, std::span<const aiVector3D* const> positions) {
+    if (!scene) {
+        return -1;
+    }
+
+    // Nearest boxes first so most triangles behind an earlier hit are never tested
+    FrameVector<std::pair<float, unsigned int>> candidates(arena);
+    unsigned int meshCount = std::min<unsigned int>(scene->mNumMeshes, static_cast<unsigned int>(worldBounds.size()));
+    for (unsigned int i = 0; i < meshCount; ++i) {
+        float tEnter;
+        if (!worldBounds[i].empty() && rayHitsBox(ray, worldBounds[i], FLT_MAX, tEnter)) {
+            candidates.push_back({tEnter, i});
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    int closest = -1;
+    float closestT = FLT_MAX;
+    for (const auto& candidate : candidates) {
+        if (candidate.first > closestT) {
+            break;
+        }
+        // Test in mesh space: the ray parameter t is the same on both sides of an affine map
+        const aiMesh* mesh = scene->mMeshes[candidate.second];
+        Ray localRay = ray;
+        if (candidate.second < transforms.size()) {
+            Mat4 toLocal = inverse(transforms[candidate.second]);
+            localRay.origin = transformPoint(toLocal, ray.origin);
+            localRay.direction = transformDirection(toLocal, ray.direction);
+        }
+        const aiVector3D* vertices = mesh->mVertices;
+        if (candidate.second < positions.size() && positions[candidate.second]) {
+            vertices = positions[candidate.second];
+        }
+        for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+            const aiFace& face = mesh->mFaces[f];
+            if (face.mNumIndices != 3) {
+                continue;
+            }
+            const aiVector3D& a = vertices[face.mIndices[0]];
+            const aiVector3D& b = vertices[face.mIndices[1]];
+            const aiVector3D& c = vertices[face.mIndices[2]];
+            float t;
+            if (rayHitsTriangle(localRay, Vec3(a.x, a.y, a.z), Vec3(b.x, b.y, b.z), Vec3(c.x, c.y, c.z), t) &&
+                t < closestT) {
+                closestT = t;
+                closest = static_cast<int>(candidate.second);
+            }
+        }
+    }
+    if (hitDistance && closest >= 0) {
+        *hitDistance = closestT;
+    }
+    return closest;
+}
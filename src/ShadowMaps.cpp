@@ -0,0 +1,344 @@
+#define GL_GLEXT_PROTOTYPES
+#include "ShadowMaps.h"
+#include <GL/glext.h>
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// The sampled atlas, and a second one holding only the static casters of each cascade
+GLuint shadowFramebuffer = 0, staticFramebuffer = 0;
+GLuint shadowTexture = 0, staticTexture = 0;
+bool shadowsAvailable = false;
+int allocatedResolution = 0;
+int allocatedCascades = 0;
+
+ShadowFrameData frameData;
+bool frameValid = false;
+int renderedLastUpdate = 0;
+
+// What each atlas slot currently holds
+struct CascadeCache {
+    bool valid = false;
+    uint64_t staticRevision = 0;
+    Vec3 lightDirection;
+    Aabb bounds;              // Light view space bounds the slot was rendered with
+    Mat4 projection;
+    bool dynamicDrawn = false;  // The sampled slot has dynamic casters over the static depth
+};
+CascadeCache cascadeCache[kMaxShadowCascades];
+std::vector<uint8_t> cachedDynamicMeshes;  // Dynamic flags the static depth was rendered with
+
+// Per update scratch, kept across frames so steady state updates do not allocate
+std::vector<Aabb> lightBounds;
+std::vector<unsigned int> casters;
+
+void invalidateCascades() {
+    for (auto& cache : cascadeCache) {
+        cache.valid = false;
+    }
+}
+
+bool attachDepth(GLuint framebuffer, GLuint texture, int width, int height) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,
+                 nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Shadow map framebuffer incomplete (0x" << std::hex << status << std::dec << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool allocateAtlas(int resolution, int cascades) {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    resolution = std::min(resolution, maxSize / cascades);
+
+    if (!attachDepth(shadowFramebuffer, shadowTexture, resolution * cascades, resolution) ||
+        !attachDepth(staticFramebuffer, staticTexture, resolution * cascades, resolution)) {
+        return false;
+    }
+
+    allocatedResolution = resolution;
+    allocatedCascades = cascades;
+    frameData.atlasTexelSize[0] = 1.0f / (resolution * cascades);
+    frameData.atlasTexelSize[1] = 1.0f / resolution;
+    invalidateCascades();
+    return true;
+}
+
+float area(const Aabb& box) {
+    return (box.max.x - box.min.x) * (box.max.y - box.min.y);
+}
+
+bool containsXY(const Aabb& outer, const Aabb& inner) {
+    return inner.min.x >= outer.min.x && inner.max.x <= outer.max.x &&
+           inner.min.y >= outer.min.y && inner.max.y <= outer.max.y;
+}
+
+bool overlapsXY(const Aabb& a, const Aabb& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y;
+}
+
+// Receivers outside every cascade map here and read as lit
+Mat4 outsideShadowMatrix() {
+    Mat4 r;
+    for (float& v : r.m) v = 0.0f;
+    r.m[12] = -2.0f;
+    r.m[13] = -2.0f;
+    r.m[15] = 1.0f;
+    return r;
+}
+
+} // namespace
+
+bool initShadowMaps() {
+    glGenFramebuffers(1, &shadowFramebuffer);
+    glGenFramebuffers(1, &staticFramebuffer);
+    glGenTextures(1, &shadowTexture);
+    glGenTextures(1, &staticTexture);
+    glBindTexture(GL_TEXTURE_2D, shadowTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    // Only ever copied from
+    glBindTexture(GL_TEXTURE_2D, staticTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    shadowsAvailable = shadowFramebuffer != 0 && shadowTexture != 0 && staticFramebuffer != 0 && staticTexture != 0;
+    frameData.depthTexture = shadowTexture;
+    return shadowsAvailable;
+}
+
+void shutdownShadowMaps() {
+    if (shadowFramebuffer) glDeleteFramebuffers(1, &shadowFramebuffer);
+    if (staticFramebuffer) glDeleteFramebuffers(1, &staticFramebuffer);
+    if (shadowTexture) glDeleteTextures(1, &shadowTexture);
+    if (staticTexture) glDeleteTextures(1, &staticTexture);
+    shadowFramebuffer = staticFramebuffer = shadowTexture = staticTexture = 0;
+    shadowsAvailable = false;
+    frameValid = false;
+}
+
+void updateShadowMaps(const ShadowSettings& settings, const Vec3& lightDirection, const ShadowCamera& camera,
+                      const std::vector<Aabb>& meshBounds, const std::vector<uint8_t>& dynamicMeshes,
+                      uint64_t staticRevision, const ShadowCasterCallback& drawCasters) {
+    frameValid = false;
+    renderedLastUpdate = 0;
+    if (!shadowsAvailable) {
+        return;
+    }
+
+    const int cascades = std::clamp(settings.cascadeCount, 1, kMaxShadowCascades);
+    if (settings.resolution != allocatedResolution || cascades != allocatedCascades) {
+        if (!allocateAtlas(std::max(settings.resolution, 64), cascades)) {
+            shadowsAvailable = false;
+            return;
+        }
+        // allocateAtlas may clamp; remember the requested value so we don't reallocate every frame
+        allocatedResolution = settings.resolution;
+    }
+    const int resolution = static_cast<int>(1.0f / frameData.atlasTexelSize[1] + 0.5f);
+
+    // A mesh turning static or dynamic moves its depth between the atlases
+    if (dynamicMeshes != cachedDynamicMeshes) {
+        cachedDynamicMeshes = dynamicMeshes;
+        invalidateCascades();
+    }
+    auto isDynamic = [&dynamicMeshes](size_t mesh) { return mesh < dynamicMeshes.size() && dynamicMeshes[mesh]; };
+
+    // Tighten the depth range to the visible receivers
+    float minDepth = camera.farPlane, maxDepth = camera.nearPlane;
+    for (const Aabb& bounds : meshBounds) {
+        if (bounds.empty()) continue;
+        Aabb eyeBounds = transformAabb(camera.view, bounds);
+        float nearDepth = -eyeBounds.max.z, farDepth = -eyeBounds.min.z;
+        if (farDepth < camera.nearPlane || nearDepth > camera.farPlane) continue;
+        minDepth = std::min(minDepth, std::max(nearDepth, camera.nearPlane));
+        maxDepth = std::max(maxDepth, std::min(farDepth, camera.farPlane));
+    }
+    if (minDepth >= maxDepth) {
+        return;
+    }
+
+    // Practical split scheme between uniform and logarithmic distribution
+    float splits[kMaxShadowCascades + 1];
+    splits[0] = minDepth;
+    for (int i = 1; i <= cascades; ++i) {
+        float t = static_cast<float>(i) / cascades;
+        float logSplit = minDepth * std::pow(maxDepth / minDepth, t);
+        float uniformSplit = minDepth + (maxDepth - minDepth) * t;
+        splits[i] = settings.splitLambda * logSplit + (1.0f - settings.splitLambda) * uniformSplit;
+    }
+
+    const Vec3 dir = normalize(lightDirection);
+    const Vec3 up = std::fabs(dir.y) > 0.99f ? Vec3(1.0f, 0.0f, 0.0f) : Vec3(0.0f, 1.0f, 0.0f);
+    const Mat4 lightView = makeLookAt(dir, Vec3(0.0f, 0.0f, 0.0f), up);
+    const Mat4 eyeToWorld = inverse(camera.view);
+    const Mat4 eyeToLight = lightView * eyeToWorld;
+
+    lightBounds.resize(meshBounds.size());
+    for (size_t i = 0; i < meshBounds.size(); ++i) {
+        lightBounds[i] = transformAabb(lightView, meshBounds[i]);
+    }
+
+    const float tanHalfFov = std::tan(camera.fovY * 0.5f * static_cast<float>(M_PI) / 180.0f);
+    bool framebufferBound = false;
+
+    for (int c = 0; c < cascades; ++c) {
+        frameData.splitDepths[c] = splits[c + 1];
+
+        // Light space bounds of this frustum slice
+        Aabb slice;
+        for (int corner = 0; corner < 8; ++corner) {
+            float depth = (corner & 4) ? splits[c + 1] : splits[c];
+            float halfHeight = depth * tanHalfFov, halfWidth = halfHeight * camera.aspect;
+            Vec3 eyePoint((corner & 1) ? halfWidth : -halfWidth, (corner & 2) ? halfHeight : -halfHeight, -depth);
+            slice.expand(transformPoint(eyeToLight, eyePoint));
+        }
+
+        // Fit to the receivers inside the slice, then extend toward the light for casters
+        Aabb receivers;
+        for (const Aabb& bounds : lightBounds) {
+            if (!bounds.empty() && overlaps(bounds, slice)) receivers.expand(bounds);
+        }
+        if (receivers.empty()) {
+            frameData.eyeToShadow[c] = outsideShadowMatrix();
+            continue;
+        }
+        Aabb needed;
+        needed.min = Vec3(std::max(slice.min.x, receivers.min.x), std::max(slice.min.y, receivers.min.y), receivers.min.z);
+        needed.max = Vec3(std::min(slice.max.x, receivers.max.x), std::min(slice.max.y, receivers.max.y), receivers.max.z);
+        for (const Aabb& bounds : lightBounds) {
+            if (!bounds.empty() && overlapsXY(bounds, needed)) needed.max.z = std::max(needed.max.z, bounds.max.z);
+        }
+
+        CascadeCache& cache = cascadeCache[c];
+        bool reusable = cache.valid && cache.staticRevision == staticRevision &&
+                        dot(cache.lightDirection, dir) > 0.99999f &&
+                        containsXY(cache.bounds, needed) &&
+                        needed.min.z >= cache.bounds.min.z && needed.max.z <= cache.bounds.max.z &&
+                        area(needed) >= 0.5f * area(cache.bounds);
+
+        auto bindSlot = [&](GLuint framebuffer) {
+            if (!framebufferBound) {
+                glPushAttrib(GL_VIEWPORT_BIT | GL_SCISSOR_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT |
+                             GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glDisable(GL_LIGHTING);
+                glDisable(GL_TEXTURE_2D);
+                glDisable(GL_CULL_FACE);
+                glEnable(GL_DEPTH_TEST);
+                glDepthMask(GL_TRUE);
+                glEnable(GL_SCISSOR_TEST);
+                glEnable(GL_POLYGON_OFFSET_FILL);
+                glPolygonOffset(2.0f, 4.0f);
+                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                glMatrixMode(GL_PROJECTION);
+                glPushMatrix();
+                glMatrixMode(GL_MODELVIEW);
+                glPushMatrix();
+                framebufferBound = true;
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glViewport(c * resolution, 0, resolution, resolution);
+            glScissor(c * resolution, 0, resolution, resolution);
+            glMatrixMode(GL_PROJECTION);
+            glLoadMatrixf(cache.projection.m);
+            glMatrixMode(GL_MODELVIEW);
+            glLoadMatrixf(lightView.m);
+        };
+        // Meshes of one kind whose bounds reach into the slot
+        auto collectCasters = [&](bool dynamic) {
+            casters.clear();
+            for (size_t i = 0; i < lightBounds.size(); ++i) {
+                if (isDynamic(i) == dynamic && !lightBounds[i].empty() && overlapsXY(lightBounds[i], cache.bounds) &&
+                    lightBounds[i].max.z >= cache.bounds.min.z) {
+                    casters.push_back(static_cast<unsigned int>(i));
+                }
+            }
+        };
+
+        bool staticRendered = false;
+        if (!reusable) {
+            // Pad so small camera moves keep hitting the cache
+            Aabb padded = needed;
+            Vec3 margin((needed.max.x - needed.min.x) * 0.1f, (needed.max.y - needed.min.y) * 0.1f,
+                        (needed.max.z - needed.min.z) * 0.01f + 0.01f);
+            padded.min = needed.min - margin;
+            padded.max = needed.max + margin;
+            cache.projection = makeOrtho(padded.min.x, padded.max.x, padded.min.y, padded.max.y,
+                                         -padded.max.z, -padded.min.z);
+            cache.valid = true;
+            cache.staticRevision = staticRevision;
+            cache.lightDirection = dir;
+            cache.bounds = padded;
+
+            bindSlot(staticFramebuffer);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            collectCasters(false);
+            drawCasters(casters);
+            staticRendered = true;
+            ++renderedLastUpdate;
+        }
+
+        // The sampled slot is the static depth with this frame's dynamic casters on top
+        collectCasters(true);
+        if (staticRendered || cache.dynamicDrawn || !casters.empty()) {
+            bindSlot(shadowFramebuffer);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFramebuffer);
+            glBlitFramebuffer(c * resolution, 0, (c + 1) * resolution, resolution, c * resolution, 0,
+                              (c + 1) * resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, shadowFramebuffer);
+            drawCasters(casters);
+            cache.dynamicDrawn = !casters.empty();
+        }
+
+        // Clip space to this cascade's region of the atlas
+        Mat4 bias;
+        bias.m[0] = 0.5f / cascades;
+        bias.m[5] = 0.5f;
+        bias.m[10] = 0.5f;
+        bias.m[12] = (0.5f + c) / cascades;
+        bias.m[13] = 0.5f;
+        bias.m[14] = 0.5f;
+        frameData.eyeToShadow[c] = bias * cache.projection * eyeToLight;
+    }
+
+    if (framebufferBound) {
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPopMatrix();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glPopAttrib();
+    }
+
+    frameData.cascadeCount = cascades;
+    frameValid = true;
+}
+
+const ShadowFrameData* currentShadowFrame() {
+    return frameValid ? &frameData : nullptr;
+}
+
+void disableShadowFrame() {
+    frameValid = false;
+}
+
+int shadowCascadesRendered() {
+    return renderedLastUpdate;
+}
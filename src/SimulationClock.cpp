@@ -0,0 +1,41 @@
+#include "SimulationClock.h"
+#include <chrono>
+
+SimulationClock::SimulationClock(double stepSeconds, int maxStepsPerFrame)
+    : step(stepSeconds), maxSteps(maxStepsPerFrame) {
+}
+
+double SimulationClock::now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+int SimulationClock::advance() {
+    return advance(now());
+}
+
+int SimulationClock::advance(double nowSeconds) {
+    if (lastTime < 0.0) {
+        lastTime = nowSeconds;
+        return 0;
+    }
+    accumulator += nowSeconds - lastTime;
+    lastTime = nowSeconds;
+
+    int count = static_cast<int>(accumulator / step);
+    if (count > maxSteps) {
+        // Too far behind (debugger, window drag): drop the backlog instead of spiralling
+        count = maxSteps;
+        accumulator = 0.0;
+    } else {
+        accumulator -= count * step;
+    }
+    simulated += count * step;
+    steps += count;
+    return count;
+}
+
+void SimulationClock::reset() {
+    accumulator = 0.0;
+    lastTime = -1.0;
+}
@@ -0,0 +1,430 @@
+#include "SkeletalAnimation.h"
+#include "JobSystem.h"
+#include "SceneQueries.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// Rotation part of an orthonormal matrix (Shepperd: divide by the largest diagonal term)
+Quat quatFromRotation(const float r[9]) {
+    // r is column-major 3x3: r[col * 3 + row]
+    float m00 = r[0], m11 = r[4], m22 = r[8];
+    float trace = m00 + m11 + m22;
+    Quat q;
+    if (trace > 0.0f) {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        q = Quat((r[5] - r[7]) / s, (r[6] - r[2]) / s, (r[1] - r[3]) / s, 0.25f * s);
+    } else if (m00 > m11 && m00 > m22) {
+        float s = std::sqrt(1.0f + m00 - m11 - m22) * 2.0f;
+        q = Quat(0.25f * s, (r[3] + r[1]) / s, (r[6] + r[2]) / s, (r[5] - r[7]) / s);
+    } else if (m11 > m22) {
+        float s = std::sqrt(1.0f + m11 - m00 - m22) * 2.0f;
+        q = Quat((r[3] + r[1]) / s, 0.25f * s, (r[7] + r[5]) / s, (r[6] - r[2]) / s);
+    } else {
+        float s = std::sqrt(1.0f + m22 - m00 - m11) * 2.0f;
+        q = Quat((r[6] + r[2]) / s, (r[7] + r[5]) / s, 0.25f * s, (r[1] - r[3]) / s);
+    }
+    return normalize(q);
+}
+
+// Translation, rotation and scale of an affine matrix without shear
+void decompose(const Mat4& m, Vec3& translation, Quat& rotation, Vec3& scale) {
+    translation = Vec3(m.m[12], m.m[13], m.m[14]);
+    Vec3 x(m.m[0], m.m[1], m.m[2]), y(m.m[4], m.m[5], m.m[6]), z(m.m[8], m.m[9], m.m[10]);
+    scale = Vec3(length(x), length(y), length(z));
+    if (dot(cross(x, y), z) < 0.0f) {
+        scale.x = -scale.x;  // Mirrored: fold the reflection into one axis
+    }
+    float r[9];
+    for (int i = 0; i < 3; ++i) {
+        r[i] = scale.x != 0.0f ? x[i] / scale.x : 0.0f;
+        r[3 + i] = scale.y != 0.0f ? y[i] / scale.y : 0.0f;
+        r[6 + i] = scale.z != 0.0f ? z[i] / scale.z : 0.0f;
+    }
+    rotation = quatFromRotation(r);
+}
+
+// translate(t) * rotate(q) * scale(s)
+Mat4 compose(const Vec3& translation, const Quat& rotation, const Vec3& scale) {
+    Mat4 r = makeRotation(rotation);
+    for (int i = 0; i < 3; ++i) {
+        r.m[i] *= scale.x;
+        r.m[4 + i] *= scale.y;
+        r.m[8 + i] *= scale.z;
+    }
+    r.m[12] = translation.x;
+    r.m[13] = translation.y;
+    r.m[14] = translation.z;
+    return r;
+}
+
+// Index of the key at or before t and the fraction towards the next one
+size_t findKey(const std::vector<float>& times, float t, float& fraction) {
+    fraction = 0.0f;
+    if (times.size() < 2 || t <= times.front()) {
+        return 0;
+    }
+    if (t >= times.back()) {
+        return times.size() - 1;
+    }
+    size_t next = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+    float span = times[next] - times[next - 1];
+    fraction = span > 0.0f ? (t - times[next - 1]) / span : 0.0f;
+    return next - 1;
+}
+
+Vec3 lerp(const Vec3& a, const Vec3& b, float t) {
+    return a + (b - a) * t;
+}
+
+// Ticks per second when the file leaves it unspecified (assimp's convention)
+const double kDefaultTicksPerSecond = 25.0;
+
+} // namespace
+
+void blendPoses(const Pose& a, const Pose& b, float weight, Pose& out) {
+    size_t count = std::min(a.translations.size(), b.translations.size());
+    out.translations.resize(count);
+    out.rotations.resize(count);
+    out.scales.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        out.translations[i] = lerp(a.translations[i], b.translations[i], weight);
+        out.rotations[i] = slerp(a.rotations[i], b.rotations[i], weight);
+        out.scales[i] = lerp(a.scales[i], b.scales[i], weight);
+    }
+}
+
+void SkeletalAnimation::clear() {
+    clips.clear();
+    animatedNodes.clear();
+    rest = Pose();
+    skins.clear();
+    skinOfMesh.clear();
+    sourceScene = nullptr;
+    skinnedPool.clear();
+}
+
+void SkeletalAnimation::build(const aiScene* scene, const TransformHierarchy& hierarchy) {
+    clear();
+    if (!scene) {
+        return;
+    }
+    sourceScene = scene;
+
+    size_t nodeCount = hierarchy.size();
+    rest.translations.resize(nodeCount);
+    rest.rotations.resize(nodeCount);
+    rest.scales.resize(nodeCount);
+    std::unordered_map<std::string, uint32_t> nodeByName;
+    for (size_t i = 0; i < nodeCount; ++i) {
+        decompose(hierarchy.local(i), rest.translations[i], rest.rotations[i], rest.scales[i]);
+        nodeByName.emplace(hierarchy.node(i)->mName.C_Str(), static_cast<uint32_t>(i));
+    }
+
+    std::vector<uint8_t> animated(nodeCount, 0);
+    for (unsigned int a = 0; a < scene->mNumAnimations; ++a) {
+        const aiAnimation* animation = scene->mAnimations[a];
+        double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : kDefaultTicksPerSecond;
+        Clip clip;
+        clip.name = animation->mName.length ? animation->mName.C_Str() : "Clip " + std::to_string(a);
+        clip.duration = animation->mDuration / ticksPerSecond;
+        for (unsigned int c = 0; c < animation->mNumChannels; ++c) {
+            const aiNodeAnim* source = animation->mChannels[c];
+            auto node = nodeByName.find(source->mNodeName.C_Str());
+            if (node == nodeByName.end()) {
+                continue;
+            }
+            Channel channel;
+            channel.node = node->second;
+            for (unsigned int k = 0; k < source->mNumPositionKeys; ++k) {
+                const aiVectorKey& key = source->mPositionKeys[k];
+                channel.positions.times.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                channel.positions.values.push_back(Vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            for (unsigned int k = 0; k < source->mNumRotationKeys; ++k) {
+                const aiQuatKey& key = source->mRotationKeys[k];
+                channel.rotationTimes.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                channel.rotations.push_back(normalize(Quat(key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w)));
+            }
+            for (unsigned int k = 0; k < source->mNumScalingKeys; ++k) {
+                const aiVectorKey& key = source->mScalingKeys[k];
+                channel.scales.times.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                channel.scales.values.push_back(Vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            animated[channel.node] = 1;
+            clip.channels.push_back(std::move(channel));
+        }
+        clips.push_back(std::move(clip));
+    }
+    for (size_t i = 0; i < nodeCount; ++i) {
+        if (animated[i]) {
+            animatedNodes.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    skinOfMesh.assign(scene->mNumMeshes, -1);
+    for (unsigned int mesh = 0; mesh < scene->mNumMeshes; ++mesh) {
+        if (scene->mMeshes[mesh]->mNumBones > 0) {
+            buildSkin(scene, mesh, hierarchy, nodeByName);
+        }
+    }
+    updatePalettes(hierarchy);
+}
+
+void SkeletalAnimation::buildSkin(const aiScene* scene, unsigned int mesh, const TransformHierarchy& hierarchy,
+                                  const std::unordered_map<std::string, uint32_t>& nodeByName) {
+    const aiMesh* source = scene->mMeshes[mesh];
+    int node = hierarchy.meshNode(mesh);
+    if (node < 0 || source->mNumBones >= 0xffff) {
+        return;
+    }
+    Skin skin;
+    skin.mesh = mesh;
+    skin.node = node;
+    unsigned int boneCount = source->mNumBones;
+    skin.joints.assign(static_cast<size_t>(source->mNumVertices) * kMaxInfluences, 0);
+    skin.weights.assign(static_cast<size_t>(source->mNumVertices) * kMaxInfluences, 0.0f);
+    for (unsigned int b = 0; b < boneCount; ++b) {
+        const aiBone* bone = source->mBones[b];
+        auto boneNode = nodeByName.find(bone->mName.C_Str());
+        skin.boneNodes.push_back(boneNode != nodeByName.end() ? static_cast<int>(boneNode->second) : -1);
+        skin.offsets.push_back(toMat4(bone->mOffsetMatrix));
+        // Keep the strongest influences; a weaker one replaces the weakest kept slot
+        for (unsigned int w = 0; w < bone->mNumWeights; ++w) {
+            const aiVertexWeight& weight = bone->mWeights[w];
+            if (weight.mVertexId >= source->mNumVertices || weight.mWeight <= 0.0f) {
+                continue;
+            }
+            float* weights = &skin.weights[static_cast<size_t>(weight.mVertexId) * kMaxInfluences];
+            uint16_t* joints = &skin.joints[static_cast<size_t>(weight.mVertexId) * kMaxInfluences];
+            int weakest = static_cast<int>(std::min_element(weights, weights + kMaxInfluences) - weights);
+            if (weight.mWeight > weights[weakest]) {
+                weights[weakest] = weight.mWeight;
+                joints[weakest] = static_cast<uint16_t>(b);
+            }
+        }
+    }
+
+    // Normalize; vertices no bone moves follow the identity entry after the bones
+    skin.boneBounds.resize(boneCount + 1);
+    for (unsigned int v = 0; v < source->mNumVertices; ++v) {
+        float* weights = &skin.weights[static_cast<size_t>(v) * kMaxInfluences];
+        uint16_t* joints = &skin.joints[static_cast<size_t>(v) * kMaxInfluences];
+        float sum = 0.0f;
+        for (int k = 0; k < kMaxInfluences; ++k) {
+            sum += weights[k];
+        }
+        if (sum <= 0.0f) {
+            weights[0] = 1.0f;
+            joints[0] = static_cast<uint16_t>(boneCount);
+            sum = 1.0f;
+        }
+        Vec3 position(source->mVertices[v].x, source->mVertices[v].y, source->mVertices[v].z);
+        for (int k = 0; k < kMaxInfluences; ++k) {
+            weights[k] /= sum;
+            if (weights[k] > 0.0f) {
+                skin.boneBounds[joints[k]].expand(position);
+            }
+        }
+    }
+    skin.palette.resize(boneCount + 1);
+    skinOfMesh[mesh] = static_cast<int>(skins.size());
+    skins.push_back(std::move(skin));
+}
+
+void SkeletalAnimation::sample(size_t clip, double seconds, Pose& out) const {
+    out.translations = rest.translations;
+    out.rotations = rest.rotations;
+    out.scales = rest.scales;
+    if (clip >= clips.size()) {
+        return;
+    }
+    const Clip& source = clips[clip];
+    double time = 0.0;
+    if (source.duration > 0.0) {
+        time = std::fmod(seconds, source.duration);
+        if (time < 0.0) {
+            time += source.duration;
+        }
+    }
+    float t = static_cast<float>(time);
+    float fraction;
+    for (const Channel& channel : source.channels) {
+        if (!channel.positions.values.empty()) {
+            size_t k = findKey(channel.positions.times, t, fraction);
+            const std::vector<Vec3>& values = channel.positions.values;
+            out.translations[channel.node] = fraction > 0.0f ? lerp(values[k], values[k + 1], fraction) : values[k];
+        }
+        if (!channel.rotations.empty()) {
+            size_t k = findKey(channel.rotationTimes, t, fraction);
+            const std::vector<Quat>& values = channel.rotations;
+            out.rotations[channel.node] = fraction > 0.0f ? slerp(values[k], values[k + 1], fraction) : values[k];
+        }
+        if (!channel.scales.values.empty()) {
+            size_t k = findKey(channel.scales.times, t, fraction);
+            const std::vector<Vec3>& values = channel.scales.values;
+            out.scales[channel.node] = fraction > 0.0f ? lerp(values[k], values[k + 1], fraction) : values[k];
+        }
+    }
+}
+
+void SkeletalAnimation::apply(const Pose& pose, TransformHierarchy& hierarchy) const {
+    for (uint32_t node : animatedNodes) {
+        if (node < pose.translations.size() && node < hierarchy.size()) {
+            hierarchy.setLocal(node, compose(pose.translations[node], pose.rotations[node], pose.scales[node]));
+        }
+    }
+}
+
+void SkeletalAnimation::updatePalettes(const TransformHierarchy& hierarchy) {
+    for (Skin& skin : skins) {
+        Mat4 toMesh = inverse(hierarchy.world(skin.node));
+        for (size_t b = 0; b < skin.boneNodes.size(); ++b) {
+            int bone = skin.boneNodes[b];
+            skin.palette[b] = bone >= 0 ? toMesh * hierarchy.world(bone) * skin.offsets[b] : Mat4();
+        }
+        skin.palette.back() = Mat4();
+    }
+}
+
+std::span<const Mat4> SkeletalAnimation::palette(unsigned int mesh) const {
+    if (!isSkinned(mesh)) {
+        return {};
+    }
+    return skins[skinOfMesh[mesh]].palette;
+}
+
+const uint16_t* SkeletalAnimation::boneIndices(unsigned int mesh) const {
+    return isSkinned(mesh) ? skins[skinOfMesh[mesh]].joints.data() : nullptr;
+}
+
+const float* SkeletalAnimation::boneWeights(unsigned int mesh) const {
+    return isSkinned(mesh) ? skins[skinOfMesh[mesh]].weights.data() : nullptr;
+}
+
+namespace {
+
+// Linear blend skinning of one mesh. The blended matrix is built column by column from the
+// weighted palette entries, then applied to the position and normal, four lanes at a time.
+void skinMesh(const aiMesh* mesh, const Mat4* palette, const uint16_t* joints, const float* weights,
+              aiVector3D* positions, aiVector3D* normals, Aabb& bounds) {
+    const int influences = SkeletalAnimation::kMaxInfluences;
+    Float4 lo = splat4(FLT_MAX), hi = splat4(-FLT_MAX);
+    float lane[4];
+    for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+        const uint16_t* joint = joints + static_cast<size_t>(v) * influences;
+        const float* weight = weights + static_cast<size_t>(v) * influences;
+        const float* m = palette[joint[0]].m;
+        Float4 w = splat4(weight[0]);
+        Float4 c0 = mul4(load4(m), w), c1 = mul4(load4(m + 4), w);
+        Float4 c2 = mul4(load4(m + 8), w), c3 = mul4(load4(m + 12), w);
+        for (int k = 1; k < influences; ++k) {
+            if (weight[k] == 0.0f) {
+                break;  // Influences are kept in slots from the front, see buildSkin
+            }
+            m = palette[joint[k]].m;
+            w = splat4(weight[k]);
+            c0 = madd4(load4(m), w, c0);
+            c1 = madd4(load4(m + 4), w, c1);
+            c2 = madd4(load4(m + 8), w, c2);
+            c3 = madd4(load4(m + 12), w, c3);
+        }
+
+        const aiVector3D& p = mesh->mVertices[v];
+        Float4 position = madd4(c0, splat4(p.x), c3);
+        position = madd4(c1, splat4(p.y), position);
+        position = madd4(c2, splat4(p.z), position);
+        lo = min4(lo, position);
+        hi = max4(hi, position);
+        store4(lane, position);
+        positions[v] = aiVector3D(lane[0], lane[1], lane[2]);
+
+        if (normals) {
+            const aiVector3D& n = mesh->mNormals[v];
+            Float4 normal = mul4(c0, splat4(n.x));
+            normal = madd4(c1, splat4(n.y), normal);
+            normal = madd4(c2, splat4(n.z), normal);
+            store4(lane, normal);
+            float len = std::sqrt(lane[0] * lane[0] + lane[1] * lane[1] + lane[2] * lane[2]);
+            float inv = len > 0.0f ? 1.0f / len : 0.0f;
+            normals[v] = aiVector3D(lane[0] * inv, lane[1] * inv, lane[2] * inv);
+        }
+    }
+    bounds = Aabb();
+    if (mesh->mNumVertices > 0) {
+        store4(lane, lo);
+        bounds.min = Vec3(lane[0], lane[1], lane[2]);
+        store4(lane, hi);
+        bounds.max = Vec3(lane[0], lane[1], lane[2]);
+    }
+}
+
+} // namespace
+
+std::shared_ptr<const SkinnedVertices> SkeletalAnimation::skin(JobSystem* jobs, size_t gpuPaletteLimit) {
+    std::shared_ptr<SkinnedVertices> out;
+    for (const std::shared_ptr<SkinnedVertices>& candidate : skinnedPool) {
+        if (candidate.use_count() == 1) {
+            // Pairs with the release of the last other owner
+            std::atomic_thread_fence(std::memory_order_acquire);
+            out = candidate;
+            break;
+        }
+    }
+    if (!out) {
+        out = std::make_shared<SkinnedVertices>();
+        skinnedPool.push_back(out);
+    }
+
+    size_t meshCount = skinOfMesh.size();
+    out->positions.resize(meshCount);
+    out->normals.resize(meshCount);
+    out->bounds.assign(meshCount, Aabb());
+    for (size_t mesh = 0; mesh < meshCount; ++mesh) {
+        if (!isSkinned(static_cast<unsigned int>(mesh))) {
+            out->positions[mesh].clear();
+            out->normals[mesh].clear();
+        }
+    }
+
+    SkinnedVertices& target = *out;
+    auto skinRange = [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            const Skin& skin = skins[s];
+            const aiMesh* mesh = sourceScene->mMeshes[skin.mesh];
+            std::vector<aiVector3D>& positions = target.positions[skin.mesh];
+            std::vector<aiVector3D>& normals = target.normals[skin.mesh];
+            if (skin.palette.size() <= gpuPaletteLimit) {
+                positions.clear();
+                normals.clear();
+                continue;
+            }
+            positions.resize(mesh->mNumVertices);
+            normals.resize(mesh->mNormals ? mesh->mNumVertices : 0);
+            skinMesh(mesh, skin.palette.data(), skin.joints.data(), skin.weights.data(), positions.data(),
+                     mesh->mNormals ? normals.data() : nullptr, target.bounds[skin.mesh]);
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(skins.size(), 1, skinRange);
+    } else {
+        skinRange(0, skins.size());
+    }
+    return out;
+}
+
+Aabb SkeletalAnimation::paletteBounds(unsigned int mesh) const {
+    Aabb bounds;
+    if (!isSkinned(mesh)) {
+        return bounds;
+    }
+    const Skin& skin = skins[skinOfMesh[mesh]];
+    for (size_t b = 0; b < skin.palette.size(); ++b) {
+        bounds.expand(transformAabb(skin.palette[b], skin.boneBounds[b]));
+    }
+    return bounds;
+}
@@ -0,0 +1,458 @@
+#include "SoftwareRasterizer.h"
+#include "TraceRecorder.h"
+#include <GL/gl.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE 1
+#endif
+
+namespace {
+
+const float kInvalidDepth = 1.0f;  // Cleared depth, same as glClearDepth(1)
+
+// OpenGL fixed-function lighting: GL_COLOR_MATERIAL ambient and diffuse, infinite viewer,
+// one-sided, no attenuation. The result is clamped like the GL primary color.
+void shade(const RenderFrame& frame, const float eye[3], const float normalIn[3], const float material[3],
+           float out[3]) {
+    Vec3 n = normalize(Vec3(normalIn[0], normalIn[1], normalIn[2]));
+    Vec3 position(eye[0], eye[1], eye[2]);
+    for (int c = 0; c < 3; ++c) {
+        out[c] = frame.globalAmbient[c] * material[c];
+    }
+    for (int i = 0; i < frame.lightCount; ++i) {
+        const RenderLight& light = frame.lights[i];
+        Vec3 l(light.position[0], light.position[1], light.position[2]);
+        if (light.position[3] != 0.0f) {
+            l = l * (1.0f / light.position[3]) - position;
+        }
+        l = normalize(l);
+        float diffuse = std::max(dot(n, l), 0.0f);
+        float specular = 0.0f;
+        if (diffuse > 0.0f) {
+            Vec3 h = normalize(l + Vec3(0.0f, 0.0f, 1.0f));
+            float nh = std::max(dot(n, h), 0.0f);
+            specular = frame.shininess > 0.0f ? std::pow(nh, frame.shininess) : 1.0f;
+        }
+        for (int c = 0; c < 3; ++c) {
+            out[c] += light.ambient[c] * material[c] + diffuse * light.diffuse[c] * material[c] +
+                      specular * light.specular[c] * frame.specular[c];
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        out[c] = std::min(std::max(out[c], 0.0f), 1.0f);
+    }
+}
+
+uint32_t packColor(const float rgb[3]) {
+    uint32_t r = static_cast<uint32_t>(rgb[0] * 255.0f + 0.5f);
+    uint32_t g = static_cast<uint32_t>(rgb[1] * 255.0f + 0.5f);
+    uint32_t b = static_cast<uint32_t>(rgb[2] * 255.0f + 0.5f);
+    return r | (g << 8) | (b << 16) | 0xFF000000u;
+}
+
+// Edge function w(p) = dx * (py - y0) - dy * (px - x0) for the directed edge p0 -> p1
+struct Edge {
+    float stepX, stepY, offset;
+    bool topLeft;
+
+    void setup(const SoftwareRasterizer::Vertex& p0, const SoftwareRasterizer::Vertex& p1) {
+        float dx = p1.x - p0.x, dy = p1.y - p0.y;
+        stepX = -dy;
+        stepY = dx;
+        offset = dy * p0.x - dx * p0.y;
+        // Counter-clockwise in a y-up window: top edges run left, left edges run down
+        topLeft = dy < 0.0f || (dy == 0.0f && dx < 0.0f);
+    }
+    float at(float x, float y) const { return stepX * x + stepY * y + offset; }
+};
+
+} // namespace
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+    }
+    // The calling thread acts as worker 0
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&SoftwareRasterizer::workerLoop, this, i);
+    }
+}
+
+SoftwareRasterizer::~SoftwareRasterizer() {
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void SoftwareRasterizer::beginFrame(const RenderFrame& newFrame) {
+    frame = newFrame;
+    if (frame.width != width || frame.height != height) {
+        width = std::max(frame.width, 1);
+        height = std::max(frame.height, 1);
+        color.assign(static_cast<size_t>(width) * height, 0);
+        depth.assign(static_cast<size_t>(width) * height, kInvalidDepth);
+        tilesX = (width + kTileSize - 1) / kTileSize;
+        tilesY = (height + kTileSize - 1) / kTileSize;
+        tileBins.assign(static_cast<size_t>(tilesX) * tilesY, {});
+    }
+    triangles.clear();
+    for (auto& bin : tileBins) {
+        bin.clear();
+    }
+}
+
+void SoftwareRasterizer::submit(const RenderMesh& item) {
+    TRACE_SCOPE("rasterSetup", "software");
+    const aiMesh* mesh = item.mesh;
+    const aiVector3D* positions = item.positions ? item.positions : mesh->mVertices;
+    const aiVector3D* normals = item.normals ? item.normals : mesh->mNormals;
+    const Mat4& modelView = item.modelView;
+    const float* p = frame.projection.m;
+
+    // Vertex stage once per vertex, faces then only gather
+    vertexClip.resize(mesh->mNumVertices * 4);
+    vertexAttributes.resize(mesh->mNumVertices * 9);
+    std::vector<float>& clip = vertexClip;
+    std::vector<float>& attributes = vertexAttributes;
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        const aiVector3D& v = positions[i];
+        Vec3 eye = transformPoint(modelView, Vec3(v.x, v.y, v.z));
+        Vec3 normal(0.0f, 0.0f, 1.0f);  // GL's current normal when the mesh has none
+        if (normals) {
+            normal = Vec3(normals[i].x, normals[i].y, normals[i].z);
+        }
+        normal = normalize(transformDirection(modelView, normal));
+
+        float* c = &clip[i * 4];
+        for (int r = 0; r < 4; ++r) {
+            c[r] = p[r] * eye.x + p[4 + r] * eye.y + p[8 + r] * eye.z + p[12 + r];
+        }
+
+        float* a = &attributes[i * 9];
+        const float eyeArray[3] = {eye.x, eye.y, eye.z};
+        const float normalArray[3] = {normal.x, normal.y, normal.z};
+        if (frame.perPixelLighting) {
+            std::memcpy(a, eyeArray, sizeof(eyeArray));
+            std::memcpy(a + 3, normalArray, sizeof(normalArray));
+            std::memcpy(a + 6, item.color, sizeof(item.color));
+        } else {
+            shade(frame, eyeArray, normalArray, item.color, a);
+        }
+    }
+
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        const aiFace& face = mesh->mFaces[f];
+        if (face.mNumIndices != 3) {
+            continue;
+        }
+        float faceClip[3][4];
+        float faceAttributes[3][9];
+        unsigned outside[6] = {};
+        for (int k = 0; k < 3; ++k) {
+            unsigned int index = face.mIndices[k];
+            std::memcpy(faceClip[k], &clip[index * 4], sizeof(faceClip[k]));
+            std::memcpy(faceAttributes[k], &attributes[index * 9], sizeof(faceAttributes[k]));
+            const float* c = faceClip[k];
+            outside[0] += c[0] < -c[3];
+            outside[1] += c[0] > c[3];
+            outside[2] += c[1] < -c[3];
+            outside[3] += c[1] > c[3];
+            outside[4] += c[2] < -c[3];
+            outside[5] += c[2] > c[3];
+        }
+        // Entirely beyond one frustum plane
+        if (std::find(std::begin(outside), std::end(outside), 3u) != std::end(outside)) {
+            continue;
+        }
+        emitClipped(faceClip, faceAttributes);
+    }
+}
+
+// Clips against the near plane (z >= -w) and hands the resulting fan to setupTriangle
+void SoftwareRasterizer::emitClipped(const float clip[3][4], const float attributes[3][9]) {
+    struct ClipVertex {
+        float c[4];
+        float a[9];
+    };
+    ClipVertex polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; ++i) {
+        int j = (i + 1) % 3;
+        float di = clip[i][2] + clip[i][3];
+        float dj = clip[j][2] + clip[j][3];
+        if (di >= 0.0f) {
+            std::memcpy(polygon[count].c, clip[i], sizeof(polygon[count].c));
+            std::memcpy(polygon[count].a, attributes[i], sizeof(polygon[count].a));
+            ++count;
+        }
+        if ((di >= 0.0f) != (dj >= 0.0f)) {
+            float t = di / (di - dj);
+            for (int k = 0; k < 4; ++k) polygon[count].c[k] = clip[i][k] + (clip[j][k] - clip[i][k]) * t;
+            for (int k = 0; k < 9; ++k) polygon[count].a[k] = attributes[i][k] + (attributes[j][k] - attributes[i][k]) * t;
+            ++count;
+        }
+    }
+    if (count < 3) {
+        return;
+    }
+
+    Vertex window[4];
+    for (int i = 0; i < count; ++i) {
+        const ClipVertex& v = polygon[i];
+        if (v.c[3] <= 1e-6f) {
+            return;  // Degenerate, only possible for points on the eye plane
+        }
+        float invW = 1.0f / v.c[3];
+        window[i].x = (v.c[0] * invW * 0.5f + 0.5f) * width;
+        window[i].y = (v.c[1] * invW * 0.5f + 0.5f) * height;
+        window[i].z = v.c[2] * invW * 0.5f + 0.5f;
+        window[i].invW = invW;
+        std::memcpy(window[i].attributes, v.a, sizeof(v.a));
+    }
+    for (int i = 1; i + 1 < count; ++i) {
+        setupTriangle(window[0], window[i], window[i + 1]);
+    }
+}
+
+void SoftwareRasterizer::setupTriangle(const Vertex& a, const Vertex& b, const Vertex& c) {
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::fabs(area) < 1e-8f) {
+        return;
+    }
+
+    Triangle triangle;
+    triangle.v[0] = a;
+    // No face culling (GL_CULL_FACE is off in the viewer); store everything counter-clockwise
+    triangle.v[1] = area > 0.0f ? b : c;
+    triangle.v[2] = area > 0.0f ? c : b;
+
+    float minX = std::min({a.x, b.x, c.x}), maxX = std::max({a.x, b.x, c.x});
+    float minY = std::min({a.y, b.y, c.y}), maxY = std::max({a.y, b.y, c.y});
+    triangle.minX = std::max(0, static_cast<int>(std::floor(minX - 0.5f)));
+    triangle.minY = std::max(0, static_cast<int>(std::floor(minY - 0.5f)));
+    triangle.maxX = std::min(width - 1, static_cast<int>(std::ceil(maxX - 0.5f)));
+    triangle.maxY = std::min(height - 1, static_cast<int>(std::ceil(maxY - 0.5f)));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+        return;
+    }
+
+    uint32_t index = static_cast<uint32_t>(triangles.size());
+    triangles.push_back(triangle);
+    for (int ty = triangle.minY / kTileSize; ty <= triangle.maxY / kTileSize; ++ty) {
+        for (int tx = triangle.minX / kTileSize; tx <= triangle.maxX / kTileSize; ++tx) {
+            tileBins[ty * tilesX + tx].push_back(index);
+        }
+    }
+}
+
+void SoftwareRasterizer::endFrame() {
+    TRACE_SCOPE("rasterTiles", "software");
+    trianglesRasterized = triangles.size();
+    nextTile.store(0, std::memory_order_relaxed);
+    const int tileCount = tilesX * tilesY;
+    runParallel([this, tileCount](unsigned) {
+        for (int tile = nextTile.fetch_add(1, std::memory_order_relaxed); tile < tileCount;
+             tile = nextTile.fetch_add(1, std::memory_order_relaxed)) {
+            rasterizeTile(tile);
+        }
+    });
+}
+
+void SoftwareRasterizer::rasterizeTile(int tileIndex) {
+    const int tileX0 = (tileIndex % tilesX) * kTileSize;
+    const int tileY0 = (tileIndex / tilesX) * kTileSize;
+    const int tileX1 = std::min(tileX0 + kTileSize, width) - 1;
+    const int tileY1 = std::min(tileY0 + kTileSize, height) - 1;
+
+    const uint32_t clearColor = packColor(frame.clearColor);
+    for (int y = tileY0; y <= tileY1; ++y) {
+        std::fill_n(&color[y * width + tileX0], tileX1 - tileX0 + 1, clearColor);
+        std::fill_n(&depth[y * width + tileX0], tileX1 - tileX0 + 1, kInvalidDepth);
+    }
+
+    const int attributeCount = frame.perPixelLighting ? 9 : 3;
+    for (uint32_t index : tileBins[tileIndex]) {
+        const Triangle& t = triangles[index];
+        const Vertex& v0 = t.v[0];
+        const Vertex& v1 = t.v[1];
+        const Vertex& v2 = t.v[2];
+        Edge e0, e1, e2;  // Opposite v0, v1, v2
+        e0.setup(v1, v2);
+        e1.setup(v2, v0);
+        e2.setup(v0, v1);
+        const float invArea = 1.0f / e0.at(v0.x, v0.y);
+
+        // Attributes pre-divided by w so the per-pixel interpolation is perspective correct
+        float attributes[3][9];
+        for (int k = 0; k < attributeCount; ++k) {
+            attributes[0][k] = v0.attributes[k] * v0.invW;
+            attributes[1][k] = v1.attributes[k] * v1.invW;
+            attributes[2][k] = v2.attributes[k] * v2.invW;
+        }
+
+        const int x0 = std::max(t.minX, tileX0), x1 = std::min(t.maxX, tileX1);
+        const int y0 = std::max(t.minY, tileY0), y1 = std::min(t.maxY, tileY1);
+
+#ifdef SOFTWARE_RASTERIZER_SSE
+        const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const Edge* edges[3] = {&e0, &e1, &e2};
+        __m128 stepX[3], topLeft[3];
+        for (int e = 0; e < 3; ++e) {
+            stepX[e] = _mm_set1_ps(edges[e]->stepX);
+            topLeft[e] = _mm_castsi128_ps(_mm_set1_epi32(edges[e]->topLeft ? -1 : 0));
+        }
+#endif
+
+        for (int y = y0; y <= y1; ++y) {
+            const float py = y + 0.5f;
+            for (int x = x0; x <= x1; x += 4) {
+                float w[3][4];
+                int covered;
+#ifdef SOFTWARE_RASTERIZER_SSE
+                __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int e = 0; e < 3; ++e) {
+                    __m128 rowBase = _mm_set1_ps(edges[e]->stepY * py + edges[e]->offset);
+                    __m128 value = _mm_add_ps(_mm_mul_ps(stepX[e], px), rowBase);
+                    __m128 pass = _mm_or_ps(_mm_cmpgt_ps(value, zero), _mm_and_ps(_mm_cmpeq_ps(value, zero), topLeft[e]));
+                    inside = _mm_and_ps(inside, pass);
+                    _mm_storeu_ps(w[e], value);
+                }
+                covered = _mm_movemask_ps(inside);
+#else
+                covered = 0;
+                const Edge* edges[3] = {&e0, &e1, &e2};
+                for (int lane = 0; lane < 4; ++lane) {
+                    bool in = true;
+                    for (int e = 0; e < 3; ++e) {
+                        w[e][lane] = edges[e]->at(x + lane + 0.5f, py);
+                        in = in && (w[e][lane] > 0.0f || (w[e][lane] == 0.0f && edges[e]->topLeft));
+                    }
+                    covered |= in ? 1 << lane : 0;
+                }
+#endif
+                if (x + 3 > x1) {
+                    covered &= (1 << (x1 - x + 1)) - 1;
+                }
+
+                for (; covered; covered &= covered - 1) {
+                    int lane = std::countr_zero(static_cast<unsigned>(covered));
+                    float b0 = w[0][lane] * invArea, b1 = w[1][lane] * invArea, b2 = w[2][lane] * invArea;
+                    float z = b0 * v0.z + b1 * v1.z + b2 * v2.z;
+                    size_t pixel = static_cast<size_t>(y) * width + x + lane;
+                    if (!(z < depth[pixel]) || z < 0.0f || z > 1.0f) {
+                        continue;
+                    }
+                    depth[pixel] = z;
+
+                    float invW = 1.0f / (b0 * v0.invW + b1 * v1.invW + b2 * v2.invW);
+                    float value[9];
+                    for (int k = 0; k < attributeCount; ++k) {
+                        value[k] = (b0 * attributes[0][k] + b1 * attributes[1][k] + b2 * attributes[2][k]) * invW;
+                    }
+                    if (frame.perPixelLighting) {
+                        float rgb[3];
+                        shade(frame, value, value + 3, value + 6, rgb);
+                        color[pixel] = packColor(rgb);
+                    } else {
+                        color[pixel] = packColor(value);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::present() {
+    presentColorBuffer(width, height, color.data());
+}
+
+void presentColorBuffer(int width, int height, const uint32_t* rgba) {
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_BLEND);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glViewport(0, 0, width, height);
+    glRasterPos2f(-1.0f, -1.0f);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glDrawPixels(width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+}
+
+void SoftwareRasterizer::readPixels(std::vector<uint8_t>& rgb) {
+    rgb.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* row = &color[static_cast<size_t>(height - 1 - y) * width];
+        uint8_t* out = &rgb[static_cast<size_t>(y) * width * 3];
+        for (int x = 0; x < width; ++x) {
+            out[x * 3] = static_cast<uint8_t>(row[x]);
+            out[x * 3 + 1] = static_cast<uint8_t>(row[x] >> 8);
+            out[x * 3 + 2] = static_cast<uint8_t>(row[x] >> 16);
+        }
+    }
+}
+
+void SoftwareRasterizer::runParallel(const std::function<void(unsigned)>& task) {
+    if (workers.empty()) {
+        task(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        currentTask = task;
+        pendingWorkers = static_cast<unsigned>(workers.size());
+        ++generation;
+    }
+    workReady.notify_all();
+    task(0);
+
+    std::unique_lock<std::mutex> lock(workMutex);
+    workDone.wait(lock, [this] { return pendingWorkers == 0; });
+}
+
+void SoftwareRasterizer::workerLoop(unsigned workerIndex) {
+    traceSetThreadName("rasterizer " + std::to_string(workerIndex));
+    uint64_t seenGeneration = 0;
+    for (;;) {
+        std::function<void(unsigned)> task;
+        {
+            std::unique_lock<std::mutex> lock(workMutex);
+            workReady.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+            task = currentTask;
+        }
+        task(workerIndex);
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            --pendingWorkers;
+        }
+        workDone.notify_one();
+    }
+}
@@ -0,0 +1,252 @@
+#include "SpatialHash.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+// Points per job
+const size_t kBuildGrain = 4096;
+const size_t kQueryGrain = 1024;
+
+// Cell coordinates keep their low 21 bits each in the key
+const int kKeyBits = 21;
+const int64_t kKeyMask = (int64_t(1) << kKeyBits) - 1;
+
+// Half of the 26 neighbouring cells, one of each opposite pair, so every pair of cells is
+// looked at from one side only
+const int kForward[13][3] = {{1, 0, 0},   {-1, 1, 0}, {0, 1, 0},  {1, 1, 0},  {-1, -1, 1}, {0, -1, 1}, {1, -1, 1},
+                             {-1, 0, 1}, {0, 0, 1},  {1, 0, 1},  {-1, 1, 1}, {0, 1, 1},   {1, 1, 1}};
+
+float squaredDistanceToBox(const Aabb& box, float x, float y, float z) {
+    float dx = std::max({box.min.x - x, 0.0f, x - box.max.x});
+    float dy = std::max({box.min.y - y, 0.0f, y - box.max.y});
+    float dz = std::max({box.min.z - z, 0.0f, z - box.max.z});
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// Runs body(begin, end, piece) over fixed ranges of grain items, each into its own list, and
+// concatenates the lists in range order
+template <typename Body>
+void collectInOrder(size_t count, size_t grain, JobSystem* jobs, std::vector<ProximityPair>& out, const Body& body) {
+    out.clear();
+    if (!jobs || count <= grain) {
+        body(0, count, out);
+        return;
+    }
+    size_t chunks = (count + grain - 1) / grain;
+    std::vector<std::vector<ProximityPair>> pieces(chunks);
+    jobs->parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            body(i * grain, std::min(count, (i + 1) * grain), pieces[i]);
+        }
+    });
+    for (const std::vector<ProximityPair>& piece : pieces) {
+        out.insert(out.end(), piece.begin(), piece.end());
+    }
+}
+
+} // namespace
+
+uint64_t SpatialHashGrid::cellKey(int64_t x, int64_t y, int64_t z) const {
+    return static_cast<uint64_t>(x & kKeyMask) | static_cast<uint64_t>(y & kKeyMask) << kKeyBits |
+           static_cast<uint64_t>(z & kKeyMask) << (2 * kKeyBits);
+}
+
+uint64_t SpatialHashGrid::cellKey(float x, float y, float z) const {
+    return cellKey(static_cast<int64_t>(std::floor(x * inverseCell)), static_cast<int64_t>(std::floor(y * inverseCell)),
+                   static_cast<int64_t>(std::floor(z * inverseCell)));
+}
+
+// Fibonacci hashing: the top bits of key times 2^64 / golden ratio
+uint32_t SpatialHashGrid::bucket(uint64_t key) const {
+    return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - bucketBits));
+}
+
+void SpatialHashGrid::build(const SwarmVectors& newPoints, size_t newCount, float cellSize, JobSystem* jobs) {
+    points = &newPoints;
+    count = newCount;
+    cell = std::max(cellSize, 1e-6f);
+    inverseCell = 1.0f / cell;
+    bucketBits = 1;
+    while ((size_t(1) << bucketBits) < 2 * count) {
+        ++bucketBits;
+    }
+    size_t buckets = size_t(1) << bucketBits;
+    bucketStarts.assign(buckets + 1, 0);
+    entries.resize(count);
+    entryKeys.resize(count);
+    pointBuckets.resize(count);
+    const float* xs = newPoints.x.data();
+    const float* ys = newPoints.y.data();
+    const float* zs = newPoints.z.data();
+
+    if (!jobs || count <= kBuildGrain) {
+        for (size_t i = 0; i < count; ++i) {
+            pointBuckets[i] = bucket(cellKey(xs[i], ys[i], zs[i]));
+            ++bucketStarts[pointBuckets[i] + 1];
+        }
+        for (size_t b = 0; b < buckets; ++b) {
+            bucketStarts[b + 1] += bucketStarts[b];
+        }
+        // Scatter in index order, advancing each start to the end of its bucket, then shift back
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t slot = bucketStarts[pointBuckets[i]]++;
+            entries[slot] = static_cast<uint32_t>(i);
+        }
+        std::copy_backward(bucketStarts.begin(), bucketStarts.end() - 1, bucketStarts.end());
+        bucketStarts[0] = 0;
+        for (size_t slot = 0; slot < count; ++slot) {
+            uint32_t i = entries[slot];
+            entryKeys[slot] = cellKey(xs[i], ys[i], zs[i]);
+        }
+        return;
+    }
+
+    jobs->parallelFor(count, kBuildGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            pointBuckets[i] = bucket(cellKey(xs[i], ys[i], zs[i]));
+            std::atomic_ref<uint32_t>(bucketStarts[pointBuckets[i] + 1]).fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    for (size_t b = 0; b < buckets; ++b) {
+        bucketStarts[b + 1] += bucketStarts[b];
+    }
+    std::vector<uint32_t> cursors(bucketStarts.begin(), bucketStarts.end() - 1);
+    jobs->parallelFor(count, kBuildGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            std::atomic_ref<uint32_t> cursor(cursors[pointBuckets[i]]);
+            uint32_t slot = cursor.fetch_add(1, std::memory_order_relaxed);
+            entries[slot] = static_cast<uint32_t>(i);
+        }
+    });
+    // Atomic slots scatter each bucket; sorting it restores index order, cheap at a point or two per bucket
+    jobs->parallelFor(buckets, kBuildGrain, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            std::sort(entries.begin() + bucketStarts[b], entries.begin() + bucketStarts[b + 1]);
+            for (uint32_t slot = bucketStarts[b]; slot < bucketStarts[b + 1]; ++slot) {
+                uint32_t i = entries[slot];
+                entryKeys[slot] = cellKey(xs[i], ys[i], zs[i]);
+            }
+        }
+    });
+}
+
+void SpatialHashGrid::collectPairs(size_t begin, size_t end, float radius, std::vector<ProximityPair>& out) const {
+    const float* xs = points->x.data();
+    const float* ys = points->y.data();
+    const float* zs = points->z.data();
+    const float radiusSquared = radius * radius;
+    for (size_t i = begin; i < end; ++i) {
+        float x = xs[i], y = ys[i], z = zs[i];
+        int64_t cx = static_cast<int64_t>(std::floor(x * inverseCell));
+        int64_t cy = static_cast<int64_t>(std::floor(y * inverseCell));
+        int64_t cz = static_cast<int64_t>(std::floor(z * inverseCell));
+        // The own cell, where only later points count, then the forward half of the neighbours
+        for (int n = -1; n < 13; ++n) {
+            uint64_t key = n < 0 ? cellKey(cx, cy, cz)
+                                 : cellKey(cx + kForward[n][0], cy + kForward[n][1], cz + kForward[n][2]);
+            uint32_t b = bucket(key);
+            for (uint32_t slot = bucketStarts[b]; slot < bucketStarts[b + 1]; ++slot) {
+                uint32_t j = entries[slot];
+                if (entryKeys[slot] != key || (n < 0 && j <= i)) {
+                    continue;
+                }
+                float ex = xs[j] - x, ey = ys[j] - y, ez = zs[j] - z;
+                if (ex * ex + ey * ey + ez * ez <= radiusSquared) {
+                    out.push_back({std::min(static_cast<uint32_t>(i), j), std::max(static_cast<uint32_t>(i), j)});
+                }
+            }
+        }
+    }
+}
+
+void SpatialHashGrid::findPairs(float radius, std::vector<ProximityPair>& out, JobSystem* jobs) const {
+    radius = std::min(radius, cell);
+    collectInOrder(count, kQueryGrain, jobs, out, [&](size_t begin, size_t end, std::vector<ProximityPair>& piece) {
+        collectPairs(begin, end, radius, piece);
+    });
+    std::sort(out.begin(), out.end(), [](const ProximityPair& a, const ProximityPair& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+}
+
+void SpatialHashGrid::collectContacts(const Aabb& box, uint32_t obstacle, float radius,
+                                      std::vector<ProximityPair>& out) const {
+    const float* xs = points->x.data();
+    const float* ys = points->y.data();
+    const float* zs = points->z.data();
+    const float radiusSquared = radius * radius;
+    auto cellOf = [this](float v) { return static_cast<int64_t>(std::floor(v * inverseCell)); };
+    int64_t x0 = cellOf(box.min.x - radius), x1 = cellOf(box.max.x + radius);
+    int64_t y0 = cellOf(box.min.y - radius), y1 = cellOf(box.max.y + radius);
+    int64_t z0 = cellOf(box.min.z - radius), z1 = cellOf(box.max.z + radius);
+    double cells = double(x1 - x0 + 1) * double(y1 - y0 + 1) * double(z1 - z0 + 1);
+    size_t first = out.size();
+    if (cells > static_cast<double>(count)) {
+        for (size_t i = 0; i < count; ++i) {
+            if (squaredDistanceToBox(box, xs[i], ys[i], zs[i]) <= radiusSquared) {
+                out.push_back({obstacle, static_cast<uint32_t>(i)});
+            }
+        }
+        return;
+    }
+    for (int64_t cz = z0; cz <= z1; ++cz) {
+        for (int64_t cy = y0; cy <= y1; ++cy) {
+            for (int64_t cx = x0; cx <= x1; ++cx) {
+                uint64_t key = cellKey(cx, cy, cz);
+                uint32_t b = bucket(key);
+                for (uint32_t slot = bucketStarts[b]; slot < bucketStarts[b + 1]; ++slot) {
+                    uint32_t i = entries[slot];
+                    if (entryKeys[slot] == key && squaredDistanceToBox(box, xs[i], ys[i], zs[i]) <= radiusSquared) {
+                        out.push_back({obstacle, i});
+                    }
+                }
+            }
+        }
+    }
+    std::sort(out.begin() + first, out.end(),
+              [](const ProximityPair& a, const ProximityPair& b) { return a.second < b.second; });
+}
+
+void SpatialHashGrid::findObstacleContacts(const std::vector<Aabb>& obstacles, float radius,
+                                           std::vector<ProximityPair>& out, JobSystem* jobs) const {
+    // Obstacles are few and uneven in size, so they go one per job
+    collectInOrder(obstacles.size(), 1, jobs, out, [&](size_t begin, size_t end, std::vector<ProximityPair>& piece) {
+        for (size_t o = begin; o < end; ++o) {
+            if (!obstacles[o].empty() && count > 0) {
+                collectContacts(obstacles[o], static_cast<uint32_t>(o), radius, piece);
+            }
+        }
+    });
+}
+
+void findPairsBruteForce(const SwarmVectors& points, size_t count, float radius, std::vector<ProximityPair>& out) {
+    out.clear();
+    const float radiusSquared = radius * radius;
+    for (size_t i = 0; i < count; ++i) {
+        float x = points.x[i], y = points.y[i], z = points.z[i];
+        for (size_t j = i + 1; j < count; ++j) {
+            float dx = points.x[j] - x, dy = points.y[j] - y, dz = points.z[j] - z;
+            if (dx * dx + dy * dy + dz * dz <= radiusSquared) {
+                out.push_back({static_cast<uint32_t>(i), static_cast<uint32_t>(j)});
+            }
+        }
+    }
+}
+
+void findObstacleContactsBruteForce(const SwarmVectors& points, size_t count, const std::vector<Aabb>& obstacles,
+                                    float radius, std::vector<ProximityPair>& out) {
+    out.clear();
+    for (size_t o = 0; o < obstacles.size(); ++o) {
+        if (obstacles[o].empty()) {
+            continue;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (squaredDistanceToBox(obstacles[o], points.x[i], points.y[i], points.z[i]) <= radius * radius) {
+                out.push_back({static_cast<uint32_t>(o), static_cast<uint32_t>(i)});
+            }
+        }
+    }
+}
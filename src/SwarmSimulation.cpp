@@ -0,0 +1,207 @@
+#include "SwarmSimulation.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Drones per job; a block of this many is a few pages of each array
+const size_t kStepGrain = 2048;
+const size_t kInstanceGrain = 1024;
+
+void resizeVectors(SwarmVectors& v, size_t count, size_t padded) {
+    for (std::vector<float>* axis : {&v.x, &v.y, &v.z}) {
+        axis->resize(padded, 0.0f);
+        std::fill(axis->begin() + count, axis->end(), 0.0f);
+    }
+}
+
+} // namespace
+
+void Swarm::resize(size_t newCount) {
+    count = newCount;
+    size_t padded = (count + kLanes - 1) / kLanes * kLanes;
+    resizeVectors(currentPositions, count, padded);
+    resizeVectors(previousPositions, count, padded);
+    resizeVectors(currentVelocities, count, padded);
+    resizeVectors(slots, count, padded);
+    for (int i = 0; i < 4; ++i) {
+        float rest = i == 3 ? 1.0f : 0.0f;
+        attitudes[i].resize(padded, rest);
+        std::fill(attitudes[i].begin() + count, attitudes[i].end(), rest);
+    }
+    for (std::vector<float>& speeds : rotorSpeeds) {
+        speeds.resize(padded, 0.0f);
+        std::fill(speeds.begin() + count, speeds.end(), 0.0f);
+    }
+}
+
+void Swarm::place(size_t index, const Vec3& position, const Vec3& slot) {
+    currentPositions.x[index] = previousPositions.x[index] = position.x;
+    currentPositions.y[index] = previousPositions.y[index] = position.y;
+    currentPositions.z[index] = previousPositions.z[index] = position.z;
+    currentVelocities.x[index] = currentVelocities.y[index] = currentVelocities.z[index] = 0.0f;
+    slots.x[index] = slot.x;
+    slots.y[index] = slot.y;
+    slots.z[index] = slot.z;
+    attitudes[0][index] = attitudes[1][index] = attitudes[2][index] = 0.0f;
+    attitudes[3][index] = 1.0f;
+    for (std::vector<float>& speeds : rotorSpeeds) {
+        speeds[index] = 0.0f;
+    }
+}
+
+Vec3 Swarm::position(size_t index) const {
+    return Vec3(currentPositions.x[index], currentPositions.y[index], currentPositions.z[index]);
+}
+
+Vec3 Swarm::velocity(size_t index) const {
+    return Vec3(currentVelocities.x[index], currentVelocities.y[index], currentVelocities.z[index]);
+}
+
+Quat Swarm::orientation(size_t index) const {
+    return Quat(attitudes[0][index], attitudes[1][index], attitudes[2][index], attitudes[3][index]);
+}
+
+void Swarm::step(float dt, const Vec3& formationCenter, const SwarmParameters& parameters, JobSystem* jobs) {
+    size_t padded = currentPositions.x.size();
+    if (!jobs) {
+        stepLanes(0, padded, dt, formationCenter, parameters);
+        return;
+    }
+    jobs->parallelFor(padded / kLanes, kStepGrain / kLanes, [&](size_t begin, size_t end) {
+        stepLanes(begin * kLanes, end * kLanes, dt, formationCenter, parameters);
+    });
+}
+
+// Every operation below is mirrored in the same order by stepScalar
+void Swarm::stepLanes(size_t begin, size_t end, float dt, const Vec3& center, const SwarmParameters& parameters) {
+    const Float4 zero = splat4(0.0f), one = splat4(1.0f), tiny = splat4(1e-6f);
+    const Float4 stiffness = splat4(parameters.stiffness), damping = splat4(parameters.damping);
+    const Float4 maxAcceleration = splat4(std::min(parameters.maxAcceleration, 0.9f * parameters.gravity));
+    const Float4 gravity = splat4(parameters.gravity), inverseGravity = splat4(1.0f / parameters.gravity);
+    const Float4 hoverRpm = splat4(parameters.hoverRpm), tiltPerG = splat4(parameters.tiltRpm / parameters.gravity);
+    const Float4 step = splat4(dt);
+    const Float4 cx = splat4(center.x), cy = splat4(center.y), cz = splat4(center.z);
+
+    for (size_t i = begin; i < end; i += kLanes) {
+        Float4 px = load4(&currentPositions.x[i]), py = load4(&currentPositions.y[i]);
+        Float4 pz = load4(&currentPositions.z[i]);
+        Float4 vx = load4(&currentVelocities.x[i]), vy = load4(&currentVelocities.y[i]);
+        Float4 vz = load4(&currentVelocities.z[i]);
+        store4(&previousPositions.x[i], px);
+        store4(&previousPositions.y[i], py);
+        store4(&previousPositions.z[i], pz);
+
+        // Damped spring towards the slot, clamped to the available acceleration
+        Float4 ax = sub4(mul4(stiffness, sub4(add4(cx, load4(&slots.x[i])), px)), mul4(damping, vx));
+        Float4 ay = sub4(mul4(stiffness, sub4(add4(cy, load4(&slots.y[i])), py)), mul4(damping, vy));
+        Float4 az = sub4(mul4(stiffness, sub4(add4(cz, load4(&slots.z[i])), pz)), mul4(damping, vz));
+        Float4 magnitude = sqrt4(madd4(ax, ax, madd4(ay, ay, mul4(az, az))));
+        Float4 scale = min4(one, div4(maxAcceleration, max4(magnitude, tiny)));
+        ax = mul4(ax, scale);
+        ay = mul4(ay, scale);
+        az = mul4(az, scale);
+
+        vx = madd4(ax, step, vx);
+        vy = madd4(ay, step, vy);
+        vz = madd4(az, step, vz);
+        store4(&currentVelocities.x[i], vx);
+        store4(&currentVelocities.y[i], vy);
+        store4(&currentVelocities.z[i], vz);
+        store4(&currentPositions.x[i], madd4(vx, step, px));
+        store4(&currentPositions.y[i], madd4(vy, step, py));
+        store4(&currentPositions.z[i], madd4(vz, step, pz));
+
+        // Thrust direction u, and the shortest arc from up to it: (uz, 0, -ux, 1 + uy) normalized
+        Float4 ty = add4(ay, gravity);
+        Float4 thrust = sqrt4(madd4(ax, ax, madd4(ty, ty, mul4(az, az))));
+        Float4 inverseThrust = div4(one, thrust);
+        Float4 ux = mul4(ax, inverseThrust), uz = mul4(az, inverseThrust);
+        Float4 w = add4(one, mul4(ty, inverseThrust));
+        Float4 inverseNorm = div4(one, sqrt4(madd4(w, w, madd4(ux, ux, mul4(uz, uz)))));
+        store4(&attitudes[0][i], mul4(uz, inverseNorm));
+        store4(&attitudes[1][i], zero);
+        store4(&attitudes[2][i], sub4(zero, mul4(ux, inverseNorm)));
+        store4(&attitudes[3][i], mul4(w, inverseNorm));
+
+        // Rotor speed goes with the square root of thrust; the rotors on the arms (+x, +z, -x, -z)
+        // facing away from the horizontal acceleration spin faster to tip the drone into it
+        Float4 collective = mul4(hoverRpm, sqrt4(mul4(thrust, inverseGravity)));
+        Float4 tiltX = mul4(ax, tiltPerG), tiltZ = mul4(az, tiltPerG);
+        store4(&rotorSpeeds[0][i], mul4(collective, sub4(one, tiltX)));
+        store4(&rotorSpeeds[1][i], mul4(collective, sub4(one, tiltZ)));
+        store4(&rotorSpeeds[2][i], mul4(collective, add4(one, tiltX)));
+        store4(&rotorSpeeds[3][i], mul4(collective, add4(one, tiltZ)));
+    }
+}
+
+void Swarm::stepScalar(float dt, const Vec3& center, const SwarmParameters& parameters) {
+    const float maxAcceleration = std::min(parameters.maxAcceleration, 0.9f * parameters.gravity);
+    const float inverseGravity = 1.0f / parameters.gravity, tiltPerG = parameters.tiltRpm / parameters.gravity;
+    for (size_t i = 0; i < currentPositions.x.size(); ++i) {
+        float px = currentPositions.x[i], py = currentPositions.y[i], pz = currentPositions.z[i];
+        float vx = currentVelocities.x[i], vy = currentVelocities.y[i], vz = currentVelocities.z[i];
+        previousPositions.x[i] = px;
+        previousPositions.y[i] = py;
+        previousPositions.z[i] = pz;
+
+        float ax = parameters.stiffness * ((center.x + slots.x[i]) - px) - parameters.damping * vx;
+        float ay = parameters.stiffness * ((center.y + slots.y[i]) - py) - parameters.damping * vy;
+        float az = parameters.stiffness * ((center.z + slots.z[i]) - pz) - parameters.damping * vz;
+        float magnitude = std::sqrt(ax * ax + (ay * ay + az * az));
+        float scale = std::min(1.0f, maxAcceleration / std::max(magnitude, 1e-6f));
+        ax *= scale;
+        ay *= scale;
+        az *= scale;
+
+        vx = ax * dt + vx;
+        vy = ay * dt + vy;
+        vz = az * dt + vz;
+        currentVelocities.x[i] = vx;
+        currentVelocities.y[i] = vy;
+        currentVelocities.z[i] = vz;
+        currentPositions.x[i] = vx * dt + px;
+        currentPositions.y[i] = vy * dt + py;
+        currentPositions.z[i] = vz * dt + pz;
+
+        float ty = ay + parameters.gravity;
+        float thrust = std::sqrt(ax * ax + (ty * ty + az * az));
+        float inverseThrust = 1.0f / thrust;
+        float ux = ax * inverseThrust, uz = az * inverseThrust;
+        float w = 1.0f + ty * inverseThrust;
+        float inverseNorm = 1.0f / std::sqrt(w * w + (ux * ux + uz * uz));
+        attitudes[0][i] = uz * inverseNorm;
+        attitudes[1][i] = 0.0f;
+        attitudes[2][i] = 0.0f - ux * inverseNorm;
+        attitudes[3][i] = w * inverseNorm;
+
+        float collective = parameters.hoverRpm * std::sqrt(thrust * inverseGravity);
+        float tiltX = ax * tiltPerG, tiltZ = az * tiltPerG;
+        rotorSpeeds[0][i] = collective * (1.0f - tiltX);
+        rotorSpeeds[1][i] = collective * (1.0f - tiltZ);
+        rotorSpeeds[2][i] = collective * (1.0f + tiltX);
+        rotorSpeeds[3][i] = collective * (1.0f + tiltZ);
+    }
+}
+
+void Swarm::writeInstances(std::vector<Mat4>& out, float alpha, const Mat4& model, float unitScale,
+                           JobSystem* jobs) const {
+    out.resize(count);
+    auto body = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Mat4 pose = makeRotation(orientation(i));
+            Vec3 from(previousPositions.x[i], previousPositions.y[i], previousPositions.z[i]);
+            Vec3 at = (from + (position(i) - from) * alpha) * unitScale;
+            pose.m[12] = at.x;
+            pose.m[13] = at.y;
+            pose.m[14] = at.z;
+            out[i] = pose * model;
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(count, kInstanceGrain, body);
+    } else {
+        body(0, count);
+    }
+}
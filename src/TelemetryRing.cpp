@@ -0,0 +1,195 @@
+#include "TelemetryRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint32_t kTelemetryRingMagic = 0x4d4c4554;  // "TELM"
+const uint32_t kTelemetryRingVersion = 1;
+
+} // namespace
+
+// Shared between the processes, followed by the samples
+struct TelemetryRing::Header {
+    std::atomic<uint32_t> magic;        // Stored last by the producer, once the rest is valid
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t sampleSize;
+    alignas(64) std::atomic<uint64_t> head;   // Producer: samples pushed
+    std::atomic<uint64_t> dropped;            // Producer: samples refused
+    alignas(64) std::atomic<uint64_t> tail;   // Consumer: samples popped
+    alignas(64) char samplesStart[1];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring needs address-free 64-bit atomics");
+
+uint64_t telemetryNowNs() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+TelemetryRing::~TelemetryRing() {
+    close();
+}
+
+bool TelemetryRing::map(const std::string& name, size_t size, bool creating) {
+#ifdef _WIN32
+    std::string mappingName = name.substr(name.find_first_not_of('/'));
+    HANDLE mapping = creating
+        ? CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size),
+                             mappingName.c_str())
+        : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName.c_str());
+    if (!mapping) {
+        if (creating) std::cerr << "Failed to create telemetry ring " << name << std::endl;
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, creating ? size : 0);
+    if (!data) {
+        CloseHandle(mapping);
+        std::cerr << "Failed to map telemetry ring " << name << std::endl;
+        return false;
+    }
+    if (!creating) {
+        MEMORY_BASIC_INFORMATION region;
+        size = VirtualQuery(data, &region, sizeof(region)) ? region.RegionSize : 0;
+    }
+    mappingHandle = mapping;
+#else
+    if (creating) {
+        shm_unlink(name.c_str());  // A ring left by a producer that crashed
+    }
+    int fd = shm_open(name.c_str(), creating ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+    if (fd < 0) {
+        if (creating || errno != ENOENT) {
+            std::cerr << "Failed to open telemetry ring " << name << ": " << std::strerror(errno) << std::endl;
+        }
+        return false;
+    }
+    struct stat info;
+    bool sized = creating ? ftruncate(fd, static_cast<off_t>(size)) == 0
+                          : fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(Header);
+    if (!creating && sized) {
+        size = static_cast<size_t>(info.st_size);
+    }
+    void* data = sized ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        // A producer that has created the name but not sized it yet; try again later
+        if (creating) {
+            std::cerr << "Failed to map telemetry ring " << name << std::endl;
+            shm_unlink(name.c_str());
+        }
+        return false;
+    }
+#endif
+    header = static_cast<Header*>(data);
+    mappingSize = size;
+    return true;
+}
+
+bool TelemetryRing::create(const std::string& name, uint32_t capacity) {
+    close();
+    uint32_t rounded = 1;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+    size_t size = offsetof(Header, samplesStart) + static_cast<size_t>(rounded) * sizeof(TelemetrySample);
+    if (!map(name, size, true)) {
+        return false;
+    }
+    ownedName = name;
+    header = new (header) Header();
+    header->version = kTelemetryRingVersion;
+    header->capacity = rounded;
+    header->sampleSize = sizeof(TelemetrySample);
+    header->head.store(0, std::memory_order_relaxed);
+    header->dropped.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    header->magic.store(kTelemetryRingMagic, std::memory_order_release);
+    samples = reinterpret_cast<TelemetrySample*>(header->samplesStart);
+    return true;
+}
+
+bool TelemetryRing::open(const std::string& name) {
+    close();
+    if (!map(name, sizeof(Header), false)) {
+        return false;
+    }
+    bool valid = header->magic.load(std::memory_order_acquire) == kTelemetryRingMagic &&
+                 header->version == kTelemetryRingVersion && header->sampleSize == sizeof(TelemetrySample) &&
+                 offsetof(Header, samplesStart) + static_cast<size_t>(header->capacity) * sizeof(TelemetrySample) <=
+                     mappingSize;
+    if (!valid) {
+        close();  // Not initialized yet, or another version
+        return false;
+    }
+    samples = reinterpret_cast<TelemetrySample*>(header->samplesStart);
+    return true;
+}
+
+void TelemetryRing::close() {
+    if (header) {
+#ifdef _WIN32
+        UnmapViewOfFile(header);
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        mappingHandle = nullptr;
+#else
+        munmap(header, mappingSize);
+        if (!ownedName.empty()) {
+            shm_unlink(ownedName.c_str());
+        }
+#endif
+    }
+    header = nullptr;
+    samples = nullptr;
+    mappingSize = 0;
+    ownedName.clear();
+}
+
+bool TelemetryRing::push(const TelemetrySample& sample) {
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    // Acquire: the consumer has finished copying the slot before it moved tail past it
+    if (head - header->tail.load(std::memory_order_acquire) >= header->capacity) {
+        header->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    samples[head & (header->capacity - 1)] = sample;
+    header->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+size_t TelemetryRing::pop(TelemetrySample* out, size_t maxCount) {
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    uint64_t available = header->head.load(std::memory_order_acquire) - tail;
+    size_t count = static_cast<size_t>(std::min<uint64_t>(available, maxCount));
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = samples[(tail + i) & (header->capacity - 1)];
+    }
+    header->tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+uint32_t TelemetryRing::capacity() const {
+    return header ? header->capacity : 0;
+}
+
+uint64_t TelemetryRing::pushed() const {
+    return header ? header->head.load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t TelemetryRing::dropped() const {
+    return header ? header->dropped.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,162 @@
+#include "TraceRecorder.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+const size_t kMaxEventsPerThread = 1u << 20;
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    char phase;          // 'X' complete, 'i' instant
+    uint64_t start;
+    uint64_t duration;
+};
+
+// The owning thread is the only writer; the mutex is only contended during export
+struct ThreadBuffer {
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    std::string name;
+    uint32_t tid = 0;
+    uint64_t dropped = 0;
+};
+
+std::atomic<bool> recording{false};
+std::atomic<uint32_t> nextTid{1};
+const uint64_t processStartNs = traceNowNs();
+
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;  // Shared so buffers outlive their threads
+
+ThreadBuffer& localBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+        created->tid = nextTid.fetch_add(1, std::memory_order_relaxed);
+        created->name = "thread " + std::to_string(created->tid);
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+void append(const TraceEvent& event) {
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() >= kMaxEventsPerThread) {
+        ++buffer.dropped;
+        return;
+    }
+    buffer.events.push_back(event);
+}
+
+void writeEscaped(std::ostream& out, const std::string& text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+}
+
+} // namespace
+
+uint64_t traceNowNs() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void traceStart() {
+    // A new recording starts from empty buffers
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& buffer : registry) {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            buffer->events.clear();
+            buffer->dropped = 0;
+        }
+    }
+    recording.store(true, std::memory_order_relaxed);
+}
+
+void traceStop() {
+    recording.store(false, std::memory_order_relaxed);
+}
+
+bool traceRecording() {
+    return recording.load(std::memory_order_relaxed);
+}
+
+void traceSetThreadName(const std::string& name) {
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.name = name;
+}
+
+void traceComplete(const char* name, const char* category, uint64_t startNs, uint64_t durationNs) {
+    if (traceRecording()) {
+        append({name, category, 'X', startNs, durationNs});
+    }
+}
+
+void traceInstant(const char* name, const char* category) {
+    if (traceRecording()) {
+        append({name, category, 'i', traceNowNs(), 0});
+    }
+}
+
+bool traceExport(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffers = registry;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Drone Viewer\"}}";
+
+    for (const auto& buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":\"";
+        writeEscaped(out, buffer->name);
+        out << "\"}}";
+
+        for (const TraceEvent& event : buffer->events) {
+            double ts = (static_cast<double>(event.start) - static_cast<double>(processStartNs)) / 1000.0;
+            out << ",\n{\"name\":\"";
+            writeEscaped(out, event.name);
+            out << "\",\"cat\":\"";
+            writeEscaped(out, event.category);
+            out << "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":" << ts;
+            if (event.phase == 'X') {
+                out << ",\"dur\":" << event.duration / 1000.0;
+            } else {
+                out << ",\"s\":\"t\"";
+            }
+            out << "}";
+        }
+        if (buffer->dropped) {
+            out << ",\n{\"name\":\"dropped " << buffer->dropped << " events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":"
+                << buffer->tid << ",\"ts\":0}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
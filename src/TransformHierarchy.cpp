@@ -0,0 +1,162 @@
+#include "TransformHierarchy.h"
+#include "SceneQueries.h"
+
+namespace {
+
+// translate(offset) * m without the full product
+Mat4 translated(const Mat4& m, const Vec3& offset) {
+    Mat4 r = m;
+    for (int col = 0; col < 4; ++col) {
+        float w = m.m[col * 4 + 3];
+        r.m[col * 4] += offset.x * w;
+        r.m[col * 4 + 1] += offset.y * w;
+        r.m[col * 4 + 2] += offset.z * w;
+    }
+    return r;
+}
+
+} // namespace
+
+void TransformHierarchy::clear() {
+    parents.clear();
+    subtreeEnds.clear();
+    objects.clear();
+    nodes.clear();
+    meshBegin.clear();
+    meshIds.clear();
+    locals.clear();
+    worlds.clear();
+    dirty.clear();
+    anyDirty = false;
+    meshOffsets.clear();
+    meshNodes.clear();
+    meshWorldMatrices.clear();
+    meshTransforms.clear();
+    meshTransformed.clear();
+    meshDirty.clear();
+    dirtyMeshes.clear();
+}
+
+void TransformHierarchy::append(const aiNode* node, int parent, int object) {
+    size_t index = parents.size();
+    parents.push_back(parent);
+    subtreeEnds.push_back(0);
+    objects.push_back(object);
+    nodes.push_back(node);
+    locals.push_back(toMat4(node->mTransformation));
+    meshBegin.push_back(static_cast<uint32_t>(meshIds.size()));
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+        unsigned int mesh = node->mMeshes[i];
+        meshIds.push_back(mesh);
+        if (mesh < meshNodes.size() && meshNodes[mesh] < 0) {
+            meshNodes[mesh] = static_cast<int>(index);
+        }
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+        append(node->mChildren[i], static_cast<int>(index), parent < 0 ? static_cast<int>(i) : object);
+    }
+    subtreeEnds[index] = static_cast<uint32_t>(parents.size());
+}
+
+void TransformHierarchy::build(const aiScene* scene) {
+    clear();
+    if (!scene || !scene->mRootNode) {
+        return;
+    }
+    meshOffsets.resize(scene->mNumMeshes);
+    meshNodes.assign(scene->mNumMeshes, -1);
+    meshWorldMatrices.resize(scene->mNumMeshes);
+    meshTransforms.assign(scene->mNumMeshes, Mat4());
+    meshTransformed.assign(scene->mNumMeshes, 0);
+    meshDirty.assign(scene->mNumMeshes, 0);
+    append(scene->mRootNode, -1, 0);
+    meshBegin.push_back(static_cast<uint32_t>(meshIds.size()));
+    worlds.resize(parents.size());
+    dirty.assign(parents.size(), 0);
+    markDirty(0);
+    update();
+}
+
+Mat4 TransformHierarchy::meshMatrix(const Mat4& world, unsigned int mesh) const {
+    Mat4 m = translated(world, meshOffsets[mesh]);
+    return meshTransformed[mesh] ? m * meshTransforms[mesh] : m;
+}
+
+Mat4 TransformHierarchy::instanceWorld(size_t index, unsigned int mesh) const {
+    if (meshNodes[mesh] == static_cast<int>(index)) {
+        return meshWorldMatrices[mesh];
+    }
+    return meshMatrix(worlds[index], mesh);
+}
+
+void TransformHierarchy::markDirty(size_t index) {
+    dirty[index] = 1;
+    anyDirty = true;
+}
+
+void TransformHierarchy::setLocal(size_t index, const Mat4& local) {
+    locals[index] = local;
+    markDirty(index);
+}
+
+void TransformHierarchy::setMeshOffset(unsigned int mesh, const Vec3& offset) {
+    Vec3& current = meshOffsets[mesh];
+    if (current.x == offset.x && current.y == offset.y && current.z == offset.z) {
+        return;
+    }
+    current = offset;
+    if (meshNodes[mesh] >= 0) {
+        markDirty(static_cast<size_t>(meshNodes[mesh]));
+    } else {
+        meshWorldMatrices[mesh] = meshMatrix(Mat4(), mesh);
+    }
+}
+
+void TransformHierarchy::setMeshTransform(unsigned int mesh, const Mat4& transform) {
+    meshTransforms[mesh] = transform;
+    meshTransformed[mesh] = 1;
+    if (meshNodes[mesh] < 0) {
+        meshWorldMatrices[mesh] = meshMatrix(Mat4(), mesh);
+    } else if (!meshDirty[mesh]) {
+        meshDirty[mesh] = 1;
+        dirtyMeshes.push_back(mesh);
+    }
+}
+
+size_t TransformHierarchy::update() {
+    size_t updated = 0;
+    size_t count = anyDirty ? parents.size() : 0;
+    for (size_t i = 0; i < count;) {
+        if (!dirty[i]) {
+            ++i;
+            continue;
+        }
+        // Parents precede children, so one pass over the subtree sees every parent updated
+        size_t end = subtreeEnds[i];
+        for (size_t j = i; j < end; ++j) {
+            if (parents[j] < 0) {
+                worlds[j] = locals[j];
+            } else {
+                worlds[j] = worlds[parents[j]] * locals[j];
+            }
+            dirty[j] = 0;
+            for (uint32_t k = meshBegin[j]; k < meshBegin[j + 1]; ++k) {
+                unsigned int mesh = meshIds[k];
+                if (mesh < meshNodes.size() && meshNodes[mesh] == static_cast<int>(j)) {
+                    meshWorldMatrices[mesh] = meshMatrix(worlds[j], mesh);
+                }
+            }
+        }
+        updated += end - i;
+        i = end;
+    }
+    anyDirty = false;
+
+    // Meshes whose own transform moved; any that were under a dirty node are already current
+    for (unsigned int mesh : dirtyMeshes) {
+        meshWorldMatrices[mesh] = meshMatrix(worlds[meshNodes[mesh]], mesh);
+        meshDirty[mesh] = 0;
+    }
+    dirtyMeshes.clear();
+    return updated;
+}
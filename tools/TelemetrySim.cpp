@@ -0,0 +1,161 @@
+// Stand-in for a drone telemetry link: streams poses into the shared-memory ring the viewer
+// reads with --telemetry. Poses come from a flight log (looped) or from a simulated circuit:
+// a climbing, banking orbit with rotor speeds that follow the manoeuvre.
+//
+//   TelemetrySim [--name /drone_telemetry] [--rate 250] [--seconds 0] [--capacity 1024]
+//                [--log flight.bin]
+//
+// --seconds 0 runs until interrupted. Once a second it prints the samples sent and dropped;
+// drops mean the viewer is not draining the ring (not running, or stalled).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "FlightLog.h"
+#include "TelemetryRing.h"
+
+namespace {
+
+std::atomic<bool> stopRequested{false};
+
+void requestStop(int) {
+    stopRequested.store(true);
+}
+
+struct SimOptions {
+    std::string name = kDefaultTelemetryRing;
+    double rate = 250.0;        // Samples per second
+    double seconds = 0.0;       // 0: until interrupted
+    uint32_t capacity = 1024;
+    std::string logPath;
+};
+
+bool parseArguments(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--name") options.name = value;
+        else if (arg == "--rate") options.rate = std::max(1.0, std::atof(value));
+        else if (arg == "--seconds") options.seconds = std::max(0.0, std::atof(value));
+        else if (arg == "--capacity") options.capacity = static_cast<uint32_t>(std::max(2, std::atoi(value)));
+        else if (arg == "--log") options.logPath = value;
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// A 20 m circuit flown once every 30 s, climbing and descending 3 m, banked into the turn
+void simulatePose(double t, TelemetrySample& sample) {
+    const double omega = 2.0 * M_PI / 30.0;
+    const float radius = 20.0f;
+    float angle = static_cast<float>(omega * t);
+    sample.position[0] = radius * std::cos(angle);
+    sample.position[1] = 5.0f + 3.0f * static_cast<float>(std::sin(0.4 * t));
+    sample.position[2] = radius * std::sin(angle);
+
+    // Heading along the velocity, rolled by the turn's centripetal acceleration
+    const float degrees = 180.0f / static_cast<float>(M_PI);
+    float heading = -angle * degrees - 90.0f;
+    float bank = std::atan(radius * static_cast<float>(omega * omega) / 9.81f) * degrees;
+    Quat attitude = makeQuat(heading, Vec3(0.0f, 1.0f, 0.0f)) * makeQuat(bank, Vec3(0.0f, 0.0f, 1.0f));
+    sample.attitude[0] = attitude.x;
+    sample.attitude[1] = attitude.y;
+    sample.attitude[2] = attitude.z;
+    sample.attitude[3] = attitude.w;
+
+    // More thrust while climbing; the outer pair works harder in the bank
+    float climb = static_cast<float>(std::cos(0.4 * t));
+    for (int r = 0; r < kTelemetryRotors; ++r) {
+        sample.rotorRpm[r] = 5200.0f + 400.0f * climb + (r < 2 ? 150.0f : -150.0f);
+    }
+}
+
+void logPose(const FlightLog& log, double t, size_t& cursor, TelemetrySample& sample) {
+    double duration = log.endTime() - log.startTime();
+    double time = log.startTime() + (duration > 0.0 ? std::fmod(t, duration) : 0.0);
+    FlightSample pose = log.sample(time, cursor);  // Falls back to the index search on a loop
+    sample.position[0] = pose.position.x;
+    sample.position[1] = pose.position.y;
+    sample.position[2] = pose.position.z;
+    sample.attitude[0] = pose.attitude.x;
+    sample.attitude[1] = pose.attitude.y;
+    sample.attitude[2] = pose.attitude.z;
+    sample.attitude[3] = pose.attitude.w;
+    for (int r = 0; r < kTelemetryRotors; ++r) {
+        sample.rotorRpm[r] = pose.rotorRpm[r % kFlightLogRotors];
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+    FlightLog log;
+    if (!options.logPath.empty() && (!log.open(options.logPath) || log.size() == 0)) {
+        return EXIT_FAILURE;
+    }
+    TelemetryRing ring;
+    if (!ring.create(options.name, options.capacity)) {
+        return EXIT_FAILURE;
+    }
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::printf("Streaming %s poses to %s at %.0f Hz (ring of %u)\n", log.isOpen() ? "logged" : "simulated",
+                options.name.c_str(), options.rate, ring.capacity());
+
+    using Clock = std::chrono::steady_clock;
+    const auto period =
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.rate));
+    const auto start = Clock::now();
+    auto next = start;
+    auto nextReport = start + std::chrono::seconds(1);
+    uint64_t sequence = 0, droppedBefore = 0, sentBefore = 0;
+    size_t cursor = 0;
+    while (!stopRequested.load()) {
+        std::this_thread::sleep_until(next);
+        next += period;
+        double t = std::chrono::duration<double>(Clock::now() - start).count();
+        if (options.seconds > 0.0 && t >= options.seconds) {
+            break;
+        }
+
+        TelemetrySample sample = {};
+        if (log.isOpen()) {
+            logPose(log, t, cursor, sample);
+        } else {
+            simulatePose(t, sample);
+        }
+        sample.sequence = sequence++;
+        sample.timestampNs = telemetryNowNs();
+        ring.push(sample);
+
+        if (Clock::now() >= nextReport) {
+            nextReport += std::chrono::seconds(1);
+            uint64_t sent = ring.pushed(), dropped = ring.dropped();
+            std::printf("t=%.0fs sent %llu dropped %llu\n", t, static_cast<unsigned long long>(sent - sentBefore),
+                        static_cast<unsigned long long>(dropped - droppedBefore));
+            std::fflush(stdout);
+            sentBefore = sent;
+            droppedBefore = dropped;
+        }
+    }
+    ring.close();
+    return EXIT_SUCCESS;
+}